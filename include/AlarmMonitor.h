@@ -0,0 +1,142 @@
+#ifndef ALARMMONITOR_H
+#define ALARMMONITOR_H
+
+#include <stdint.h>
+#include "SampleBuffer.h"
+
+// a threshold that isn't set, in the config and in AlarmThresholds
+#define ALARM_OFF (-32767 - 1)
+
+// how far a reading has to come back past the threshold before its alarm
+// clears, in hundredths. Without it a reading sitting on the threshold
+// would upload on every wake.
+#ifndef ALARM_TEMP_HYSTERESIS_CENTI
+#define ALARM_TEMP_HYSTERESIS_CENTI 50      // 0.5 C
+#endif
+#ifndef ALARM_HUMIDITY_HYSTERESIS_CENTI
+#define ALARM_HUMIDITY_HYSTERESIS_CENTI 200 // 2 %RH
+#endif
+
+// while an alarm is on the node reads at least this often
+#ifndef ALARM_INTERVAL_SECONDS
+#define ALARM_INTERVAL_SECONDS 60
+#endif
+
+enum AlarmBit : uint8_t {
+  ALARM_TEMP_HIGH = 1,
+  ALARM_TEMP_LOW = 2,
+  ALARM_HUMIDITY_HIGH = 4,
+  ALARM_HUMIDITY_LOW = 8
+};
+const uint8_t ALARM_KIND_COUNT = 4;
+
+// in hundredths like Sample, ALARM_OFF for the ones not watched
+struct AlarmThresholds {
+  int16_t tempHighCenti;
+  int16_t tempLowCenti;
+  int16_t humidityHighCenti;
+  int16_t humidityLowCenti;
+};
+
+/**
+ * @brief What the alarms remember between wakes, in RTC memory. The
+ * firmware copies the thresholds in from the config on every boot, the
+ * stub has no NVS. All zero is thresholds at 0 and nothing on, so the
+ * firmware sets them before the first reading is checked.
+ */
+struct AlarmState {
+  AlarmThresholds thresholds;
+  bool armed;               // thresholds were set at least once
+  uint8_t active;           // AlarmBits on now
+  uint8_t changed;          // came on or went off since the last upload, that upload is due now
+  int64_t changedWakeRawUs; // TimeKeeper::rawClockUs() at the start of the wake that saw the first of those
+  uint32_t lastLatencyMs;   // that wake to the server's answer, for the last alarm upload
+  bool latencyUnsent;       // lastLatencyMs hasn't been reported yet
+};
+
+// for the server, see ApiHandler
+struct AlarmReport {
+  uint8_t active;
+  uint8_t changed;          // 0 = not an alarm upload, just the state
+  uint32_t sinceWakeMs;     // the wake that saw the change to this request
+  uint32_t lastLatencyMs;   // the last alarm upload, wake to answer. 0 = none to report
+};
+
+// one threshold: on past it, off once back by the hysteresis
+static inline __attribute__((always_inline)) bool alarmOn(bool wasOn, int32_t value, int32_t limit, int32_t hysteresis, bool high) {
+  if (limit == ALARM_OFF) return false;
+  if (high) return wasOn ? value > limit - hysteresis : value > limit;
+  return wasOn ? value < limit + hysteresis : value < limit;
+}
+
+/**
+ * @brief Checks a reading against the thresholds. Runs in the wake stub
+ * too, so it is inline and only touches RTC memory.
+ *
+ * @param wakeRawUs raw clock at the start of this wake, for the latency.
+ * @return true if an alarm came on or went off, which has to go out now.
+ */
+static inline __attribute__((always_inline)) bool alarmCheck(AlarmState& state, const Sample& sample, int64_t wakeRawUs) {
+  if (!state.armed) return false;
+  const AlarmThresholds& limits = state.thresholds;
+  uint8_t on = 0;
+  if (alarmOn(state.active & ALARM_TEMP_HIGH, sample.temperatureCenti, limits.tempHighCenti, ALARM_TEMP_HYSTERESIS_CENTI, true)) on |= ALARM_TEMP_HIGH;
+  if (alarmOn(state.active & ALARM_TEMP_LOW, sample.temperatureCenti, limits.tempLowCenti, ALARM_TEMP_HYSTERESIS_CENTI, false)) on |= ALARM_TEMP_LOW;
+  if (alarmOn(state.active & ALARM_HUMIDITY_HIGH, sample.humidityCenti, limits.humidityHighCenti, ALARM_HUMIDITY_HYSTERESIS_CENTI, true)) on |= ALARM_HUMIDITY_HIGH;
+  if (alarmOn(state.active & ALARM_HUMIDITY_LOW, sample.humidityCenti, limits.humidityLowCenti, ALARM_HUMIDITY_HYSTERESIS_CENTI, false)) on |= ALARM_HUMIDITY_LOW;
+
+  uint8_t flipped = on ^ state.active;
+  if (flipped == 0) return false;
+  if (state.changed == 0) state.changedWakeRawUs = wakeRawUs;
+  state.active = on;
+  state.changed |= flipped;
+  return true;
+}
+
+// RTC memory, in main.cpp
+extern AlarmState alarmState;
+
+/**
+ * @brief Per-metric threshold alarms, the firmware's side. Pure C++,
+ * builds on the host.
+ *
+ * Every reading goes through alarmCheck(), in the stub or the firmware. A
+ * threshold crossed either way makes the next upload due right away
+ * (decideWake() boots for it, ConnectivityPolicy's backoff and Retry-After
+ * don't hold it back), and while an alarm is on the node reads every
+ * ALARM_INTERVAL_SECONDS.
+ */
+class AlarmMonitor {
+public:
+  AlarmMonitor(AlarmState& state);
+
+  // from the config, on every boot. Alarms on a threshold that went away are off.
+  void setThresholds(const AlarmThresholds& thresholds);
+
+  // see alarmCheck()
+  bool check(const Sample& sample, int64_t wakeRawUs);
+
+  // a change is waiting to go out
+  bool due() const { return _state.changed != 0; }
+
+  uint8_t active() const { return _state.active; }
+
+  /**
+   * @brief What the next upload says about the alarms.
+   * @return false if there's nothing on, nothing changed and no latency to report.
+   */
+  bool pendingReport(int64_t nowRawUs, AlarmReport& report) const;
+
+  // the server took it: the changes are out, and this was how long they took
+  void onUploaded(const AlarmReport& report, int64_t nowRawUs);
+
+  // "temperatureHigh" etc.
+  static const char* kindName(uint8_t bit);
+
+  const AlarmState& state() const { return _state; }
+
+private:
+  AlarmState& _state;
+};
+
+#endif // ALARMMONITOR_H
@@ -1,7 +1,39 @@
 #ifndef APIHANDLER_H
 #define APIHANDLER_H
 
+#include <HTTPClient.h>
 #include "ConfigManager.h"
+#include "OtaManager.h"
+#include "TimeKeeper.h"
+#include "SampleBuffer.h"
+#include "ConnectivityPolicy.h"
+#include "WakeStub.h"
+#include "TxPowerController.h"
+#include "NodeAuth.h"
+#include "EndpointSelector.h"
+#include "SleepPolicy.h"
+#include "AwakeBudget.h"
+#include "AlarmMonitor.h"
+
+// 1 = send readings to /ingest as a packed sample block (SampleCodec.h)
+// instead of JSON. The server has to understand it, see tools/sample_codec.py.
+#ifndef BINARY_INGEST
+#define BINARY_INGEST 0
+#endif
+
+/**
+ * @brief Things a telemetry send can carry besides the current reading.
+ * Anything left null is not sent.
+ */
+struct TelemetryExtras {
+  const SampleBuffer* backlog = nullptr;            // readings taken while offline
+  const ConnectivityReport* connectivity = nullptr; // failures since the last upload
+  const WakeReport* wakes = nullptr;                // stub and full boot wakes since the last upload
+  const TxPowerReport* radio = nullptr;             // TX power and RSSI this wake
+  const SleepReport* sleep = nullptr;               // deep sleep vs staying connected
+  const AwakeBudgetReport* budget = nullptr;        // wakes cut short since the last upload
+  const AlarmReport* alarm = nullptr;               // alarms on, and the ones that make this an alarm upload
+};
 
 /**
  * @brief Manages all HTTP communication with the backend server, including
@@ -12,12 +44,18 @@ public:
   /**
    * @brief Construct a new Api Handler object.
    * @param configManager A reference to the main ConfigManager instance.
+   * @param timeKeeper Synced from every server response, and used to timestamp telemetry.
+   * @param auth Signs the ingest bodies, only used with SIGNED_INGEST.
+   * @param endpoints Picks between serverUrl and the fallback URLs.
    */
-  ApiHandler(ConfigManager& configManager);
+  ApiHandler(ConfigManager& configManager, TimeKeeper& timeKeeper, NodeAuth& auth, EndpointSelector& endpoints);
 
   /**
    * @brief Checks if the device has a deviceId. If not, it attempts to register
-   * with the server to obtain one.
+   * with the server to obtain one. With SIGNED_INGEST it also needs the
+   * secret, so a node registered by an unsigned build registers again, and
+   * a node whose secret keeps being turned down asks for a new one for the
+   * same deviceId, signed with the old one.
    * 
    * @return true if the device is registered (or already was).
    * @return false if registration failed.
@@ -26,17 +64,113 @@ public:
 
   /**
    * @brief Sends telemetry data (temperature, humidity, battery) to the server.
+   * The firmware version goes along, and if the response advertises a newer
+   * one firmwareUpdateAvailable() becomes true. Once the clock is synced the
+   * data also carries a timestamp and its uncertainty. With BINARY_INGEST the
+   * readings go as a sample block behind a small JSON header. With
+   * SIGNED_INGEST the body carries a counter and goes out signed. With
+   * fallback URLs configured it also reports how each endpoint is doing.
    * 
    * @param temperature The temperature reading in Celsius.
    * @param humidity The humidity reading in percent.
    * @param battery The battery level in percent.
+   * @param extras Buffered readings and failure counts to send along.
    * @return true if the data was sent successfully.
    * @return false if sending failed.
    */
-  bool sendTelemetry(float temperature, float humidity, float battery);
+  bool sendTelemetry(float temperature, float humidity, float battery, const TelemetryExtras& extras = TelemetryExtras());
+
+  /**
+   * @brief Checks that something answers at the configured server URL. Used
+   * right after setup to tell the user if the URL is wrong.
+   *
+   * @return true if the server sent any HTTP response.
+   */
+  bool checkServerReachable();
+
+  /**
+   * @brief true if the last ingest response offered a different firmware.
+   */
+  bool firmwareUpdateAvailable() const;
+
+  /**
+   * @brief The update the server offered, valid when firmwareUpdateAvailable().
+   */
+  const FirmwareUpdate& firmwareUpdate() const;
+
+  /**
+   * @brief Retry-After (in seconds) from the last response, 0 if there was none.
+   */
+  uint32_t retryAfterSeconds() const;
+
+  /**
+   * @brief The server URL that answered last, serverUrl if none did yet.
+   * Relative firmware URLs are relative to this one.
+   */
+  const char* activeServerUrl() const;
+
+  /**
+   * @brief While true, telemetry goes over one connection that stays open
+   * from one send to the next (HTTP keep-alive, and the TLS session with
+   * it), for a node that stays associated in between (SleepPolicy.h).
+   * false closes it.
+   */
+  void keepConnection(bool keep);
+
+  /**
+   * @brief true if the last telemetry send went over the kept connection
+   * instead of opening one.
+   */
+  bool connectionReused() const;
 
 private:
   ConfigManager& _configManager;
+  TimeKeeper& _timeKeeper;
+  NodeAuth& _auth;
+  EndpointSelector& _endpoints;
+  const char* _activeServerUrl;
+  FirmwareUpdate _firmwareUpdate;
+  bool _updateAvailable;
+  uint32_t _retryAfterSeconds;
+  HTTPClient _keptHttp;       // the connection keepConnection() keeps
+  const char* _keptUrl;       // the endpoint it goes to, nullptr if none
+  bool _keepConnection;
+  bool _connectionReused;
+
+  // drops the kept connection, the next send opens a new one
+  void closeKeptConnection();
+
+  /**
+   * @brief POSTs to path on the best endpoint, and on to the next ones as
+   * long as they fail (no answer in time, or a 5xx). http is left open with
+   * the last response for the caller to read and end(). If http is the kept
+   * connection it's used as long as it goes to the endpoint tried.
+   * @return the HTTP code of the last try, or the HTTPC_ERROR_* it failed with.
+   */
+  int postWithFailover(HTTPClient& http, const char* path, uint8_t* body, size_t length, const char* contentType,
+                       const String& authorization, int64_t& requestRawUs, int64_t& responseRawUs);
+
+  // begin() and the headers for one try of postWithFailover().
+  void beginPost(HTTPClient& http, const String& url, const EndpointTimeouts& timeouts, const char* contentType,
+                 const String& authorization);
+
+  // "HMAC-SHA256 <deviceId>:<tag>" for the Authorization header.
+  bool signBody(const uint8_t* body, size_t length, String& authorization);
+
+  // POSTs a finished body to /ingest and reads the response.
+  bool postIngest(uint8_t* body, size_t length, const char* contentType);
+
+  // JSON header + sample block with the backlog and the current reading, malloc'd.
+  uint8_t* buildBinaryIngest(const String& header, const SampleBuffer* backlog, const Sample& current, size_t& length);
+
+  // Looks for a firmware advert and the server time in an ingest response.
+  void parseIngestResponse(const String& payload, int64_t requestRawUs, int64_t responseRawUs);
+
+  // 401 counts towards a re-key, 409 moves the auth counter past the server's.
+  void handleAuthRejection(int httpCode, const String& payload);
+
+  // Syncs the clock from the Date header of a finished request and picks up Retry-After.
+  void readResponseHeaders(HTTPClient& http, int64_t requestRawUs, int64_t responseRawUs);
 };
 
 #endif // APIHANDLER_H
@@ -0,0 +1,148 @@
+#ifndef AWAKEBUDGET_H
+#define AWAKEBUDGET_H
+
+#include <stdint.h>
+
+// how long a wake may take in all, by what woke it. A timer wake is normally
+// 2 to 7 s, the worst that still makes sense is a 15 s connect plus an ingest
+// through all the fallbacks and the result screen.
+#ifndef AWAKE_BUDGET_TIMER_MS
+#define AWAKE_BUDGET_TIMER_MS 60000
+#endif
+#ifndef AWAKE_BUDGET_BUTTON_MS
+#define AWAKE_BUDGET_BUTTON_MS 90000 // the info screen, and maybe a send after it
+#endif
+#ifndef AWAKE_BUDGET_BOOT_MS
+#define AWAKE_BUDGET_BOOT_MS 90000   // power on, the first connect and registration
+#endif
+
+// and the slices for the steps that block
+#ifndef BUDGET_CONNECT_MS
+#define BUDGET_CONNECT_MS 20000  // connectToWiFi(), the probe and the 15 s timeout
+#endif
+#ifndef BUDGET_REQUEST_MS
+#define BUDGET_REQUEST_MS 30000  // one registration or ingest, fallbacks included
+#endif
+#ifndef BUDGET_SENSOR_MS
+#define BUDGET_SENSOR_MS 2000    // the AHT answers in ~80 ms, more is a stuck I2C bus
+#endif
+#ifndef BUDGET_PORTAL_MS
+#define BUDGET_PORTAL_MS 600000  // a setup session (portal or USB provisioning)
+#endif
+#ifndef BUDGET_UPDATE_MS
+#define BUDGET_UPDATE_MS 180000  // downloading and applying a firmware update
+#endif
+
+enum BudgetWakeReason : uint8_t {
+  BUDGET_WAKE_TIMER = 0, // also each cycle after a connected idle
+  BUDGET_WAKE_BUTTON,
+  BUDGET_WAKE_BOOT,
+  BUDGET_WAKE_REASON_COUNT
+};
+
+enum BudgetStep : uint8_t {
+  BUDGET_STEP_NONE = 0, // between steps, only the wake's budget
+  BUDGET_STEP_CONNECT,
+  BUDGET_STEP_REQUEST,
+  BUDGET_STEP_SENSOR,
+  BUDGET_STEP_PORTAL,
+  BUDGET_STEP_UPDATE,
+  BUDGET_STEP_COUNT
+};
+
+/**
+ * @brief Overruns since the last report. Meant to live in RTC memory, the
+ * wake that overran doesn't get to upload. All zero is none.
+ */
+struct AwakeBudgetState {
+  uint16_t overruns[BUDGET_STEP_COUNT]; // by the step that ran out, [BUDGET_STEP_NONE] is the wake's budget
+  uint8_t lastStep;                     // BudgetStep
+  uint8_t lastReason;                   // BudgetWakeReason
+  uint32_t lastAwakeMs;                 // when it was cut short
+};
+
+// the overruns for the server, see ApiHandler
+struct AwakeBudgetReport {
+  uint16_t overruns[BUDGET_STEP_COUNT];
+  uint8_t lastStep;
+  uint8_t lastReason;
+  uint32_t lastAwakeMs;
+};
+
+/**
+ * @brief Bounds how long a wake can keep the node at full power. Pure C++,
+ * builds on the host, the timer that enforces it is PowerManager's.
+ *
+ * A wake gets AWAKE_BUDGET_*_MS by what woke it, and every step that can
+ * block (connect, request, sensor, portal, update) gets its own slice
+ * within that. deadlineMs() is whichever runs out first; when the timer
+ * set for it fires the firmware is stuck somewhere, so it calls
+ * onOverrun() and goes to deep sleep from the timer task.
+ *
+ * Steps can nest (a server check during the portal), the inner one ends
+ * first. The portal and the update are sessions somebody asked for: while
+ * one runs only its own slice counts, and the wake's budget starts over
+ * when it ends.
+ */
+class AwakeBudget {
+public:
+  static const uint8_t MAX_DEPTH = 3;
+
+  AwakeBudget(AwakeBudgetState& state);
+
+  // a wake (or a cycle after a connected idle) starts now
+  void beginWake(BudgetWakeReason reason, uint32_t nowMs);
+
+  void beginStep(BudgetStep step, uint32_t nowMs);
+
+  // the innermost step is done
+  void endStep(uint32_t nowMs);
+
+  // when the first limit runs out, on the millis() clock
+  uint32_t deadlineMs() const;
+
+  // what's left until deadlineMs(), 0 if it's past
+  uint32_t msLeft(uint32_t nowMs) const;
+
+  /**
+   * @brief The deadline passed: notes which limit it was and when.
+   * @return the step that ran out, BUDGET_STEP_NONE for the wake's budget.
+   */
+  BudgetStep onOverrun(uint32_t nowMs);
+
+  /**
+   * @brief The overruns since the last report.
+   * @return false if there weren't any.
+   */
+  bool pendingReport(AwakeBudgetReport& report) const;
+
+  // the report went out, take what it had off the counts
+  void onReported(const AwakeBudgetReport& report);
+
+  static uint32_t budgetMs(BudgetWakeReason reason);
+  static uint32_t sliceMs(BudgetStep step);
+
+  // "connect" etc., "wake" for the wake's own budget
+  static const char* stepName(uint8_t step);
+  static const char* reasonName(uint8_t reason);
+
+  const AwakeBudgetState& state() const { return _state; }
+
+private:
+  struct Running {
+    BudgetStep step;
+    uint32_t deadlineMs;
+  };
+
+  AwakeBudgetState& _state;
+  BudgetWakeReason _reason = BUDGET_WAKE_BOOT;
+  uint32_t _wakeStartMs = 0;
+  uint32_t _wakeDeadlineMs = 0;
+  Running _steps[MAX_DEPTH] = {};
+  uint8_t _depth = 0;
+
+  bool inSession() const;
+  static bool isSession(BudgetStep step);
+};
+
+#endif // AWAKEBUDGET_H
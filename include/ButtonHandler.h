@@ -1,7 +1,11 @@
 #ifndef BUTTONHANDLER_H
 #define BUTTONHANDLER_H
 
+#include "Features.h"
+
+#if HAS_BUTTON
 #include <OneButton.h>
+#endif
 
 /**
  * @brief Enum to for dif button states
@@ -37,6 +41,7 @@ enum ButtonEvent {
  *    ButtonEvent event = myButton.getEvent();
  *    if (event != EV_NONE) { ... process event ... }
  */
+#if HAS_BUTTON
 class ButtonHandler {
 public:
   /**
@@ -82,4 +87,17 @@ private:
   static void handleLongPress();
 };
 
+#else
+
+// no button fitted: never reports an event
+class ButtonHandler {
+public:
+  ButtonHandler(int pin) {}
+  void begin() {}
+  void tick() {}
+  ButtonEvent getEvent() { return EV_NONE; }
+};
+
+#endif // HAS_BUTTON
+
 #endif // BUTTONHANDLER_H
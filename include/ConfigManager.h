@@ -3,6 +3,12 @@
 
 #include <Arduino.h>
 
+// server URLs tried when serverUrl doesn't answer, see EndpointSelector
+#define FALLBACK_URL_COUNT 2
+
+// an alarm threshold that isn't set
+#define CONFIG_NO_THRESHOLD (-32767 - 1)
+
 //truct to hold all the device's configuration data.
 struct DeviceConfig {
   // WiFi creds
@@ -11,7 +17,10 @@ struct DeviceConfig {
 
   // Server Details
   char serverUrl[256];
+  char fallbackUrls[FALLBACK_URL_COUNT][256]; // same backend, another way in. Empty = none
   char deviceId[33]; // server gives us this
+  char authSecret[65]; // and this, in hex, with SIGNED_INGEST (see NodeAuth)
+  uint32_t authCounterLease;
 
   // Device Details
   char deviceName[33];
@@ -20,6 +29,12 @@ struct DeviceConfig {
 
   // Other params
   int sleepIntervalSeconds;
+  int txPowerMinDbm; // WiFi TX power limits, 0 = no limit (see TxPowerController)
+  int txPowerMaxDbm;
+  int alarmTempHighCenti; // alarm thresholds in hundredths, CONFIG_NO_THRESHOLD = not watched (see AlarmMonitor)
+  int alarmTempLowCenti;
+  int alarmHumidityHighCenti;
+  int alarmHumidityLowCenti;
   bool configured; // check if the device has been set up
 };
 
@@ -36,8 +51,9 @@ public:
   // Loads the configuration from NVS into the  config object.
   void loadConfig();
 
-  // Saves the current  config object to NV mem.
-  void saveConfig();
+  // Saves the current  config object to NV mem, "configured" last.
+  // returns false if NVS couldn't be written.
+  bool saveConfig();
 
   // Clears all configuration from NV mem and resets the  config object.
   void clearConfig();
@@ -48,11 +64,23 @@ public:
   // Allows changing  the configuration before saving.
   DeviceConfig& getMutableConfig();
 
+  // Swaps in a whole new configuration (not saved yet). The deviceId and
+  // secret belong to the old server, if serverUrl changed they are dropped
+  // so the node registers with the new one.
+  void replaceConfig(const DeviceConfig& newConfig);
+
   // check to see if the device has been configured.
   bool isConfigured();
 
+  // An alarm threshold as the portal and provisioning frames send it, in C
+  // or %RH, to hundredths for DeviceConfig. Clamped to what fits, and
+  // nullptr, blank or not a number is CONFIG_NO_THRESHOLD.
+  static int thresholdCenti(const char* text);
+
 private:
   DeviceConfig _config;
+
+  void setDefaults();
 };
 
 #endif // CONFIGMANAGER_H
@@ -0,0 +1,119 @@
+#ifndef CONNECTIVITYPOLICY_H
+#define CONNECTIVITYPOLICY_H
+
+#include <stdint.h>
+
+/**
+ * @brief What the policy remembers between wakes. Meant to live in RTC
+ * memory, all zero is a fresh start.
+ */
+struct ConnectivityState {
+  // the AP we last got through on, so we can look for it on one channel
+  bool apKnown;
+  uint8_t bssid[6];
+  uint8_t channel;
+
+  // wakes in a row that ended without an upload, and how many more wakes
+  // to just sample before trying again
+  uint8_t consecutiveFailures;
+  uint8_t wakesToSkip;
+
+  // accounting since the last successful upload, reported with it
+  uint16_t wifiFailures;
+  uint16_t uploadFailures;
+  uint16_t skippedUploads;
+  uint16_t probeMisses;
+  uint32_t firstFailureRawSeconds;
+};
+
+/**
+ * @brief Failures since the last successful upload, for the server.
+ */
+struct ConnectivityReport {
+  uint16_t wifiFailures;    // WiFi connects that timed out
+  uint16_t uploadFailures;  // connected, but registration/ingest failed
+  uint16_t skippedUploads;  // wakes that only sampled because of the backoff
+  uint16_t probeMisses;     // known AP not seen on its channel
+  uint32_t offlineSeconds;  // first failure to now
+};
+
+/**
+ * @brief Decides how hard a wake tries to get online, based on how the last
+ * wakes went. Pure C++, builds on the host.
+ *
+ * - Once we know which AP we connect through, a failing node first does a
+ *   ~100 ms scan of that one channel on every wake and connects as soon as
+ *   the AP is back.
+ * - Full connects (no probe, or the probe missed) back off exponentially
+ *   after repeated failures: the node still wakes and samples every interval
+ *   but only tries every 2nd, 4th, 8th, 16th wake. The one that is due still
+ *   goes ahead after a probe miss, in case the AP moved to another channel.
+ * - The connect timeout shrinks with each failure.
+ * - One successful upload puts everything back to normal, and the failures
+ *   up to then are reported with it.
+ */
+class ConnectivityPolicy {
+public:
+  // longest backoff, in wakes
+  static const uint8_t MAX_WAKES_TO_SKIP = 15;
+
+  // connect timeouts, normal and after the first and the following failures
+  static const uint32_t CONNECT_TIMEOUT_MS = 15000;
+  static const uint32_t RETRY_CONNECT_TIMEOUT_MS = 8000;
+  static const uint32_t MIN_CONNECT_TIMEOUT_MS = 4000;
+
+  // how long to show the result on the OLED before sleeping
+  static const uint32_t RESULT_DISPLAY_MS = 5000;
+  static const uint32_t FAILING_RESULT_DISPLAY_MS = 1000;
+
+  ConnectivityPolicy(ConnectivityState& state);
+
+  // true if a full connect is due, false if we are backing off
+  bool uploadDue() const;
+
+  // this wake only sampled, no probe and no connect
+  void onUploadSkipped();
+
+  // how long connectToWiFi() waits for an IP
+  uint32_t connectTimeoutMs() const;
+
+  // true if we should scan the known channel before connecting
+  bool shouldProbe() const;
+
+  /**
+   * @brief The probe didn't see the AP.
+   * @return true if a full connect is due anyway, false to end the wake
+   * without connecting (counts as a skipped wake for the backoff).
+   */
+  bool onProbeMiss();
+
+  // WiFi didn't come up
+  void onWiFiFailure(uint32_t rawSeconds);
+
+  // WiFi came up, remember the AP for the next probe
+  void onWiFiConnected(const uint8_t bssid[6], uint8_t channel);
+
+  // registration or ingest failed
+  void onUploadFailure(uint32_t rawSeconds);
+
+  /**
+   * @brief Fills in the failures since the last successful upload.
+   * @return false if there weren't any, nothing to report.
+   */
+  bool pendingReport(uint32_t rawSeconds, ConnectivityReport& report) const;
+
+  // upload went through, back to normal
+  void onUploadSuccess();
+
+  // how long to show "Sent!" / "WiFi Failed" on the OLED
+  uint32_t resultDisplayMs() const;
+
+  const ConnectivityState& state() const { return _state; }
+
+private:
+  ConnectivityState& _state;
+
+  void onFailure(uint32_t rawSeconds);
+};
+
+#endif // CONNECTIVITYPOLICY_H
@@ -0,0 +1,99 @@
+#ifndef DELTAPATCH_H
+#define DELTAPATCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Where DeltaPatcher reads the old image from and writes the new one to.
+ */
+class DeltaPatchIO {
+public:
+  virtual ~DeltaPatchIO() {}
+
+  // The patch says which image it was made against. Return false to refuse it.
+  virtual bool checkBase(const uint8_t sha256[32]) = 0;
+
+  // Reads length bytes of the running image starting at offset.
+  virtual bool readBase(uint32_t offset, uint8_t* buffer, size_t length) = 0;
+
+  // Appends bytes to the new image.
+  virtual bool writeOutput(const uint8_t* data, size_t length) = 0;
+};
+
+/**
+ * @brief Applies an (already decompressed) binary patch as it streams in, so
+ * neither the patch nor the new image ever has to be in RAM. No Arduino
+ * dependencies, it builds on the host as well.
+ *
+ * Patch format, all integers little endian (made by tools/make_delta.py):
+ *
+ *    header  "NDP1" | u32 new image size | 32 byte sha256 of the base image
+ *    0x01    COPY  u32 base offset, u32 length        copy from the old image
+ *    0x02    DATA  u32 length, bytes                  literal bytes
+ *    0x03    ADD   u32 base offset, u32 length, bytes old byte + delta byte
+ *    0x00    END
+ *
+ * ADD is the bsdiff trick: code that moved keeps most bytes but has changed
+ * addresses in it, so the deltas are mostly zero and compress very well.
+ */
+class DeltaPatcher {
+public:
+  enum Status {
+    PATCH_IN_PROGRESS,
+    PATCH_DONE,
+    PATCH_ERROR
+  };
+
+  DeltaPatcher(DeltaPatchIO& io);
+
+  // Feeds the next piece of the patch stream.
+  Status feed(const uint8_t* data, size_t length);
+
+  Status status() const;
+
+  // Size of the new image from the header (0 until the header arrived).
+  uint32_t outputSize() const;
+
+  // Bytes of the new image written so far.
+  uint32_t outputWritten() const;
+
+  // Short description of what went wrong, for logs.
+  const char* error() const;
+
+private:
+  enum State {
+    ST_HEADER,
+    ST_OPCODE,
+    ST_ARGS,
+    ST_DATA,
+    ST_ADD,
+    ST_END
+  };
+
+  static const size_t HEADER_SIZE = 4 + 4 + 32;
+  static const size_t COPY_CHUNK = 512;
+
+  DeltaPatchIO& _io;
+  State _state;
+  Status _status;
+  const char* _error;
+
+  uint8_t _scratch[HEADER_SIZE]; // header / op arguments being collected
+  size_t _scratchLength;
+  size_t _scratchNeeded;
+
+  uint8_t _opcode;
+  uint32_t _baseOffset;
+  uint32_t _remaining;
+  uint32_t _outputSize;
+  uint32_t _outputWritten;
+
+  Status fail(const char* why);
+  bool collect(const uint8_t*& data, size_t& length);
+  bool startOp();
+  bool copyFromBase(uint32_t offset, uint32_t length);
+  bool write(const uint8_t* data, size_t length);
+};
+
+#endif // DELTAPATCH_H
@@ -0,0 +1,82 @@
+#ifndef DRIFTESTIMATOR_H
+#define DRIFTESTIMATOR_H
+
+#include <stdint.h>
+
+/**
+ * @brief Everything the estimator needs to remember. Meant to live in RTC
+ * memory so it survives deep sleep.
+ */
+struct DriftState {
+  bool synced;
+
+  // latest time reference: true epoch time at a raw clock reading
+  int64_t anchorEpochMs;
+  int64_t anchorRawUs;
+  uint32_t anchorUncertaintyMs;
+
+  // older reference we measure the drift against
+  int64_t learnEpochMs;
+  int64_t learnRawUs;
+  uint32_t learnUncertaintyMs;
+
+  // true elapsed time / raw elapsed time, and how sure we are of it
+  double ratio;
+  double ratioUncertainty;
+  uint32_t drifts; // number of drift measurements so far
+};
+
+/**
+ * @brief Turns a drifting raw clock into epoch time, learning the drift from
+ * occasional time syncs. Pure C++, builds on the host.
+ *
+ * The raw clock is the RTC based system time, which keeps counting in deep
+ * sleep but is off by up to a few percent. Every sync gives us true time at
+ * some raw reading. Two syncs far enough apart give the ratio between true
+ * and raw elapsed time, which is filtered (1D Kalman) so bad samples don't
+ * throw it off, and used to correct later readings.
+ *
+ * Every time comes with an uncertainty: the uncertainty of the sync it is
+ * based on plus the remaining drift uncertainty times the time since.
+ */
+class DriftEstimator {
+public:
+  // before we measured anything: "percent level"
+  static constexpr double INITIAL_RATIO_UNCERTAINTY = 0.02;
+
+  // raw time needed between two syncs before we trust a drift measurement,
+  // with second resolution syncs 10 minutes is ~0.2%
+  static const int64_t MIN_LEARN_US = 10LL * 60 * 1000000;
+
+  DriftEstimator(DriftState& state);
+
+  // Forgets everything (e.g. the raw clock was reset).
+  void reset();
+
+  /**
+   * @brief Feeds a time sync.
+   *
+   * @param epochMs True time in ms since 1970.
+   * @param uncertaintyMs How far off epochMs could be.
+   * @param rawUs Raw clock reading at that moment.
+   */
+  void sync(int64_t epochMs, uint32_t uncertaintyMs, int64_t rawUs);
+
+  bool isSynced() const;
+
+  // Epoch time in ms for a raw clock reading. Only valid when synced.
+  int64_t epochMs(int64_t rawUs) const;
+
+  // How far off epochMs(rawUs) could be.
+  uint32_t uncertaintyMs(int64_t rawUs) const;
+
+  double ratio() const;
+  double ratioUncertainty() const;
+
+private:
+  DriftState& _state;
+
+  void learnDrift(int64_t epochMs, uint32_t uncertaintyMs, int64_t rawUs);
+};
+
+#endif // DRIFTESTIMATOR_H
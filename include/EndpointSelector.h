@@ -0,0 +1,151 @@
+#ifndef ENDPOINTSELECTOR_H
+#define ENDPOINTSELECTOR_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// where a request to an endpoint went wrong
+enum EndpointPhase : uint8_t {
+  ENDPOINT_OK = 0,
+  ENDPOINT_FAIL_DNS,      // the host didn't resolve
+  ENDPOINT_FAIL_CONNECT,  // refused, or no connection within the connect timeout
+  ENDPOINT_FAIL_RESPONSE, // connected, but no (complete) answer within the first byte timeout
+  ENDPOINT_FAIL_SERVER    // it answered with a 5xx
+};
+
+/**
+ * @brief How one endpoint has been doing.
+ */
+struct EndpointStats {
+  uint16_t avgMs;              // smoothed request time when it answers, 0 = never measured
+  uint16_t dnsMs;              // last lookup
+  uint8_t consecutiveFailures;
+  uint8_t lastFailure;         // EndpointPhase
+  uint32_t retryAtSeconds;     // raw clock, cooling off until then after failures
+  uint16_t successes;          // since the last report
+  uint16_t failures;           // since the last report
+};
+
+/**
+ * @brief What the selector remembers between wakes. Meant to live in RTC
+ * memory, all zero is a fresh start.
+ */
+struct EndpointState {
+  static const uint8_t MAX_ENDPOINTS = 3; // serverUrl and FALLBACK_URL_COUNT fallbacks
+
+  uint32_t urlsHash; // the stats start over when the URLs change
+  uint8_t count;
+  uint16_t failovers; // requests a fallback answered, since the last report
+  EndpointStats stats[MAX_ENDPOINTS];
+};
+
+// the endpoints for the server, see ApiHandler
+struct EndpointReport {
+  uint8_t count;
+  uint16_t failovers;
+  EndpointStats stats[EndpointState::MAX_ENDPOINTS];
+};
+
+// limits for one try: the lookup, then what HTTPClient's setConnectTimeout() / setTimeout() get
+struct EndpointTimeouts {
+  uint16_t dnsMs;
+  uint16_t connectMs;
+  uint16_t firstByteMs;
+};
+
+/**
+ * @brief Picks which server URL a request goes to first, and how long each
+ * try may take. Pure C++, builds on the host.
+ *
+ * All URLs have to lead to the same backend (a second front door, a standby
+ * in another building), the deviceId and the signing secret are the same
+ * everywhere.
+ *
+ * - Config order, primary first, except that an endpoint that answered
+ *   before moves ahead of another one that answered if it is faster by
+ *   more than PREFER_EARLIER_MS (so the order doesn't flap on noise).
+ * - An endpoint that failed cools off, 60 s doubling up to an hour, and is
+ *   tried last until then. After that it gets one try in its old place,
+ *   so a primary that comes back gets used again.
+ * - Every try but the last gets tight timeouts on the lookup, the connect
+ *   and the first byte, so a dead or slow primary costs ~1.5 s instead of
+ *   ten (or 15 s for a name nobody answers for). The last one gets HTTPClient's usual 5 s
+ *   each, a slow server is still better than none. With only one URL
+ *   that's the only try, so nothing changes.
+ */
+class EndpointSelector {
+public:
+  static const uint8_t MAX_ENDPOINTS = EndpointState::MAX_ENDPOINTS;
+
+  // a cached name resolves right away, a DNS server that answers at all within ~100 ms
+  static const uint16_t FAST_DNS_TIMEOUT_MS = 1000;
+  static const uint16_t FAST_CONNECT_TIMEOUT_MS = 1500;
+  // first byte: 3x the endpoint's usual time, within these
+  static const uint16_t FAST_MIN_FIRST_BYTE_MS = 1000;
+  static const uint16_t FAST_MAX_FIRST_BYTE_MS = 4000;
+  static const uint16_t LAST_TRY_TIMEOUT_MS = 5000;
+
+  static const uint16_t PREFER_EARLIER_MS = 50;
+  static const uint32_t COOLDOWN_SECONDS = 60;
+  static const uint32_t MAX_COOLDOWN_SECONDS = 3600;
+
+  EndpointSelector(EndpointState& state);
+
+  /**
+   * @brief The configured URLs, primary first. Empty ones are skipped. Cheap
+   * to call before every request, the stats only reset if the URLs changed.
+   */
+  void setUrls(const char* const urls[], uint8_t count);
+
+  uint8_t count() const { return _count; }
+
+  // the URL of an endpoint, as passed to setUrls()
+  const char* url(uint8_t index) const { return _urls[index]; }
+
+  /**
+   * @brief The endpoints to try, best first.
+   * @return how many there are in order.
+   */
+  uint8_t order(uint32_t rawSeconds, uint8_t order[MAX_ENDPOINTS]) const;
+
+  // tight for all but the last try
+  EndpointTimeouts timeouts(uint8_t index, bool lastTry) const;
+
+  // the lookup before the connect, 0 ms is fine for an IP address
+  void onDns(uint8_t index, uint32_t ms);
+
+  // it answered (any status below 500), attempt is 0 for the first endpoint tried
+  void onAnswer(uint8_t index, uint32_t requestMs, uint8_t attempt);
+
+  void onFailure(uint8_t index, EndpointPhase phase, uint32_t rawSeconds);
+
+  /**
+   * @brief Fills in the stats since the last report.
+   * @return false with only one endpoint, there is nothing to compare.
+   */
+  bool pendingReport(EndpointReport& report) const;
+
+  // the report went out, take what it had off the counts
+  void onReported(const EndpointReport& report);
+
+  // "connect" etc., for the log and the report
+  static const char* phaseName(uint8_t phase);
+
+  /**
+   * @brief Copies the host out of http://host:port/path.
+   * @return false if there isn't one or it doesn't fit.
+   */
+  static bool hostOf(const char* url, char* host, size_t size);
+
+  const EndpointState& state() const { return _state; }
+
+private:
+  EndpointState& _state;
+  const char* _urls[MAX_ENDPOINTS] = {};
+  uint8_t _count = 0;
+
+  bool coolingOff(uint8_t index, uint32_t rawSeconds) const;
+  bool goesBefore(uint8_t a, uint8_t b, uint32_t rawSeconds) const;
+};
+
+#endif // ENDPOINTSELECTOR_H
@@ -0,0 +1,26 @@
+#ifndef FEATURES_H
+#define FEATURES_H
+
+// What the board has fitted. All on by default; the seeed_xiao_esp32c3_headless
+// env turns them off for sealed nodes with no display and no button. What
+// they switch off is compiled out, not skipped at runtime:
+//
+//   HAS_OLED    OLEDHandler becomes an empty inline class (no Adafruit_SH110X)
+//   HAS_BUTTON  ButtonHandler never reports an event (no OneButton), and the
+//               button doesn't wake the node
+//   HAS_PORTAL  no captive portal (no web server, DNS or CONFIG_PAGE). An
+//               unconfigured node waits for tools/provision.py on USB serial
+
+#ifndef HAS_OLED
+#define HAS_OLED 1
+#endif
+
+#ifndef HAS_BUTTON
+#define HAS_BUTTON 1
+#endif
+
+#ifndef HAS_PORTAL
+#define HAS_PORTAL 1
+#endif
+
+#endif // FEATURES_H
@@ -0,0 +1,95 @@
+#ifndef NODEAUTH_H
+#define NODEAUTH_H
+
+#include <Arduino.h>
+#include "ConfigManager.h"
+
+// 1 = sign every /ingest body with a per-device secret instead of relying on
+// TLS, for nodes on a network we trust not to snoop but not to be clean
+// either. Registration asks the server for the secret. See README "Signed
+// Ingest" and tools/ingest_auth.py for the server side.
+#ifndef SIGNED_INGEST
+#define SIGNED_INGEST 0
+#endif
+
+// what registration asks for and the Authorization header is called
+#define NODE_AUTH_SCHEME "HMAC-SHA256"
+
+/**
+ * @brief The counter in RTC memory, so most wakes don't touch flash. All
+ * zero (power on) means read where we were from NVS.
+ */
+struct AuthCounter {
+  uint32_t next;      // goes in the next body
+  uint32_t leaseEnd;  // NVS already says counters below this may be used
+  uint8_t rejections; // 401s in a row, see needsRekey()
+};
+
+/**
+ * @brief Signs ingest bodies: HMAC-SHA256 with the secret the server gave
+ * us at registration, over the exact bytes that are sent. Each body also
+ * carries a counter that only goes up, so the server can turn down a body
+ * it has seen before.
+ *
+ * The counter has to survive power loss without an NVS write per wake.
+ * NVS holds the end of a lease of COUNTER_LEASE counters, RTC memory where
+ * we are in it. After a power cut the node starts at the end of the last
+ * lease, so it skips ahead but never goes back.
+ *
+ * A 401 on its own doesn't cost the node its identity, it can be a fallback
+ * server that isn't synced yet. After MAX_REJECTIONS in a row the node
+ * re-keys: it registers again with its deviceId, signed with the old secret,
+ * and the server hands the same id a new secret.
+ *
+ * mbedtls does the HMAC, on the ESP32-C3 that runs on the SHA accelerator.
+ */
+class NodeAuth {
+public:
+  static const size_t SECRET_SIZE = 32;
+  static const size_t TAG_HEX_SIZE = 65; // 64 hex digits and the terminator
+  static const uint32_t COUNTER_LEASE = 1000;
+  static const uint8_t MAX_REJECTIONS = 3;
+
+  NodeAuth(ConfigManager& configManager, AuthCounter& counter);
+
+  // true once registration stored a secret
+  bool hasSecret() const;
+
+  // checks and stores the hex secret from the registration response (doesn't save)
+  bool setSecret(const char* hex);
+
+  // forgets the secret, e.g. when the server doesn't know us anymore (doesn't save)
+  void clearSecret();
+
+  /**
+   * @brief The counter for the next body. Extends the lease in NVS first
+   * if it ran out.
+   * @return 0 if NVS couldn't be written, don't send then.
+   */
+  uint32_t takeCounter();
+
+  // the server has seen a counter this high already, e.g. NVS was restored from an old image
+  void skipPast(uint32_t counter);
+
+  // the server turned down our signature (401) / took a signed body
+  void onRejected();
+  void onAccepted();
+
+  // enough 401s in a row that the secret should be replaced, see ApiHandler::registerDeviceIfNeeded()
+  bool needsRekey() const;
+
+  /**
+   * @brief HMAC-SHA256 of body with our secret, as 64 lowercase hex digits.
+   * @return false without a secret or if mbedtls failed.
+   */
+  bool sign(const uint8_t* body, size_t length, char tag[TAG_HEX_SIZE]);
+
+  // plain HMAC-SHA256, also used by the benchmark
+  static bool hmacSha256(const uint8_t* key, size_t keyLength, const uint8_t* data, size_t length, uint8_t out[32]);
+
+private:
+  ConfigManager& _configManager;
+  AuthCounter& _counter;
+};
+
+#endif // NODEAUTH_H
@@ -1,6 +1,11 @@
 #ifndef OLEDHANDLER_H
 #define OLEDHANDLER_H
 
+#include <stdint.h>
+#include "Features.h"
+
+#if HAS_OLED
+
 #include <Adafruit_SH110X.h>
 
 
@@ -47,5 +52,21 @@ private:
 
 };
 
+#else
+
+// no display fitted: same calls, nothing behind them, they compile away
+class OLEDHandler {
+
+public:
+
+    OLEDHandler(uint16_t SDA, uint16_t SCL) {}
+    void initializeOLED() {}
+    void displayText(const char* text) {}
+    void displayInfo(const char* deviceName, const char* deviceId, const char* serverUrl, float temp, float humidity) {}
+    void clearDisplay() {}
+
+};
+
+#endif // HAS_OLED
 
 #endif 
\ No newline at end of file
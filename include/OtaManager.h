@@ -0,0 +1,76 @@
+#ifndef OTAMANAGER_H
+#define OTAMANAGER_H
+
+#include <Arduino.h>
+
+// set from platformio.ini, reported with every telemetry send
+#ifndef FIRMWARE_VERSION
+#define FIRMWARE_VERSION "dev"
+#endif
+
+/**
+ * @brief A firmware update the server advertised in an ingest response.
+ */
+struct FirmwareUpdate {
+  char version[24];
+  char url[256];      // patch location, relative to serverUrl or absolute
+  char sha256[65];    // hex sha256 of the complete new image
+  uint32_t size;      // size of the complete new image
+};
+
+/**
+ * @brief Handles delta OTA updates and rolling back a bad one.
+ *
+ * The server advertises a new version in the /ingest response. The node then
+ * downloads a zlib compressed patch against the image it is running (made by
+ * tools/make_delta.py), inflates it and applies it straight into the
+ * inactive OTA partition as it arrives, checks the sha256 of the result and
+ * boots it.
+ *
+ * A new image is on trial until it manages a successful telemetry send. If
+ * a few upload attempts fail first, or it keeps crashing or losing power
+ * before it gets that far, we switch back to the previous one. Wakes that
+ * only take a reading don't count against it.
+ *
+ * HOW TO USE:
+ * 1. Call begin() early in setup(). It may reboot into the old image.
+ * 2. Call markHealthy() after every successful telemetry send and
+ *    onUploadFailed() after every one that didn't go through.
+ * 3. When ApiHandler reports an update, call applyUpdate() and restart if it
+ *    returns true.
+ */
+class OtaManager {
+public:
+  OtaManager();
+
+  /**
+   * @brief Counts trial boots of a new image and rolls back when it has used
+   * up its failed uploads or boots.
+   */
+  void begin();
+
+  /**
+   * @brief Confirms the running image works. Ends the trial if there is one.
+   */
+  void markHealthy();
+
+  /**
+   * @brief An upload was tried and didn't go through. Counts against the
+   * trial if there is one.
+   */
+  void onUploadFailed();
+
+  /**
+   * @brief Downloads and applies an update.
+   *
+   * @param update What the server advertised.
+   * @param serverUrl Base URL for a relative update.url.
+   * @return true if the new image is written, verified and set to boot.
+   */
+  bool applyUpdate(const FirmwareUpdate& update, const char* serverUrl);
+
+private:
+  bool _onTrial; // from NVS in begin(), so a failed upload outside a trial costs nothing
+};
+
+#endif // OTAMANAGER_H
@@ -0,0 +1,178 @@
+// GENERATED by scripts/build_portal_assets.py from web/ - do not edit.
+#ifndef PORTALASSETS_H
+#define PORTALASSETS_H
+
+#include <Arduino.h>
+
+// config.html: 4921 bytes raw, 3711 minified, 1481 gzipped
+const char CONFIG_PAGE_TYPE[] = "text/html";
+const char CONFIG_PAGE_ETAG[] = "\"c129010c93a988c4\"";
+const size_t CONFIG_PAGE_GZ_LEN = 1481;
+const uint8_t CONFIG_PAGE_GZ[] PROGMEM = {
+  0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x9d, 0x57, 0x6d, 0x6f, 0xdb, 0x36,
+  0x10, 0xfe, 0x2b, 0x57, 0x15, 0x2d, 0x6c, 0xcc, 0x96, 0x25, 0xbb, 0xe9, 0x32, 0x59, 0xf6, 0xb0,
+  0xa6, 0x2d, 0x1a, 0x20, 0x6b, 0x83, 0x3a, 0xc5, 0x36, 0x0c, 0xfd, 0x40, 0x4b, 0xb4, 0xc5, 0x85,
+  0x22, 0x35, 0x91, 0xf2, 0xcb, 0x8c, 0xfc, 0xf7, 0x1d, 0x45, 0xfa, 0x45, 0x71, 0x5c, 0x17, 0x85,
+  0x91, 0x98, 0x47, 0x91, 0xcf, 0x3d, 0xf7, 0xf0, 0x8e, 0x3a, 0xc7, 0xcf, 0xde, 0x7e, 0xba, 0xba,
+  0xfb, 0xeb, 0xf6, 0x1d, 0x64, 0x3a, 0xe7, 0xe3, 0xd8, 0xfd, 0xa7, 0x24, 0x1d, 0xc7, 0x39, 0xd5,
+  0x04, 0x04, 0xc9, 0xe9, 0xc8, 0x5b, 0x30, 0xba, 0x2c, 0x64, 0xa9, 0x3d, 0x48, 0xa4, 0xd0, 0x54,
+  0xe8, 0x91, 0xb7, 0x64, 0xa9, 0xce, 0x46, 0x29, 0x5d, 0xb0, 0x84, 0x76, 0x6b, 0xa3, 0x03, 0x4c,
+  0x30, 0xcd, 0x08, 0xef, 0xaa, 0x84, 0x70, 0x3a, 0x0a, 0xbd, 0x71, 0xac, 0x99, 0xe6, 0x74, 0x7c,
+  0x2d, 0xef, 0xe0, 0xa3, 0x4c, 0x29, 0x4c, 0xa8, 0xae, 0x8a, 0xb8, 0x67, 0x67, 0x63, 0xa5, 0xd7,
+  0xf8, 0x35, 0x95, 0xe9, 0x7a, 0x33, 0x43, 0xd8, 0xee, 0x8c, 0xe4, 0x8c, 0xaf, 0xa3, 0x2e, 0x29,
+  0x0a, 0x4e, 0xbb, 0x6a, 0xad, 0x34, 0xcd, 0x3b, 0x6f, 0x38, 0x13, 0xf7, 0xbf, 0x93, 0x64, 0x52,
+  0x9b, 0xef, 0x71, 0x5d, 0xc7, 0x9b, 0xd0, 0xb9, 0xa4, 0xf0, 0xe5, 0xda, 0xeb, 0x7c, 0x96, 0x53,
+  0xa9, 0x65, 0x47, 0x11, 0xa1, 0xba, 0x8a, 0x96, 0x6c, 0x36, 0x9c, 0x92, 0xe4, 0x7e, 0x5e, 0xca,
+  0x4a, 0xa4, 0xdd, 0x44, 0x72, 0x59, 0x46, 0xcf, 0x67, 0x7d, 0xf3, 0x19, 0x3a, 0x6b, 0x30, 0x18,
+  0x0c, 0x73, 0x52, 0xce, 0x99, 0x88, 0x82, 0x61, 0x41, 0xd2, 0x94, 0x89, 0x79, 0xd4, 0x0f, 0x8a,
+  0xd5, 0xf0, 0xc1, 0x37, 0xc1, 0x11, 0x26, 0x68, 0xb9, 0xc9, 0xc9, 0xca, 0x06, 0x15, 0x5d, 0x04,
+  0xe6, 0x99, 0xdb, 0x41, 0x2a, 0x2d, 0x0f, 0x3c, 0x44, 0xcb, 0x8c, 0x69, 0xda, 0x44, 0x99, 0xca,
+  0x32, 0xa5, 0x65, 0xb7, 0x24, 0x29, 0xab, 0x54, 0x74, 0x59, 0xcf, 0xac, 0xba, 0x2a, 0x23, 0xa9,
+  0x5c, 0x46, 0x01, 0xf4, 0x8b, 0x15, 0xbc, 0xc2, 0xbf, 0x72, 0x3e, 0x25, 0xad, 0xa0, 0x53, 0x7f,
+  0xfc, 0xb0, 0x3d, 0x7c, 0xc8, 0xc2, 0x8d, 0x63, 0x18, 0x04, 0x3f, 0x93, 0xd9, 0x6c, 0xa8, 0xe9,
+  0x4a, 0x77, 0x09, 0x67, 0x73, 0x11, 0x25, 0xa8, 0x38, 0x2d, 0x87, 0x0f, 0x9c, 0x4c, 0x29, 0xdf,
+  0xa4, 0x4c, 0x15, 0x9c, 0xac, 0xa3, 0x29, 0x97, 0xc9, 0xbd, 0x63, 0xd6, 0xd5, 0xb2, 0x88, 0xc2,
+  0x0b, 0xf4, 0x56, 0x2b, 0xb9, 0xa4, 0x6c, 0x9e, 0xe9, 0x68, 0x2a, 0x79, 0x3a, 0x7c, 0x60, 0xa2,
+  0xa8, 0xf4, 0xdf, 0x7a, 0x5d, 0xd0, 0x91, 0xc1, 0xfc, 0xda, 0x39, 0x98, 0x28, 0x88, 0x52, 0x4b,
+  0x64, 0xfc, 0x75, 0x63, 0xa3, 0xc5, 0x83, 0x4b, 0x5a, 0x61, 0x10, 0xbc, 0x80, 0x2e, 0xf4, 0x91,
+  0x6b, 0x7b, 0x17, 0x5c, 0xb8, 0x97, 0xa1, 0x76, 0x76, 0xb1, 0x8b, 0x35, 0x0a, 0x31, 0x1e, 0x25,
+  0x39, 0x4b, 0xe1, 0x79, 0x92, 0x24, 0x8f, 0x14, 0x78, 0x65, 0x94, 0x3d, 0xf0, 0xa8, 0xaa, 0x69,
+  0xce, 0xf4, 0xd7, 0xcd, 0xf1, 0x39, 0xb9, 0xb8, 0xad, 0xd5, 0x54, 0x36, 0x34, 0xb2, 0x1d, 0xc8,
+  0x1b, 0x09, 0x29, 0xe8, 0x13, 0x8e, 0x92, 0xaa, 0x54, 0xb8, 0xb9, 0x90, 0xac, 0x16, 0xcc, 0xc6,
+  0x64, 0xc2, 0xb1, 0xb2, 0x28, 0xf6, 0x1f, 0x8d, 0xc2, 0xd7, 0xcd, 0x40, 0xec, 0xd9, 0x1f, 0x33,
+  0x8c, 0x32, 0xb9, 0xc0, 0x4c, 0x78, 0x8a, 0xe7, 0xc5, 0xeb, 0xe9, 0x00, 0xd3, 0xc5, 0x4c, 0x17,
+  0x1b, 0xc7, 0xa2, 0x3e, 0x80, 0xbd, 0x10, 0x94, 0xee, 0xd8, 0xdb, 0x47, 0x8f, 0xe4, 0xab, 0xed,
+  0x87, 0xb8, 0x67, 0x6b, 0x20, 0xee, 0xd9, 0x92, 0x33, 0xb5, 0x30, 0x8e, 0x53, 0xb6, 0x80, 0x84,
+  0xe3, 0xc9, 0x8c, 0xbc, 0x5d, 0x46, 0x62, 0x2d, 0x65, 0xe1, 0x51, 0x21, 0xe1, 0x54, 0x3c, 0x93,
+  0x65, 0x0e, 0x24, 0xd1, 0x4c, 0x8a, 0x91, 0xd7, 0x53, 0x64, 0x41, 0x3d, 0xc0, 0xd2, 0xcd, 0x64,
+  0x3a, 0xf2, 0x6e, 0x3f, 0x4d, 0xee, 0xbc, 0x06, 0x60, 0xcd, 0x19, 0xa7, 0xea, 0x54, 0x02, 0xdc,
+  0x3b, 0xf2, 0x94, 0x62, 0xa9, 0x37, 0xfe, 0x83, 0xbd, 0x67, 0xf0, 0x91, 0x6a, 0xcc, 0x86, 0x7b,
+  0x68, 0x4d, 0x26, 0xd7, 0x6f, 0xdb, 0x71, 0xaf, 0x5e, 0x35, 0x8e, 0x6b, 0x71, 0xa0, 0x16, 0xc7,
+  0x33, 0x29, 0xe4, 0x01, 0x4b, 0xdd, 0x3e, 0x77, 0x41, 0xd8, 0x31, 0x67, 0x0a, 0x6f, 0x06, 0x61,
+  0x41, 0x94, 0x07, 0xa6, 0x5c, 0x12, 0x99, 0x63, 0x35, 0x6b, 0x5c, 0x23, 0x67, 0x33, 0x0f, 0x4a,
+  0xfa, 0x6f, 0xc5, 0x4a, 0x8a, 0xb1, 0xa6, 0x44, 0x13, 0xb3, 0xa1, 0xc6, 0xda, 0xed, 0x41, 0x29,
+  0xb6, 0x0f, 0x1a, 0x24, 0x4d, 0xa2, 0x3a, 0x92, 0xb7, 0x2e, 0x67, 0x9f, 0xa4, 0xb7, 0x4d, 0x68,
+  0x4b, 0xb1, 0xde, 0xe5, 0x28, 0x5a, 0x04, 0x84, 0x67, 0x8b, 0xb3, 0x8a, 0xd0, 0x72, 0x61, 0x24,
+  0x9f, 0xd4, 0xdf, 0xf0, 0xe5, 0xf3, 0xcd, 0x39, 0x29, 0xec, 0x86, 0xad, 0x18, 0xce, 0xc2, 0x2a,
+  0x4d, 0x68, 0x86, 0x35, 0x48, 0x11, 0x33, 0xd3, 0xba, 0x88, 0x7a, 0xbd, 0xf0, 0x97, 0xbe, 0x1f,
+  0xbe, 0xbe, 0xf4, 0x43, 0x1f, 0xd3, 0x32, 0x7a, 0x15, 0x04, 0x41, 0x8f, 0x14, 0xec, 0x50, 0x97,
+  0x23, 0x1e, 0x7d, 0x6f, 0xfc, 0x9e, 0x70, 0x6e, 0x12, 0x11, 0xf6, 0x8c, 0x14, 0xb4, 0x64, 0x61,
+  0x0e, 0x9d, 0xf0, 0x0e, 0x28, 0xf4, 0x0b, 0x66, 0x01, 0x15, 0x69, 0xfb, 0xbb, 0xb8, 0xf6, 0x9b,
+  0x64, 0xfb, 0xe7, 0xd9, 0x86, 0x7b, 0xb6, 0xdf, 0x86, 0x1e, 0x34, 0xa1, 0x07, 0x4f, 0x43, 0x1b,
+  0xb6, 0x55, 0xe1, 0xd3, 0x15, 0x31, 0xf9, 0x81, 0x57, 0x6f, 0xee, 0xa0, 0xbf, 0xe7, 0x80, 0x0c,
+  0xbe, 0x37, 0x7e, 0x5b, 0xbf, 0x7c, 0xe0, 0x23, 0x1a, 0x67, 0x62, 0xae, 0xd7, 0x3b, 0x56, 0x76,
+  0xdc, 0xa0, 0x44, 0xfd, 0xb9, 0xdf, 0x81, 0x1b, 0xb6, 0xc0, 0x6a, 0x85, 0xcf, 0x52, 0xe6, 0xa8,
+  0xb3, 0xc0, 0x8b, 0xe4, 0xc4, 0xb1, 0x18, 0xf4, 0x9d, 0xf7, 0x3b, 0x34, 0x76, 0xde, 0x15, 0xe5,
+  0x34, 0xb1, 0x19, 0x5d, 0x2f, 0x72, 0x2e, 0xed, 0x86, 0xd8, 0x9e, 0x17, 0x2c, 0x08, 0xaf, 0x70,
+  0xf2, 0x8e, 0xe6, 0x45, 0xef, 0x43, 0x95, 0xb3, 0x94, 0xe9, 0xb5, 0x37, 0x6e, 0x98, 0x71, 0xcf,
+  0xae, 0x45, 0x35, 0x2c, 0x64, 0xc3, 0x3f, 0xde, 0xfb, 0xc4, 0x3c, 0xf5, 0xc6, 0x37, 0x6e, 0x04,
+  0x1f, 0xf0, 0xc2, 0x3b, 0xa3, 0xc1, 0x6e, 0x97, 0x23, 0xb5, 0xb7, 0x9f, 0xd0, 0xe2, 0x93, 0x00,
+  0x9d, 0x61, 0x4a, 0x49, 0x79, 0xaf, 0x32, 0xca, 0x67, 0xdf, 0x79, 0x2e, 0xf5, 0xb5, 0x8b, 0xf1,
+  0x61, 0xe9, 0x70, 0x4a, 0x0b, 0xb8, 0x76, 0x36, 0xb4, 0x14, 0xc5, 0xab, 0x2c, 0x55, 0xe7, 0x92,
+  0x73, 0x07, 0xe0, 0x48, 0xee, 0x6d, 0xa7, 0xda, 0x20, 0x08, 0x4e, 0x9d, 0xca, 0x2a, 0x67, 0xc2,
+  0x5d, 0x11, 0x77, 0x7f, 0xc2, 0xad, 0x5c, 0x62, 0xa1, 0xdc, 0x30, 0xbc, 0xca, 0xb1, 0x54, 0xd2,
+  0x37, 0x79, 0x07, 0xa6, 0x9c, 0x88, 0x7b, 0x18, 0xd5, 0xd7, 0x52, 0x8e, 0xb1, 0x27, 0xe7, 0xd8,
+  0x58, 0xc8, 0xed, 0x21, 0x5a, 0xa3, 0x21, 0x16, 0xce, 0x74, 0xc0, 0x28, 0x06, 0x97, 0xb8, 0xc3,
+  0x60, 0xe4, 0x78, 0x3b, 0x63, 0x8e, 0x55, 0x39, 0x36, 0x23, 0x89, 0xf7, 0x0d, 0x60, 0xb2, 0x3a,
+  0x00, 0x36, 0x46, 0x13, 0x98, 0xac, 0x1c, 0x70, 0x78, 0x71, 0x02, 0xf9, 0x20, 0x74, 0xc2, 0x49,
+  0x99, 0x63, 0x77, 0x54, 0x64, 0xcc, 0x26, 0x12, 0x2d, 0x89, 0xae, 0x4a, 0x0a, 0xbf, 0x99, 0x07,
+  0xd0, 0x7a, 0x99, 0xd2, 0xf9, 0xf0, 0x6a, 0x2f, 0x80, 0x79, 0x7b, 0x9e, 0x8b, 0xfd, 0x10, 0xd3,
+  0x11, 0x6d, 0x4c, 0x35, 0xe8, 0x92, 0x29, 0xbe, 0x2b, 0x1d, 0xe1, 0x41, 0xd0, 0x20, 0x9c, 0xd2,
+  0x84, 0xe5, 0x26, 0x23, 0xce, 0xf9, 0xe1, 0xf2, 0xc8, 0x8f, 0x99, 0x6a, 0xf8, 0x41, 0xbe, 0x72,
+  0xe9, 0xfc, 0x5c, 0x9c, 0x70, 0xf3, 0x58, 0x97, 0xac, 0xca, 0x8d, 0x2c, 0xdb, 0xd2, 0xda, 0x6a,
+  0xf2, 0xe2, 0x07, 0xe4, 0xb0, 0x50, 0x87, 0x2c, 0xdd, 0xcc, 0x49, 0x31, 0x2e, 0x7f, 0x40, 0x0c,
+  0xc4, 0x7c, 0xa4, 0x85, 0x9b, 0x39, 0x29, 0x45, 0xff, 0x94, 0x17, 0x5b, 0xb3, 0x87, 0xbe, 0x6c,
+  0x73, 0xb3, 0x2b, 0xa7, 0x09, 0xb6, 0x0b, 0x70, 0x25, 0xc5, 0x8c, 0xcd, 0xab, 0xd2, 0x5d, 0x2a,
+  0x71, 0xcf, 0xb4, 0x14, 0xdb, 0xcd, 0x2a, 0x29, 0x59, 0xa1, 0xc7, 0xb3, 0x4a, 0xd4, 0x2d, 0x06,
+  0x70, 0x49, 0x52, 0xd7, 0x26, 0xa8, 0x96, 0x2e, 0x19, 0x55, 0x6d, 0xd8, 0xcc, 0xa8, 0x4e, 0xb2,
+  0x16, 0x76, 0x1f, 0x09, 0x11, 0x5e, 0xdb, 0xc7, 0xab, 0x43, 0xb4, 0x76, 0x3b, 0x5a, 0x25, 0xae,
+  0x60, 0x33, 0xfc, 0xf6, 0x95, 0xc6, 0xbc, 0x54, 0x30, 0x1a, 0x21, 0xe5, 0x3e, 0xbc, 0x7c, 0x09,
+  0x35, 0x00, 0x8c, 0x21, 0xc0, 0x25, 0xa0, 0xa8, 0xbe, 0x63, 0x39, 0x95, 0x95, 0x3e, 0xd8, 0x6c,
+  0x1e, 0x1c, 0xfb, 0xc4, 0xf6, 0x14, 0x9b, 0x66, 0x78, 0xe8, 0x00, 0xbe, 0x46, 0x03, 0x1c, 0x95,
+  0xd8, 0x10, 0x95, 0x02, 0x44, 0xc5, 0x39, 0x4e, 0x3b, 0xab, 0xf4, 0xff, 0x51, 0x52, 0xb4, 0xb0,
+  0xbb, 0x3e, 0xe2, 0xb4, 0x6d, 0x38, 0x1c, 0xb5, 0x67, 0x7b, 0xdb, 0xee, 0x1d, 0x6e, 0x27, 0x7c,
+  0x7c, 0x0f, 0x1c, 0xf2, 0x21, 0x98, 0x37, 0x86, 0x93, 0x73, 0x31, 0xf5, 0x4b, 0xec, 0x7d, 0x90,
+  0x0e, 0xa9, 0x07, 0xe8, 0xbb, 0x3d, 0x5c, 0x90, 0xb2, 0x6e, 0x85, 0x30, 0xb5, 0x52, 0x99, 0x60,
+  0xc1, 0x0a, 0xed, 0xcf, 0xa9, 0x7e, 0xc7, 0xa9, 0x19, 0xbe, 0x59, 0x5f, 0xa7, 0xad, 0x7d, 0xc3,
+  0xd3, 0xde, 0x7b, 0x42, 0xd9, 0xdf, 0x11, 0xd4, 0xf1, 0x80, 0x25, 0x7a, 0x32, 0x68, 0xee, 0xcd,
+  0x71, 0x80, 0x97, 0x94, 0x94, 0x68, 0xea, 0x20, 0x5b, 0x9e, 0x5d, 0x80, 0x60, 0x76, 0xe0, 0xd7,
+  0xc7, 0x6b, 0x52, 0xdb, 0x37, 0x9d, 0xd9, 0x76, 0xd6, 0x96, 0x86, 0x99, 0xad, 0x49, 0xff, 0x04,
+  0x1e, 0xe0, 0xc5, 0xe8, 0xe1, 0xa0, 0x25, 0x7c, 0x59, 0x50, 0x01, 0xbf, 0x82, 0xd7, 0x01, 0x33,
+  0xf2, 0x20, 0x02, 0x0f, 0xf1, 0x4c, 0x1c, 0x3e, 0xfe, 0x20, 0xc3, 0xc6, 0xe2, 0x2a, 0x63, 0x3c,
+  0x75, 0x4d, 0x87, 0x91, 0xd4, 0xa8, 0x8a, 0xaf, 0x90, 0x06, 0x61, 0xe4, 0x6b, 0x1e, 0x34, 0x0e,
+  0x2c, 0xc4, 0xf3, 0xc1, 0xf7, 0x98, 0xcd, 0xa3, 0xb8, 0x67, 0x7b, 0xdc, 0x5e, 0xfd, 0x4b, 0xf3,
+  0x7f, 0x0b, 0xbc, 0x19, 0x11, 0x7f, 0x0e, 0x00, 0x00,
+};
+
+// saved.html: 2536 bytes raw, 1893 minified, 1014 gzipped
+const char SAVED_PAGE_TYPE[] = "text/html";
+const char SAVED_PAGE_ETAG[] = "\"ff885b1bc5b952e1\"";
+const size_t SAVED_PAGE_GZ_LEN = 1014;
+const uint8_t SAVED_PAGE_GZ[] PROGMEM = {
+  0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x95, 0x55, 0x6d, 0x6f, 0xdb, 0x36,
+  0x10, 0xfe, 0x2b, 0x17, 0xed, 0x43, 0x6d, 0x54, 0x92, 0x65, 0x67, 0x45, 0x06, 0xeb, 0xe5, 0x43,
+  0xbc, 0x16, 0x08, 0xb0, 0x75, 0x45, 0x93, 0x62, 0x18, 0x82, 0x20, 0xa0, 0xc5, 0x93, 0xc4, 0x86,
+  0x22, 0x05, 0x92, 0xb2, 0x63, 0x04, 0xfe, 0xef, 0x3d, 0x4a, 0xb6, 0xeb, 0x6c, 0xeb, 0x80, 0xc1,
+  0x6f, 0x12, 0x75, 0x7c, 0xee, 0xb9, 0xe7, 0x9e, 0xa3, 0xb3, 0x8b, 0x5f, 0xff, 0x58, 0xdd, 0xfd,
+  0xf5, 0xe9, 0x3d, 0x34, 0xae, 0x95, 0x45, 0x76, 0xf8, 0x46, 0xc6, 0x8b, 0xac, 0x45, 0xc7, 0x40,
+  0xb1, 0x16, 0xf3, 0x60, 0x23, 0x70, 0xdb, 0x69, 0xe3, 0x02, 0x28, 0xb5, 0x72, 0xa8, 0x5c, 0x1e,
+  0x6c, 0x05, 0x77, 0x4d, 0xce, 0x71, 0x23, 0x4a, 0x8c, 0x86, 0x9b, 0x10, 0x84, 0x12, 0x4e, 0x30,
+  0x19, 0xd9, 0x92, 0x49, 0xcc, 0xe7, 0x41, 0x91, 0x39, 0xe1, 0x24, 0x16, 0x37, 0xfa, 0x0e, 0x3e,
+  0x6a, 0x8e, 0x70, 0x8b, 0xae, 0xef, 0xb2, 0xd9, 0xb8, 0x9a, 0x59, 0xb7, 0xa3, 0x9f, 0xb5, 0xe6,
+  0xbb, 0x97, 0x8a, 0x60, 0xa3, 0x8a, 0xb5, 0x42, 0xee, 0x96, 0x11, 0xeb, 0x3a, 0x89, 0x91, 0xdd,
+  0x59, 0x87, 0x6d, 0x78, 0x2d, 0x85, 0x7a, 0xfa, 0x9d, 0x95, 0xb7, 0xc3, 0xed, 0x07, 0x8a, 0x0b,
+  0x83, 0x5b, 0xac, 0x35, 0xc2, 0x97, 0x9b, 0x20, 0xfc, 0xac, 0xd7, 0xda, 0xe9, 0xd0, 0x32, 0x65,
+  0x23, 0x8b, 0x46, 0x54, 0xe9, 0x9a, 0x95, 0x4f, 0xb5, 0xd1, 0xbd, 0xe2, 0x51, 0xa9, 0xa5, 0x36,
+  0xcb, 0x9f, 0xaa, 0x85, 0x7f, 0xa5, 0x87, 0xbb, 0xcb, 0xcb, 0xcb, 0xb4, 0x65, 0xa6, 0x16, 0x6a,
+  0x99, 0xa4, 0x1d, 0xe3, 0x5c, 0xa8, 0x7a, 0xb9, 0x48, 0xba, 0xe7, 0x74, 0x1f, 0xfb, 0xe2, 0x98,
+  0x50, 0x68, 0x5e, 0x5a, 0xf6, 0x3c, 0x16, 0xb5, 0x7c, 0x97, 0xf8, 0x67, 0x87, 0x1d, 0xac, 0x77,
+  0xfa, 0x2c, 0xc3, 0x72, 0xdb, 0x08, 0x87, 0xaf, 0x51, 0xd6, 0xda, 0x70, 0x34, 0x91, 0x61, 0x5c,
+  0xf4, 0x76, 0xf9, 0xcb, 0xb0, 0xf2, 0x1c, 0xd9, 0x86, 0x71, 0xbd, 0x5d, 0x26, 0xb0, 0xe8, 0x9e,
+  0xe1, 0x67, 0xfa, 0x98, 0x7a, 0xcd, 0x26, 0x49, 0x38, 0xbc, 0xe2, 0xf9, 0x34, 0xdd, 0x37, 0xf3,
+  0x97, 0x03, 0xc3, 0x24, 0xb9, 0x62, 0x55, 0x95, 0x3a, 0x7c, 0x76, 0x11, 0x93, 0xa2, 0x56, 0xcb,
+  0x92, 0x14, 0x47, 0x43, 0x04, 0xf5, 0xd3, 0x31, 0x68, 0xce, 0xae, 0xaa, 0xcb, 0x2b, 0x5a, 0x5a,
+  0x33, 0x7e, 0x5c, 0x2b, 0xab, 0xc5, 0x62, 0x81, 0xe9, 0x3e, 0x9b, 0x8d, 0xca, 0x66, 0xb3, 0xb1,
+  0x91, 0x5e, 0xe1, 0x22, 0xe3, 0x62, 0x03, 0xa5, 0x64, 0xd6, 0xe6, 0xc1, 0xa9, 0x4e, 0xea, 0x50,
+  0x33, 0x2f, 0x56, 0x5a, 0x55, 0xa2, 0xee, 0x0d, 0x73, 0x42, 0x2b, 0xb8, 0x65, 0x1b, 0xe4, 0x17,
+  0xb4, 0x77, 0x5e, 0x64, 0x1d, 0x08, 0x9e, 0x07, 0xd6, 0x31, 0xd7, 0xdb, 0xa0, 0xb8, 0x33, 0x3b,
+  0x2a, 0x13, 0x9c, 0xf6, 0x2e, 0x50, 0x58, 0x3a, 0x7f, 0xb9, 0xd3, 0xbd, 0x81, 0x3f, 0xc5, 0x07,
+  0x01, 0x4c, 0x71, 0x70, 0x0d, 0x02, 0xf5, 0x61, 0x83, 0x26, 0x8e, 0xe3, 0x6c, 0xd6, 0x1d, 0x21,
+  0x0c, 0x7e, 0xd5, 0x42, 0x05, 0xd0, 0x08, 0xce, 0x51, 0x15, 0xb7, 0x4e, 0x48, 0x09, 0x5b, 0x46,
+  0x76, 0x51, 0x35, 0x45, 0xc2, 0xdd, 0xb0, 0x8f, 0xcc, 0x01, 0x0a, 0xdd, 0x56, 0x9b, 0x27, 0x68,
+  0x35, 0xd1, 0x78, 0x95, 0xe0, 0x8d, 0x85, 0xb2, 0x61, 0x94, 0x58, 0x86, 0x60, 0x0f, 0xeb, 0x5d,
+  0xa3, 0x15, 0x42, 0xcb, 0x76, 0xd0, 0x10, 0x6d, 0x90, 0x58, 0x39, 0x10, 0x2e, 0x86, 0x9b, 0x8a,
+  0xa8, 0x08, 0x0b, 0x5c, 0xa3, 0x55, 0x6f, 0xdc, 0xb0, 0xb1, 0xc6, 0x10, 0x46, 0x1e, 0x40, 0x86,
+  0x8c, 0xbc, 0x21, 0xa3, 0xc1, 0x90, 0x07, 0xe6, 0x14, 0xde, 0xb1, 0x1a, 0xa1, 0x64, 0xc6, 0x08,
+  0xb4, 0xa0, 0xd5, 0xeb, 0x0a, 0x9c, 0xd9, 0x9d, 0x0a, 0xc8, 0x18, 0x34, 0x06, 0xab, 0x3c, 0x98,
+  0x05, 0xc5, 0x35, 0xf9, 0xc1, 0x13, 0x75, 0xa7, 0x1a, 0x2a, 0x6d, 0xda, 0x6c, 0xc6, 0x8a, 0x61,
+  0xfb, 0x8c, 0x84, 0x27, 0xaf, 0x97, 0x46, 0x74, 0xae, 0xd8, 0x30, 0x03, 0x2d, 0x5a, 0x4b, 0x79,
+  0x2c, 0xe4, 0xf0, 0x72, 0x10, 0x12, 0xf9, 0x12, 0xee, 0x03, 0xfd, 0x14, 0x84, 0x10, 0xac, 0x8e,
+  0x4b, 0x17, 0x83, 0x2a, 0xca, 0xcf, 0x0d, 0x51, 0x53, 0x7a, 0x4b, 0x8c, 0x68, 0x18, 0xf0, 0x3b,
+  0xdd, 0xd7, 0x8a, 0x6d, 0xbd, 0xa6, 0xa5, 0xd4, 0x16, 0xe3, 0xe0, 0x21, 0xdc, 0x1a, 0xad, 0xea,
+  0xc7, 0x8e, 0xfa, 0x4d, 0x0f, 0x07, 0x78, 0x72, 0x8a, 0xc7, 0xf7, 0xa0, 0x43, 0xbf, 0x8e, 0xcf,
+  0xa8, 0x0f, 0xd6, 0x0b, 0x33, 0x24, 0x8d, 0xe1, 0x93, 0x44, 0x66, 0x49, 0x85, 0x06, 0xa9, 0x2c,
+  0xe1, 0xc6, 0x6c, 0x66, 0x07, 0xac, 0x26, 0xcb, 0x78, 0x64, 0xa5, 0x1f, 0xad, 0x15, 0xff, 0x0a,
+  0x79, 0xa4, 0x52, 0xea, 0x5e, 0x72, 0xa2, 0xec, 0x60, 0x8d, 0xa4, 0x06, 0x8d, 0x4a, 0x0c, 0xab,
+  0x01, 0xd0, 0x8b, 0xe4, 0xcf, 0x94, 0x43, 0x11, 0xcc, 0xb7, 0xcb, 0x97, 0x47, 0x4d, 0x31, 0xbe,
+  0x45, 0x03, 0x75, 0x51, 0x89, 0xc7, 0x8a, 0x09, 0x89, 0xe7, 0x49, 0x56, 0x27, 0xcc, 0x33, 0xf7,
+  0xb9, 0xbf, 0x65, 0x3e, 0xd1, 0x7f, 0xc5, 0x78, 0x74, 0xe4, 0x63, 0xaf, 0x0c, 0x32, 0x72, 0xc2,
+  0x5a, 0xe2, 0x19, 0xee, 0xb0, 0xdd, 0xef, 0xb5, 0x21, 0xac, 0x7b, 0x77, 0x66, 0x61, 0xe0, 0x62,
+  0x4c, 0x48, 0xa7, 0xcb, 0x96, 0x1c, 0x7d, 0x56, 0xc2, 0x21, 0xe0, 0xcb, 0xe7, 0xdf, 0x08, 0x7f,
+  0x9f, 0xfa, 0xb6, 0x7a, 0xc2, 0xbd, 0x19, 0xda, 0x9a, 0xa4, 0x55, 0xaf, 0xca, 0x61, 0x9a, 0x3a,
+  0x2d, 0xe5, 0x64, 0x0a, 0x2f, 0x15, 0xba, 0xb2, 0x99, 0x04, 0xb3, 0xc3, 0x2c, 0x4d, 0x63, 0x42,
+  0x51, 0x93, 0x53, 0xd8, 0xc4, 0x50, 0x0c, 0x35, 0xc1, 0xf5, 0x86, 0x84, 0x88, 0xbf, 0x5a, 0xad,
+  0x26, 0xd3, 0x14, 0xf6, 0xff, 0x88, 0xb3, 0x1e, 0xeb, 0x3c, 0x13, 0xd7, 0x65, 0xdf, 0xd2, 0xf9,
+  0x10, 0xd7, 0xe8, 0xde, 0x4b, 0xf4, 0x97, 0xd7, 0xbb, 0x1b, 0x3e, 0x39, 0x8e, 0xdc, 0x34, 0x1e,
+  0x2d, 0x4b, 0xc1, 0xce, 0xf4, 0x38, 0x50, 0x6d, 0xe9, 0xe6, 0xe8, 0xc2, 0x7b, 0x1b, 0x13, 0x54,
+  0x2f, 0xdd, 0x43, 0x2a, 0x2a, 0x98, 0x5c, 0xb4, 0x9e, 0x08, 0x19, 0xeb, 0x4e, 0xb4, 0xa8, 0x7b,
+  0x37, 0xf1, 0x05, 0x84, 0x30, 0x4f, 0x92, 0x84, 0xf8, 0x8c, 0x04, 0x89, 0x97, 0x47, 0x19, 0x4b,
+  0x21, 0xa8, 0x1f, 0x52, 0x38, 0x16, 0x9b, 0x8e, 0x17, 0xf1, 0x70, 0xfc, 0x7c, 0xf4, 0xdd, 0xa7,
+  0xfc, 0xf7, 0xc9, 0xc3, 0x71, 0xdd, 0x1f, 0x75, 0xab, 0xf1, 0x8f, 0x65, 0x78, 0x32, 0x7f, 0xf8,
+  0xaf, 0xb2, 0xfc, 0x1c, 0x9e, 0x55, 0xe5, 0x81, 0x20, 0xcf, 0xc1, 0x8f, 0x4f, 0x4a, 0x82, 0x95,
+  0xcc, 0x2b, 0xfd, 0x5d, 0x31, 0xaa, 0xc7, 0x17, 0xf6, 0xf6, 0xed, 0x49, 0xb6, 0x22, 0x87, 0xcb,
+  0x29, 0xfc, 0x0f, 0xe1, 0x2a, 0x26, 0x2d, 0xa6, 0x3f, 0x10, 0x65, 0x4f, 0xef, 0xb1, 0xcb, 0x29,
+  0x1d, 0xbc, 0xe3, 0x98, 0x67, 0xb3, 0xf1, 0xcc, 0x9d, 0x0d, 0xff, 0xa7, 0xdf, 0x00, 0x55, 0x5d,
+  0xda, 0x91, 0x65, 0x07, 0x00, 0x00,
+};
+
+#endif // PORTALASSETS_H
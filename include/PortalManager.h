@@ -1,16 +1,39 @@
 #ifndef PORTALMANAGER_H
 #define PORTALMANAGER_H
 
-#include <WebServer.h>
+#include <ESPAsyncWebServer.h>
 #include <DNSServer.h>
 #include "ConfigManager.h"
 
+/**
+ * @brief Outcome of trying the freshly saved config, shown on the portal page.
+ */
+enum SetupResult {
+  SETUP_PENDING,            // still trying
+  SETUP_CONNECTED,          // WiFi up and the server answered
+  SETUP_WRONG_PASSWORD,     // AP rejected the password
+  SETUP_NO_SSID,            // network not found
+  SETUP_WIFI_FAILED,        // timed out for some other reason
+  SETUP_SERVER_UNREACHABLE  // WiFi fine, but nothing answered at the server URL
+};
+
 /**
  * @brief Manages the Captive Portal for initial device setup.
  * 
  * When active, this class starts a WiFi Access Point and a web server.
  * Any device connecting to the AP will be redirected to a configuration page
  * where they can enter WiFi credentials and other settings.
+ *
+ * The web server is async (it runs in its own task), so several phones
+ * probing the portal at once don't wait on each other. A WiFi scan is started
+ * with the portal and its results are offered on the page as an SSID list.
+ *
+ * In AP+STA mode there is one radio, and the station's connection takes
+ * the AP along to the router's channel, which drops the phone. So before
+ * the new config is tried, moveToChannelOf() moves the AP to the channel
+ * the scan saw the network on (the phone rejoins on its own, the saved
+ * page keeps polling and asks the user to rejoin if that takes long) and
+ * the station is pinned to that channel.
  */
 class PortalManager {
 public:
@@ -26,7 +49,8 @@ public:
   void start();
 
   /**
-   * @brief Processes DNS and Web server requests. called repeatedly in a loop.
+   * @brief Processes DNS requests, collects WiFi scan results and saves a
+   * submitted form. called repeatedly in a loop.
    */
   void loop();
 
@@ -41,16 +65,66 @@ public:
    */
   bool isConfigSaved();
 
+  /**
+   * @brief Re-arms the form after a failed attempt so the user can submit again.
+   */
+  void clearConfigSaved();
+
+  /**
+   * @brief Publishes the result of trying the new config. The saved page polls
+   * /status and shows it to the user.
+   */
+  void setSetupResult(SetupResult result);
+
+  /**
+   * @brief Moves the AP to the channel the scan found ssid on, if it isn't
+   * there already. Phones on the portal drop and rejoin.
+   * @return the channel, for WiFi.begin(), or 0 if ssid wasn't in the scan
+   * (then the AP moves when the station joins).
+   */
+  int32_t moveToChannelOf(const char* ssid);
+
+  // max networks we keep from a scan
+  static const int MAX_SCAN_RESULTS = 20;
+
 private:
   ConfigManager& _configManager;
-  WebServer _server;
+  AsyncWebServer _server;
   DNSServer _dnsServer;
-  bool _configSaved;
+  DeviceConfig _pendingConfig;   // the submitted form, written by the web server task
+  volatile bool _configPending;  // _pendingConfig is complete, loop() picks it up
+  volatile bool _configSaved;    // loop() applied and saved it
+  volatile SetupResult _setupResult;
+
+  // cached result of the WiFi scan, as JSON for the /scan endpoint
+  String _scanJson;
+  volatile bool _scanReady;
+
+  // the channel of each network in _scanJson (its strongest AP), for moveToChannelOf()
+  struct ScanChannel {
+    char ssid[33];
+    int32_t channel;
+  };
+  ScanChannel _scanChannels[MAX_SCAN_RESULTS];
+  int _scanChannelCount;
 
   // Web Server Handlers
-  void handleRoot();
-  void handleSave();
-  void handleNotFound();
+  void handleRoot(AsyncWebServerRequest* request);
+  void handleSave(AsyncWebServerRequest* request);
+  void handleScan(AsyncWebServerRequest* request);
+  void handleStatus(AsyncWebServerRequest* request);
+  void handleProbe(AsyncWebServerRequest* request);
+  void handleNotFound(AsyncWebServerRequest* request);
+
+  // Sends a gzipped page from flash with caching headers. etag can be null for
+  // pages that should not be cached.
+  void sendAsset(AsyncWebServerRequest* request, const uint8_t* data, size_t length, const char* contentType, const char* etag);
+
+  // Turns a finished async scan into _scanJson.
+  void updateScanResults();
+
+  // Makes the submitted form the config and saves it, from loop().
+  void applyPendingConfig();
 };
 
 #endif // PORTALMANAGER_H
@@ -2,6 +2,28 @@
 #define POWERMANAGER_H
 
 #include <Arduino.h>
+#include "esp_timer.h"
+
+// spread the wakes of a fleet over the interval (see WakeSlot.h), build
+// with -DWAKE_SLOTS=0 to sleep a plain interval instead
+#ifndef WAKE_SLOTS
+#define WAKE_SLOTS 1
+#endif
+
+// auto light sleep while associated needs an IDF built with power management
+// and tickless idle. Arduino's prebuilt one usually isn't, then idling
+// connected only gets modem sleep (see SleepPolicy.h).
+#ifndef CONNECTED_LIGHT_SLEEP
+#if __has_include("sdkconfig.h")
+#include "sdkconfig.h"
+#if defined(CONFIG_PM_ENABLE) && defined(CONFIG_FREERTOS_USE_TICKLESS_IDLE)
+#define CONNECTED_LIGHT_SLEEP 1
+#endif
+#endif
+#ifndef CONNECTED_LIGHT_SLEEP
+#define CONNECTED_LIGHT_SLEEP 0
+#endif
+#endif
 
 /**
  * @brief Manages the device's power states, primarily handling the transition
@@ -12,8 +34,8 @@ public:
   /**
    * @brief Construct a new Power Manager object.
    * 
-   * @param buttonPin The GPIO pin connected to the wake-up button.
-   * @param oledPowerPin The GPIO pin controlling the OLED power transistor.
+   * @param buttonPin The GPIO pin connected to the wake-up button, -1 if there is none.
+   * @param oledPowerPin The GPIO pin controlling the OLED power transistor, -1 if there is no OLED.
    * @param sensorPowerPin The GPIO pin controlling the sensor power transistor.
    */
   PowerManager(int buttonPin, int oledPowerPin, int sensorPowerPin);
@@ -35,10 +57,81 @@ public:
    */
   void enterDeepSleep(uint32_t sleepDurationSeconds);
 
+  /**
+   * @brief Makes the next enterDeepSleep() wake in this node's slot (see
+   * WakeSlot.h) instead of a plain interval from now.
+   *
+   * @param key Stable per node string, normally the deviceId.
+   * @param clockMs Current time on the clock the slots are laid out on.
+   */
+  void setWakeSlot(const char* key, uint64_t clockMs);
+
+  /**
+   * @brief The server asked us to come back later (Retry-After). Moves the
+   * slot so the next wake is at least that far away, and keeps it there.
+   *
+   * @param retryAfterSeconds 0 does nothing.
+   */
+  void deferWakeSlot(uint32_t retryAfterSeconds);
+
+  /**
+   * @brief Stays associated but saves what it can until leaveConnectedIdle():
+   * DTIM based modem sleep for the radio, and with CONNECTED_LIGHT_SLEEP the
+   * CPU light sleeps whenever nothing runs (e.g. in delay()).
+   *
+   * @return false if it's modem sleep only.
+   */
+  bool enterConnectedIdle();
+
+  /**
+   * @brief Back to full speed, with the WiFi power save Arduino starts with.
+   */
+  void leaveConnectedIdle();
+
+  /**
+   * @brief Calls onExpired once ms have passed, unless disarmAwakeTimer() or
+   * another armAwakeTimer() comes first. It runs in the esp_timer task, so
+   * it fires even while loop() hangs in a blocking call (see AwakeBudget.h).
+   */
+  void armAwakeTimer(uint32_t ms, void (*onExpired)());
+
+  void disarmAwakeTimer();
+
+  /**
+   * @brief Works out now what enterDeepSleep(sleepDurationSeconds) would do
+   * (slot, Retry-After, jitter), for deepSleepFromTimer(). Call it whenever
+   * the awake timer is armed.
+   */
+  void planDeepSleep(uint32_t sleepDurationSeconds);
+
+  /**
+   * @brief Deep sleeps as the last planDeepSleep() said, from the awake
+   * timer's callback. Peripherals go off at register level, no Serial, WiFi,
+   * heap or delay(), the task it cut short may be holding their locks.
+   */
+  void deepSleepFromTimer();
+
 private:
   int _buttonPin;
   int _oledPowerPin;
   int _sensorPowerPin;
+
+  bool _slotted;
+  uint32_t _slotHash;
+  uint64_t _slotClockMs;
+  uint32_t _retryAfterMs;
+  uint32_t _cpuMhz;
+
+  // planDeepSleep(): wake at this esp_timer time, with the slot shifted this far
+  int64_t _plannedWakeUs;
+  uint32_t _plannedShiftMs;
+
+  esp_timer_handle_t _awakeTimer;
+  void (*_onAwakeTimer)();
+
+  static void awakeTimerFired(void* arg);
+
+  uint64_t deepSleepUs(uint32_t sleepDurationSeconds, uint32_t& shiftMs, bool verbose) const;
 };
 
 #endif // POWERMANAGER_H
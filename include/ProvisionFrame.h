@@ -0,0 +1,76 @@
+#ifndef PROVISIONFRAME_H
+#define PROVISIONFRAME_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <ArduinoJson.h>
+
+/**
+ * @brief Parser for the serial provisioning frames. It only needs
+ * ArduinoJson, so it can be built and tested on the host (test/).
+ *
+ * A frame is one line of text:
+ *
+ *    @PROV <crc32 as 8 hex digits> <config json>\n
+ *
+ * where the CRC32 (same as zlib's crc32) is computed over the JSON bytes only.
+ * Anything that isn't a @PROV line (boot logs, noise) is ignored.
+ *
+ * HOW TO USE:
+ *    ProvisionFrameParser parser;
+ *    while (Serial.available()) {
+ *      if (parser.feed(Serial.read()) == ProvisionFrameParser::FRAME_OK) {
+ *        use parser.payload() / parser.payloadLength()
+ *      }
+ *    }
+ */
+class ProvisionFrameParser {
+public:
+  enum Result {
+    FRAME_NONE,      // nothing complete yet, or a line we don't care about
+    FRAME_OK,        // payload() holds a checked frame
+    FRAME_BAD_CRC,   // the CRC didn't match the payload
+    FRAME_MALFORMED, // @PROV line in the wrong format
+    FRAME_TOO_LONG   // line didn't fit in the buffer
+  };
+
+  // longest line we accept, a full DeviceConfig as JSON is well under this
+  static const size_t MAX_LINE = 1024;
+
+  ProvisionFrameParser();
+
+  // Forgets any partial line.
+  void reset();
+
+  // Feeds one received byte. Returns FRAME_NONE until a line is complete.
+  Result feed(char c);
+
+  // The JSON of the last FRAME_OK, null terminated. Valid until the next feed().
+  const char* payload() const;
+  size_t payloadLength() const;
+
+private:
+  char _line[MAX_LINE + 1];
+  size_t _length;
+  bool _overflow;
+  const char* _payload;
+  size_t _payloadLength;
+
+  Result parseLine();
+};
+
+/**
+ * @brief Standard CRC32 (poly 0xEDB88320), matches zlib.crc32 in Python.
+ */
+uint32_t provisionCrc32(const uint8_t* data, size_t length);
+
+/**
+ * @brief Parses the JSON of a FRAME_OK and checks it has what a config
+ * can't do without, a non-empty ssid and server.
+ *
+ * @param doc Gets the parsed JSON, for the rest of the fields.
+ * @return nullptr if it is usable, else the @NAK reason ("bad_json", "missing_fields").
+ */
+const char* provisionCheckPayload(JsonDocument& doc, const char* json, size_t length);
+
+#endif // PROVISIONFRAME_H
@@ -0,0 +1,54 @@
+#ifndef SAMPLEBUFFER_H
+#define SAMPLEBUFFER_H
+
+#include <stdint.h>
+
+/**
+ * @brief One sensor reading, fixed point to keep RTC memory small.
+ */
+struct Sample {
+  uint32_t rawSeconds;     // TimeKeeper::rawClockUs() / 1000000 when taken
+  int16_t temperatureCenti; // 0.01 C
+  uint16_t humidityCenti;   // 0.01 %
+};
+
+/**
+ * @brief Readings taken while we couldn't (or didn't try to) upload, sent
+ * along with the next successful upload.
+ *
+ * Meant to live in RTC memory, so it is a plain struct that is zero when
+ * empty. When it is full the oldest reading is dropped. Pure C++, builds on
+ * the host.
+ */
+struct SampleBuffer {
+  // 48 readings is 4 hours at the default 5 minute interval, in 388 bytes
+  static const uint8_t CAPACITY = 48;
+
+  uint8_t count;
+  Sample samples[CAPACITY];
+
+  // adds a reading, dropping the oldest if full. Returns false if one was dropped.
+  // Inline and without library calls because the wake stub (WakeStub.h) runs
+  // it from RTC memory, before there is any flash to call into.
+  __attribute__((always_inline)) bool push(const Sample& sample) {
+    bool dropped = count >= CAPACITY;
+    if (dropped) {
+      for (uint8_t i = 1; i < CAPACITY; i++) {
+        samples[i - 1] = samples[i];
+        asm volatile("" ::: "memory"); // or the compiler turns the loop into a memmove() call
+      }
+      count = CAPACITY - 1;
+    }
+    samples[count++] = sample;
+    return !dropped;
+  }
+
+  void clear();
+  bool isFull() const { return count >= CAPACITY; }
+
+  static Sample makeSample(uint32_t rawSeconds, float temperature, float humidity);
+  static float temperature(const Sample& sample) { return sample.temperatureCenti / 100.0f; }
+  static float humidity(const Sample& sample) { return sample.humidityCenti / 100.0f; }
+};
+
+#endif // SAMPLEBUFFER_H
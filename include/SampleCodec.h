@@ -0,0 +1,58 @@
+#ifndef SAMPLECODEC_H
+#define SAMPLECODEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "SampleBuffer.h"
+
+/**
+ * @brief Packs a series of Samples into a few bits each, Gorilla style.
+ *
+ * Timestamps are nearly regular, so we store the change of the interval
+ * (delta-of-delta), which is 0 or a few seconds. Readings are already fixed
+ * point and move by a few hundredths between wakes, so we store the change
+ * from the previous reading. Both go into variable length buckets. A
+ * typical reading costs ~3 bytes instead of ~80 as JSON.
+ *
+ * Block format, bits written MSB first, padded with 0 bits to a whole byte:
+ *
+ *    8 bits     sample count
+ *    first sample: 32 bits rawSeconds, 16 bits temperatureCenti, 16 bits humidityCenti
+ *    every following sample:
+ *      rawSeconds, delta-of-delta (the first interval counts from 0):
+ *        0                 same interval as before
+ *        10    + 7 bits    -64..63
+ *        110   + 9 bits    -256..255
+ *        1110  + 12 bits   -2048..2047
+ *        1111  + 32 bits   anything else, rawSeconds itself
+ *      temperatureCenti, then humidityCenti, change from the previous sample:
+ *        0                 no change
+ *        10    + 4 bits    -8..7
+ *        110   + 7 bits    -64..63
+ *        1110  + 10 bits   -512..511
+ *        1111  + 16 bits   anything else, the value itself
+ *
+ * Bucket values are two's complement. No Arduino dependencies, it builds on
+ * the host. tools/sample_codec.py is the same decoder for the server.
+ */
+
+// most samples in one block, the count is 8 bits
+const size_t SAMPLE_BLOCK_MAX_SAMPLES = 255;
+
+// bytes encodeSamples() needs for count samples in the worst case
+size_t sampleBlockMaxSize(size_t count);
+
+/**
+ * @brief Encodes samples (oldest first) into out.
+ * @return bytes written, 0 if there are too many samples or out is too small.
+ */
+size_t encodeSamples(const Sample* samples, size_t count, uint8_t* out, size_t capacity);
+
+/**
+ * @brief Decodes a block made by encodeSamples().
+ * @return number of samples written to samples, -1 if the block is
+ * malformed, truncated or holds more than capacity samples.
+ */
+int decodeSamples(const uint8_t* data, size_t length, Sample* samples, size_t capacity);
+
+#endif // SAMPLECODEC_H
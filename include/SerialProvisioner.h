@@ -0,0 +1,64 @@
+#ifndef SERIALPROVISIONER_H
+#define SERIALPROVISIONER_H
+
+#include <Arduino.h>
+#include "ConfigManager.h"
+#include "ProvisionFrame.h"
+
+/**
+ * @brief What happened during the provisioning window.
+ */
+enum ProvisionResult {
+  PROVISION_NONE,           // nobody sent a config
+  PROVISION_SAVED,          // config saved
+  PROVISION_SAVED_REGISTER  // config saved and the host wants the deviceId back
+};
+
+/**
+ * @brief Bulk provisioning over the USB CDC serial port, used by
+ * tools/provision.py to set up many nodes without the captive portal.
+ *
+ * On a cold boot the node opens a short window and talks this protocol
+ * (one line per message):
+ *
+ *    node -> host   @HELLO iot-node <mac> <deviceId or ->
+ *    host -> node   @PROV <crc32> <config json>       (see ProvisionFrame.h)
+ *    node -> host   @ACK saved                       or @NAK <reason>
+ *    node -> host   @REG <deviceId>                  or @NAK register_failed
+ *
+ * The JSON uses the same names as the portal form: ssid, pass, server, name,
+ * type, location, interval. "register": true asks the node to connect and
+ * register right away and send back its deviceId (the @REG line).
+ */
+class SerialProvisioner {
+public:
+  /**
+   * @brief Construct a new Serial Provisioner object.
+   * @param configManager A reference to the main ConfigManager instance.
+   */
+  SerialProvisioner(ConfigManager& configManager);
+
+  /**
+   * @brief Announces the node and waits for a config frame. Blocks for at most
+   * windowMs, a bit longer if a frame is in the middle of arriving.
+   *
+   * @param windowMs How long to wait for a frame to start.
+   * @return ProvisionResult what was received.
+   */
+  ProvisionResult listen(unsigned long windowMs);
+
+  /**
+   * @brief Sends the result of the registration the host asked for.
+   * @param success true if registration worked.
+   */
+  void reportRegistration(bool success);
+
+private:
+  ConfigManager& _configManager;
+  ProvisionFrameParser _parser;
+
+  // Applies a checked frame to the config. Returns false and sends @NAK if it is unusable.
+  bool applyFrame(const char* json, size_t length, bool& wantsRegister);
+};
+
+#endif // SERIALPROVISIONER_H
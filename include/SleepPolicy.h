@@ -0,0 +1,143 @@
+#ifndef SLEEPPOLICY_H
+#define SLEEPPOLICY_H
+
+#include <stdint.h>
+
+// 1 = short intervals can stay associated between readings instead of deep
+// sleeping, when SleepPolicy works out that it's cheaper. 0 always deep sleeps.
+#ifndef HYBRID_SLEEP
+#define HYBRID_SLEEP 1
+#endif
+
+// rough ESP32-C3 currents the crossover comes from. Measure your board and
+// override them to move it, the "sleep" report has what each mode cost.
+#ifndef SLEEP_ACTIVE_MA
+#define SLEEP_ACTIVE_MA 80        // awake with the radio on
+#endif
+#ifndef SLEEP_DEEP_UA
+#define SLEEP_DEEP_UA 50          // deep sleep, the XIAO's regulator included
+#endif
+#ifndef SLEEP_LIGHT_IDLE_UA
+#define SLEEP_LIGHT_IDLE_UA 1500  // associated, DTIM modem sleep and auto light sleep
+#endif
+#ifndef SLEEP_MODEM_IDLE_UA
+#define SLEEP_MODEM_IDLE_UA 15000 // associated, modem sleep but the CPU idles clocked
+#endif
+
+enum SleepMode : uint8_t {
+  SLEEP_DEEP = 0,      // deep sleep, boot and connect again every wake
+  SLEEP_CONNECTED = 1, // stay associated in modem/light sleep, keep the connection to the server
+  SLEEP_MODE_COUNT
+};
+
+/**
+ * @brief What one mode cost, since the last report.
+ */
+struct SleepModeStats {
+  uint16_t cycles;  // deep sleep wakes that ran the firmware / connected idles
+  uint32_t awakeMs; // wake (or connected cycle) to sleep
+  uint32_t radioMs; // radio on and listening, the power save stretches not counted
+  uint32_t sleepS;  // deep sleep / connected idle
+};
+
+/**
+ * @brief What the policy remembers between wakes. Meant to live in RTC
+ * memory, all zero is deep sleep and nothing measured.
+ */
+struct SleepPolicyState {
+  uint8_t mode;               // SleepMode
+  bool noLightSleep;          // the IDF turned auto light sleep down, idling connected costs more
+  uint16_t reconnectMs;       // smoothed, deep sleep wake to associated. 0 = not measured yet
+  uint16_t reconnectsAvoided; // uploads that found WiFi still up after a connected idle, since the last report
+  uint16_t connectionsReused; // requests that went over the kept connection, since the last report
+  SleepModeStats modes[SLEEP_MODE_COUNT];
+};
+
+// how sleeping went, for the server, see ApiHandler
+struct SleepReport {
+  uint8_t mode;
+  uint16_t reconnectMs;
+  uint32_t crossoverS;
+  uint16_t reconnectsAvoided;
+  uint16_t connectionsReused;
+  SleepModeStats modes[SLEEP_MODE_COUNT];
+  uint32_t chargeMas[SLEEP_MODE_COUNT]; // rough, from the currents above
+};
+
+/**
+ * @brief Picks between deep sleep and staying connected for the time
+ * between two uploads. Pure C++, builds on the host.
+ *
+ * A deep sleep wake pays for the boot, setup() and getting associated again
+ * (scan, auth, DHCP) before it can send anything, that's reconnectMs,
+ * measured on every deep sleep wake. Staying associated in DTIM modem sleep
+ * skips all that but draws SLEEP_*_IDLE_UA instead of SLEEP_DEEP_UA the whole
+ * time in between. Both cost the same for the reading and the request, so
+ * connected wins when
+ *
+ *     interval * (idle - deep) < reconnectMs * SLEEP_ACTIVE_MA
+ *
+ * which with light sleep and a ~1.8 s reconnect is around 100 s, and with
+ * modem sleep alone (the CPU idles clocked, e.g. Arduino's prebuilt IDF
+ * without tickless idle) only ~10 s. Opening the TCP/TLS connection isn't in
+ * reconnectMs, so for TLS the real crossover is later than this one.
+ *
+ * The mode only changes once the interval is 10% past the crossover, so a
+ * noisy reconnectMs doesn't flip it back and forth. Until a reconnect has
+ * been measured it's deep sleep.
+ */
+class SleepPolicy {
+public:
+  static const uint8_t HYSTERESIS_PCT = 10;
+
+  SleepPolicy(SleepPolicyState& state, bool lightSleep);
+
+  /**
+   * @brief The mode for the time until the next upload.
+   * @param uploadIntervalSeconds time between uploads, not between readings:
+   * with SAMPLES_PER_UPLOAD > 1 only every n-th deep sleep wake connects.
+   */
+  SleepMode choose(uint32_t uploadIntervalSeconds);
+
+  SleepMode mode() const { return (SleepMode)_state.mode; }
+
+  // the upload interval below which staying connected is cheaper, 0 before anything was measured
+  uint32_t crossoverSeconds() const;
+
+  // idling connected didn't get light sleep after all, the crossover drops
+  void onNoLightSleep();
+
+  // a deep sleep wake got associated this long after it woke
+  void onReconnect(uint32_t ms);
+
+  // an upload after a connected idle found WiFi still up
+  void onReconnectAvoided();
+
+  // a request went over the connection kept from the last one
+  void onConnectionReused();
+
+  // cycles, for the report
+  void onDeepSleep(uint32_t awakeMs, uint32_t radioMs, uint32_t sleepSeconds);
+  void onConnectedIdle(uint32_t awakeMs, uint32_t radioMs, uint32_t idleSeconds);
+
+  /**
+   * @brief Fills in the stats since the last report.
+   * @return false if nothing slept since then.
+   */
+  bool pendingReport(SleepReport& report) const;
+
+  // the report went out, take what it had off the counts
+  void onReported(const SleepReport& report);
+
+  static const char* modeName(uint8_t mode);
+
+  const SleepPolicyState& state() const { return _state; }
+
+private:
+  SleepPolicyState& _state;
+  bool _lightSleep;
+
+  uint32_t idleUa() const;
+};
+
+#endif // SLEEPPOLICY_H
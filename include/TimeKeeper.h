@@ -0,0 +1,68 @@
+#ifndef TIMEKEEPER_H
+#define TIMEKEEPER_H
+
+#include <Arduino.h>
+#include "DriftEstimator.h"
+
+/**
+ * @brief Keeps wall clock time across deep sleep without an NTP exchange.
+ *
+ * The state lives in RTC memory. Time is synced on the side from responses
+ * we get anyway: the HTTP Date header of every request, or a "serverTime"
+ * field (epoch ms) in the ingest response, which is more precise. Between
+ * syncs it uses the RTC clock corrected with the learned drift (see
+ * DriftEstimator).
+ *
+ * HOW TO USE:
+ *    int64_t before = TimeKeeper::rawClockUs();
+ *    ... do the request ...
+ *    timeKeeper.syncFromHttpDate(http.header("Date"), before, TimeKeeper::rawClockUs());
+ *
+ *    if (timeKeeper.isSynced()) { timeKeeper.nowMs(), timeKeeper.uncertaintyMs() }
+ */
+class TimeKeeper {
+public:
+  TimeKeeper();
+
+  // true once we got at least one sync since power on
+  bool isSynced() const;
+
+  // current time in ms since 1970, only valid when isSynced()
+  int64_t nowMs() const;
+
+  // how far off nowMs() could be
+  uint32_t uncertaintyMs() const;
+
+  // clock for laying out wake slots: real time when synced, otherwise time
+  // since power on (which nodes powered on together share anyway)
+  uint64_t slotClockMs() const;
+
+  // learned RTC drift (true/raw elapsed time), for diagnostics
+  double driftRatio() const;
+
+  /**
+   * @brief Syncs from an HTTP Date header (1 s resolution).
+   *
+   * @param date The header value, e.g. "Sun, 06 Nov 1994 08:49:37 GMT".
+   * @param requestRawUs rawClockUs() just before the request was sent.
+   * @param responseRawUs rawClockUs() when the response was in.
+   * @return true if the header could be used.
+   */
+  bool syncFromHttpDate(const String& date, int64_t requestRawUs, int64_t responseRawUs);
+
+  /**
+   * @brief Syncs from a server timestamp in ms since 1970.
+   */
+  void syncFromServerTime(int64_t epochMs, int64_t requestRawUs, int64_t responseRawUs);
+
+  // RTC backed system clock in us, keeps counting through deep sleep
+  static int64_t rawClockUs();
+
+  // parses an RFC 7231 date, returns seconds since 1970 or -1
+  static int64_t parseHttpDate(const char* date);
+
+private:
+  DriftEstimator _estimator;
+};
+
+#endif // TIMEKEEPER_H
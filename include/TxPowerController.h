@@ -0,0 +1,112 @@
+#ifndef TXPOWERCONTROLLER_H
+#define TXPOWERCONTROLLER_H
+
+#include <stdint.h>
+
+// one wake's link, oldest first in TxPowerState::history
+struct TxPowerSample {
+  int8_t rssi;   // AP as we heard it, 0 if we never connected
+  uint8_t level; // index into TxPowerController::LEVELS_QDBM we sent at
+  uint8_t flags; // TX_SAMPLE_*
+};
+
+enum {
+  TX_SAMPLE_UPLOADED = 1, // the upload went through
+  TX_SAMPLE_RETRIED = 2,  // the driver had to retry the connect
+  TX_SAMPLE_FAILED = 4    // WiFi never came up
+};
+
+/**
+ * @brief What the controller remembers between wakes. Meant to live in RTC
+ * memory, all zero is full power and an empty history.
+ */
+struct TxPowerState {
+  static const uint8_t HISTORY = 8;
+
+  uint8_t level;        // 0 is full power, higher is less
+  uint8_t healthyWakes; // clean wakes in a row since the last change
+  uint8_t holdWakes;    // wakes to stay put after trouble before stepping down again
+  uint8_t historyCount;
+  uint8_t historyNext;
+  TxPowerSample history[HISTORY];
+};
+
+// the radio for the server, see ApiHandler
+struct TxPowerReport {
+  int16_t txQdbm;  // what this wake sent at, in 0.25 dBm
+  int8_t rssi;     // this wake
+  int8_t rssiMin;  // worst of this wake and the history
+  uint8_t retries; // connect retries this wake
+};
+
+/**
+ * @brief Picks the WiFi TX power for the next wake from how the last ones
+ * went. Pure C++, builds on the host.
+ *
+ * The node only ever talks to one AP a few metres away, and full power
+ * (19.5 dBm) is both the default and the most expensive thing the radio does.
+ * We can't hear how strong we arrive at the AP, but the link is close enough
+ * to symmetric that the AP's RSSI at our end, minus what the AP sends at and
+ * plus what we send at, is a fair guess.
+ *
+ * - Trouble (the connect needed retries, WiFi never came up or the upload
+ *   failed) steps one level up right away and holds there for a while.
+ * - A weak link (the guess below UPLINK_FLOOR_DBM) steps one level up.
+ * - After a few clean wakes it steps one level down, but only if the worst
+ *   RSSI in the history would still leave STEP_DOWN_MARGIN_DB at the lower
+ *   level, so one lucky reading doesn't take it down.
+ * - Configured bounds always win, the levels are clamped to them.
+ */
+class TxPowerController {
+public:
+  // the steps Arduino's wifi_power_t has, in 0.25 dBm, highest first
+  static const uint8_t LEVEL_COUNT = 11;
+  static const int8_t LEVELS_QDBM[LEVEL_COUNT];
+
+  // what we assume the AP sends at (most home and office APs, give or take)
+  static const int8_t AP_TX_DBM = 20;
+  // the AP should hear us at least this loud, roughly where 802.11g rates still hold up
+  static const int8_t UPLINK_FLOOR_DBM = -75;
+  // extra room a step down has to leave, so we don't flap around the floor
+  static const int8_t STEP_DOWN_MARGIN_DB = 4;
+
+  static const uint8_t HEALTHY_WAKES_TO_STEP_DOWN = 3;
+  static const uint8_t HOLD_WAKES_AFTER_TROUBLE = 8;
+
+  TxPowerController(TxPowerState& state);
+
+  // configured limits in whole dBm, 0 for no limit
+  void setBounds(int8_t minDbm, int8_t maxDbm);
+
+  // what to pass to WiFi.setTxPower() this wake
+  int8_t powerQdbm() const;
+
+  /**
+   * @brief The wake is over, record it and pick the next level.
+   * @param rssi the AP as WiFi.RSSI() had it after connecting
+   * @param uploadOk registration and ingest went through
+   * @param retries disconnects the driver reported while connecting
+   */
+  void onWake(int8_t rssi, bool uploadOk, uint8_t retries);
+
+  // WiFi never came up. Could be the AP is down, could be us, so it counts as trouble.
+  void onWiFiFailure(uint8_t retries);
+
+  // this wake's link for the telemetry, before we know how the upload goes
+  TxPowerReport report(int8_t rssi, uint8_t retries) const;
+
+  const TxPowerState& state() const { return _state; }
+
+private:
+  TxPowerState& _state;
+  uint8_t _highestLevel = 0;            // index of the max bound
+  uint8_t _lowestLevel = LEVEL_COUNT - 1; // index of the min bound
+
+  uint8_t level() const;
+  void record(int8_t rssi, uint8_t flags);
+  void stepUp();
+  int8_t worstRssi(int8_t rssi) const;
+  static int uplinkGuess(int8_t rssi, uint8_t level);
+};
+
+#endif // TXPOWERCONTROLLER_H
@@ -0,0 +1,39 @@
+#ifndef WAKESLOT_H
+#define WAKESLOT_H
+
+#include <stdint.h>
+
+/**
+ * @brief Spreads the wakes of many nodes over the sleep interval.
+ *
+ * Every node gets a fixed phase inside the interval from a hash of its
+ * deviceId, and always wakes at "clock = phase (mod interval)" instead of
+ * "interval after whenever it went to sleep". Nodes that were powered on
+ * together therefore don't keep hitting the server in the same second.
+ *
+ * Pure C++ so tools/wake_slot_sim.cpp can run it for thousands of nodes.
+ */
+
+// FNV-1a of the key (normally the deviceId)
+uint32_t wakeSlotHash(const char* key);
+
+// where in the interval this node wakes, shifted by shiftMs
+uint32_t wakeSlotPhaseMs(uint32_t hash, uint32_t intervalMs, uint32_t shiftMs);
+
+/**
+ * @brief How long to sleep to wake in our slot.
+ *
+ * @param clockMs Current time on the clock the slots are measured on.
+ * @param intervalMs The sleep interval.
+ * @param phaseMs From wakeSlotPhaseMs().
+ * @param minSleepMs Never sleep less than this. Half the interval is normal
+ *        so a node never wakes twice in quick succession.
+ * @param jitterMs Random offset in [-maxJitter, maxJitter] added on top, see
+ *        wakeSlotMaxJitterMs().
+ */
+uint32_t slottedSleepMs(uint64_t clockMs, uint32_t intervalMs, uint32_t phaseMs, uint32_t minSleepMs, int32_t jitterMs);
+
+// jitter bound for an interval: 5% of it, at most 2 s
+uint32_t wakeSlotMaxJitterMs(uint32_t intervalMs);
+
+#endif // WAKESLOT_H
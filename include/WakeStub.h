@@ -0,0 +1,142 @@
+#ifndef WAKESTUB_H
+#define WAKESTUB_H
+
+#include <stdint.h>
+#include "SampleBuffer.h"
+
+/**
+ * @brief Sample-only wakes without booting the firmware.
+ *
+ * With SAMPLES_PER_UPLOAD > 1 most timer wakes only take a reading and go
+ * back to sleep. Booting for that costs the bootloader, loading the app,
+ * Arduino init and setup() (with its delays) before we even know there is
+ * nothing to send. The deep sleep wake stub (src/WakeStub.cpp) runs from RTC
+ * memory right after the ROM, powers the sensor, reads it over a bit-banged
+ * I2C, adds the reading to the RTC sample buffer and sleeps again. It only
+ * lets the firmware boot when decideWake() says so: the button was pressed,
+ * an alarm came on or went off (AlarmMonitor.h), an upload is due or the
+ * buffer is full.
+ *
+ * Without the stub (WAKE_STUB=0, or a core older than 2.0.3) the firmware
+ * makes the same decision after booting, so batching works either way, just
+ * slower.
+ *
+ * decideWake() and finishSampleOnlyWake() are inline and call nothing, so
+ * the stub, the firmware and the fleet simulator all run the same code.
+ */
+
+// readings per upload. 1 uploads on every wake like before; 6 with the
+// default 5 minute interval samples every 5 minutes and uploads every 30
+#ifndef SAMPLES_PER_UPLOAD
+#define SAMPLES_PER_UPLOAD 1
+#endif
+
+static_assert(SAMPLES_PER_UPLOAD >= 1 && SAMPLES_PER_UPLOAD <= SampleBuffer::CAPACITY, "SAMPLES_PER_UPLOAD must fit in the sample buffer");
+
+// the stub is written for the C3's registers. From ESP-IDF 5.1 (Arduino core
+// 3.x) it sleeps again through esp_wake_stub.h and is on by default. IDF 4.4
+// (core 2.0.3 and up, what the espressif32 platform ships) has no such API,
+// there it does the same steps on the registers by hand. Those haven't been
+// measured on an XIAO ESP32-C3 yet, and a wrong write leaves a node that
+// doesn't wake, so they are opt in with -DWAKE_STUB_IDF44=1.
+// Build with -DWAKE_STUB=0 to leave the stub out.
+#ifndef WAKE_STUB_IDF44
+#define WAKE_STUB_IDF44 0
+#endif
+#ifndef WAKE_STUB
+#if __has_include("esp_idf_version.h") && __has_include("sdkconfig.h")
+#include "esp_idf_version.h"
+#include "sdkconfig.h"
+#if defined(CONFIG_IDF_TARGET_ESP32C3) && (ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 1, 0) || \
+                                           (WAKE_STUB_IDF44 && ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(4, 4, 0)))
+#define WAKE_STUB 1
+#endif
+#endif
+#ifndef WAKE_STUB
+#define WAKE_STUB 0
+#endif
+#endif
+
+/**
+ * @brief What the stub works from, in RTC memory. The firmware fills it in
+ * before deep sleep (wakePlanArm()), the stub keeps it up to date.
+ */
+struct WakePlan {
+  bool armed;               // false after power on, every wake boots until the firmware armed it
+  uint8_t wakesUntilUpload; // sample-only wakes left before the next upload
+  uint32_t intervalMs;      // a sample-only wake sleeps this long (minus its own time)
+  uint64_t wakeTicks;       // RTC slow clock when this wake started, set by the stub
+  uint64_t armTicks;        // RTC slow clock when the firmware armed the plan...
+  int64_t armRawUs;         // ...and TimeKeeper::rawClockUs() at that moment
+
+  // since the last upload, see WakeReport
+  uint16_t stubWakes;
+  uint16_t stubSensorFailures;
+  uint16_t bootWakes;
+  uint32_t stubAwakeUs;
+  uint32_t bootAwakeMs;
+};
+
+enum WakeDecision : uint8_t {
+  WAKE_SAMPLE_ONLY,        // take a reading, keep it, sleep again
+  WAKE_BOOT_NOT_ARMED,     // first wake after power on
+  WAKE_BOOT_BUTTON,        // someone wants the info screen
+  WAKE_BOOT_ALARM,         // a threshold was crossed, that goes out now
+  WAKE_BOOT_UPLOAD_DUE,
+  WAKE_BOOT_BUFFER_FULL,   // uploading now beats dropping readings
+  WAKE_BOOT_SENSOR_FAILED  // the stub couldn't read the sensor, the firmware tries
+};
+
+// what sleeps in the stats and the telemetry, see ApiHandler
+struct WakeReport {
+  uint16_t stubWakes;
+  uint32_t stubAvgUs;      // stub entry to sleep
+  uint16_t bootWakes;
+  uint32_t bootAvgMs;      // stub entry (or power on) to sleep, so including the boot
+  uint16_t stubSensorFailures;
+};
+
+/**
+ * @brief Whether a wake needs the firmware. Runs inside the stub, so it is
+ * inline and only touches RTC memory.
+ *
+ * @param timerWake false for the button (or anything else that isn't the timer).
+ * @param alarmDue an alarm change hasn't gone out yet, see AlarmMonitor::due().
+ */
+static inline __attribute__((always_inline)) WakeDecision decideWake(const WakePlan& plan, bool timerWake, const SampleBuffer& buffer, bool alarmDue) {
+  if (!plan.armed) return WAKE_BOOT_NOT_ARMED;
+  if (!timerWake) return WAKE_BOOT_BUTTON;
+  if (alarmDue) return WAKE_BOOT_ALARM;
+  if (plan.wakesUntilUpload == 0) return WAKE_BOOT_UPLOAD_DUE;
+  if (buffer.count >= SampleBuffer::CAPACITY) return WAKE_BOOT_BUFFER_FULL;
+  return WAKE_SAMPLE_ONLY;
+}
+
+// a sample-only wake has its reading: keep it and count down to the upload
+static inline __attribute__((always_inline)) void finishSampleOnlyWake(WakePlan& plan, SampleBuffer& buffer, const Sample& sample) {
+  buffer.push(sample);
+  if (plan.wakesUntilUpload > 0) plan.wakesUntilUpload--;
+}
+
+// RTC memory, wakePlan is in WakeStub.cpp and sampleBuffer in main.cpp
+extern WakePlan wakePlan;
+extern SampleBuffer sampleBuffer;
+
+// firmware side
+
+// right before deep sleep: counts this boot and hands the next wakes to the stub
+void wakePlanArm(WakePlan& plan, uint32_t intervalMs);
+
+// an upload went through: the next SAMPLES_PER_UPLOAD - 1 wakes only sample, and the stats start over
+void wakePlanUploaded(WakePlan& plan);
+
+// an upload failed: boot on every wake until one works, ConnectivityPolicy decides how hard to try
+void wakePlanUploadFailed(WakePlan& plan);
+
+// ms from the start of this wake (stub entry, or power on) to now
+uint32_t wakePlanAwakeMs(const WakePlan& plan);
+
+// fills in report, false if there is nothing to report
+bool wakePlanReport(const WakePlan& plan, WakeReport& report);
+
+#endif // WAKESTUB_H
@@ -0,0 +1,100 @@
+"""
+Minifies and gzips the captive portal pages in web/ into flash arrays.
+
+Runs automatically before every PlatformIO build (see extra_scripts in
+platformio.ini) and can also be run by hand:
+
+    python scripts/build_portal_assets.py
+
+The output is include/PortalAssets.h. It is only rewritten when the content
+actually changes so it doesn't trigger a full rebuild every time.
+"""
+import gzip
+import hashlib
+import os
+import re
+
+# (source file, C identifier prefix, content type)
+ASSETS = [
+    ("config.html", "CONFIG_PAGE", "text/html"),
+    ("saved.html", "SAVED_PAGE", "text/html"),
+]
+
+
+def project_dir():
+    try:
+        Import("env")  # noqa: F821 - only defined when run by PlatformIO
+        return env["PROJECT_DIR"]  # noqa: F821
+    except NameError:
+        return os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+
+def minify_html(text):
+    # good enough for our hand written pages: drop indentation and line breaks
+    # and squash the whitespace between tags. Nothing in them depends on it.
+    text = re.sub(r"<!--.*?-->", "", text, flags=re.S)
+    # whole-line // comments in scripts have to go before lines get joined
+    lines = [line.strip() for line in text.splitlines()]
+    text = "".join(line for line in lines if not line.startswith("//"))
+    text = re.sub(r">\s+<", "><", text)
+    # CSS punctuation only inside <style>, the page text has commas too
+    text = re.sub(r"<style>(.*?)</style>",
+                  lambda m: "<style>" + re.sub(r"\s*([{};:,])\s*", r"\1", m.group(1)) + "</style>",
+                  text, flags=re.S)
+    return text
+
+
+def c_array(data):
+    lines = []
+    for i in range(0, len(data), 16):
+        lines.append("  " + ", ".join("0x%02x" % b for b in data[i:i + 16]) + ",")
+    return "\n".join(lines)
+
+
+def build(root):
+    web_dir = os.path.join(root, "web")
+    out_path = os.path.join(root, "include", "PortalAssets.h")
+
+    out = [
+        "// GENERATED by scripts/build_portal_assets.py from web/ - do not edit.",
+        "#ifndef PORTALASSETS_H",
+        "#define PORTALASSETS_H",
+        "",
+        "#include <Arduino.h>",
+        "",
+    ]
+    report = []
+    for filename, name, content_type in ASSETS:
+        with open(os.path.join(web_dir, filename), encoding="utf-8") as f:
+            raw = f.read()
+        minified = minify_html(raw).encode("utf-8")
+        # mtime=0 keeps the output (and the ETag) stable between builds
+        packed = gzip.compress(minified, compresslevel=9, mtime=0)
+        etag = '"%s"' % hashlib.sha1(packed).hexdigest()[:16]
+
+        out += [
+            "// %s: %d bytes raw, %d minified, %d gzipped" % (filename, len(raw.encode("utf-8")), len(minified), len(packed)),
+            'const char %s_TYPE[] = "%s";' % (name, content_type),
+            'const char %s_ETAG[] = "%s";' % (name, etag.replace('"', '\\"')),
+            "const size_t %s_GZ_LEN = %d;" % (name, len(packed)),
+            "const uint8_t %s_GZ[] PROGMEM = {" % name,
+            c_array(packed),
+            "};",
+            "",
+        ]
+        report.append("%s %d -> %d bytes" % (filename, len(raw.encode("utf-8")), len(packed)))
+
+    out += ["#endif // PORTALASSETS_H", ""]
+    text = "\n".join(out)
+
+    old = None
+    if os.path.exists(out_path):
+        with open(out_path, encoding="utf-8") as f:
+            old = f.read()
+    if old != text:
+        with open(out_path, "w", encoding="utf-8") as f:
+            f.write(text)
+        print("Portal assets rebuilt: " + ", ".join(report))
+
+
+build(project_dir())
@@ -0,0 +1,141 @@
+#include "SimNode.h"
+#include <Arduino.h>
+#include <esp_timer.h>
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+
+SimNode simNode;
+
+void SimNode::advanceUs(uint64_t us) {
+  uint64_t untilUs = awakeUs + us;
+  // timers due on the way run at their time, and may not come back
+  while (simRunTimerDue(untilUs)) {}
+  if (awakeUs < untilUs) awakeUs = untilUs;
+  if (!idle && awakeUs - cycleStartUs > MAX_AWAKE_US) finish(SIM_END_STUCK);
+}
+
+int64_t SimNode::rawClockUs() const {
+  return rawClockAtBootUs + (int64_t)(awakeUs * clockRate);
+}
+
+int64_t SimNode::epochMs() const {
+  return epochAtBootMs + (int64_t)(awakeUs / 1000);
+}
+
+void SimNode::recordRequest(int code, uint8_t endpoint, uint16_t port, uint32_t bodyBytes, uint32_t latencyUs, uint64_t finishedUs,
+                            bool reused) {
+  if (result.requestCount >= SIM_MAX_REQUESTS) return;
+  SimRequest& request = result.requests[result.requestCount++];
+  request.code = code;
+  request.endpoint = endpoint;
+  request.port = port;
+  request.reused = reused;
+  request.bodyBytes = bodyBytes;
+  request.latencyUs = latencyUs;
+  request.finishedUs = finishedUs;
+  request.atMs = (awakeUs - cycleStartUs) / 1000;
+}
+
+static bool writeAll(int fd, const void* data, size_t length) {
+  const char* p = (const char*)data;
+  while (length > 0) {
+    ssize_t written = write(fd, p, length);
+    if (written <= 0) return false;
+    p += written;
+    length -= written;
+  }
+  return true;
+}
+
+// result, then NVS, then RTC memory, each with its length in front
+static void sendResult(const SimNode& node) {
+  std::string nvsData = simEncodeNvs(node.nvs);
+  uint32_t nvsLength = nvsData.size();
+  uint32_t rtcLength = __stop_sim_rtc_data - __start_sim_rtc_data;
+  writeAll(node.resultFd, &node.result, sizeof(node.result));
+  writeAll(node.resultFd, &nvsLength, sizeof(nvsLength));
+  writeAll(node.resultFd, nvsData.data(), nvsLength);
+  writeAll(node.resultFd, &rtcLength, sizeof(rtcLength));
+  writeAll(node.resultFd, __start_sim_rtc_data, rtcLength);
+  if (node.trace) fflush(stdout);
+}
+
+void SimNode::finish(SimWakeEnd end) {
+  if (radioOn) result.radioMs += (awakeUs - radioOnSinceUs) / 1000;
+  result.end = end;
+  result.awakeMs = (awakeUs - cycleStartUs) / 1000;
+  sendResult(*this);
+  _exit(0);
+}
+
+SimAccessPoint SimNode::endIdle() {
+  result.end = SIM_END_IDLE;
+  result.awakeMs = (idleSinceUs - cycleStartUs) / 1000;
+  result.sleepUs = awakeUs - idleSinceUs;
+  sendResult(*this);
+
+  // the runner closes the socket when the run is over
+  SimResume resume;
+  char* p = (char*)&resume;
+  size_t length = sizeof(resume);
+  while (length > 0) {
+    ssize_t got = read(resultFd, p, length);
+    if (got <= 0) _exit(0);
+    p += got;
+    length -= got;
+  }
+
+  memset(&result, 0, sizeof(result));
+  idle = false;
+  cycleStartUs = awakeUs;
+  accessPoint = resume.accessPoint;
+  temperatureCenti = resume.temperatureCenti;
+  return resume.accessPoint;
+}
+
+std::string simEncodeNvs(const std::map<std::string, std::string>& nvs) {
+  std::string data;
+  for (const auto& entry : nvs) {
+    uint16_t keyLength = entry.first.size();
+    uint16_t valueLength = entry.second.size();
+    data.append((const char*)&keyLength, sizeof(keyLength));
+    data.append(entry.first);
+    data.append((const char*)&valueLength, sizeof(valueLength));
+    data.append(entry.second);
+  }
+  return data;
+}
+
+bool simDecodeNvs(const std::string& data, std::map<std::string, std::string>& nvs) {
+  nvs.clear();
+  size_t pos = 0;
+  while (pos < data.size()) {
+    uint16_t keyLength, valueLength;
+    if (pos + sizeof(keyLength) > data.size()) return false;
+    memcpy(&keyLength, data.data() + pos, sizeof(keyLength));
+    pos += sizeof(keyLength);
+    if (pos + keyLength + sizeof(valueLength) > data.size()) return false;
+    std::string key = data.substr(pos, keyLength);
+    pos += keyLength;
+    memcpy(&valueLength, data.data() + pos, sizeof(valueLength));
+    pos += sizeof(valueLength);
+    if (pos + valueLength > data.size()) return false;
+    nvs[key] = data.substr(pos, valueLength);
+    pos += valueLength;
+  }
+  return true;
+}
+
+uint64_t simWallUs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+int simGettimeofday(struct timeval* tv, void* tz) {
+  int64_t us = simNode.rawClockUs();
+  tv->tv_sec = us / 1000000;
+  tv->tv_usec = us % 1000000;
+  return 0;
+}
@@ -0,0 +1,146 @@
+#ifndef SIMNODE_H
+#define SIMNODE_H
+
+#include <stdint.h>
+#include <map>
+#include <string>
+#include <esp_sleep.h>
+
+/**
+ * @brief Everything the HAL shim needs to know about the node that is
+ * currently awake.
+ *
+ * The simulator runs every wake of every node in its own forked process, so
+ * there is exactly one node per process and this can be a plain global. The
+ * runner fills it in before the fork, the child runs setup() / loop() until
+ * the firmware goes to deep sleep (or restarts), then the result, the NVS
+ * contents and RTC memory go back to the runner through a socket.
+ *
+ * A node that stays associated between readings (SleepPolicy.h) keeps its
+ * process: at the end of each connected idle it sends the cycle like a
+ * finished wake and waits until the runner says its time has come.
+ */
+
+// what a request looked like from the node's side
+struct SimRequest {
+  int16_t code;         // HTTP status, or a negative HTTPC_ERROR_*
+  uint8_t endpoint;     // SIM_ENDPOINT_*
+  uint16_t port;        // which server, for runs with fallback URLs
+  bool reused;          // went over a connection kept from an earlier request
+  uint32_t latencyUs;   // wall clock, connect to last byte
+  uint32_t bodyBytes;   // request body
+  uint64_t finishedUs;  // wall clock, for throughput
+  uint32_t atMs;        // virtual, wake (or cycle) start to the answer
+};
+
+enum {
+  SIM_ENDPOINT_OTHER,
+  SIM_ENDPOINT_DEVICES,
+  SIM_ENDPOINT_INGEST,
+  SIM_ENDPOINT_COUNT
+};
+
+const int SIM_MAX_REQUESTS = 8;
+
+enum SimWakeEnd {
+  SIM_END_SLEEP,    // esp_deep_sleep_start()
+  SIM_END_RESTART,  // ESP.restart()
+  SIM_END_STUCK,    // still awake after SimNode::MAX_AWAKE_US
+  SIM_END_IDLE      // idled connected, the process waits for a SimResume
+};
+
+struct SimWakeResult {
+  uint8_t end;          // SimWakeEnd
+  uint64_t sleepUs;     // timer wakeup that was set (RTC), or how long it idled (virtual)
+  uint32_t awakeMs;     // boot (or the last idle) to sleep, virtual
+  uint32_t radioMs;     // WiFi on, virtual
+  bool wifiConnected;
+  int8_t txQdbm;        // last WiFi.setTxPower(), 0 if the radio never came on
+  int8_t rssi;          // the AP after connecting
+  uint8_t connectRetries; // association attempts that failed before one worked
+  bool budgetSleep;     // went to sleep from a timer callback, the awake budget ran out
+  uint8_t requestCount;
+  SimRequest requests[SIM_MAX_REQUESTS];
+};
+
+// the access point as this wake sees it
+struct SimAccessPoint {
+  bool up;
+  uint8_t channel;
+  uint32_t scanMs;      // a plain WiFi.begin() scans channels until it finds the AP
+  uint32_t associateMs; // found the AP to WL_CONNECTED
+  uint8_t pathLossDb;   // between the node and the AP this wake, same both ways
+};
+
+// the AP sends at this, so the node hears it at SIM_AP_TX_DBM - pathLossDb
+const int SIM_AP_TX_DBM = 20;
+// the AP can't hear the node below this, and between it and
+// SIM_AP_SENSITIVITY_DBM + SIM_MARGINAL_DB some association attempts fail
+const int SIM_AP_SENSITIVITY_DBM = -85;
+const int SIM_MARGINAL_DB = 8;
+
+// what an idle node gets from the runner when it's due
+struct SimResume {
+  SimAccessPoint accessPoint; // the AP may have gone in the meantime
+  int16_t temperatureCenti;   // and the room may have warmed up
+};
+
+struct SimNode {
+  // give up on a wake that never sleeps, e.g. a node that lost its config
+  static const uint64_t MAX_AWAKE_US = 600ULL * 1000000;
+
+  int index;
+  char mac[18];
+  esp_sleep_wakeup_cause_t wakeCause;
+  SimAccessPoint accessPoint;
+  int16_t temperatureCenti; // what the sensor reads this wake, noise comes on top
+  double clockRate;         // RTC seconds per real second
+  int64_t rawClockAtBootUs; // what gettimeofday() says at boot
+  int64_t epochAtBootMs;    // true time at boot, for the Date header
+  bool trace;               // print this node's serial output
+
+  // NVS, "namespace/key" -> raw bytes of the value
+  std::map<std::string, std::string> nvs;
+
+  // virtual time since boot
+  uint64_t awakeUs;
+  uint64_t radioOnSinceUs;
+  bool radioOn;
+  uint64_t cycleStartUs; // boot, or the end of the last connected idle
+  bool idle;             // in a connected idle, see SimWiFi::setSleep()
+  uint64_t idleSinceUs;
+  bool inTimer;          // an esp_timer callback is running
+
+  SimWakeResult result;
+  int resultFd;
+
+  void advanceUs(uint64_t us);
+  int64_t rawClockUs() const;
+  int64_t epochMs() const;
+  void recordRequest(int code, uint8_t endpoint, uint16_t port, uint32_t bodyBytes, uint32_t latencyUs, uint64_t finishedUs,
+                     bool reused = false);
+
+  // sends the result to the runner and ends the process
+  [[noreturn]] void finish(SimWakeEnd end);
+
+  // the firmware stops idling: sends the cycle up to the idle to the runner
+  // and waits until the node's time comes, the access point it finds then is
+  // returned. Nothing the node does while idle (delay(), the button) touches
+  // the outside world, so the runner only has to stop it at the end.
+  SimAccessPoint endIdle();
+};
+
+extern SimNode simNode;
+
+// NVS blob <-> map, for the pipe
+std::string simEncodeNvs(const std::map<std::string, std::string>& nvs);
+bool simDecodeNvs(const std::string& data, std::map<std::string, std::string>& nvs);
+
+// RTC_DATA_ATTR variables, see sim/hal/Arduino.h
+extern "C" char __start_sim_rtc_data[];
+extern "C" char __stop_sim_rtc_data[];
+
+// wall clock in us, for latency and throughput
+uint64_t simWallUs();
+
+#endif // SIMNODE_H
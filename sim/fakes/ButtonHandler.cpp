@@ -0,0 +1,19 @@
+// Simulated button: never pressed.
+#include "ButtonHandler.h"
+
+#if HAS_BUTTON
+
+ButtonHandler::ButtonHandler(int pin) : _pin(pin) {
+}
+
+void ButtonHandler::begin() {
+}
+
+void ButtonHandler::tick() {
+}
+
+ButtonEvent ButtonHandler::getEvent() {
+  return EV_NONE;
+}
+
+#endif // HAS_BUTTON
@@ -0,0 +1,24 @@
+// Simulated OLED: the text goes to the node's trace.
+#include "OLEDHandler.h"
+
+#if HAS_OLED
+
+OLEDHandler::OLEDHandler(uint16_t SDA, uint16_t SCL) : sda_pin(SDA), scl_pin(SCL) {
+}
+
+void OLEDHandler::initializeOLED() {
+  delay(100); // the real one waits for the display to power up
+}
+
+void OLEDHandler::displayText(const char* text) {
+  Serial.printf("[OLED] %s\n", text);
+}
+
+void OLEDHandler::displayInfo(const char* deviceName, const char* deviceId, const char* serverUrl, float temp, float humidity) {
+  Serial.printf("[OLED] %s %s %s %.1fC %.0f%%\n", deviceName, deviceId, serverUrl, temp, humidity);
+}
+
+void OLEDHandler::clearDisplay() {
+}
+
+#endif // HAS_OLED
@@ -0,0 +1,20 @@
+// Simulated OTA: there is no flash to patch, so an offered update is logged
+// and reported as failed. The node keeps running the same firmware.
+#include "OtaManager.h"
+
+OtaManager::OtaManager() : _onTrial(false) {
+}
+
+void OtaManager::begin() {
+}
+
+void OtaManager::markHealthy() {
+}
+
+void OtaManager::onUploadFailed() {
+}
+
+bool OtaManager::applyUpdate(const FirmwareUpdate& update, const char* serverUrl) {
+  Serial.printf("OTA: update to %s not simulated.\n", update.version);
+  return false;
+}
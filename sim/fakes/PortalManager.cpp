@@ -0,0 +1,41 @@
+// Simulated nodes come with their config already in NVS, so the portal is
+// never used. A node that ends up here anyway (lost config) just waits and
+// the simulator reports it as stuck.
+#include "Features.h"
+
+#if HAS_PORTAL
+
+#include "PortalManager.h"
+
+PortalManager::PortalManager(ConfigManager& configManager)
+  : _configManager(configManager), _server(80), _configPending(false), _configSaved(false), _setupResult(SETUP_PENDING), _scanReady(false),
+    _scanChannelCount(0) {
+}
+
+void PortalManager::start() {
+  Serial.println("Portal: not simulated.");
+}
+
+void PortalManager::loop() {
+}
+
+void PortalManager::stop() {
+}
+
+bool PortalManager::isConfigSaved() {
+  return _configSaved;
+}
+
+void PortalManager::clearConfigSaved() {
+  _configSaved = false;
+}
+
+void PortalManager::setSetupResult(SetupResult result) {
+  _setupResult = result;
+}
+
+int32_t PortalManager::moveToChannelOf(const char* ssid) {
+  return 0;
+}
+
+#endif // HAS_PORTAL
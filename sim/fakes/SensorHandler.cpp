@@ -0,0 +1,25 @@
+// Simulated AHT10: room temperature (the runner's, see --excursion) and
+// humidity with a bit of noise.
+#include "SensorHandler.h"
+#include "../SimNode.h"
+
+// one measurement takes about this long on the real sensor
+const unsigned long MEASUREMENT_MS = 80;
+
+SensorHandler::SensorHandler() {
+}
+
+bool SensorHandler::begin() {
+  delay(20);
+  return true;
+}
+
+float SensorHandler::readTemperature() {
+  delay(MEASUREMENT_MS);
+  return (simNode.temperatureCenti + (int)(esp_random() % 200)) / 100.0;
+}
+
+float SensorHandler::readHumidity() {
+  delay(MEASUREMENT_MS);
+  return 40.0 + (esp_random() % 1000) / 100.0;
+}
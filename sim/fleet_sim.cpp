@@ -0,0 +1,696 @@
+// Fleet simulator: runs the real firmware (main.cpp, ApiHandler,
+// ConfigManager, TimeKeeper, PowerManager...) for many virtual nodes
+// against a real server, and reports what the server saw and how long the
+// nodes were awake. See sim/README.md.
+
+#include <Arduino.h>
+#include <errno.h>
+#include <getopt.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include <map>
+#include <queue>
+#include <random>
+#include <vector>
+#include "SimNode.h"
+#include "ConfigManager.h"
+#include "PowerManager.h"
+#include "WakeStub.h"
+#include "SleepPolicy.h"
+#include "AlarmMonitor.h"
+
+// from main.cpp
+void setup();
+void loop();
+
+// ROM, bootloader and Arduino init before setup() runs
+const uint64_t BOOT_US = 250000;
+// a software reset takes about this long to get back to setup()
+const double RESTART_MS = 300;
+// time one pass through loop() takes on the real node, roughly
+const uint64_t LOOP_US = 1000;
+// a sample-only wake in the wake stub: the AHT's power up and conversion
+// waits (130 ms) plus the ROM and the I2C traffic
+const uint64_t STUB_US = 140000;
+// the room, the sensor adds up to 2 C of noise
+const int16_t ROOM_CENTI = 2100;
+
+// rough ESP32-C3 radio currents, only for comparing runs: ~85 mA receiving or
+// listening, transmitting from ~190 mA at 2 dBm up to ~290 mA at 19.5 dBm,
+// and a short wake transmits for about a fifth of the time the radio is on
+const double RX_MA = 85;
+const double TX_DUTY = 0.2;
+static double radioMa(int txQdbm) {
+  return RX_MA + TX_DUTY * (180 + 5.5 * txQdbm / 4.0 - RX_MA);
+}
+
+struct Options {
+  int nodes = 100;
+  const char* server = "http://127.0.0.1:4000/api";
+  const char* fallbacks[FALLBACK_URL_COUNT] = {}; // --fallback, in order
+  int interval = 300;
+  double hours = 1;
+  double speed = 0;       // simulated seconds per wall second, 0 = as fast as it goes
+  int jobs = 32;          // wakes running at once
+  double spread = 0;      // power on times spread over this many seconds
+  double drift = 2;       // RTC error, +/- percent
+  double wifiFail = 0;    // chance the AP isn't there on a wake
+  double outageStart = -1; // minutes
+  double outageLength = 0; // minutes
+  int trace = -1;
+  unsigned seed = 1;
+  bool stub = true;       // run the wake stub's sample-only wakes
+  int txMin = 0;          // TX power bounds the nodes are configured with, 0 = none
+  int txMax = 0;
+  double farthest = 98;   // path loss to the AP is spread from 60 dB up to this
+  int alarmHigh = CONFIG_NO_THRESHOLD; // temperature alarm the nodes are configured with, centi C
+  double excursionStart = -1; // minutes
+  double excursionLength = 0; // minutes
+  int excursionCenti = 0;     // the room's temperature during it
+};
+
+struct Node {
+  std::map<std::string, std::string> nvs;
+  std::vector<char> rtc;
+  double clockRate;
+  int64_t rawClockUs; // RTC clock at the next boot
+  esp_sleep_wakeup_cause_t cause;
+  uint32_t wakes;
+  bool stuck;
+  double pathLossDb;  // where it sits, each wake adds some fading
+  pid_t idlePid;      // the process of a node idling connected, 0 if none
+  int idleFd;         // and its socket
+  bool excursionSent; // an upload since the excursion started got through
+};
+
+struct Running {
+  pid_t pid;
+  int node;
+  double startMs; // simulated
+  bool resumed;   // after a connected idle, not a boot
+};
+
+struct Stats {
+  std::vector<uint32_t> latencyUs[SIM_ENDPOINT_COUNT];
+  std::map<int, uint32_t> codes[SIM_ENDPOINT_COUNT];
+  uint64_t bodyBytes[SIM_ENDPOINT_COUNT] = {};
+  std::vector<uint64_t> finishedUs;
+  std::map<uint16_t, std::vector<uint32_t>> serverLatencyUs; // by port, requests it answered
+  std::map<uint16_t, uint32_t> serverFailures;               // by port, no answer or a 5xx
+  std::vector<uint32_t> awakeMs;
+  std::vector<uint32_t> bootAwakeMs; // wakes that ran the firmware
+  uint32_t stubWakes = 0;
+  uint32_t idles = 0;          // connected idles
+  uint64_t idleMs = 0;
+  uint64_t deepSleepMs = 0;
+  uint32_t reusedRequests = 0; // over a kept connection
+  uint64_t radioMs = 0;
+  double radioMas = 0;      // radio charge, see radioMa()
+  uint64_t txQdbmTotal = 0; // over the wakes that turned the radio on
+  uint32_t txWakes = 0;
+  uint32_t retriedWakes = 0;
+  uint32_t connectRetries = 0;
+  uint32_t wakes = 0;
+  uint32_t restarts = 0;
+  uint32_t stuck = 0;
+  uint32_t budgetSleeps = 0; // wakes the awake budget cut short
+  uint32_t wifiFailed = 0;
+  uint32_t delivered = 0;
+  double maxLagMs = 0;
+  std::vector<double> excursionMs; // excursion start to each node's first upload after it
+};
+
+static Options options;
+static std::vector<Node> nodes;
+static Stats stats;
+static std::mt19937 rng;
+static int64_t simEpochMs;
+
+static void usage() {
+  printf("usage: program [options]\n"
+         "  --nodes N        virtual nodes (100)\n"
+         "  --server URL     server URL the nodes are configured with (http://127.0.0.1:4000/api)\n"
+         "  --fallback URL   fallback server URL, up to 2 (give it twice)\n"
+         "  --interval S     sleep interval in seconds (300)\n"
+         "  --hours H        simulated time (1)\n"
+         "  --speed X        simulated seconds per real second, 0 = as fast as possible (0)\n"
+         "  --jobs J         wakes running at the same time (32)\n"
+         "  --spread S       spread power on over S seconds, 0 = all at once (0)\n"
+         "  --drift PCT      RTC clock error, +/- percent (2)\n"
+         "  --wifi-fail P    chance the AP is unreachable on any wake (0)\n"
+         "  --outage M:L     AP down for everyone from minute M for L minutes\n"
+         "  --trace N        print the serial output of node N\n"
+         "  --no-stub        boot the firmware for sample-only wakes too\n"
+         "  --tx-power A:B   configure TX power bounds in dBm, 0 = none (0:0, 20:0 pins full power)\n"
+         "  --farthest DB    path loss to the AP of the farthest node (98)\n"
+         "  --alarm-high C   configure a high temperature alarm at C degrees (none)\n"
+         "  --excursion M:L:C  the room is at C degrees from minute M for L minutes\n"
+         "  --seed N         random seed (1)\n");
+}
+
+static bool parseOptions(int argc, char** argv) {
+  static const struct option longOptions[] = {
+    { "nodes", required_argument, nullptr, 'n' },
+    { "server", required_argument, nullptr, 's' },
+    { "fallback", required_argument, nullptr, 'F' },
+    { "interval", required_argument, nullptr, 'i' },
+    { "hours", required_argument, nullptr, 'h' },
+    { "speed", required_argument, nullptr, 'x' },
+    { "jobs", required_argument, nullptr, 'j' },
+    { "spread", required_argument, nullptr, 'p' },
+    { "drift", required_argument, nullptr, 'd' },
+    { "wifi-fail", required_argument, nullptr, 'w' },
+    { "outage", required_argument, nullptr, 'o' },
+    { "trace", required_argument, nullptr, 't' },
+    { "seed", required_argument, nullptr, 'r' },
+    { "no-stub", no_argument, nullptr, 'S' },
+    { "tx-power", required_argument, nullptr, 'T' },
+    { "farthest", required_argument, nullptr, 'f' },
+    { "alarm-high", required_argument, nullptr, 'A' },
+    { "excursion", required_argument, nullptr, 'E' },
+    { nullptr, 0, nullptr, 0 }
+  };
+  int option;
+  while ((option = getopt_long(argc, argv, "", longOptions, nullptr)) != -1) {
+    switch (option) {
+      case 'n': options.nodes = atoi(optarg); break;
+      case 's': options.server = optarg; break;
+      case 'F': {
+        int i = 0;
+        while (i < FALLBACK_URL_COUNT && options.fallbacks[i]) i++;
+        if (i == FALLBACK_URL_COUNT) return false;
+        options.fallbacks[i] = optarg;
+        break;
+      }
+      case 'i': options.interval = atoi(optarg); break;
+      case 'h': options.hours = atof(optarg); break;
+      case 'x': options.speed = atof(optarg); break;
+      case 'j': options.jobs = atoi(optarg); break;
+      case 'p': options.spread = atof(optarg); break;
+      case 'd': options.drift = atof(optarg); break;
+      case 'w': options.wifiFail = atof(optarg); break;
+      case 'o':
+        if (sscanf(optarg, "%lf:%lf", &options.outageStart, &options.outageLength) != 2) return false;
+        break;
+      case 't': options.trace = atoi(optarg); break;
+      case 'r': options.seed = atoi(optarg); break;
+      case 'S': options.stub = false; break;
+      case 'T':
+        if (sscanf(optarg, "%d:%d", &options.txMin, &options.txMax) != 2) return false;
+        break;
+      case 'f': options.farthest = atof(optarg); break;
+      case 'A': options.alarmHigh = (int)lround(atof(optarg) * 100); break;
+      case 'E': {
+        double celsius;
+        if (sscanf(optarg, "%lf:%lf:%lf", &options.excursionStart, &options.excursionLength, &celsius) != 3) return false;
+        options.excursionCenti = (int)lround(celsius * 100);
+        break;
+      }
+      default: return false;
+    }
+  }
+  return options.nodes > 0 && options.jobs > 0 && options.interval > 0;
+}
+
+// every node starts out configured exactly like the portal would leave it
+static void createNodes() {
+  std::uniform_real_distribution<double> rate(1 - options.drift / 100, 1 + options.drift / 100);
+  std::uniform_real_distribution<double> pathLoss(60, std::max(60.0, options.farthest));
+  std::vector<char> rtc(__start_sim_rtc_data, __stop_sim_rtc_data);
+
+  nodes.resize(options.nodes);
+  for (int i = 0; i < options.nodes; i++) {
+    simNode.nvs.clear();
+    ConfigManager seed;
+    DeviceConfig& config = seed.getMutableConfig();
+    strncpy(config.wifiSSID, "sim", sizeof(config.wifiSSID));
+    strncpy(config.wifiPassword, "simulated", sizeof(config.wifiPassword));
+    strncpy(config.serverUrl, options.server, sizeof(config.serverUrl) - 1);
+    for (int f = 0; f < FALLBACK_URL_COUNT; f++) {
+      if (options.fallbacks[f]) strncpy(config.fallbackUrls[f], options.fallbacks[f], sizeof(config.fallbackUrls[f]) - 1);
+    }
+    snprintf(config.deviceName, sizeof(config.deviceName), "sim-%05d", i);
+    strncpy(config.deviceType, "Temp/Humidity", sizeof(config.deviceType));
+    strncpy(config.locationHint, "simulator", sizeof(config.locationHint));
+    config.sleepIntervalSeconds = options.interval;
+    config.txPowerMinDbm = options.txMin;
+    config.txPowerMaxDbm = options.txMax;
+    config.alarmTempHighCenti = options.alarmHigh;
+    config.alarmTempLowCenti = CONFIG_NO_THRESHOLD;
+    config.alarmHumidityHighCenti = CONFIG_NO_THRESHOLD;
+    config.alarmHumidityLowCenti = CONFIG_NO_THRESHOLD;
+    config.configured = true;
+    seed.saveConfig();
+
+    Node& node = nodes[i];
+    node.nvs = simNode.nvs;
+    node.rtc = rtc;
+    node.clockRate = rate(rng);
+    node.rawClockUs = 0;
+    node.cause = ESP_SLEEP_WAKEUP_UNDEFINED;
+    node.wakes = 0;
+    node.stuck = false;
+    node.pathLossDb = pathLoss(rng);
+    node.idlePid = 0;
+    node.idleFd = -1;
+    node.excursionSent = false;
+  }
+}
+
+static bool inExcursion(double timeMs) {
+  double minute = timeMs / 60000;
+  return options.excursionStart >= 0 && minute >= options.excursionStart && minute < options.excursionStart + options.excursionLength;
+}
+
+// the room at that moment, same for every node
+static int16_t temperatureAt(double timeMs) {
+  return inExcursion(timeMs) ? options.excursionCenti : ROOM_CENTI;
+}
+
+static SimAccessPoint accessPointAt(const Node& node, double timeMs) {
+  std::uniform_real_distribution<double> chance(0, 1);
+  std::normal_distribution<double> fading(0, 2);
+  std::uniform_int_distribution<uint32_t> associate(300, 800);
+  SimAccessPoint accessPoint;
+  double minute = timeMs / 60000;
+  bool outage = options.outageStart >= 0 && minute >= options.outageStart && minute < options.outageStart + options.outageLength;
+  accessPoint.up = !outage && chance(rng) >= options.wifiFail;
+  accessPoint.channel = 6;
+  accessPoint.scanMs = accessPoint.channel * 120; // active scan, channel 1 up
+  accessPoint.associateMs = associate(rng);
+  accessPoint.pathLossDb = (uint8_t)std::min(120.0, std::max(30.0, node.pathLossDb + fading(rng)));
+  return accessPoint;
+}
+
+// what the wake stub does before the firmware would boot: the same
+// decideWake() on the node's RTC memory, and if it's a sample-only wake the
+// reading goes in the buffer and the node sleeps again. Returns when it wakes
+// next, or < 0 if the firmware has to boot.
+static double stubWake(int index, double timeMs) {
+  Node& node = nodes[index];
+  if (!options.stub || node.cause != ESP_SLEEP_WAKEUP_TIMER) return -1;
+
+  // RTC memory is only borrowed, the runner itself doesn't use it
+  memcpy(__start_sim_rtc_data, node.rtc.data(), node.rtc.size());
+  if (decideWake(wakePlan, true, sampleBuffer, alarmState.changed != 0) != WAKE_SAMPLE_ONLY) return -1;
+
+  std::uniform_int_distribution<int> noise(0, 199);
+  Sample sample;
+  sample.rawSeconds = (node.rawClockUs + STUB_US) / 1000000;
+  sample.temperatureCenti = temperatureAt(timeMs) + noise(rng);
+  sample.humidityCenti = 4000 + noise(rng) * 5;
+  finishSampleOnlyWake(wakePlan, sampleBuffer, sample);
+  if (alarmCheck(alarmState, sample, node.rawClockUs)) {
+    // the real stub boots right there, the firmware sends it
+    memcpy(node.rtc.data(), __start_sim_rtc_data, node.rtc.size());
+    if (index == options.trace) printf("--- node %d, wake %u at %.1f s: stub saw an alarm\n", index, node.wakes + 1, timeMs / 1000);
+    return -1;
+  }
+  wakePlan.stubWakes++;
+  wakePlan.stubAwakeUs += STUB_US;
+  uint64_t sleepUs = wakePlan.intervalMs * 1000ULL - STUB_US;
+  memcpy(node.rtc.data(), __start_sim_rtc_data, node.rtc.size());
+
+  if (index == options.trace) {
+    printf("--- node %d, wake %u at %.1f s: stub sampled, %u to go\n", index, node.wakes + 1, timeMs / 1000, wakePlan.wakesUntilUpload);
+  }
+  node.wakes++;
+  stats.wakes++;
+  stats.stubWakes++;
+  stats.awakeMs.push_back(STUB_US / 1000);
+  node.rawClockUs += (int64_t)(STUB_US * node.clockRate) + sleepUs;
+  stats.deepSleepMs += sleepUs / 1000 / node.clockRate;
+  return timeMs + STUB_US / 1000.0 + sleepUs / 1000.0 / node.clockRate;
+}
+
+// one wake of one node in a child process, returns the runner's end of its socket
+static int launchWake(int index, double timeMs, Running& running) {
+  Node& node = nodes[index];
+
+  memset(&simNode.result, 0, sizeof(simNode.result));
+  simNode.index = index;
+  snprintf(simNode.mac, sizeof(simNode.mac), "02:00:00:%02X:%02X:%02X", (index >> 16) & 0xff, (index >> 8) & 0xff, index & 0xff);
+  simNode.wakeCause = node.cause;
+  simNode.accessPoint = accessPointAt(node, timeMs);
+  simNode.temperatureCenti = temperatureAt(timeMs);
+  simNode.clockRate = node.clockRate;
+  simNode.rawClockAtBootUs = node.rawClockUs;
+  simNode.epochAtBootMs = simEpochMs + (int64_t)timeMs;
+  simNode.trace = index == options.trace;
+  simNode.nvs = node.nvs;
+  simNode.awakeUs = BOOT_US;
+  simNode.radioOn = false;
+  simNode.radioOnSinceUs = 0;
+  simNode.cycleStartUs = 0;
+  simNode.idle = false;
+  simNode.inTimer = false;
+  uint32_t childSeed = rng();
+
+  if (simNode.trace) printf("--- node %d, wake %u at %.1f s\n", index, node.wakes + 1, timeMs / 1000);
+  fflush(stdout); // or the child prints our buffer again
+
+  // both ways, an idle node waits on it for its SimResume
+  int fds[2];
+  if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) return -1;
+  pid_t pid = fork();
+  if (pid < 0) {
+    close(fds[0]);
+    close(fds[1]);
+    return -1;
+  }
+  if (pid == 0) {
+    // nothing of the runner's, an idle node only sees the run end once every
+    // copy of the runner's end of its socket is closed
+    if (fds[1] > 3) close_range(3, fds[1] - 1, 0);
+    close_range(fds[1] + 1, ~0U, 0);
+    simNode.resultFd = fds[1];
+    srandom(childSeed);
+    memcpy(__start_sim_rtc_data, node.rtc.data(), node.rtc.size());
+    setup();
+    while (true) {
+      loop();
+      simNode.advanceUs(LOOP_US);
+    }
+  }
+
+  close(fds[1]);
+  running.pid = pid;
+  running.node = index;
+  running.startMs = timeMs;
+  running.resumed = false;
+  return fds[0];
+}
+
+// a node that idled connected goes on in the process it has
+static int resumeWake(int index, double timeMs, Running& running) {
+  Node& node = nodes[index];
+  SimResume resume;
+  resume.accessPoint = accessPointAt(node, timeMs);
+  resume.temperatureCenti = temperatureAt(timeMs);
+  if (index == options.trace) printf("--- node %d, wake %u at %.1f s (still connected)\n", index, node.wakes + 1, timeMs / 1000);
+  fflush(stdout);
+  if (write(node.idleFd, &resume, sizeof(resume)) != sizeof(resume)) return -1;
+
+  int fd = node.idleFd;
+  running.pid = node.idlePid;
+  running.node = index;
+  running.startMs = timeMs;
+  running.resumed = true;
+  node.idlePid = 0;
+  node.idleFd = -1;
+  return fd;
+}
+
+static bool readAll(int fd, void* data, size_t length) {
+  char* p = (char*)data;
+  while (length > 0) {
+    ssize_t got = read(fd, p, length);
+    if (got < 0 && errno == EINTR) continue;
+    if (got <= 0) return false;
+    p += got;
+    length -= got;
+  }
+  return true;
+}
+
+// picks up a finished wake, returns when the node wakes next (or < 0 if it doesn't)
+static double collectWake(int fd, const Running& running) {
+  Node& node = nodes[running.node];
+  SimWakeResult result;
+  uint32_t nvsLength = 0, rtcLength = 0;
+  std::string nvsData;
+  bool ok = readAll(fd, &result, sizeof(result)) && readAll(fd, &nvsLength, sizeof(nvsLength));
+  if (ok) {
+    nvsData.resize(nvsLength);
+    ok = readAll(fd, &nvsData[0], nvsLength) && readAll(fd, &rtcLength, sizeof(rtcLength)) &&
+         rtcLength == node.rtc.size() && readAll(fd, node.rtc.data(), rtcLength);
+  }
+  int status = 0;
+  if (ok && result.end == SIM_END_IDLE) {
+    // it waits for resumeWake()
+    node.idlePid = running.pid;
+    node.idleFd = fd;
+  }
+  else {
+    close(fd);
+    waitpid(running.pid, &status, 0);
+  }
+
+  if (!ok || !simDecodeNvs(nvsData, node.nvs)) {
+    fprintf(stderr, "node %d: wake crashed (status %d)\n", running.node, status);
+    node.stuck = true;
+    stats.stuck++;
+    return -1;
+  }
+
+  node.wakes++;
+  stats.wakes++;
+  stats.awakeMs.push_back(result.awakeMs);
+  if (!running.resumed) stats.bootAwakeMs.push_back(result.awakeMs);
+  stats.radioMs += result.radioMs;
+  if (result.radioMs > 0) {
+    int txQdbm = result.txQdbm ? result.txQdbm : 78;
+    stats.radioMas += result.radioMs / 1000.0 * radioMa(txQdbm);
+    stats.txQdbmTotal += txQdbm;
+    stats.txWakes++;
+  }
+  if (result.connectRetries > 0) {
+    stats.retriedWakes++;
+    stats.connectRetries += result.connectRetries;
+  }
+  if (!result.wifiConnected) stats.wifiFailed++;
+  if (result.budgetSleep) stats.budgetSleeps++;
+  for (int i = 0; i < result.requestCount; i++) {
+    const SimRequest& request = result.requests[i];
+    stats.codes[request.endpoint][request.code]++;
+    if (request.code > 0) {
+      stats.bodyBytes[request.endpoint] += request.bodyBytes;
+      stats.latencyUs[request.endpoint].push_back(request.latencyUs);
+      stats.finishedUs.push_back(request.finishedUs);
+    }
+    if (request.endpoint == SIM_ENDPOINT_INGEST && request.code >= 200 && request.code < 300) {
+      stats.delivered++;
+      // how long the server took to hear about the excursion from this node
+      double excursionMs = options.excursionStart * 60000;
+      if (options.excursionStart >= 0 && !node.excursionSent && running.startMs >= excursionMs) {
+        node.excursionSent = true;
+        stats.excursionMs.push_back(running.startMs + request.atMs - excursionMs);
+      }
+    }
+    if (request.reused) stats.reusedRequests++;
+    if (request.code > 0 && request.code < 500) stats.serverLatencyUs[request.port].push_back(request.latencyUs);
+    else stats.serverFailures[request.port]++;
+  }
+
+  // the RTC keeps counting (at its own rate) through the wake and the sleep
+  double endMs = running.startMs + result.awakeMs;
+  node.rawClockUs += (int64_t)(result.awakeMs * 1000.0 * node.clockRate);
+  switch (result.end) {
+    case SIM_END_SLEEP:
+      node.cause = ESP_SLEEP_WAKEUP_TIMER;
+      node.rawClockUs += result.sleepUs;
+      stats.deepSleepMs += result.sleepUs / 1000 / node.clockRate;
+      return endMs + result.sleepUs / 1000.0 / node.clockRate;
+    case SIM_END_IDLE:
+      // virtual time in the node, so the RTC ran at its rate through it
+      stats.idles++;
+      stats.idleMs += result.sleepUs / 1000;
+      node.rawClockUs += (int64_t)(result.sleepUs * node.clockRate);
+      return endMs + result.sleepUs / 1000.0;
+    case SIM_END_RESTART:
+      stats.restarts++;
+      node.cause = ESP_SLEEP_WAKEUP_UNDEFINED;
+      node.rawClockUs += (int64_t)(RESTART_MS * 1000 * node.clockRate);
+      return endMs + RESTART_MS;
+    default:
+      fprintf(stderr, "node %d: still awake after %u ms, dropping it\n", running.node, result.awakeMs);
+      node.stuck = true;
+      stats.stuck++;
+      return -1;
+  }
+}
+
+template <typename T>
+static double percentile(std::vector<T>& values, double p) {
+  if (values.empty()) return 0;
+  size_t index = std::min(values.size() - 1, (size_t)(p / 100 * values.size()));
+  std::nth_element(values.begin(), values.begin() + index, values.end());
+  return values[index];
+}
+
+static void report(double wallSeconds) {
+  static const char* ENDPOINT_NAMES[SIM_ENDPOINT_COUNT] = { "other", "/devices", "/ingest" };
+
+  printf("\n%d nodes, %d s interval, %.1f h simulated in %.1f s, wake slots %s, hybrid sleep %s\n",
+         options.nodes, options.interval, options.hours, wallSeconds, WAKE_SLOTS ? "on" : "off",
+         !HYBRID_SLEEP ? "off" : CONNECTED_LIGHT_SLEEP ? "on (light sleep)" : "on (modem sleep)");
+  printf("wakes             %u (%u without WiFi, %u restarts, %u stuck, %u cut short by the awake budget)\n",
+         stats.wakes, stats.wifiFailed, stats.restarts, stats.stuck, stats.budgetSleeps);
+  printf("samples/upload    %d, wake stub %s (%u sample-only wakes in the stub)\n",
+         SAMPLES_PER_UPLOAD, options.stub ? "on" : "off", stats.stubWakes);
+  printf("telemetry         %u delivered\n", stats.delivered);
+  if (options.excursionStart >= 0) {
+    char alarm[32] = "no alarm";
+    if (options.alarmHigh != CONFIG_NO_THRESHOLD) snprintf(alarm, sizeof(alarm), "alarm above %.1f C", options.alarmHigh / 100.0);
+    printf("excursion         to %.1f C at minute %.0f, %s: server heard p50 %.1f s  p90 %.1f s  max %.1f s later (%zu of %d nodes)\n",
+           options.excursionCenti / 100.0, options.excursionStart, alarm, percentile(stats.excursionMs, 50) / 1000,
+           percentile(stats.excursionMs, 90) / 1000, percentile(stats.excursionMs, 100) / 1000, stats.excursionMs.size(), options.nodes);
+  }
+
+  printf("\nserver side\n");
+  size_t answered = stats.finishedUs.size();
+  if (answered > 0) {
+    std::sort(stats.finishedUs.begin(), stats.finishedUs.end());
+    uint32_t peak = 0;
+    size_t windowStart = 0;
+    for (size_t i = 0; i < answered; i++) {
+      while (stats.finishedUs[i] - stats.finishedUs[windowStart] >= 1000000) windowStart++;
+      peak = std::max(peak, (uint32_t)(i - windowStart + 1));
+    }
+    double span = std::max(1.0, (stats.finishedUs.back() - stats.finishedUs.front()) / 1e6);
+    printf("throughput        %.0f req/s average, %u req/s peak (1 s window)\n", answered / span, peak);
+  }
+  if (options.speed > 0) printf("max lag           %.0f ms behind schedule\n", stats.maxLagMs);
+  printf("%-17s %8s %8s %8s %8s %8s %8s   %s\n", "latency ms", "count", "body B", "p50", "p90", "p99", "max", "status codes");
+  for (int endpoint = 0; endpoint < SIM_ENDPOINT_COUNT; endpoint++) {
+    std::vector<uint32_t>& latency = stats.latencyUs[endpoint];
+    if (stats.codes[endpoint].empty()) continue;
+    std::string codes;
+    for (const auto& code : stats.codes[endpoint]) {
+      codes += std::to_string(code.first) + " x" + std::to_string(code.second) + "  ";
+    }
+    printf("  %-15s %8zu %8.0f %8.1f %8.1f %8.1f %8.1f   %s\n", ENDPOINT_NAMES[endpoint], latency.size(),
+           latency.empty() ? 0.0 : (double)stats.bodyBytes[endpoint] / latency.size(), percentile(latency, 50) / 1000, percentile(latency, 90) / 1000, percentile(latency, 99) / 1000,
+           percentile(latency, 100) / 1000, codes.c_str());
+  }
+
+  if (options.fallbacks[0]) {
+    printf("%-17s %8s %8s %8s %8s %8s\n", "by server port", "answered", "failed", "p50", "p90", "max");
+    std::map<uint16_t, bool> ports;
+    for (const auto& server : stats.serverLatencyUs) ports[server.first] = true;
+    for (const auto& server : stats.serverFailures) ports[server.first] = true;
+    for (const auto& port : ports) {
+      std::vector<uint32_t>& latency = stats.serverLatencyUs[port.first];
+      printf("  %-15u %8zu %8u %8.1f %8.1f %8.1f\n", port.first, latency.size(), stats.serverFailures[port.first],
+             percentile(latency, 50) / 1000, percentile(latency, 90) / 1000, percentile(latency, 100) / 1000);
+    }
+  }
+
+  printf("\nnode side (simulated time)\n");
+  if (stats.wakes > 0) {
+    double awakeTotal = 0;
+    for (uint32_t ms : stats.awakeMs) awakeTotal += ms;
+    printf("awake ms/wake     p50 %.0f  p90 %.0f  p99 %.0f  max %.0f\n",
+           percentile(stats.awakeMs, 50), percentile(stats.awakeMs, 90), percentile(stats.awakeMs, 99), percentile(stats.awakeMs, 100));
+    if (stats.stubWakes > 0) {
+      printf("  firmware boots  p50 %.0f  p90 %.0f  (%zu wakes)\n", percentile(stats.bootAwakeMs, 50), percentile(stats.bootAwakeMs, 90), stats.bootAwakeMs.size());
+      printf("  wake stub       %.0f  (%u wakes)\n", STUB_US / 1000.0, stats.stubWakes);
+    }
+    printf("radio ms/wake     %.0f average\n", (double)stats.radioMs / stats.wakes);
+    double nodeDays = options.nodes * options.hours / 24;
+    printf("per node per day  %.0f s awake, %.0f s radio on, %.0f mAs radio charge (rough)\n", awakeTotal / 1000 / nodeDays,
+           stats.radioMs / 1000.0 / nodeDays, stats.radioMas / nodeDays);
+    if (stats.idles > 0) {
+      printf("connected idle    %u idles, %.0f s per node per day, %u requests on a kept connection\n", stats.idles,
+             stats.idleMs / 1000.0 / nodeDays, stats.reusedRequests);
+    }
+    // the whole node with SleepPolicy's currents, what it decides by
+    uint32_t idleUa = CONNECTED_LIGHT_SLEEP ? SLEEP_LIGHT_IDLE_UA : SLEEP_MODEM_IDLE_UA;
+    printf("charge/node/day   %.0f mAs awake + %.0f mAs idling connected + %.0f mAs deep sleep (SleepPolicy's currents)\n",
+           awakeTotal * SLEEP_ACTIVE_MA / 1000 / nodeDays, stats.idleMs * idleUa / 1e6 / nodeDays,
+           stats.deepSleepMs * SLEEP_DEEP_UA / 1e6 / nodeDays);
+    if (stats.txWakes > 0) {
+      printf("tx power          %.1f dBm average, %u wakes needed connect retries (%u retries)\n",
+             stats.txQdbmTotal / 4.0 / stats.txWakes, stats.retriedWakes, stats.connectRetries);
+    }
+  }
+}
+
+int main(int argc, char** argv) {
+  if (!parseOptions(argc, argv)) {
+    usage();
+    return 1;
+  }
+  signal(SIGPIPE, SIG_IGN);
+  rng.seed(options.seed);
+  simEpochMs = (int64_t)time(nullptr) * 1000;
+  createNodes();
+
+  // (time, node) of the next wake, earliest first
+  typedef std::pair<double, int> Wake;
+  std::priority_queue<Wake, std::vector<Wake>, std::greater<Wake>> schedule;
+  std::uniform_real_distribution<double> powerOn(0, options.spread * 1000);
+  for (int i = 0; i < options.nodes; i++) schedule.push(Wake(powerOn(rng), i));
+
+  const double endMs = options.hours * 3600 * 1000;
+  std::map<int, Running> running; // by pipe fd
+  uint64_t startUs = simWallUs();
+
+  while (!schedule.empty() || !running.empty()) {
+    int timeoutMs = -1;
+    if (!schedule.empty() && (int)running.size() < options.jobs) {
+      Wake next = schedule.top();
+      if (next.first >= endMs) {
+        schedule.pop();
+        Node& node = nodes[next.second];
+        if (node.idleFd >= 0) {
+          // its process sees the socket close and ends
+          close(node.idleFd);
+          waitpid(node.idlePid, nullptr, 0);
+          node.idleFd = -1;
+          node.idlePid = 0;
+        }
+        continue;
+      }
+      double lateMs = 0;
+      if (options.speed > 0) {
+        lateMs = (simWallUs() - startUs) / 1000.0 - next.first / options.speed;
+        if (lateMs < 0) timeoutMs = (int)-lateMs + 1;
+      }
+      if (timeoutMs < 0) {
+        schedule.pop();
+        stats.maxLagMs = std::max(stats.maxLagMs, lateMs);
+        Running wake;
+        int fd;
+        if (nodes[next.second].idleFd >= 0) {
+          fd = resumeWake(next.second, next.first, wake);
+        }
+        else {
+          double stubNextMs = stubWake(next.second, next.first);
+          if (stubNextMs >= 0) {
+            schedule.push(Wake(stubNextMs, next.second));
+            continue;
+          }
+          fd = launchWake(next.second, next.first, wake);
+        }
+        if (fd < 0) {
+          perror(nodes[next.second].idleFd >= 0 ? "resume" : "fork");
+          return 1;
+        }
+        running[fd] = wake;
+        continue;
+      }
+    }
+
+    std::vector<struct pollfd> fds;
+    for (const auto& entry : running) fds.push_back({ entry.first, POLLIN, 0 });
+    if (poll(fds.data(), fds.size(), timeoutMs) < 0 && errno != EINTR) {
+      perror("poll");
+      return 1;
+    }
+    for (const struct pollfd& fd : fds) {
+      if (!fd.revents) continue;
+      Running wake = running[fd.fd];
+      running.erase(fd.fd);
+      double nextMs = collectWake(fd.fd, wake);
+      if (nextMs >= 0) schedule.push(Wake(nextMs, wake.node));
+    }
+  }
+
+  report((simWallUs() - startUs) / 1e6);
+  return 0;
+}
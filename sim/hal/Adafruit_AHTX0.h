@@ -0,0 +1,18 @@
+#ifndef SIM_ADAFRUIT_AHTX0_H
+#define SIM_ADAFRUIT_AHTX0_H
+
+// only the types SensorHandler.h needs, the simulated sensor is in sim/fakes
+
+#include <Arduino.h>
+
+typedef struct {
+  float temperature;
+  float relative_humidity;
+} sensors_event_t;
+
+class Adafruit_AHTX0 {
+public:
+  Adafruit_AHTX0() {}
+};
+
+#endif // SIM_ADAFRUIT_AHTX0_H
@@ -0,0 +1,15 @@
+#ifndef SIM_ADAFRUIT_SH110X_H
+#define SIM_ADAFRUIT_SH110X_H
+
+// only the types OLEDHandler.h needs, the simulated OLED is in sim/fakes
+
+#include <Arduino.h>
+
+typedef uint16_t u16_t; // comes from lwIP on the ESP32
+
+class Adafruit_SH1106G {
+public:
+  Adafruit_SH1106G() {}
+};
+
+#endif // SIM_ADAFRUIT_SH110X_H
@@ -0,0 +1,75 @@
+#include <Arduino.h>
+#include <stdarg.h>
+#include <unistd.h>
+#include "../SimNode.h"
+
+SimSerial Serial;
+EspClass ESP;
+
+String::String(double value, unsigned int decimals) {
+  char buffer[48];
+  snprintf(buffer, sizeof(buffer), "%.*f", decimals, value);
+  _str = buffer;
+}
+
+void String::trim() {
+  size_t start = _str.find_first_not_of(" \t\r\n");
+  size_t end = _str.find_last_not_of(" \t\r\n");
+  _str = start == std::string::npos ? "" : _str.substr(start, end - start + 1);
+}
+
+size_t SimSerial::printf(const char* format, ...) {
+  char buffer[512];
+  va_list args;
+  va_start(args, format);
+  int length = vsnprintf(buffer, sizeof(buffer), format, args);
+  va_end(args);
+  write(buffer);
+  return length < 0 ? 0 : length;
+}
+
+size_t SimSerial::write(const char* text) {
+  if (simNode.trace) fputs(text, stdout);
+  return strlen(text);
+}
+
+void EspClass::restart() {
+  simNode.finish(SIM_END_RESTART);
+}
+
+unsigned long millis() {
+  return simNode.awakeUs / 1000;
+}
+
+unsigned long micros() {
+  return simNode.awakeUs;
+}
+
+void delay(unsigned long ms) {
+  simNode.advanceUs(ms * 1000ULL);
+}
+
+void delayMicroseconds(unsigned int us) {
+  simNode.advanceUs(us);
+}
+
+void yield() {
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+}
+
+int digitalRead(uint8_t pin) {
+  return HIGH; // button not pressed
+}
+
+uint32_t esp_random() {
+  return (uint32_t)random();
+}
+
+const char* esp_err_to_name(esp_err_t err) {
+  return err == ESP_OK ? "ESP_OK" : "ESP_FAIL";
+}
@@ -0,0 +1,163 @@
+#ifndef SIM_ARDUINO_H
+#define SIM_ARDUINO_H
+
+// Just enough of the Arduino core for the firmware to build on a PC, see
+// sim/README.md. Time is virtual: millis() and delay() run on the node's
+// simulated clock, not the PC's.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <string>
+
+using std::max;
+using std::min;
+
+typedef uint8_t byte;
+typedef int esp_err_t;
+
+#define ESP_OK 0
+#define ESP_FAIL -1
+
+// RTC memory is one linker section so the simulator can save and restore it
+// per node between wakes
+#define RTC_DATA_ATTR __attribute__((section("sim_rtc_data")))
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+
+class String {
+public:
+  String(const char* str = "") : _str(str ? str : "") {}
+  String(const std::string& str) : _str(str) {}
+  String(char c) : _str(1, c) {}
+  String(int value) : _str(std::to_string(value)) {}
+  String(unsigned int value) : _str(std::to_string(value)) {}
+  String(long value) : _str(std::to_string(value)) {}
+  String(unsigned long value) : _str(std::to_string(value)) {}
+  String(long long value) : _str(std::to_string(value)) {}
+  String(unsigned long long value) : _str(std::to_string(value)) {}
+  String(double value, unsigned int decimals = 2);
+
+  String& operator=(const char* str) { _str = str ? str : ""; return *this; }
+
+  const char* c_str() const { return _str.c_str(); }
+  unsigned int length() const { return _str.length(); }
+  bool reserve(unsigned int size) { _str.reserve(size); return true; }
+  char operator[](unsigned int index) const { return index < _str.length() ? _str[index] : 0; }
+
+  bool concat(const char* str) { if (str) _str += str; return true; }
+  bool concat(char c) { _str += c; return true; }
+  String& operator+=(const String& other) { _str += other._str; return *this; }
+  String& operator+=(const char* str) { concat(str); return *this; }
+  String& operator+=(char c) { concat(c); return *this; }
+
+  bool operator==(const String& other) const { return _str == other._str; }
+  bool operator==(const char* str) const { return _str == (str ? str : ""); }
+  bool operator!=(const String& other) const { return _str != other._str; }
+  bool operator!=(const char* str) const { return !(*this == str); }
+
+  bool equalsIgnoreCase(const String& other) const { return strcasecmp(c_str(), other.c_str()) == 0; }
+  bool startsWith(const String& prefix) const { return _str.compare(0, prefix._str.length(), prefix._str) == 0; }
+  bool endsWith(const String& suffix) const {
+    return _str.length() >= suffix._str.length() && _str.compare(_str.length() - suffix._str.length(), suffix._str.length(), suffix._str) == 0;
+  }
+  int indexOf(char c, unsigned int from = 0) const { size_t i = _str.find(c, from); return i == std::string::npos ? -1 : (int)i; }
+  int indexOf(const String& str, unsigned int from = 0) const { size_t i = _str.find(str._str, from); return i == std::string::npos ? -1 : (int)i; }
+  String substring(unsigned int from, unsigned int to = (unsigned int)-1) const {
+    if (from > _str.length()) return String();
+    return String(_str.substr(from, to == (unsigned int)-1 ? std::string::npos : to - from));
+  }
+  void trim();
+  long toInt() const { return atol(c_str()); }
+  float toFloat() const { return atof(c_str()); }
+
+  friend String operator+(const String& a, const String& b) { return String(a._str + b._str); }
+  friend String operator+(const String& a, const char* b) { return String(a._str + (b ? b : "")); }
+  friend String operator+(const char* a, const String& b) { return String((a ? a : "") + b._str); }
+
+private:
+  std::string _str;
+};
+
+// ArduinoJson knows about this one from the real core
+class StringSumHelper : public String {
+public:
+  using String::String;
+};
+
+// IPv4 only, like most of the real one
+class IPAddress {
+public:
+  IPAddress(uint8_t a = 0, uint8_t b = 0, uint8_t c = 0, uint8_t d = 0) : _bytes{ a, b, c, d } {}
+  uint8_t operator[](int index) const { return _bytes[index]; }
+  uint8_t& operator[](int index) { return _bytes[index]; }
+  String toString() const {
+    return String(std::to_string(_bytes[0]) + "." + std::to_string(_bytes[1]) + "." + std::to_string(_bytes[2]) + "." + std::to_string(_bytes[3]));
+  }
+
+private:
+  uint8_t _bytes[4];
+};
+
+// Serial output goes nowhere unless the simulator traces this node
+class SimSerial {
+public:
+  void begin(unsigned long baud) {}
+  void end() {}
+  void flush() {}
+  int available() { return 0; }
+  int read() { return -1; }
+  operator bool() const { return true; }
+
+  size_t print(const String& text) { return write(text.c_str()); }
+  size_t print(const char* text) { return write(text); }
+  size_t print(char c) { char text[2] = { c, 0 }; return write(text); }
+  size_t print(int value) { return printf("%d", value); }
+  size_t print(unsigned int value) { return printf("%u", value); }
+  size_t print(long value) { return printf("%ld", value); }
+  size_t print(unsigned long value) { return printf("%lu", value); }
+  size_t print(double value, int decimals = 2) { return printf("%.*f", decimals, value); }
+
+  size_t println() { return write("\n"); }
+  template <typename T> size_t println(const T& value) { return print(value) + println(); }
+
+  size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+  size_t write(const char* text);
+};
+
+extern SimSerial Serial;
+
+class EspClass {
+public:
+  [[noreturn]] void restart();
+  uint32_t getFreeHeap() { return 200000; }
+};
+
+extern EspClass ESP;
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+
+uint32_t esp_random();
+const char* esp_err_to_name(esp_err_t err);
+
+// clocks are only asked for, never changed
+inline uint32_t getCpuFrequencyMhz() { return 160; }
+inline uint32_t getXtalFrequencyMhz() { return 40; }
+
+#endif // SIM_ARDUINO_H
@@ -0,0 +1,11 @@
+#ifndef SIM_DNSSERVER_H
+#define SIM_DNSSERVER_H
+
+// only the type PortalManager.h needs
+
+class DNSServer {
+public:
+  DNSServer() {}
+};
+
+#endif // SIM_DNSSERVER_H
@@ -0,0 +1,15 @@
+#ifndef SIM_ESPASYNCWEBSERVER_H
+#define SIM_ESPASYNCWEBSERVER_H
+
+// only the types PortalManager.h needs, simulated nodes come pre-configured
+
+#include <Arduino.h>
+
+class AsyncWebServerRequest;
+
+class AsyncWebServer {
+public:
+  AsyncWebServer(uint16_t port) {}
+};
+
+#endif // SIM_ESPASYNCWEBSERVER_H
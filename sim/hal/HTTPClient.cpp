@@ -0,0 +1,254 @@
+#include <HTTPClient.h>
+#include <WiFi.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+#include "../SimNode.h"
+
+bool HTTPClient::begin(const String& url) {
+  _valid = false;
+  _requestHeaders.clear();
+  _responseHeaders.clear();
+  _body = "";
+
+  std::string rest = url.c_str();
+  if (rest.compare(0, 7, "http://") != 0) return false; // no TLS in the simulator
+  rest = rest.substr(7);
+
+  size_t slash = rest.find('/');
+  std::string hostPort = rest.substr(0, slash);
+  _path = slash == std::string::npos ? "/" : rest.substr(slash);
+
+  size_t colon = hostPort.find(':');
+  _host = hostPort.substr(0, colon);
+  _port = colon == std::string::npos ? 80 : atoi(hostPort.c_str() + colon + 1);
+  _valid = !_host.empty() && _port != 0;
+  return _valid;
+}
+
+void HTTPClient::end() {
+  _valid = false;
+  if (!_reuse) closeConnection();
+}
+
+bool HTTPClient::connected() {
+  if (_fd < 0) return false;
+  // open until the server hangs up, a peek tells without reading anything
+  char byte;
+  ssize_t got = recv(_fd, &byte, 1, MSG_PEEK | MSG_DONTWAIT);
+  if (got > 0 || (got < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))) return true;
+  closeConnection();
+  return false;
+}
+
+void HTTPClient::closeConnection() {
+  if (_fd >= 0) close(_fd);
+  _fd = -1;
+}
+
+void HTTPClient::addHeader(const String& name, const String& value) {
+  _requestHeaders.emplace_back(name.c_str(), value.c_str());
+}
+
+void HTTPClient::collectHeaders(const char* headerKeys[], size_t headerKeysCount) {
+  _collect.assign(headerKeys, headerKeys + headerKeysCount);
+}
+
+int HTTPClient::GET() {
+  return sendRequest("GET", nullptr, 0);
+}
+
+int HTTPClient::POST(const String& payload) {
+  return sendRequest("POST", (const uint8_t*)payload.c_str(), payload.length());
+}
+
+int HTTPClient::POST(const uint8_t* payload, size_t size) {
+  return sendRequest("POST", payload, size);
+}
+
+bool HTTPClient::hasHeader(const char* name) {
+  for (const auto& header : _responseHeaders) {
+    if (strcasecmp(header.first.c_str(), name) == 0) return true;
+  }
+  return false;
+}
+
+String HTTPClient::header(const char* name) {
+  for (const auto& header : _responseHeaders) {
+    if (strcasecmp(header.first.c_str(), name) == 0) return String(header.second);
+  }
+  return String();
+}
+
+String HTTPClient::errorToString(int error) {
+  switch (error) {
+    case HTTPC_ERROR_CONNECTION_REFUSED:  return "connection refused";
+    case HTTPC_ERROR_SEND_HEADER_FAILED:  return "send header failed";
+    case HTTPC_ERROR_SEND_PAYLOAD_FAILED: return "send payload failed";
+    case HTTPC_ERROR_NOT_CONNECTED:       return "not connected";
+    case HTTPC_ERROR_CONNECTION_LOST:     return "connection lost";
+    case HTTPC_ERROR_NO_HTTP_SERVER:      return "no HTTP server";
+    case HTTPC_ERROR_READ_TIMEOUT:        return "read Timeout";
+    default:                              return String();
+  }
+}
+
+int HTTPClient::sendRequest(const char* method, const uint8_t* payload, size_t size) {
+  _responseHeaders.clear();
+  _body = "";
+  if (!_valid) return HTTPC_ERROR_CONNECTION_REFUSED;
+
+  uint8_t endpoint = SIM_ENDPOINT_OTHER;
+  if (_path.size() >= 8 && _path.compare(_path.size() - 8, 8, "/devices") == 0) endpoint = SIM_ENDPOINT_DEVICES;
+  if (_path.size() >= 7 && _path.compare(_path.size() - 7, 7, "/ingest") == 0) endpoint = SIM_ENDPOINT_INGEST;
+
+  if (WiFi.status() != WL_CONNECTED) {
+    simNode.recordRequest(HTTPC_ERROR_CONNECTION_REFUSED, endpoint, _port, size, 0, simWallUs());
+    return HTTPC_ERROR_CONNECTION_REFUSED;
+  }
+
+  std::string request = std::string(method) + " " + _path + " HTTP/1.1\r\n";
+  request += "Host: " + _host + ":" + std::to_string(_port) + "\r\n";
+  request += "User-Agent: ESP32HTTPClient\r\n";
+  request += _reuse ? "Connection: keep-alive\r\n" : "Connection: close\r\n";
+  for (const auto& header : _requestHeaders) {
+    request += header.first + ": " + header.second + "\r\n";
+  }
+  if (payload) request += "Content-Length: " + std::to_string(size) + "\r\n";
+  request += "\r\n";
+  if (payload) request.append((const char*)payload, size);
+
+  // the node is awake for as long as the real server takes
+  uint64_t startUs = simWallUs();
+  int code = exchange(request);
+  uint64_t endUs = simWallUs();
+  simNode.advanceUs(endUs - startUs);
+  simNode.recordRequest(code, endpoint, _port, size, endUs - startUs, endUs, _lastReused);
+
+  // the server's Date is real time, but the node lives in simulated time
+  if (hasHeader("Date")) {
+    time_t seconds = simNode.epochMs() / 1000;
+    struct tm utc;
+    gmtime_r(&seconds, &utc);
+    char date[40];
+    strftime(date, sizeof(date), "%a, %d %b %Y %H:%M:%S GMT", &utc);
+    for (auto& header : _responseHeaders) {
+      if (strcasecmp(header.first.c_str(), "Date") == 0) header.second = date;
+    }
+  }
+  return code;
+}
+
+static int connectWithTimeout(const std::string& host, uint16_t port, int timeoutMs) {
+  struct addrinfo hints = {};
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  struct addrinfo* addresses = nullptr;
+  if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &addresses) != 0) return -1;
+
+  int fd = -1;
+  for (struct addrinfo* address = addresses; address && fd < 0; address = address->ai_next) {
+    fd = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+    if (fd < 0) continue;
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    if (connect(fd, address->ai_addr, address->ai_addrlen) != 0 && errno != EINPROGRESS) {
+      close(fd);
+      fd = -1;
+      continue;
+    }
+    struct pollfd pending = { fd, POLLOUT, 0 };
+    int error = 0;
+    socklen_t length = sizeof(error);
+    if (poll(&pending, 1, timeoutMs) != 1 || getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &length) != 0 || error != 0) {
+      close(fd);
+      fd = -1;
+      continue;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+  }
+  freeaddrinfo(addresses);
+  return fd;
+}
+
+int HTTPClient::exchange(const std::string& request) {
+  if (_fd >= 0 && (_fdHost != _host || _fdPort != _port || !connected())) closeConnection();
+  _lastReused = _fd >= 0;
+  if (_fd < 0) {
+    _fd = connectWithTimeout(_host, _port, _connectTimeoutMs);
+    if (_fd < 0) return HTTPC_ERROR_CONNECTION_REFUSED;
+    _fdHost = _host;
+    _fdPort = _port;
+  }
+  int fd = _fd;
+
+  struct timeval timeout = { _timeoutMs / 1000, (_timeoutMs % 1000) * 1000 };
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+  size_t sent = 0;
+  while (sent < request.size()) {
+    ssize_t written = send(fd, request.data() + sent, request.size() - sent, MSG_NOSIGNAL);
+    if (written <= 0) {
+      closeConnection();
+      return HTTPC_ERROR_SEND_HEADER_FAILED;
+    }
+    sent += written;
+  }
+
+  // the response ends at Content-Length, or when the server hangs up
+  std::string response;
+  size_t headerEnd = std::string::npos;
+  long contentLength = -1;
+  char buffer[4096];
+  while (true) {
+    ssize_t got = recv(fd, buffer, sizeof(buffer), 0);
+    if (got < 0) {
+      closeConnection();
+      return errno == EAGAIN || errno == EWOULDBLOCK ? HTTPC_ERROR_READ_TIMEOUT : HTTPC_ERROR_CONNECTION_LOST;
+    }
+    if (got == 0) break;
+    response.append(buffer, got);
+
+    if (headerEnd == std::string::npos) {
+      headerEnd = response.find("\r\n\r\n");
+      if (headerEnd != std::string::npos) {
+        const char* found = strcasestr(response.c_str(), "\r\nContent-Length:");
+        if (found && (size_t)(found - response.c_str()) < headerEnd) contentLength = atol(found + 17);
+      }
+    }
+    if (headerEnd != std::string::npos && contentLength >= 0 && response.size() >= headerEnd + 4 + contentLength) break;
+  }
+  // kept only if the end of the response was clear and the server didn't say close
+  const char* connection = headerEnd == std::string::npos ? nullptr : strcasestr(response.c_str(), "\r\nConnection: close");
+  if (!_reuse || contentLength < 0 || (connection && (size_t)(connection - response.c_str()) < headerEnd)) closeConnection();
+
+  if (headerEnd == std::string::npos || response.compare(0, 5, "HTTP/") != 0) return HTTPC_ERROR_NO_HTTP_SERVER;
+  int code = atoi(response.c_str() + response.find(' ') + 1);
+
+  // status line, then "Name: value" lines. Only the collected ones are kept,
+  // like the real HTTPClient.
+  size_t lineStart = response.find("\r\n") + 2;
+  while (lineStart < headerEnd) {
+    size_t lineEnd = response.find("\r\n", lineStart);
+    std::string line = response.substr(lineStart, lineEnd - lineStart);
+    lineStart = lineEnd + 2;
+    size_t colon = line.find(':');
+    if (colon == std::string::npos) continue;
+    std::string name = line.substr(0, colon);
+    std::string value = line.substr(colon + 1);
+    value.erase(0, value.find_first_not_of(' '));
+    for (const std::string& wanted : _collect) {
+      if (strcasecmp(wanted.c_str(), name.c_str()) == 0) _responseHeaders.emplace_back(name, value);
+    }
+  }
+
+  std::string body = response.substr(headerEnd + 4);
+  if (contentLength >= 0 && body.size() > (size_t)contentLength) body.resize(contentLength);
+  _body = String(body);
+  return code;
+}
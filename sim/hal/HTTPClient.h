@@ -0,0 +1,89 @@
+#ifndef SIM_HTTPCLIENT_H
+#define SIM_HTTPCLIENT_H
+
+// HTTPClient over real sockets, so simulated nodes talk to a real server.
+// Plain http:// only. Like the real one it asks for keep-alive and keeps the
+// connection after end() until it's destroyed or setReuse(false), if the
+// server lets it. The wall clock time each request takes is added to the
+// node's virtual clock and to the report.
+
+#include <Arduino.h>
+#include <vector>
+
+#define HTTPC_ERROR_CONNECTION_REFUSED  (-1)
+#define HTTPC_ERROR_SEND_HEADER_FAILED  (-2)
+#define HTTPC_ERROR_SEND_PAYLOAD_FAILED (-3)
+#define HTTPC_ERROR_NOT_CONNECTED       (-4)
+#define HTTPC_ERROR_CONNECTION_LOST     (-5)
+#define HTTPC_ERROR_NO_STREAM           (-6)
+#define HTTPC_ERROR_NO_HTTP_SERVER      (-7)
+#define HTTPC_ERROR_TOO_LESS_RAM        (-8)
+#define HTTPC_ERROR_ENCODING            (-9)
+#define HTTPC_ERROR_STREAM_WRITE        (-10)
+#define HTTPC_ERROR_READ_TIMEOUT        (-11)
+
+typedef enum {
+  HTTP_CODE_OK = 200,
+  HTTP_CODE_CREATED = 201,
+  HTTP_CODE_NO_CONTENT = 204,
+  HTTP_CODE_NOT_MODIFIED = 304,
+  HTTP_CODE_BAD_REQUEST = 400,
+  HTTP_CODE_UNAUTHORIZED = 401,
+  HTTP_CODE_NOT_FOUND = 404,
+  HTTP_CODE_CONFLICT = 409,
+  HTTP_CODE_TOO_MANY_REQUESTS = 429,
+  HTTP_CODE_INTERNAL_SERVER_ERROR = 500,
+  HTTP_CODE_SERVICE_UNAVAILABLE = 503
+} t_http_codes;
+
+class HTTPClient {
+public:
+  HTTPClient() = default;
+  HTTPClient(const HTTPClient&) = delete;
+  HTTPClient& operator=(const HTTPClient&) = delete;
+  ~HTTPClient() { closeConnection(); }
+
+  bool begin(const String& url);
+  void end();
+  void setReuse(bool reuse) { _reuse = reuse; }
+  bool connected();
+
+  void setConnectTimeout(int32_t timeoutMs) { _connectTimeoutMs = timeoutMs; }
+  void setTimeout(uint16_t timeoutMs) { _timeoutMs = timeoutMs; }
+  void addHeader(const String& name, const String& value);
+  void collectHeaders(const char* headerKeys[], size_t headerKeysCount);
+
+  int GET();
+  int POST(const String& payload);
+  int POST(const uint8_t* payload, size_t size);
+
+  String getString() { return _body; }
+  int getSize() { return (int)_body.length(); }
+  bool hasHeader(const char* name);
+  String header(const char* name);
+
+  static String errorToString(int error);
+
+private:
+  std::string _host;
+  uint16_t _port = 80;
+  std::string _path;
+  bool _valid = false;
+  int32_t _connectTimeoutMs = 5000;
+  uint16_t _timeoutMs = 5000;
+  std::vector<std::pair<std::string, std::string>> _requestHeaders;
+  std::vector<std::string> _collect;
+  std::vector<std::pair<std::string, std::string>> _responseHeaders;
+  String _body;
+  bool _reuse = true;
+  int _fd = -1;          // open connection, kept between requests with _reuse
+  std::string _fdHost;
+  uint16_t _fdPort = 0;
+  bool _lastReused = false;
+
+  int sendRequest(const char* method, const uint8_t* payload, size_t size);
+  int exchange(const std::string& request);
+  void closeConnection();
+};
+
+#endif // SIM_HTTPCLIENT_H
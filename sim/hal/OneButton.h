@@ -0,0 +1,12 @@
+#ifndef SIM_ONEBUTTON_H
+#define SIM_ONEBUTTON_H
+
+// only the type ButtonHandler.h needs, nobody presses buttons in the simulator
+
+class OneButton {
+public:
+  OneButton() {}
+  OneButton(int pin, bool activeLow = true, bool pullupActive = true) {}
+};
+
+#endif // SIM_ONEBUTTON_H
@@ -0,0 +1,183 @@
+#include <Preferences.h>
+#include <nvs.h>
+#include <vector>
+#include "../SimNode.h"
+
+// NVS is one map per node, keys are "namespace/key"
+
+static std::string nvsKey(const std::string& space, const char* key) {
+  return space + "/" + key;
+}
+
+static bool nvsGet(const std::string& space, const char* key, std::string& value) {
+  auto found = simNode.nvs.find(nvsKey(space, key));
+  if (found == simNode.nvs.end()) return false;
+  value = found->second;
+  return true;
+}
+
+template <typename T>
+static T nvsGetValue(const std::string& space, const char* key, T defaultValue) {
+  std::string value;
+  if (!nvsGet(space, key, value) || value.size() != sizeof(T)) return defaultValue;
+  T result;
+  memcpy(&result, value.data(), sizeof(T));
+  return result;
+}
+
+template <typename T>
+static size_t nvsPutValue(const std::string& space, const char* key, T value) {
+  simNode.nvs[nvsKey(space, key)] = std::string((const char*)&value, sizeof(T));
+  return sizeof(T);
+}
+
+// Preferences
+
+bool Preferences::begin(const char* name, bool readOnly) {
+  _namespace = name;
+  _open = true;
+  _readOnly = readOnly;
+  return true;
+}
+
+void Preferences::end() {
+  _open = false;
+}
+
+bool Preferences::clear() {
+  if (!_open || _readOnly) return false;
+  std::string prefix = _namespace + "/";
+  for (auto it = simNode.nvs.begin(); it != simNode.nvs.end();) {
+    if (it->first.compare(0, prefix.size(), prefix) == 0) it = simNode.nvs.erase(it);
+    else ++it;
+  }
+  return true;
+}
+
+bool Preferences::remove(const char* key) {
+  if (!_open || _readOnly) return false;
+  return simNode.nvs.erase(nvsKey(_namespace, key)) > 0;
+}
+
+bool Preferences::isKey(const char* key) {
+  std::string value;
+  return _open && nvsGet(_namespace, key, value);
+}
+
+size_t Preferences::putBool(const char* key, bool value) {
+  return putUChar(key, value ? 1 : 0);
+}
+
+size_t Preferences::putUChar(const char* key, uint8_t value) {
+  if (!_open || _readOnly) return 0;
+  return nvsPutValue(_namespace, key, value);
+}
+
+size_t Preferences::putInt(const char* key, int32_t value) {
+  if (!_open || _readOnly) return 0;
+  return nvsPutValue(_namespace, key, value);
+}
+
+size_t Preferences::putUInt(const char* key, uint32_t value) {
+  if (!_open || _readOnly) return 0;
+  return nvsPutValue(_namespace, key, value);
+}
+
+size_t Preferences::putString(const char* key, const char* value) {
+  if (!_open || _readOnly) return 0;
+  simNode.nvs[nvsKey(_namespace, key)] = value;
+  return strlen(value);
+}
+
+size_t Preferences::putBytes(const char* key, const void* value, size_t length) {
+  if (!_open || _readOnly) return 0;
+  simNode.nvs[nvsKey(_namespace, key)] = std::string((const char*)value, length);
+  return length;
+}
+
+bool Preferences::getBool(const char* key, bool defaultValue) {
+  return getUChar(key, defaultValue ? 1 : 0) != 0;
+}
+
+uint8_t Preferences::getUChar(const char* key, uint8_t defaultValue) {
+  return _open ? nvsGetValue(_namespace, key, defaultValue) : defaultValue;
+}
+
+int32_t Preferences::getInt(const char* key, int32_t defaultValue) {
+  return _open ? nvsGetValue(_namespace, key, defaultValue) : defaultValue;
+}
+
+uint32_t Preferences::getUInt(const char* key, uint32_t defaultValue) {
+  return _open ? nvsGetValue(_namespace, key, defaultValue) : defaultValue;
+}
+
+size_t Preferences::getString(const char* key, char* value, size_t maxLength) {
+  std::string stored;
+  if (!_open || !nvsGet(_namespace, key, stored) || stored.size() + 1 > maxLength) return 0;
+  memcpy(value, stored.c_str(), stored.size() + 1);
+  return stored.size() + 1;
+}
+
+String Preferences::getString(const char* key, const String& defaultValue) {
+  std::string stored;
+  if (!_open || !nvsGet(_namespace, key, stored)) return defaultValue;
+  return String(stored);
+}
+
+size_t Preferences::getBytes(const char* key, void* buffer, size_t maxLength) {
+  std::string stored;
+  if (!_open || !nvsGet(_namespace, key, stored) || stored.size() > maxLength) return 0;
+  memcpy(buffer, stored.data(), stored.size());
+  return stored.size();
+}
+
+// raw NVS API, a handle is an index into the namespaces opened so far. Writes go straight
+// to the map, so commit has nothing left to do.
+
+static std::vector<std::string> openNamespaces;
+
+esp_err_t nvs_open(const char* name, nvs_open_mode_t mode, nvs_handle_t* handle) {
+  openNamespaces.push_back(name);
+  *handle = openNamespaces.size();
+  return ESP_OK;
+}
+
+static const std::string* handleNamespace(nvs_handle_t handle) {
+  if (handle == 0 || handle > openNamespaces.size()) return nullptr;
+  return &openNamespaces[handle - 1];
+}
+
+esp_err_t nvs_set_u8(nvs_handle_t handle, const char* key, uint8_t value) {
+  const std::string* space = handleNamespace(handle);
+  if (!space) return ESP_FAIL;
+  nvsPutValue(*space, key, value);
+  return ESP_OK;
+}
+
+esp_err_t nvs_set_i32(nvs_handle_t handle, const char* key, int32_t value) {
+  const std::string* space = handleNamespace(handle);
+  if (!space) return ESP_FAIL;
+  nvsPutValue(*space, key, value);
+  return ESP_OK;
+}
+
+esp_err_t nvs_set_u32(nvs_handle_t handle, const char* key, uint32_t value) {
+  const std::string* space = handleNamespace(handle);
+  if (!space) return ESP_FAIL;
+  nvsPutValue(*space, key, value);
+  return ESP_OK;
+}
+
+esp_err_t nvs_set_str(nvs_handle_t handle, const char* key, const char* value) {
+  const std::string* space = handleNamespace(handle);
+  if (!space) return ESP_FAIL;
+  simNode.nvs[nvsKey(*space, key)] = value;
+  return ESP_OK;
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle) {
+  return handleNamespace(handle) ? ESP_OK : ESP_FAIL;
+}
+
+void nvs_close(nvs_handle_t handle) {
+}
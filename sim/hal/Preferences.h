@@ -0,0 +1,37 @@
+#ifndef SIM_PREFERENCES_H
+#define SIM_PREFERENCES_H
+
+#include <Arduino.h>
+
+// Preferences on top of the node's simulated NVS (see SimNode.h)
+class Preferences {
+public:
+  bool begin(const char* name, bool readOnly = false);
+  void end();
+  bool clear();
+  bool remove(const char* key);
+  bool isKey(const char* key);
+
+  size_t putBool(const char* key, bool value);
+  size_t putUChar(const char* key, uint8_t value);
+  size_t putInt(const char* key, int32_t value);
+  size_t putUInt(const char* key, uint32_t value);
+  size_t putString(const char* key, const char* value);
+  size_t putString(const char* key, const String& value) { return putString(key, value.c_str()); }
+  size_t putBytes(const char* key, const void* value, size_t length);
+
+  bool getBool(const char* key, bool defaultValue = false);
+  uint8_t getUChar(const char* key, uint8_t defaultValue = 0);
+  int32_t getInt(const char* key, int32_t defaultValue = 0);
+  uint32_t getUInt(const char* key, uint32_t defaultValue = 0);
+  size_t getString(const char* key, char* value, size_t maxLength);
+  String getString(const char* key, const String& defaultValue = String());
+  size_t getBytes(const char* key, void* buffer, size_t maxLength);
+
+private:
+  std::string _namespace;
+  bool _open = false;
+  bool _readOnly = false;
+};
+
+#endif // SIM_PREFERENCES_H
@@ -0,0 +1,180 @@
+#include <WiFi.h>
+#include <lwip/dns.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include "../SimNode.h"
+
+SimWiFi WiFi;
+
+// the real driver retries on its own and reports every failed attempt
+const unsigned long DISCONNECT_EVENT_INTERVAL_MS = 3000;
+
+bool SimWiFi::mode(wifi_mode_t mode) {
+  _mode = mode;
+  if (mode == WIFI_OFF) {
+    _connecting = false;
+    radioOff();
+  }
+  else {
+    radioOn();
+  }
+  return true;
+}
+
+wl_status_t SimWiFi::begin(const char* ssid, const char* passphrase, int32_t channel, const uint8_t* bssid) {
+  if (_mode == WIFI_OFF) mode(WIFI_STA);
+  _ssid = ssid ? ssid : "";
+  _connecting = true;
+  // with the channel given the driver skips its scan
+  _channelKnown = channel != 0 && channel == simNode.accessPoint.channel;
+  _beginMs = millis();
+  _lastEventMs = _beginMs;
+  _eventsSent = 0;
+  _retriesCounted = false;
+
+  // how loud the AP hears us decides how many association attempts fail first
+  simNode.result.txQdbm = _txPower;
+  int margin = _txPower / 4 - simNode.accessPoint.pathLossDb - SIM_AP_SENSITIVITY_DBM;
+  _failedAttempts = 0;
+  if (margin < 0) _failedAttempts = 255;
+  while (margin < SIM_MARGINAL_DB && _failedAttempts < 255 && random() % SIM_MARGINAL_DB >= margin) _failedAttempts++;
+  return WL_DISCONNECTED;
+}
+
+bool SimWiFi::setTxPower(wifi_power_t power) {
+  if (_mode == WIFI_OFF) return false;
+  _txPower = power;
+  simNode.result.txQdbm = power;
+  return true;
+}
+
+bool SimWiFi::disconnect(bool wifiOff) {
+  _connecting = false;
+  if (wifiOff) mode(WIFI_OFF);
+  return true;
+}
+
+wl_status_t SimWiFi::status() {
+  if (!_connecting) return WL_DISCONNECTED;
+
+  unsigned long now = millis();
+  bool reachable = simNode.accessPoint.up && _failedAttempts < 255;
+  if (reachable) {
+    // every failed attempt costs the driver's retry interval
+    uint32_t connectMs = simNode.accessPoint.associateMs + (_channelKnown ? 0 : simNode.accessPoint.scanMs) +
+                         _failedAttempts * DISCONNECT_EVENT_INTERVAL_MS;
+    if (now - _beginMs >= connectMs) {
+      simNode.result.wifiConnected = true;
+      simNode.result.rssi = simNodeRssi();
+      if (!_retriesCounted) simNode.result.connectRetries = _failedAttempts;
+      _retriesCounted = true;
+      return WL_CONNECTED;
+    }
+  }
+
+  if (now - _lastEventMs >= DISCONNECT_EVENT_INTERVAL_MS && (!reachable || _eventsSent < _failedAttempts)) {
+    _lastEventMs = now;
+    if (_eventsSent < 255) _eventsSent++;
+    sendDisconnect(simNode.accessPoint.up ? WIFI_REASON_ASSOC_FAIL : WIFI_REASON_NO_AP_FOUND);
+  }
+  if (reachable) return WL_DISCONNECTED;
+  return now - _beginMs >= DISCONNECT_EVENT_INTERVAL_MS ? WL_NO_SSID_AVAIL : WL_DISCONNECTED;
+}
+
+bool SimWiFi::setSleep(wifi_ps_type_t sleepType) {
+  if (sleepType == WIFI_PS_MAX_MODEM && !simNode.idle) {
+    // only the beacons until it's set back, the runner counts that time apart
+    radioOff();
+    simNode.idle = true;
+    simNode.idleSinceUs = simNode.awakeUs;
+  }
+  else if (sleepType != WIFI_PS_MAX_MODEM && simNode.idle) {
+    simNode.endIdle();
+    // status() goes by the AP this cycle finds, if it's gone so are we
+    if (_mode != WIFI_OFF) radioOn();
+    simNode.result.txQdbm = _txPower;
+  }
+  return true;
+}
+
+String SimWiFi::macAddress() {
+  return String(simNode.mac);
+}
+
+int8_t SimWiFi::RSSI() {
+  return status() == WL_CONNECTED ? simNodeRssi() : 0;
+}
+
+uint8_t* SimWiFi::BSSID() {
+  return status() == WL_CONNECTED ? _bssid : nullptr;
+}
+
+int32_t SimWiFi::channel() {
+  return status() == WL_CONNECTED ? simNode.accessPoint.channel : 0;
+}
+
+int16_t SimWiFi::scanNetworks(bool async, bool show_hidden, bool passive, uint32_t max_ms_per_chan,
+                              uint8_t channel, const char* ssid, const uint8_t* bssid) {
+  if (_mode == WIFI_OFF) mode(WIFI_STA);
+  // 13 channels unless told which one
+  delay(max_ms_per_chan * (channel ? 1 : 13));
+  bool seen = simNode.accessPoint.up && (channel == 0 || channel == simNode.accessPoint.channel);
+  if (ssid) _ssid = ssid;
+  _scanCount = seen ? 1 : 0;
+  return _scanCount;
+}
+
+int32_t SimWiFi::simNodeChannel() {
+  return simNode.accessPoint.channel;
+}
+
+int8_t SimWiFi::simNodeRssi() {
+  return SIM_AP_TX_DBM - simNode.accessPoint.pathLossDb;
+}
+
+void SimWiFi::sendDisconnect(uint8_t reason) {
+  if (!_disconnectCallback) return;
+  WiFiEventInfo_t info;
+  info.wifi_sta_disconnected.reason = reason;
+  _disconnectCallback(ARDUINO_EVENT_WIFI_STA_DISCONNECTED, info);
+}
+
+int SimWiFi::onEvent(WiFiEventFuncCb callback, arduino_event_id_t event) {
+  if (event == ARDUINO_EVENT_WIFI_STA_DISCONNECTED) _disconnectCallback = callback;
+  return 0;
+}
+
+int SimWiFi::hostByName(const char* host, IPAddress& result) {
+  if (status() != WL_CONNECTED) return 0;
+  struct addrinfo hints = {};
+  hints.ai_family = AF_INET;
+  struct addrinfo* addresses = nullptr;
+  uint64_t startUs = simWallUs();
+  int error = getaddrinfo(host, nullptr, &hints, &addresses);
+  simNode.advanceUs(simWallUs() - startUs);
+  if (error != 0 || !addresses) return 0;
+  uint32_t address = ntohl(((struct sockaddr_in*)addresses->ai_addr)->sin_addr.s_addr);
+  result = IPAddress(address >> 24, address >> 16, address >> 8, address);
+  freeaddrinfo(addresses);
+  return 1;
+}
+
+err_t dns_gethostbyname(const char* hostname, ip_addr_t* addr, dns_found_callback found, void* callback_arg) {
+  IPAddress result;
+  if (!WiFi.hostByName(hostname, result)) return ERR_VAL;
+  addr->u_addr.ip4.addr = htonl((uint32_t)result[0] << 24 | result[1] << 16 | result[2] << 8 | result[3]);
+  addr->type = 0;
+  return ERR_OK;
+}
+
+void SimWiFi::radioOn() {
+  if (simNode.radioOn) return;
+  simNode.radioOn = true;
+  simNode.radioOnSinceUs = simNode.awakeUs;
+}
+
+void SimWiFi::radioOff() {
+  if (!simNode.radioOn) return;
+  simNode.radioOn = false;
+  simNode.result.radioMs += (simNode.awakeUs - simNode.radioOnSinceUs) / 1000;
+}
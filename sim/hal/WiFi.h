@@ -0,0 +1,146 @@
+#ifndef SIM_WIFI_H
+#define SIM_WIFI_H
+
+// Simulated station. Whether the AP is there and how long association takes
+// comes from the simulator's scenario (SimNode.h). The TX power matters: the
+// AP has to hear us over the path loss, and a marginal link costs retries.
+// Time with the radio on is counted for the report. WIFI_PS_MAX_MODEM is
+// taken as the node idling connected, see SimNode::endIdle().
+
+#include <Arduino.h>
+
+typedef enum {
+  WL_IDLE_STATUS = 0,
+  WL_NO_SSID_AVAIL = 1,
+  WL_SCAN_COMPLETED = 2,
+  WL_CONNECTED = 3,
+  WL_CONNECT_FAILED = 4,
+  WL_CONNECTION_LOST = 5,
+  WL_DISCONNECTED = 6
+} wl_status_t;
+
+typedef enum {
+  WIFI_OFF = 0,
+  WIFI_STA = 1,
+  WIFI_AP = 2,
+  WIFI_AP_STA = 3
+} wifi_mode_t;
+
+typedef enum {
+  WIFI_PS_NONE,
+  WIFI_PS_MIN_MODEM,
+  WIFI_PS_MAX_MODEM
+} wifi_ps_type_t;
+
+typedef enum {
+  WIFI_AUTH_OPEN = 0,
+  WIFI_AUTH_WEP,
+  WIFI_AUTH_WPA_PSK,
+  WIFI_AUTH_WPA2_PSK
+} wifi_auth_mode_t;
+
+typedef enum {
+  WIFI_REASON_UNSPECIFIED = 1,
+  WIFI_REASON_AUTH_FAIL = 2,
+  WIFI_REASON_4WAY_HANDSHAKE_TIMEOUT = 15,
+  WIFI_REASON_BEACON_TIMEOUT = 200,
+  WIFI_REASON_NO_AP_FOUND = 201,
+  WIFI_REASON_AUTH_FAIL_2 = 202,
+  WIFI_REASON_ASSOC_FAIL = 203,
+  WIFI_REASON_HANDSHAKE_TIMEOUT = 204
+} wifi_err_reason_t;
+
+// 0.25 dBm steps, like the real one
+typedef enum {
+  WIFI_POWER_19_5dBm = 78,
+  WIFI_POWER_19dBm = 76,
+  WIFI_POWER_18_5dBm = 74,
+  WIFI_POWER_17dBm = 68,
+  WIFI_POWER_15dBm = 60,
+  WIFI_POWER_13dBm = 52,
+  WIFI_POWER_11dBm = 44,
+  WIFI_POWER_8_5dBm = 34,
+  WIFI_POWER_7dBm = 28,
+  WIFI_POWER_5dBm = 20,
+  WIFI_POWER_2dBm = 8,
+  WIFI_POWER_MINUS_1dBm = -4
+} wifi_power_t;
+
+typedef enum {
+  ARDUINO_EVENT_WIFI_STA_CONNECTED = 4,
+  ARDUINO_EVENT_WIFI_STA_DISCONNECTED = 5,
+  ARDUINO_EVENT_MAX
+} arduino_event_id_t;
+
+typedef arduino_event_id_t WiFiEvent_t;
+
+typedef union {
+  struct {
+    uint8_t reason;
+  } wifi_sta_disconnected;
+} arduino_event_info_t;
+
+typedef arduino_event_info_t WiFiEventInfo_t;
+typedef void (*WiFiEventFuncCb)(WiFiEvent_t event, WiFiEventInfo_t info);
+
+#define WIFI_SCAN_RUNNING (-1)
+#define WIFI_SCAN_FAILED (-2)
+
+class SimWiFi {
+public:
+  bool mode(wifi_mode_t mode);
+  wifi_mode_t getMode() const { return _mode; }
+  wl_status_t begin(const char* ssid, const char* passphrase = nullptr, int32_t channel = 0, const uint8_t* bssid = nullptr);
+  bool disconnect(bool wifiOff = false);
+  wl_status_t status();
+  bool isConnected() { return status() == WL_CONNECTED; }
+  bool setTxPower(wifi_power_t power);
+  wifi_power_t getTxPower() const { return _txPower; }
+  bool setSleep(wifi_ps_type_t sleepType);
+
+  String macAddress();
+  String SSID() const { return String(_ssid.c_str()); }
+  int8_t RSSI();
+  uint8_t* BSSID();
+  int32_t channel();
+
+  // blocking only, takes max_ms_per_chan of virtual time per channel
+  int16_t scanNetworks(bool async = false, bool show_hidden = false, bool passive = false, uint32_t max_ms_per_chan = 300,
+                       uint8_t channel = 0, const char* ssid = nullptr, const uint8_t* bssid = nullptr);
+  int16_t scanComplete() { return _scanCount; }
+  void scanDelete() { _scanCount = WIFI_SCAN_FAILED; }
+  String SSID(uint8_t i) const { return i < _scanCount ? String(_ssid.c_str()) : String(); }
+  int32_t RSSI(uint8_t i) const { return i < _scanCount ? simNodeRssi() : 0; }
+  uint8_t* BSSID(uint8_t i) { return i < _scanCount ? _bssid : nullptr; }
+  int32_t channel(uint8_t i) const { return i < _scanCount ? simNodeChannel() : 0; }
+
+  int onEvent(WiFiEventFuncCb callback, arduino_event_id_t event = ARDUINO_EVENT_MAX);
+
+  // real lookup on the PC, the wall clock time it takes is added like for HTTP
+  int hostByName(const char* host, IPAddress& result);
+
+private:
+  wifi_mode_t _mode = WIFI_OFF;
+  std::string _ssid;
+  bool _connecting = false;
+  bool _channelKnown = false;
+  int16_t _scanCount = WIFI_SCAN_FAILED;
+  uint8_t _bssid[6] = {0x02, 0xa9, 0x00, 0x00, 0x00, 0x01};
+  unsigned long _beginMs = 0;
+  unsigned long _lastEventMs = 0;
+  uint8_t _failedAttempts = 0; // before the association that works, 255 = none works
+  uint8_t _eventsSent = 0;
+  bool _retriesCounted = false; // a connected idle asks status() again, the retries were this begin()'s
+  wifi_power_t _txPower = WIFI_POWER_19_5dBm;
+  WiFiEventFuncCb _disconnectCallback = nullptr;
+
+  void radioOn();
+  void radioOff();
+  static int32_t simNodeChannel();
+  static int8_t simNodeRssi();
+  void sendDisconnect(uint8_t reason);
+};
+
+extern SimWiFi WiFi;
+
+#endif // SIM_WIFI_H
@@ -0,0 +1,7 @@
+#ifndef SIM_ESP_IDF_VERSION_H
+#define SIM_ESP_IDF_VERSION_H
+
+// what the sim's esp_pm.h looks like
+#define ESP_IDF_VERSION_MAJOR 5
+
+#endif // SIM_ESP_IDF_VERSION_H
@@ -0,0 +1,18 @@
+#ifndef SIM_ESP_PM_H
+#define SIM_ESP_PM_H
+
+// Power management for builds with -DCONNECTED_LIGHT_SLEEP=1. Nothing to
+// configure on a PC, whether a node idles connected is up to the WiFi power
+// save mode (SimWiFi::setSleep()).
+
+#include <Arduino.h>
+
+typedef struct {
+  int max_freq_mhz;
+  int min_freq_mhz;
+  bool light_sleep_enable;
+} esp_pm_config_t;
+
+inline esp_err_t esp_pm_configure(const void* config) { return ESP_OK; }
+
+#endif // SIM_ESP_PM_H
@@ -0,0 +1,9 @@
+#ifndef SIM_ESP_ROM_SYS_H
+#define SIM_ESP_ROM_SYS_H
+
+// the ROM printf, what code that can't take the Serial lock logs with
+#include <Arduino.h>
+
+#define esp_rom_printf(...) Serial.printf(__VA_ARGS__)
+
+#endif // SIM_ESP_ROM_SYS_H
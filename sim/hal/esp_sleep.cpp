@@ -0,0 +1,20 @@
+#include <esp_sleep.h>
+#include "../SimNode.h"
+
+esp_sleep_wakeup_cause_t esp_sleep_get_wakeup_cause() {
+  return simNode.wakeCause;
+}
+
+int esp_sleep_enable_timer_wakeup(uint64_t timeUs) {
+  simNode.result.sleepUs = timeUs;
+  return 0;
+}
+
+int esp_deep_sleep_enable_gpio_wakeup(uint64_t gpioPinMask, esp_deepsleep_gpio_wake_up_mode_t mode) {
+  return 0;
+}
+
+void esp_deep_sleep_start() {
+  simNode.result.budgetSleep = simNode.inTimer;
+  simNode.finish(SIM_END_SLEEP);
+}
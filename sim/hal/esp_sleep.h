@@ -0,0 +1,30 @@
+#ifndef SIM_ESP_SLEEP_H
+#define SIM_ESP_SLEEP_H
+
+#include <stdint.h>
+
+typedef enum {
+  ESP_SLEEP_WAKEUP_UNDEFINED,
+  ESP_SLEEP_WAKEUP_ALL,
+  ESP_SLEEP_WAKEUP_EXT0,
+  ESP_SLEEP_WAKEUP_EXT1,
+  ESP_SLEEP_WAKEUP_TIMER,
+  ESP_SLEEP_WAKEUP_TOUCHPAD,
+  ESP_SLEEP_WAKEUP_ULP,
+  ESP_SLEEP_WAKEUP_GPIO,
+  ESP_SLEEP_WAKEUP_UART
+} esp_sleep_wakeup_cause_t;
+
+typedef enum {
+  ESP_GPIO_WAKEUP_GPIO_LOW = 0,
+  ESP_GPIO_WAKEUP_GPIO_HIGH = 1
+} esp_deepsleep_gpio_wake_up_mode_t;
+
+esp_sleep_wakeup_cause_t esp_sleep_get_wakeup_cause();
+int esp_sleep_enable_timer_wakeup(uint64_t timeUs);
+int esp_deep_sleep_enable_gpio_wakeup(uint64_t gpioPinMask, esp_deepsleep_gpio_wake_up_mode_t mode);
+
+// ends this wake, the simulator schedules the next one
+[[noreturn]] void esp_deep_sleep_start();
+
+#endif // SIM_ESP_SLEEP_H
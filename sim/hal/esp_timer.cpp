@@ -0,0 +1,54 @@
+#include <esp_timer.h>
+#include "../SimNode.h"
+
+struct SimTimer {
+  esp_timer_cb_t callback;
+  void* arg;
+  bool armed;
+  uint64_t dueUs;
+};
+
+// the firmware creates one, a few to spare
+static SimTimer timers[4];
+static int timerCount = 0;
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t* args, esp_timer_handle_t* handle) {
+  if (timerCount >= (int)(sizeof(timers) / sizeof(timers[0]))) return ESP_FAIL;
+  SimTimer& timer = timers[timerCount++];
+  timer.callback = args->callback;
+  timer.arg = args->arg;
+  timer.armed = false;
+  *handle = &timer;
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeoutUs) {
+  if (timer->armed) return ESP_ERR_INVALID_STATE;
+  timer->armed = true;
+  timer->dueUs = simNode.awakeUs + timeoutUs;
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer) {
+  if (!timer->armed) return ESP_ERR_INVALID_STATE;
+  timer->armed = false;
+  return ESP_OK;
+}
+
+int64_t esp_timer_get_time() {
+  return simNode.awakeUs;
+}
+
+bool simRunTimerDue(uint64_t untilUs) {
+  SimTimer* due = nullptr;
+  for (int i = 0; i < timerCount; i++) {
+    if (timers[i].armed && timers[i].dueUs <= untilUs && (!due || timers[i].dueUs < due->dueUs)) due = &timers[i];
+  }
+  if (!due) return false;
+  due->armed = false;
+  if (simNode.awakeUs < due->dueUs) simNode.awakeUs = due->dueUs;
+  simNode.inTimer = true;
+  due->callback(due->arg);
+  simNode.inTimer = false;
+  return true;
+}
@@ -0,0 +1,38 @@
+#ifndef SIM_ESP_TIMER_H
+#define SIM_ESP_TIMER_H
+
+// One-shot timers on the node's virtual clock. A timer comes due while the
+// firmware's clock moves (delay(), a request) and its callback runs right
+// there at its time, the way the esp_timer task would preempt loop().
+
+#include <Arduino.h>
+
+#ifndef ESP_ERR_INVALID_STATE
+#define ESP_ERR_INVALID_STATE 0x103
+#endif
+
+typedef void (*esp_timer_cb_t)(void* arg);
+
+typedef enum {
+  ESP_TIMER_TASK
+} esp_timer_dispatch_t;
+
+typedef struct {
+  esp_timer_cb_t callback;
+  void* arg;
+  esp_timer_dispatch_t dispatch_method;
+  const char* name;
+  bool skip_unhandled_events;
+} esp_timer_create_args_t;
+
+typedef struct SimTimer* esp_timer_handle_t;
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t* args, esp_timer_handle_t* handle);
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeoutUs);
+esp_err_t esp_timer_stop(esp_timer_handle_t timer);
+int64_t esp_timer_get_time();
+
+// sim only: runs the first timer due by untilUs, false if there is none
+bool simRunTimerDue(uint64_t untilUs);
+
+#endif // SIM_ESP_TIMER_H
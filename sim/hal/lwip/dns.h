@@ -0,0 +1,28 @@
+#ifndef SIM_LWIP_DNS_H
+#define SIM_LWIP_DNS_H
+
+// lwIP's resolver. In the simulator it is the PC's, answered right away
+// (see WiFi.cpp), so the caller never waits for the callback.
+#include <stdint.h>
+
+typedef int8_t err_t;
+#define ERR_OK 0
+#define ERR_INPROGRESS -5
+#define ERR_VAL -6
+
+struct ip4_addr_t {
+  uint32_t addr; // network order
+};
+
+struct ip_addr_t {
+  union {
+    ip4_addr_t ip4;
+  } u_addr;
+  uint8_t type;
+};
+
+typedef void (*dns_found_callback)(const char* name, const ip_addr_t* ipaddr, void* callback_arg);
+
+err_t dns_gethostbyname(const char* hostname, ip_addr_t* addr, dns_found_callback found, void* callback_arg);
+
+#endif // SIM_LWIP_DNS_H
@@ -0,0 +1,16 @@
+#ifndef SIM_SOC_GPIO_REG_H
+#define SIM_SOC_GPIO_REG_H
+
+// GPIO registers. The simulated pins don't drive anything, so a write to
+// them is dropped like digitalWrite() is.
+#include <stdint.h>
+
+#ifndef BIT
+#define BIT(nr) (1UL << (nr))
+#endif
+
+#define GPIO_OUT_W1TC_REG 0x60004008
+
+#define REG_WRITE(reg, value) ((void)(reg), (void)(value))
+
+#endif // SIM_SOC_GPIO_REG_H
@@ -0,0 +1,11 @@
+#ifndef SIM_SYS_TIME_H
+#define SIM_SYS_TIME_H
+
+#include_next <sys/time.h>
+
+// TimeKeeper reads the RTC clock through gettimeofday(), in the simulator
+// that has to be the node's own (virtual, drifting) clock
+int simGettimeofday(struct timeval* tv, void* tz);
+#define gettimeofday simGettimeofday
+
+#endif // SIM_SYS_TIME_H
@@ -0,0 +1,48 @@
+#include "AlarmMonitor.h"
+
+AlarmMonitor::AlarmMonitor(AlarmState& state) : _state(state) {
+}
+
+void AlarmMonitor::setThresholds(const AlarmThresholds& thresholds) {
+  _state.thresholds = thresholds;
+  _state.armed = true;
+  // an alarm whose threshold was taken away is just off, that isn't news for the server
+  uint8_t watched = 0;
+  if (thresholds.tempHighCenti != ALARM_OFF) watched |= ALARM_TEMP_HIGH;
+  if (thresholds.tempLowCenti != ALARM_OFF) watched |= ALARM_TEMP_LOW;
+  if (thresholds.humidityHighCenti != ALARM_OFF) watched |= ALARM_HUMIDITY_HIGH;
+  if (thresholds.humidityLowCenti != ALARM_OFF) watched |= ALARM_HUMIDITY_LOW;
+  _state.active &= watched;
+  _state.changed &= watched;
+}
+
+bool AlarmMonitor::check(const Sample& sample, int64_t wakeRawUs) {
+  return alarmCheck(_state, sample, wakeRawUs);
+}
+
+bool AlarmMonitor::pendingReport(int64_t nowRawUs, AlarmReport& report) const {
+  if (_state.active == 0 && _state.changed == 0 && !_state.latencyUnsent) return false;
+  report.active = _state.active;
+  report.changed = _state.changed;
+  report.sinceWakeMs = _state.changed ? (nowRawUs - _state.changedWakeRawUs) / 1000 : 0;
+  report.lastLatencyMs = _state.latencyUnsent ? _state.lastLatencyMs : 0;
+  return true;
+}
+
+void AlarmMonitor::onUploaded(const AlarmReport& report, int64_t nowRawUs) {
+  if (report.lastLatencyMs) _state.latencyUnsent = false;
+  if (report.changed == 0) return;
+  _state.lastLatencyMs = (nowRawUs - _state.changedWakeRawUs) / 1000;
+  _state.latencyUnsent = true;
+  // anything that changed after the report was built is still due
+  _state.changed &= ~report.changed;
+}
+
+const char* AlarmMonitor::kindName(uint8_t bit) {
+  switch (bit) {
+    case ALARM_TEMP_HIGH:     return "temperatureHigh";
+    case ALARM_TEMP_LOW:      return "temperatureLow";
+    case ALARM_HUMIDITY_HIGH: return "humidityHigh";
+    default:                  return "humidityLow";
+  }
+}
@@ -1,46 +1,105 @@
 #include "ApiHandler.h"
 #include <HTTPClient.h>
 #include <ArduinoJson.h>
+#include <WiFi.h>
+#include <lwip/dns.h>
+#include "SampleCodec.h"
 
-ApiHandler::ApiHandler(ConfigManager& configManager)
-  : _configManager(configManager) {
+// response headers HTTPClient should keep for us
+const char* COLLECTED_HEADERS[] = { "Date", "Retry-After" };
+
+// body is a u16 little endian header length, a JSON header and a sample
+// block, see buildBinaryIngest()
+const char* BINARY_INGEST_CONTENT_TYPE = "application/x-iot-samples";
+
+// the lookup resolveHost() waits for, a late answer to one it gave up on is ignored
+static volatile uint32_t dnsLookup = 0;
+static volatile bool dnsDone = false;
+static volatile bool dnsFound = false;
+
+// lwIP calls this from its own task
+static void onDnsFound(const char* name, const ip_addr_t* address, void* arg) {
+  if ((uint32_t)(uintptr_t)arg != dnsLookup) return;
+  dnsFound = address != nullptr;
+  dnsDone = true;
+}
+
+// WiFi.hostByName() without its 15 s wait: lwIP keeps asking after we give
+// up and caches the answer, HTTPClient's own lookup is free after this
+static bool resolveHost(const char* host, uint32_t timeoutMs) {
+  ip_addr_t address;
+  dnsLookup++;
+  dnsFound = false;
+  dnsDone = false;
+  err_t err = dns_gethostbyname(host, &address, onDnsFound, (void*)(uintptr_t)dnsLookup);
+  if (err == ERR_OK) return true; // cached, or an IP address
+  if (err != ERR_INPROGRESS) return false;
+  unsigned long start = millis();
+  while (!dnsDone && millis() - start < timeoutMs) delay(5);
+  return dnsDone && dnsFound;
+}
+
+ApiHandler::ApiHandler(ConfigManager& configManager, TimeKeeper& timeKeeper, NodeAuth& auth, EndpointSelector& endpoints)
+  : _configManager(configManager), _timeKeeper(timeKeeper), _auth(auth), _endpoints(endpoints), _activeServerUrl(nullptr),
+    _updateAvailable(false), _retryAfterSeconds(0), _keptUrl(nullptr), _keepConnection(false), _connectionReused(false) {
+  memset(&_firmwareUpdate, 0, sizeof(_firmwareUpdate));
 }
 
 bool ApiHandler::registerDeviceIfNeeded() {
   DeviceConfig& config = _configManager.getMutableConfig();
 
   // If we already have a deviceId, we don't need to register.
-  if (strlen(config.deviceId) > 0) {
+  // Signed builds need the secret too, which older registrations didn't get,
+  // and a new one once the server kept turning the old one down.
+  bool rekey = SIGNED_INGEST && strlen(config.deviceId) > 0 && _auth.needsRekey();
+  if (strlen(config.deviceId) > 0 && (!SIGNED_INGEST || _auth.hasSecret()) && !rekey) {
     Serial.println("Device is already registered.");
     return true;
   }
 
-  Serial.println("Device not registered. Attempting registration...");
+  Serial.println(rekey ? "Server keeps turning down our secret. Re-keying..." : "Device not registered. Attempting registration...");
 
   // Create the JSON payload 
   JsonDocument doc;
   doc["name"] = config.deviceName;
   doc["type"] = config.deviceType;
   doc["locationHint"] = config.locationHint;
+#if SIGNED_INGEST
+  doc["auth"] = NODE_AUTH_SCHEME; // the server answers with our secret
+  if (rekey) {
+    // same id, new secret. Signed with the old secret and a fresh counter so
+    // only we can do it and a recorded one can't be played back.
+    uint32_t counter = _auth.takeCounter();
+    if (counter == 0) {
+      Serial.println("Cannot re-key: couldn't save the auth counter.");
+      return false;
+    }
+    doc["deviceId"] = config.deviceId;
+    doc["counter"] = counter;
+  }
+#endif
 
   String jsonPayload;
   serializeJson(doc, jsonPayload);
+  String authorization;
+  if (rekey && !signBody((uint8_t*)jsonPayload.c_str(), jsonPayload.length(), authorization)) {
+    Serial.println("Cannot re-key: signing failed.");
+    return false;
+  }
 
   //  HTTP POST request for registerning
+  Serial.println("Sending registration request, payload: " + jsonPayload);
   HTTPClient http;
-  String registrationUrl = String(config.serverUrl) + "/devices";
-  http.begin(registrationUrl);
-  http.addHeader("Content-Type", "application/json");
-
-  Serial.println("Sending registration request to: " + registrationUrl);
-  Serial.println("Payload: " + jsonPayload);
-
-  int httpCode = http.POST(jsonPayload);
+  int64_t requestRawUs, responseRawUs;
+  int httpCode = postWithFailover(http, "/devices", (uint8_t*)jsonPayload.c_str(), jsonPayload.length(), "application/json",
+                                  authorization, requestRawUs, responseRawUs);
 
   if (httpCode > 0) {
     String responsePayload = http.getString();
     Serial.printf("Registration response code: %d\n", httpCode);
-    Serial.println("Response payload: " + responsePayload);
+#if !SIGNED_INGEST
+    Serial.println("Response payload: " + responsePayload); // has the secret otherwise
+#endif
 
     if (httpCode == HTTP_CODE_CREATED || httpCode == HTTP_CODE_OK) {
       // -get the deviceId from serverc response
@@ -49,8 +108,17 @@ bool ApiHandler::registerDeviceIfNeeded() {
       const char* receivedId = responseDoc["id"];
 
       if (receivedId) {
+#if SIGNED_INGEST
+        const char* secret = responseDoc["secret"];
+        if (!_auth.setSecret(secret)) {
+          Serial.println("Registration successful, but no usable 'secret' in response.");
+          http.end();
+          return false;
+        }
+#endif
         strncpy(config.deviceId, receivedId, sizeof(config.deviceId));
-        _configManager.saveConfig(); // Save the new deviceId
+        _auth.onAccepted();
+        _configManager.saveConfig(); // Save the new deviceId (and secret)
         Serial.println("Successfully registered! New Device ID: " + String(config.deviceId));
         http.end();
         return true;
@@ -58,6 +126,17 @@ bool ApiHandler::registerDeviceIfNeeded() {
         Serial.println("Registration successful, but no 'id' field in response.");
       }
     }
+    else if (rekey && httpCode == HTTP_CODE_UNAUTHORIZED) {
+      // it doesn't take the old secret for this id either, start over as a new device
+      Serial.println("Server turned down the re-key, registering as a new device next time.");
+      memset(config.deviceId, 0, sizeof(config.deviceId));
+      _auth.clearSecret();
+      _auth.onAccepted();
+      _configManager.saveConfig();
+    }
+    else if (rekey) {
+      handleAuthRejection(httpCode, responsePayload); // a 409 moves the counter on for the next try
+    }
   } else {
     Serial.printf("Registration failed, HTTP error: %s\n", http.errorToString(httpCode).c_str());
   }
@@ -66,7 +145,7 @@ bool ApiHandler::registerDeviceIfNeeded() {
   return false;
 }
 
-bool ApiHandler::sendTelemetry(float temperature, float humidity, float battery) {
+bool ApiHandler::sendTelemetry(float temperature, float humidity, float battery, const TelemetryExtras& extras) {
   const DeviceConfig& config = _configManager.getConfig();
 
   // We can't send telemetry without a deviceId
@@ -78,32 +157,433 @@ bool ApiHandler::sendTelemetry(float temperature, float humidity, float battery)
   // JSON payload 
   JsonDocument doc;
   doc["deviceId"] = config.deviceId;
+#if !BINARY_INGEST
   doc["metrics"]["temperature_c"] = temperature;
   doc["metrics"]["humidity_pct"] = humidity;
+#endif
   doc["metrics"]["battery_pct"] = battery;
+  doc["fwVersion"] = FIRMWARE_VERSION;
+  if (_timeKeeper.isSynced()) {
+    doc["timestampMs"] = _timeKeeper.nowMs();
+    doc["timestampUncertaintyMs"] = _timeKeeper.uncertaintyMs();
+  }
+
+  if (extras.connectivity) {
+    JsonObject connectivity = doc["connectivity"].to<JsonObject>();
+    connectivity["wifiFailures"] = extras.connectivity->wifiFailures;
+    connectivity["uploadFailures"] = extras.connectivity->uploadFailures;
+    connectivity["skippedUploads"] = extras.connectivity->skippedUploads;
+    connectivity["probeMisses"] = extras.connectivity->probeMisses;
+    connectivity["offlineS"] = extras.connectivity->offlineSeconds;
+  }
+  if (extras.wakes) {
+    JsonObject wakes = doc["wakes"].to<JsonObject>();
+    wakes["stub"] = extras.wakes->stubWakes;
+    wakes["stubAvgMs"] = extras.wakes->stubAvgUs / 1000.0;
+    wakes["boot"] = extras.wakes->bootWakes;
+    wakes["bootAvgMs"] = extras.wakes->bootAvgMs;
+    wakes["stubSensorFails"] = extras.wakes->stubSensorFailures;
+  }
+  EndpointReport endpointReport;
+  bool reportEndpoints = _endpoints.pendingReport(endpointReport);
+  if (reportEndpoints) {
+    JsonObject endpoints = doc["endpoints"].to<JsonObject>();
+    endpoints["failovers"] = endpointReport.failovers;
+    JsonArray list = endpoints["list"].to<JsonArray>();
+    for (uint8_t i = 0; i < endpointReport.count; i++) {
+      const EndpointStats& stats = endpointReport.stats[i];
+      JsonObject entry = list.add<JsonObject>();
+      entry["avgMs"] = stats.avgMs;
+      entry["dnsMs"] = stats.dnsMs;
+      entry["ok"] = stats.successes;
+      entry["failed"] = stats.failures;
+      if (stats.lastFailure != ENDPOINT_OK) entry["lastFailure"] = EndpointSelector::phaseName(stats.lastFailure);
+    }
+  }
+  if (extras.radio) {
+    JsonObject radio = doc["radio"].to<JsonObject>();
+    radio["txDbm"] = extras.radio->txQdbm / 4.0;
+    radio["rssi"] = extras.radio->rssi;
+    radio["rssiMin"] = extras.radio->rssiMin;
+    radio["retries"] = extras.radio->retries;
+  }
+  if (extras.sleep) {
+    JsonObject sleep = doc["sleep"].to<JsonObject>();
+    sleep["mode"] = SleepPolicy::modeName(extras.sleep->mode);
+    sleep["reconnectMs"] = extras.sleep->reconnectMs;
+    sleep["crossoverS"] = extras.sleep->crossoverS;
+    sleep["reconnectsAvoided"] = extras.sleep->reconnectsAvoided;
+    sleep["connectionsReused"] = extras.sleep->connectionsReused;
+    for (uint8_t i = 0; i < SLEEP_MODE_COUNT; i++) {
+      const SleepModeStats& stats = extras.sleep->modes[i];
+      if (stats.cycles == 0) continue;
+      JsonObject mode = sleep[SleepPolicy::modeName(i)].to<JsonObject>();
+      mode["cycles"] = stats.cycles;
+      mode["awakeMs"] = stats.awakeMs;
+      mode["radioMs"] = stats.radioMs;
+      mode["sleepS"] = stats.sleepS;
+      mode["mAs"] = extras.sleep->chargeMas[i];
+    }
+  }
+  if (extras.budget) {
+    JsonObject budget = doc["budget"].to<JsonObject>();
+    uint32_t overruns = 0;
+    for (uint8_t i = 0; i < BUDGET_STEP_COUNT; i++) {
+      if (extras.budget->overruns[i] == 0) continue;
+      budget[AwakeBudget::stepName(i)] = extras.budget->overruns[i];
+      overruns += extras.budget->overruns[i];
+    }
+    budget["overruns"] = overruns;
+    budget["last"] = AwakeBudget::stepName(extras.budget->lastStep);
+    budget["lastWake"] = AwakeBudget::reasonName(extras.budget->lastReason);
+    budget["lastAwakeMs"] = extras.budget->lastAwakeMs;
+  }
+  if (extras.alarm) {
+    // only an alarm event has "changed", the rest is the state
+    JsonObject alarm = doc["alarm"].to<JsonObject>();
+    JsonArray active = alarm["active"].to<JsonArray>();
+    for (uint8_t bit = 1; bit < (1 << ALARM_KIND_COUNT); bit <<= 1) {
+      if (extras.alarm->active & bit) active.add(AlarmMonitor::kindName(bit));
+    }
+    if (extras.alarm->changed) {
+      JsonArray changed = alarm["changed"].to<JsonArray>();
+      for (uint8_t bit = 1; bit < (1 << ALARM_KIND_COUNT); bit <<= 1) {
+        if (extras.alarm->changed & bit) changed.add(AlarmMonitor::kindName(bit));
+      }
+      alarm["sinceWakeMs"] = extras.alarm->sinceWakeMs;
+    }
+    if (extras.alarm->lastLatencyMs) alarm["lastLatencyMs"] = extras.alarm->lastLatencyMs;
+  }
 
+  uint32_t nowSeconds = TimeKeeper::rawClockUs() / 1000000;
 
-  String jsonPayload;
-  serializeJson(doc, jsonPayload);
+#if SIGNED_INGEST
+  // the server only takes a counter bigger than the last one it saw
+  uint32_t counter = _auth.takeCounter();
+  if (counter == 0) {
+    Serial.println("Cannot send telemetry: couldn't save the auth counter.");
+    return false;
+  }
+  doc["counter"] = counter;
+#endif
 
-  // HTTP POST request for telemetry
-  HTTPClient http;
-  String ingestUrl = String(config.serverUrl) + "/ingest";
-  http.begin(ingestUrl);
-  http.addHeader("Content-Type", "application/json");
+#if BINARY_INGEST
+  // the readings go in the sample block, the server works out when each was
+  // taken from rawNowS
+  doc["rawNowS"] = nowSeconds;
+  String header;
+  serializeJson(doc, header);
+  Serial.println("Header: " + header);
 
-  Serial.println("Sending telemetry to: " + ingestUrl);
+  size_t length;
+  uint8_t* body = buildBinaryIngest(header, extras.backlog, SampleBuffer::makeSample(nowSeconds, temperature, humidity), length);
+  if (!body) {
+    Serial.println("Cannot send telemetry: no memory for the sample block.");
+    return false;
+  }
+  bool sent = postIngest(body, length, BINARY_INGEST_CONTENT_TYPE);
+  free(body);
+  if (sent && reportEndpoints) _endpoints.onReported(endpointReport);
+  return sent;
+#else
+  // readings from wakes that didn't upload, oldest first. ageS is how long
+  // before this request each was taken.
+  if (extras.backlog && extras.backlog->count > 0) {
+    JsonArray backlog = doc["backlog"].to<JsonArray>();
+    for (uint8_t i = 0; i < extras.backlog->count; i++) {
+      const Sample& sample = extras.backlog->samples[i];
+      uint32_t ageSeconds = nowSeconds > sample.rawSeconds ? nowSeconds - sample.rawSeconds : 0;
+      JsonObject entry = backlog.add<JsonObject>();
+      entry["ageS"] = ageSeconds;
+      if (_timeKeeper.isSynced()) entry["timestampMs"] = _timeKeeper.nowMs() - (int64_t)ageSeconds * 1000;
+      entry["temperature_c"] = SampleBuffer::temperature(sample);
+      entry["humidity_pct"] = SampleBuffer::humidity(sample);
+    }
+  }
+
+  String jsonPayload;
+  serializeJson(doc, jsonPayload);
   Serial.println("Payload: " + jsonPayload);
+  bool sent = postIngest((uint8_t*)jsonPayload.c_str(), jsonPayload.length(), "application/json");
+  if (sent && reportEndpoints) _endpoints.onReported(endpointReport);
+  return sent;
+#endif
+}
 
-  int httpCode = http.POST(jsonPayload);
+bool ApiHandler::postIngest(uint8_t* body, size_t length, const char* contentType) {
+  String authorization;
+#if SIGNED_INGEST
+  if (!signBody(body, length, authorization)) {
+    Serial.println("Cannot send telemetry: signing failed.");
+    return false;
+  }
+#endif
+
+  // HTTP POST request for telemetry
+  Serial.printf("Sending telemetry (%u bytes)\n", (unsigned)length);
+  HTTPClient oneShot;
+  HTTPClient& http = _keepConnection ? _keptHttp : oneShot;
+  int64_t requestRawUs, responseRawUs;
+  int httpCode = postWithFailover(http, "/ingest", body, length, contentType, authorization, requestRawUs, responseRawUs);
 
   if (httpCode > 0 && (httpCode >= 200 && httpCode < 300)) {
     Serial.printf("Telemetry sent successfully, response code: %d\n", httpCode);
+#if SIGNED_INGEST
+    _auth.onAccepted();
+#endif
+    parseIngestResponse(http.getString(), requestRawUs, responseRawUs);
     http.end();
     return true;
   } else {
     Serial.printf("Telemetry failed, HTTP error: %s\n", http.errorToString(httpCode).c_str());
+#if SIGNED_INGEST
+    handleAuthRejection(httpCode, http.getString());
+#endif
     http.end();
     return false;
   }
 }
+
+// over exactly these bytes, so whatever carries them can't change a thing
+bool ApiHandler::signBody(const uint8_t* body, size_t length, String& authorization) {
+  char tag[NodeAuth::TAG_HEX_SIZE];
+  unsigned long startMicros = micros();
+  if (!_auth.sign(body, length, tag)) return false;
+  Serial.printf("Signed %u bytes in %lu us.\n", (unsigned)length, micros() - startMicros);
+  authorization = String(NODE_AUTH_SCHEME " ") + _configManager.getConfig().deviceId + ":" + tag;
+  return true;
+}
+
+int ApiHandler::postWithFailover(HTTPClient& http, const char* path, uint8_t* body, size_t length, const char* contentType,
+                                 const String& authorization, int64_t& requestRawUs, int64_t& responseRawUs) {
+  const DeviceConfig& config = _configManager.getConfig();
+  const char* urls[EndpointSelector::MAX_ENDPOINTS] = { config.serverUrl };
+  for (int i = 0; i < FALLBACK_URL_COUNT && i + 1 < EndpointSelector::MAX_ENDPOINTS; i++) urls[i + 1] = config.fallbackUrls[i];
+  _endpoints.setUrls(urls, EndpointSelector::MAX_ENDPOINTS);
+
+  uint32_t nowSeconds = TimeKeeper::rawClockUs() / 1000000;
+  uint8_t order[EndpointSelector::MAX_ENDPOINTS];
+  uint8_t count = _endpoints.order(nowSeconds, order);
+  int httpCode = HTTPC_ERROR_CONNECTION_REFUSED;
+  requestRawUs = responseRawUs = TimeKeeper::rawClockUs();
+  bool kept = &http == &_keptHttp;
+  _connectionReused = false;
+
+  for (uint8_t attempt = 0; attempt < count; attempt++) {
+    uint8_t index = order[attempt];
+    const char* serverUrl = _endpoints.url(index);
+    EndpointTimeouts timeouts = _endpoints.timeouts(index, attempt + 1 == count);
+    String url = String(serverUrl) + path;
+    // only what this attempt gets back counts, an attempt that never goes out gets nothing
+    _retryAfterSeconds = 0;
+
+    // look the host up ourselves, HTTPClient can't tell us a failed lookup
+    // from a refused connect, and would wait 15 s for a DNS server that
+    // doesn't answer
+    char host[128];
+    unsigned long dnsStart = millis();
+    if (!EndpointSelector::hostOf(serverUrl, host, sizeof(host)) || !resolveHost(host, timeouts.dnsMs)) {
+      Serial.printf("Endpoint %u: can't resolve %s within %u ms.\n", index, url.c_str(), timeouts.dnsMs);
+      _endpoints.onFailure(index, ENDPOINT_FAIL_DNS, nowSeconds);
+      httpCode = HTTPC_ERROR_CONNECTION_REFUSED;
+      continue;
+    }
+    _endpoints.onDns(index, millis() - dnsStart);
+
+    // HTTPClient would happily reuse a connection to another host
+    if (kept && _keptUrl != serverUrl) closeKeptConnection();
+    bool reused = kept && http.connected();
+
+    beginPost(http, url, timeouts, contentType, authorization);
+    Serial.printf("POST %s (endpoint %u, %u/%u ms%s)\n", url.c_str(), index, timeouts.connectMs, timeouts.firstByteMs,
+                  reused ? ", kept connection" : "");
+    requestRawUs = TimeKeeper::rawClockUs();
+    httpCode = http.POST(body, length);
+    if (reused && httpCode < 0) {
+      // the server may have closed it while we slept, that isn't the endpoint failing
+      Serial.println("Kept connection is gone, opening a new one.");
+      closeKeptConnection();
+      reused = false;
+      beginPost(http, url, timeouts, contentType, authorization);
+      requestRawUs = TimeKeeper::rawClockUs();
+      httpCode = http.POST(body, length);
+    }
+    responseRawUs = TimeKeeper::rawClockUs();
+    readResponseHeaders(http, requestRawUs, responseRawUs);
+
+    // any answer but a 5xx is the backend talking, a 4xx would be the same on the next one
+    if (httpCode > 0 && httpCode < 500) {
+      _endpoints.onAnswer(index, (responseRawUs - requestRawUs) / 1000, attempt);
+      _activeServerUrl = serverUrl;
+      if (kept) _keptUrl = serverUrl;
+      _connectionReused = reused;
+      return httpCode;
+    }
+
+    EndpointPhase phase = ENDPOINT_FAIL_RESPONSE;
+    if (httpCode >= 500) phase = ENDPOINT_FAIL_SERVER;
+    else if (httpCode == HTTPC_ERROR_CONNECTION_REFUSED) phase = ENDPOINT_FAIL_CONNECT;
+    Serial.printf("Endpoint %u failed (%s): %s\n", index, EndpointSelector::phaseName(phase),
+                  httpCode > 0 ? String(httpCode).c_str() : http.errorToString(httpCode).c_str());
+    _endpoints.onFailure(index, phase, nowSeconds);
+    if (kept) _keptUrl = nullptr; // don't trust it for the next one
+    // the last one stays open so the caller can read its 5xx
+    if (attempt + 1 < count) http.end();
+  }
+  return httpCode;
+}
+
+void ApiHandler::beginPost(HTTPClient& http, const String& url, const EndpointTimeouts& timeouts, const char* contentType,
+                           const String& authorization) {
+  http.begin(url);
+  http.setConnectTimeout(timeouts.connectMs);
+  http.setTimeout(timeouts.firstByteMs);
+  http.addHeader("Content-Type", contentType);
+  if (authorization.length() > 0) http.addHeader("Authorization", authorization);
+  http.collectHeaders(COLLECTED_HEADERS, 2);
+}
+
+// 401: the server doesn't take our signature. Once is no reason to give up
+// the identity, after NodeAuth::MAX_REJECTIONS in a row the next wake re-keys
+// (see registerDeviceIfNeeded()). 409: it already took a bigger counter from
+// us, e.g. after NVS was restored, so carry on after that one:
+// {"error": "replayed counter", "lastCounter": 1234}
+void ApiHandler::handleAuthRejection(int httpCode, const String& payload) {
+  if (httpCode == HTTP_CODE_UNAUTHORIZED) {
+    _auth.onRejected();
+    if (_auth.needsRekey()) Serial.println("Server keeps turning down our signature, re-keying next time.");
+    else Serial.println("Server turned down our signature.");
+  }
+  else if (httpCode == HTTP_CODE_CONFLICT) {
+    JsonDocument doc;
+    if (deserializeJson(doc, payload) != DeserializationError::Ok || !doc["lastCounter"].is<uint32_t>()) return;
+    Serial.printf("Server has seen counter %u already, skipping past it.\n", doc["lastCounter"].as<uint32_t>());
+    _auth.skipPast(doc["lastCounter"].as<uint32_t>());
+  }
+}
+
+// u16 little endian length of the JSON header, the header, then a sample
+// block (SampleCodec.h) with the backlog oldest first and the current
+// reading last
+uint8_t* ApiHandler::buildBinaryIngest(const String& header, const SampleBuffer* backlog, const Sample& current, size_t& length) {
+  Sample samples[SampleBuffer::CAPACITY + 1];
+  size_t count = 0;
+  if (backlog) {
+    memcpy(samples, backlog->samples, backlog->count * sizeof(Sample));
+    count = backlog->count;
+  }
+  samples[count++] = current;
+
+  size_t headerLength = header.length();
+  size_t capacity = 2 + headerLength + sampleBlockMaxSize(count);
+  uint8_t* body = (uint8_t*)malloc(capacity);
+  if (!body) return nullptr;
+  body[0] = headerLength & 0xFF;
+  body[1] = (headerLength >> 8) & 0xFF;
+  memcpy(body + 2, header.c_str(), headerLength);
+
+  unsigned long startMicros = micros();
+  size_t blockLength = encodeSamples(samples, count, body + 2 + headerLength, capacity - 2 - headerLength);
+  unsigned long encodeMicros = micros() - startMicros;
+  Serial.printf("Packed %u readings into %u bytes in %lu us.\n", (unsigned)count, (unsigned)blockLength, encodeMicros);
+
+  length = 2 + headerLength + blockLength;
+  return body;
+}
+
+bool ApiHandler::checkServerReachable() {
+  const DeviceConfig& config = _configManager.getConfig();
+
+  HTTPClient http;
+  http.setConnectTimeout(5000);
+  http.setTimeout(5000);
+  if (!http.begin(config.serverUrl)) {
+    Serial.println("Server check: invalid server URL.");
+    return false;
+  }
+
+  // any status code at all means there is a server there, even a 404
+  int httpCode = http.GET();
+  http.end();
+  if (httpCode > 0) {
+    Serial.printf("Server check: reachable, response code: %d\n", httpCode);
+    return true;
+  }
+  Serial.printf("Server check failed, HTTP error: %s\n", http.errorToString(httpCode).c_str());
+  return false;
+}
+
+bool ApiHandler::firmwareUpdateAvailable() const {
+  return _updateAvailable;
+}
+
+const FirmwareUpdate& ApiHandler::firmwareUpdate() const {
+  return _firmwareUpdate;
+}
+
+uint32_t ApiHandler::retryAfterSeconds() const {
+  return _retryAfterSeconds;
+}
+
+const char* ApiHandler::activeServerUrl() const {
+  return _activeServerUrl ? _activeServerUrl : _configManager.getConfig().serverUrl;
+}
+
+void ApiHandler::keepConnection(bool keep) {
+  if (!keep) closeKeptConnection();
+  _keepConnection = keep;
+}
+
+bool ApiHandler::connectionReused() const {
+  return _connectionReused;
+}
+
+void ApiHandler::closeKeptConnection() {
+  // end() keeps it open for reuse, unless reuse is off
+  _keptHttp.setReuse(false);
+  _keptHttp.end();
+  _keptHttp.setReuse(true);
+  _keptUrl = nullptr;
+}
+
+// the server can offer an update in the ingest response:
+// {"firmware": {"version": "1.1.0", "url": "/firmware/...", "sha256": "...", "size": 123456}}
+// and tell us its time in ms, which is more precise than the Date header:
+// {"serverTime": 1763497800123}
+void ApiHandler::parseIngestResponse(const String& payload, int64_t requestRawUs, int64_t responseRawUs) {
+  _updateAvailable = false;
+  if (payload.length() == 0) return;
+
+  JsonDocument responseDoc;
+  if (deserializeJson(responseDoc, payload) != DeserializationError::Ok) return;
+
+  if (responseDoc["serverTime"].is<int64_t>()) {
+    _timeKeeper.syncFromServerTime(responseDoc["serverTime"].as<int64_t>(), requestRawUs, responseRawUs);
+  }
+
+  JsonObject firmware = responseDoc["firmware"];
+  const char* version = firmware["version"];
+  const char* url = firmware["url"];
+  const char* sha256 = firmware["sha256"];
+  uint32_t size = firmware["size"] | 0;
+  if (!version || !url || !sha256 || size == 0) return;
+  if (strcmp(version, FIRMWARE_VERSION) == 0) return; // already running it
+
+  strncpy(_firmwareUpdate.version, version, sizeof(_firmwareUpdate.version) - 1);
+  strncpy(_firmwareUpdate.url, url, sizeof(_firmwareUpdate.url) - 1);
+  strncpy(_firmwareUpdate.sha256, sha256, sizeof(_firmwareUpdate.sha256) - 1);
+  _firmwareUpdate.size = size;
+  _updateAvailable = true;
+  Serial.printf("Server offers firmware %s (running %s).\n", version, FIRMWARE_VERSION);
+}
+
+void ApiHandler::readResponseHeaders(HTTPClient& http, int64_t requestRawUs, int64_t responseRawUs) {
+  // only the seconds form, nobody sends the date form to devices
+  _retryAfterSeconds = http.hasHeader("Retry-After") ? http.header("Retry-After").toInt() : 0;
+
+  if (!http.hasHeader("Date")) return;
+  if (_timeKeeper.syncFromHttpDate(http.header("Date"), requestRawUs, responseRawUs)) {
+    Serial.printf("Clock synced from Date header, +/- %u ms, drift ratio %.5f\n",
+                  _timeKeeper.uncertaintyMs(), _timeKeeper.driftRatio());
+  }
+}
@@ -0,0 +1,133 @@
+#include "AwakeBudget.h"
+#include <string.h>
+
+// millis() wraps after 49 days, which a node that stays connected does see
+static bool before(uint32_t a, uint32_t b) {
+  return (int32_t)(a - b) < 0;
+}
+
+AwakeBudget::AwakeBudget(AwakeBudgetState& state) : _state(state) {
+}
+
+void AwakeBudget::beginWake(BudgetWakeReason reason, uint32_t nowMs) {
+  _reason = reason;
+  _wakeStartMs = nowMs;
+  _wakeDeadlineMs = nowMs + budgetMs(reason);
+  _depth = 0;
+}
+
+void AwakeBudget::beginStep(BudgetStep step, uint32_t nowMs) {
+  // deeper than that doesn't happen, but keep the count so endStep() pairs up
+  if (_depth < MAX_DEPTH) {
+    _steps[_depth].step = step;
+    _steps[_depth].deadlineMs = nowMs + sliceMs(step);
+  }
+  if (_depth < 255) _depth++;
+}
+
+void AwakeBudget::endStep(uint32_t nowMs) {
+  if (_depth == 0) return;
+  _depth--;
+  // after a session the rest of the wake gets its budget again
+  if (_depth < MAX_DEPTH && isSession(_steps[_depth].step) && !inSession()) {
+    _wakeDeadlineMs = nowMs + budgetMs(_reason);
+  }
+}
+
+uint32_t AwakeBudget::deadlineMs() const {
+  bool found = !inSession();
+  uint32_t deadline = _wakeDeadlineMs;
+  for (uint8_t i = 0; i < _depth && i < MAX_DEPTH; i++) {
+    if (!found || before(_steps[i].deadlineMs, deadline)) deadline = _steps[i].deadlineMs;
+    found = true;
+  }
+  return deadline;
+}
+
+uint32_t AwakeBudget::msLeft(uint32_t nowMs) const {
+  int32_t left = (int32_t)(deadlineMs() - nowMs);
+  return left > 0 ? left : 0;
+}
+
+BudgetStep AwakeBudget::onOverrun(uint32_t nowMs) {
+  // the innermost step that's out, or the wake if none is
+  BudgetStep step = BUDGET_STEP_NONE;
+  for (uint8_t i = _depth < MAX_DEPTH ? _depth : MAX_DEPTH; i > 0; i--) {
+    if (!before(nowMs, _steps[i - 1].deadlineMs)) {
+      step = _steps[i - 1].step;
+      break;
+    }
+  }
+  if (_state.overruns[step] < 0xFFFF) _state.overruns[step]++;
+  _state.lastStep = step;
+  _state.lastReason = _reason;
+  _state.lastAwakeMs = nowMs - _wakeStartMs;
+  return step;
+}
+
+bool AwakeBudget::pendingReport(AwakeBudgetReport& report) const {
+  bool any = false;
+  for (uint8_t i = 0; i < BUDGET_STEP_COUNT; i++) any |= _state.overruns[i] > 0;
+  if (!any) return false;
+  memcpy(report.overruns, _state.overruns, sizeof(report.overruns));
+  report.lastStep = _state.lastStep;
+  report.lastReason = _state.lastReason;
+  report.lastAwakeMs = _state.lastAwakeMs;
+  return true;
+}
+
+void AwakeBudget::onReported(const AwakeBudgetReport& report) {
+  // whatever happened after the report was built stays for the next one
+  for (uint8_t i = 0; i < BUDGET_STEP_COUNT; i++) {
+    _state.overruns[i] -= report.overruns[i] < _state.overruns[i] ? report.overruns[i] : _state.overruns[i];
+  }
+}
+
+uint32_t AwakeBudget::budgetMs(BudgetWakeReason reason) {
+  switch (reason) {
+    case BUDGET_WAKE_TIMER:  return AWAKE_BUDGET_TIMER_MS;
+    case BUDGET_WAKE_BUTTON: return AWAKE_BUDGET_BUTTON_MS;
+    default:                 return AWAKE_BUDGET_BOOT_MS;
+  }
+}
+
+uint32_t AwakeBudget::sliceMs(BudgetStep step) {
+  switch (step) {
+    case BUDGET_STEP_CONNECT: return BUDGET_CONNECT_MS;
+    case BUDGET_STEP_REQUEST: return BUDGET_REQUEST_MS;
+    case BUDGET_STEP_SENSOR:  return BUDGET_SENSOR_MS;
+    case BUDGET_STEP_PORTAL:  return BUDGET_PORTAL_MS;
+    case BUDGET_STEP_UPDATE:  return BUDGET_UPDATE_MS;
+    default:                  return 0;
+  }
+}
+
+const char* AwakeBudget::stepName(uint8_t step) {
+  switch (step) {
+    case BUDGET_STEP_CONNECT: return "connect";
+    case BUDGET_STEP_REQUEST: return "request";
+    case BUDGET_STEP_SENSOR:  return "sensor";
+    case BUDGET_STEP_PORTAL:  return "portal";
+    case BUDGET_STEP_UPDATE:  return "update";
+    default:                  return "wake";
+  }
+}
+
+const char* AwakeBudget::reasonName(uint8_t reason) {
+  switch (reason) {
+    case BUDGET_WAKE_TIMER:  return "timer";
+    case BUDGET_WAKE_BUTTON: return "button";
+    default:                 return "boot";
+  }
+}
+
+bool AwakeBudget::inSession() const {
+  for (uint8_t i = 0; i < _depth && i < MAX_DEPTH; i++) {
+    if (isSession(_steps[i].step)) return true;
+  }
+  return false;
+}
+
+bool AwakeBudget::isSession(BudgetStep step) {
+  return step == BUDGET_STEP_PORTAL || step == BUDGET_STEP_UPDATE;
+}
@@ -1,4 +1,7 @@
 #include "ButtonHandler.h"
+
+#if HAS_BUTTON
+
 #include <Arduino.h>
 
 //static members
@@ -64,3 +67,5 @@ void ButtonHandler::handleLongPress() {
   //cancel any pending double click state
   _currentState = S_IDLE;
 }
+
+#endif // HAS_BUTTON
@@ -1,14 +1,28 @@
 #include "ConfigManager.h"
 #include <Preferences.h>
+#include <nvs.h>
+#include <ctype.h>
 
 // The namespace for storing the preferences in NV mem
 const char* PREFERENCES_NAMESPACE = "iot-node-config";
 
+// NVS keys of DeviceConfig::fallbackUrls
+const char* FALLBACK_URL_KEYS[FALLBACK_URL_COUNT] = { "fallbackUrl1", "fallbackUrl2" };
+
 Preferences preferences;
 
 ConfigManager::ConfigManager() {
   // Initialize with default/empty values
+  setDefaults();
+}
+
+// empty, no alarms watched (0 would be a threshold at 0 C / 0 %RH)
+void ConfigManager::setDefaults() {
   memset(&_config, 0, sizeof(DeviceConfig));
+  _config.alarmTempHighCenti = CONFIG_NO_THRESHOLD;
+  _config.alarmTempLowCenti = CONFIG_NO_THRESHOLD;
+  _config.alarmHumidityHighCenti = CONFIG_NO_THRESHOLD;
+  _config.alarmHumidityLowCenti = CONFIG_NO_THRESHOLD;
 }
 
 void ConfigManager::begin() {
@@ -24,29 +38,73 @@ void ConfigManager::loadConfig() { // loads config
     preferences.getString("wifiSSID", _config.wifiSSID, sizeof(_config.wifiSSID));
     preferences.getString("wifiPassword", _config.wifiPassword, sizeof(_config.wifiPassword));
     preferences.getString("serverUrl", _config.serverUrl, sizeof(_config.serverUrl));
+    for (int i = 0; i < FALLBACK_URL_COUNT; i++) {
+      preferences.getString(FALLBACK_URL_KEYS[i], _config.fallbackUrls[i], sizeof(_config.fallbackUrls[i]));
+    }
     preferences.getString("deviceId", _config.deviceId, sizeof(_config.deviceId));
+    preferences.getString("authSecret", _config.authSecret, sizeof(_config.authSecret));
+    _config.authCounterLease = preferences.getUInt("authLease", 0);
     preferences.getString("deviceName", _config.deviceName, sizeof(_config.deviceName));
     preferences.getString("deviceType", _config.deviceType, sizeof(_config.deviceType));
     preferences.getString("locationHint", _config.locationHint, sizeof(_config.locationHint));
     _config.sleepIntervalSeconds = preferences.getInt("sleepInterval", 300);
+    _config.txPowerMinDbm = preferences.getInt("txPowerMin", 0);
+    _config.txPowerMaxDbm = preferences.getInt("txPowerMax", 0);
+    _config.alarmTempHighCenti = preferences.getInt("alarmTempHi", CONFIG_NO_THRESHOLD);
+    _config.alarmTempLowCenti = preferences.getInt("alarmTempLo", CONFIG_NO_THRESHOLD);
+    _config.alarmHumidityHighCenti = preferences.getInt("alarmHumHi", CONFIG_NO_THRESHOLD);
+    _config.alarmHumidityLowCenti = preferences.getInt("alarmHumLo", CONFIG_NO_THRESHOLD);
   }
 }
 
-void ConfigManager::saveConfig() { // saves config
-  preferences.putBool("configured", _config.configured);
-  preferences.putString("wifiSSID", _config.wifiSSID);
-  preferences.putString("wifiPassword", _config.wifiPassword);
-  preferences.putString("serverUrl", _config.serverUrl);
-  preferences.putString("deviceId", _config.deviceId);
-  preferences.putString("deviceName", _config.deviceName);
-  preferences.putString("deviceType", _config.deviceType);
-  preferences.putString("locationHint", _config.locationHint);
-  preferences.putInt("sleepInterval", _config.sleepIntervalSeconds);
+bool ConfigManager::saveConfig() { // saves config
+  // Goes through the raw NVS API so there is one open and one commit instead
+  // of one per key like Preferences does. Key names and types match what
+  // Preferences uses (bool = u8, int = i32, uint = u32) so loadConfig reads it as usual.
+  // NVS has no transactions, every key is written on its own, so "configured"
+  // goes last: a save cut short on a new node leaves it unconfigured instead
+  // of half set up. On a node that was already configured a cut short save
+  // can leave some keys old and some new.
+  nvs_handle_t handle;
+  if (nvs_open(PREFERENCES_NAMESPACE, NVS_READWRITE, &handle) != ESP_OK) {
+    Serial.println("Failed to open NVS for saving config");
+    return false;
+  }
+
+  esp_err_t err = ESP_OK;
+  if (err == ESP_OK) err = nvs_set_str(handle, "wifiSSID", _config.wifiSSID);
+  if (err == ESP_OK) err = nvs_set_str(handle, "wifiPassword", _config.wifiPassword);
+  if (err == ESP_OK) err = nvs_set_str(handle, "serverUrl", _config.serverUrl);
+  for (int i = 0; i < FALLBACK_URL_COUNT; i++) {
+    if (err == ESP_OK) err = nvs_set_str(handle, FALLBACK_URL_KEYS[i], _config.fallbackUrls[i]);
+  }
+  if (err == ESP_OK) err = nvs_set_str(handle, "deviceId", _config.deviceId);
+  if (err == ESP_OK) err = nvs_set_str(handle, "authSecret", _config.authSecret);
+  if (err == ESP_OK) err = nvs_set_u32(handle, "authLease", _config.authCounterLease);
+  if (err == ESP_OK) err = nvs_set_str(handle, "deviceName", _config.deviceName);
+  if (err == ESP_OK) err = nvs_set_str(handle, "deviceType", _config.deviceType);
+  if (err == ESP_OK) err = nvs_set_str(handle, "locationHint", _config.locationHint);
+  if (err == ESP_OK) err = nvs_set_i32(handle, "sleepInterval", _config.sleepIntervalSeconds);
+  if (err == ESP_OK) err = nvs_set_i32(handle, "txPowerMin", _config.txPowerMinDbm);
+  if (err == ESP_OK) err = nvs_set_i32(handle, "txPowerMax", _config.txPowerMaxDbm);
+  if (err == ESP_OK) err = nvs_set_i32(handle, "alarmTempHi", _config.alarmTempHighCenti);
+  if (err == ESP_OK) err = nvs_set_i32(handle, "alarmTempLo", _config.alarmTempLowCenti);
+  if (err == ESP_OK) err = nvs_set_i32(handle, "alarmHumHi", _config.alarmHumidityHighCenti);
+  if (err == ESP_OK) err = nvs_set_i32(handle, "alarmHumLo", _config.alarmHumidityLowCenti);
+  if (err == ESP_OK) err = nvs_set_u8(handle, "configured", _config.configured);
+  if (err == ESP_OK) err = nvs_commit(handle);
+  nvs_close(handle);
+
+  if (err != ESP_OK) {
+    Serial.printf("Failed to save config: %s\n", esp_err_to_name(err));
+    return false;
+  }
+  return true;
 }
 
 void ConfigManager::clearConfig() { // clearns config
   preferences.clear();
-  memset(&_config, 0, sizeof(DeviceConfig)); // Reset struct in NV memory
+  setDefaults(); // Reset struct in NV memory
 }
 
 const DeviceConfig& ConfigManager::getConfig() const {
@@ -57,6 +115,29 @@ DeviceConfig& ConfigManager::getMutableConfig() {
   return _config;
 }
 
+void ConfigManager::replaceConfig(const DeviceConfig& newConfig) {
+  bool serverChanged = strcmp(newConfig.serverUrl, _config.serverUrl) != 0;
+  _config = newConfig;
+  if (serverChanged) {
+    memset(_config.deviceId, 0, sizeof(_config.deviceId));
+    memset(_config.authSecret, 0, sizeof(_config.authSecret));
+    _config.authCounterLease = 0;
+  }
+}
+
+int ConfigManager::thresholdCenti(const char* text) {
+  if (!text) return CONFIG_NO_THRESHOLD;
+  while (isspace((unsigned char)*text)) text++;
+  char* end;
+  float value = strtof(text, &end);
+  if (end == text) return CONFIG_NO_THRESHOLD;
+  while (isspace((unsigned char)*end)) end++;
+  if (*end != '\0' || isnan(value)) return CONFIG_NO_THRESHOLD;
+  // clamp before converting, lroundf of something huge is undefined
+  value = fmaxf(-327.67f, fminf(value, 327.67f));
+  return (int)lroundf(value * 100);
+}
+
 bool ConfigManager::isConfigured() {
   // device configured if the flag is set.
   return _config.configured;
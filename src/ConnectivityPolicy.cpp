@@ -0,0 +1,84 @@
+#include "ConnectivityPolicy.h"
+#include <string.h>
+
+ConnectivityPolicy::ConnectivityPolicy(ConnectivityState& state) : _state(state) {
+}
+
+bool ConnectivityPolicy::uploadDue() const {
+  return _state.wakesToSkip == 0;
+}
+
+void ConnectivityPolicy::onUploadSkipped() {
+  if (_state.wakesToSkip > 0) _state.wakesToSkip--;
+  _state.skippedUploads++;
+}
+
+uint32_t ConnectivityPolicy::connectTimeoutMs() const {
+  if (_state.consecutiveFailures == 0) return CONNECT_TIMEOUT_MS;
+  if (_state.consecutiveFailures == 1) return RETRY_CONNECT_TIMEOUT_MS;
+  return MIN_CONNECT_TIMEOUT_MS;
+}
+
+bool ConnectivityPolicy::shouldProbe() const {
+  return _state.apKnown && _state.consecutiveFailures > 0;
+}
+
+bool ConnectivityPolicy::onProbeMiss() {
+  _state.probeMisses++;
+  // the AP may have moved to another channel, so a due full connect still happens
+  if (uploadDue()) return true;
+  _state.wakesToSkip--;
+  return false;
+}
+
+void ConnectivityPolicy::onWiFiFailure(uint32_t rawSeconds) {
+  _state.wifiFailures++;
+  onFailure(rawSeconds);
+}
+
+void ConnectivityPolicy::onWiFiConnected(const uint8_t bssid[6], uint8_t channel) {
+  if (!bssid || channel == 0) return;
+  memcpy(_state.bssid, bssid, sizeof(_state.bssid));
+  _state.channel = channel;
+  _state.apKnown = true;
+}
+
+void ConnectivityPolicy::onUploadFailure(uint32_t rawSeconds) {
+  _state.uploadFailures++;
+  onFailure(rawSeconds);
+}
+
+bool ConnectivityPolicy::pendingReport(uint32_t rawSeconds, ConnectivityReport& report) const {
+  report.wifiFailures = _state.wifiFailures;
+  report.uploadFailures = _state.uploadFailures;
+  report.skippedUploads = _state.skippedUploads;
+  report.probeMisses = _state.probeMisses;
+  bool failed = report.wifiFailures || report.uploadFailures || report.skippedUploads || report.probeMisses;
+  report.offlineSeconds = failed && rawSeconds > _state.firstFailureRawSeconds ? rawSeconds - _state.firstFailureRawSeconds : 0;
+  return failed;
+}
+
+void ConnectivityPolicy::onUploadSuccess() {
+  _state.consecutiveFailures = 0;
+  _state.wakesToSkip = 0;
+  _state.wifiFailures = 0;
+  _state.uploadFailures = 0;
+  _state.skippedUploads = 0;
+  _state.probeMisses = 0;
+  _state.firstFailureRawSeconds = 0;
+}
+
+uint32_t ConnectivityPolicy::resultDisplayMs() const {
+  // nobody reads "WiFi Failed" for the tenth time in a row
+  return _state.consecutiveFailures >= 2 ? FAILING_RESULT_DISPLAY_MS : RESULT_DISPLAY_MS;
+}
+
+void ConnectivityPolicy::onFailure(uint32_t rawSeconds) {
+  if (_state.consecutiveFailures == 0) _state.firstFailureRawSeconds = rawSeconds;
+  if (_state.consecutiveFailures < 255) _state.consecutiveFailures++;
+
+  // skip 0, 1, 3, 7, 15 wakes after 1, 2, 3, 4, 5+ failures
+  uint8_t shift = _state.consecutiveFailures - 1;
+  uint32_t skip = shift >= 4 ? MAX_WAKES_TO_SKIP : (1u << shift) - 1;
+  _state.wakesToSkip = skip > MAX_WAKES_TO_SKIP ? MAX_WAKES_TO_SKIP : skip;
+}
@@ -0,0 +1,169 @@
+#include "DeltaPatch.h"
+#include <string.h>
+
+static const uint8_t OP_END = 0x00;
+static const uint8_t OP_COPY = 0x01;
+static const uint8_t OP_DATA = 0x02;
+static const uint8_t OP_ADD = 0x03;
+
+static uint32_t readU32(const uint8_t* p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+DeltaPatcher::DeltaPatcher(DeltaPatchIO& io)
+  : _io(io), _state(ST_HEADER), _status(PATCH_IN_PROGRESS), _error(""),
+    _scratchLength(0), _scratchNeeded(HEADER_SIZE), _opcode(0), _baseOffset(0),
+    _remaining(0), _outputSize(0), _outputWritten(0) {
+}
+
+DeltaPatcher::Status DeltaPatcher::status() const {
+  return _status;
+}
+
+uint32_t DeltaPatcher::outputSize() const {
+  return _outputSize;
+}
+
+uint32_t DeltaPatcher::outputWritten() const {
+  return _outputWritten;
+}
+
+const char* DeltaPatcher::error() const {
+  return _error;
+}
+
+DeltaPatcher::Status DeltaPatcher::feed(const uint8_t* data, size_t length) {
+  while (length > 0 && _status == PATCH_IN_PROGRESS) {
+    switch (_state) {
+      case ST_HEADER:
+        if (!collect(data, length)) break;
+        if (memcmp(_scratch, "NDP1", 4) != 0) return fail("bad magic");
+        _outputSize = readU32(_scratch + 4);
+        if (!_io.checkBase(_scratch + 8)) return fail("patch is for a different base image");
+        _state = ST_OPCODE;
+        break;
+
+      case ST_OPCODE:
+        _opcode = *data++;
+        length--;
+        if (_opcode == OP_END) {
+          _state = ST_END;
+          if (_outputWritten != _outputSize) return fail("output size mismatch");
+          _status = PATCH_DONE;
+          break;
+        }
+        _scratchLength = 0;
+        if (_opcode == OP_COPY || _opcode == OP_ADD) _scratchNeeded = 8;
+        else if (_opcode == OP_DATA) _scratchNeeded = 4;
+        else return fail("unknown opcode");
+        _state = ST_ARGS;
+        break;
+
+      case ST_ARGS:
+        if (!collect(data, length)) break;
+        if (!startOp()) return _status;
+        break;
+
+      case ST_DATA: {
+        size_t n = length < _remaining ? length : _remaining;
+        if (!write(data, n)) return _status;
+        data += n;
+        length -= n;
+        _remaining -= n;
+        if (_remaining == 0) _state = ST_OPCODE;
+        break;
+      }
+
+      case ST_ADD: {
+        // add the deltas onto the old bytes a chunk at a time
+        uint8_t chunk[COPY_CHUNK];
+        size_t n = length < _remaining ? length : _remaining;
+        if (n > COPY_CHUNK) n = COPY_CHUNK;
+        if (!_io.readBase(_baseOffset, chunk, n)) return fail("base read failed");
+        for (size_t i = 0; i < n; i++) chunk[i] += data[i];
+        if (!write(chunk, n)) return _status;
+        data += n;
+        length -= n;
+        _baseOffset += n;
+        _remaining -= n;
+        if (_remaining == 0) _state = ST_OPCODE;
+        break;
+      }
+
+      case ST_END:
+        return fail("data after end of patch");
+    }
+  }
+  return _status;
+}
+
+DeltaPatcher::Status DeltaPatcher::fail(const char* why) {
+  _error = why;
+  _status = PATCH_ERROR;
+  return _status;
+}
+
+// gathers _scratchNeeded bytes into _scratch, true once they are all there
+bool DeltaPatcher::collect(const uint8_t*& data, size_t& length) {
+  size_t n = _scratchNeeded - _scratchLength;
+  if (n > length) n = length;
+  memcpy(_scratch + _scratchLength, data, n);
+  _scratchLength += n;
+  data += n;
+  length -= n;
+  if (_scratchLength < _scratchNeeded) return false;
+  _scratchLength = 0;
+  return true;
+}
+
+// arguments for the current opcode are in _scratch
+bool DeltaPatcher::startOp() {
+  if (_opcode == OP_DATA) {
+    _remaining = readU32(_scratch);
+  } else {
+    _baseOffset = readU32(_scratch);
+    _remaining = readU32(_scratch + 4);
+  }
+
+  if (_outputWritten + _remaining > _outputSize) {
+    fail("patch writes past the end of the image");
+    return false;
+  }
+
+  if (_opcode == OP_COPY) {
+    if (!copyFromBase(_baseOffset, _remaining)) return false;
+    _state = ST_OPCODE;
+    return true;
+  }
+
+  if (_remaining == 0) {
+    _state = ST_OPCODE;
+  } else {
+    _state = _opcode == OP_DATA ? ST_DATA : ST_ADD;
+  }
+  return true;
+}
+
+bool DeltaPatcher::copyFromBase(uint32_t offset, uint32_t length) {
+  uint8_t chunk[COPY_CHUNK];
+  while (length > 0) {
+    size_t n = length < COPY_CHUNK ? length : COPY_CHUNK;
+    if (!_io.readBase(offset, chunk, n)) {
+      fail("base read failed");
+      return false;
+    }
+    if (!write(chunk, n)) return false;
+    offset += n;
+    length -= n;
+  }
+  return true;
+}
+
+bool DeltaPatcher::write(const uint8_t* data, size_t length) {
+  if (!_io.writeOutput(data, length)) {
+    fail("output write failed");
+    return false;
+  }
+  _outputWritten += length;
+  return true;
+}
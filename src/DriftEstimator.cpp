@@ -0,0 +1,99 @@
+#include "DriftEstimator.h"
+#include <math.h>
+
+// how much the drift may change between two measurements (temperature etc.)
+static const double DRIFT_PROCESS_NOISE = 0.001;
+
+// anything further off than this isn't drift, something else went wrong
+static const double MAX_DRIFT = 0.10;
+
+DriftEstimator::DriftEstimator(DriftState& state)
+  : _state(state) {
+}
+
+void DriftEstimator::reset() {
+  _state.synced = false;
+  _state.anchorEpochMs = 0;
+  _state.anchorRawUs = 0;
+  _state.anchorUncertaintyMs = 0;
+  _state.learnEpochMs = 0;
+  _state.learnRawUs = 0;
+  _state.learnUncertaintyMs = 0;
+  _state.ratio = 1.0;
+  _state.ratioUncertainty = INITIAL_RATIO_UNCERTAINTY;
+  _state.drifts = 0;
+}
+
+void DriftEstimator::sync(int64_t epochMs, uint32_t uncertaintyMs, int64_t rawUs) {
+  if (_state.synced && rawUs < _state.anchorRawUs) {
+    // raw clock went backwards, it must have been reset
+    reset();
+  }
+
+  if (!_state.synced) {
+    _state.synced = true;
+    _state.anchorEpochMs = epochMs;
+    _state.anchorRawUs = rawUs;
+    _state.anchorUncertaintyMs = uncertaintyMs;
+    _state.learnEpochMs = epochMs;
+    _state.learnRawUs = rawUs;
+    _state.learnUncertaintyMs = uncertaintyMs;
+    return;
+  }
+
+  learnDrift(epochMs, uncertaintyMs, rawUs);
+
+  // only move the anchor if this sync is better than what we'd predict
+  if (uncertaintyMs <= this->uncertaintyMs(rawUs)) {
+    _state.anchorEpochMs = epochMs;
+    _state.anchorRawUs = rawUs;
+    _state.anchorUncertaintyMs = uncertaintyMs;
+  }
+}
+
+// measures the ratio against the learn reference once it is far enough back
+void DriftEstimator::learnDrift(int64_t epochMs, uint32_t uncertaintyMs, int64_t rawUs) {
+  int64_t rawElapsedUs = rawUs - _state.learnRawUs;
+  if (rawElapsedUs < MIN_LEARN_US) return;
+
+  double rawElapsedMs = rawElapsedUs / 1000.0;
+  double sample = (epochMs - _state.learnEpochMs) / rawElapsedMs;
+  double sampleUncertainty = (uncertaintyMs + _state.learnUncertaintyMs) / rawElapsedMs;
+
+  // start the next measurement from here either way
+  _state.learnEpochMs = epochMs;
+  _state.learnRawUs = rawUs;
+  _state.learnUncertaintyMs = uncertaintyMs;
+
+  if (fabs(sample - 1.0) > MAX_DRIFT) return;
+
+  double predicted = _state.ratioUncertainty * _state.ratioUncertainty + DRIFT_PROCESS_NOISE * DRIFT_PROCESS_NOISE;
+  double measured = sampleUncertainty * sampleUncertainty;
+  double gain = predicted / (predicted + measured);
+  _state.ratio += gain * (sample - _state.ratio);
+  _state.ratioUncertainty = sqrt((1.0 - gain) * predicted);
+  _state.drifts++;
+}
+
+bool DriftEstimator::isSynced() const {
+  return _state.synced;
+}
+
+int64_t DriftEstimator::epochMs(int64_t rawUs) const {
+  double elapsedMs = (rawUs - _state.anchorRawUs) / 1000.0;
+  return _state.anchorEpochMs + (int64_t)llround(elapsedMs * _state.ratio);
+}
+
+uint32_t DriftEstimator::uncertaintyMs(int64_t rawUs) const {
+  double elapsedMs = fabs((rawUs - _state.anchorRawUs) / 1000.0);
+  double uncertainty = _state.anchorUncertaintyMs + elapsedMs * _state.ratioUncertainty;
+  return uncertainty > 4e9 ? 4000000000u : (uint32_t)ceil(uncertainty);
+}
+
+double DriftEstimator::ratio() const {
+  return _state.ratio;
+}
+
+double DriftEstimator::ratioUncertainty() const {
+  return _state.ratioUncertainty;
+}
@@ -0,0 +1,149 @@
+#include "EndpointSelector.h"
+#include <string.h>
+
+// FNV-1a over the URLs, to notice a new config
+static uint32_t hashUrls(const char* const urls[], uint8_t count) {
+  uint32_t hash = 2166136261u;
+  for (uint8_t i = 0; i < count; i++) {
+    for (const char* c = urls[i]; *c; c++) hash = (hash ^ (uint8_t)*c) * 16777619u;
+    hash = (hash ^ 0xFF) * 16777619u; // separator, so "ab","c" isn't "a","bc"
+  }
+  return hash;
+}
+
+EndpointSelector::EndpointSelector(EndpointState& state) : _state(state) {
+}
+
+void EndpointSelector::setUrls(const char* const urls[], uint8_t count) {
+  _count = 0;
+  for (uint8_t i = 0; i < count && _count < MAX_ENDPOINTS; i++) {
+    if (urls[i] && urls[i][0]) _urls[_count++] = urls[i];
+  }
+
+  uint32_t hash = hashUrls(_urls, _count);
+  if (hash != _state.urlsHash || _count != _state.count) {
+    memset(&_state, 0, sizeof(_state));
+    _state.urlsHash = hash;
+    _state.count = _count;
+  }
+}
+
+uint8_t EndpointSelector::order(uint32_t rawSeconds, uint8_t order[MAX_ENDPOINTS]) const {
+  // insertion sort, it's three at most
+  for (uint8_t i = 0; i < _count; i++) {
+    uint8_t j = i;
+    while (j > 0 && goesBefore(i, order[j - 1], rawSeconds)) {
+      order[j] = order[j - 1];
+      j--;
+    }
+    order[j] = i;
+  }
+  return _count;
+}
+
+EndpointTimeouts EndpointSelector::timeouts(uint8_t index, bool lastTry) const {
+  EndpointTimeouts timeouts;
+  if (lastTry) {
+    timeouts.dnsMs = LAST_TRY_TIMEOUT_MS;
+    timeouts.connectMs = LAST_TRY_TIMEOUT_MS;
+    timeouts.firstByteMs = LAST_TRY_TIMEOUT_MS;
+    return timeouts;
+  }
+  uint32_t usual = _state.stats[index].avgMs * 3;
+  if (usual == 0 || usual > FAST_MAX_FIRST_BYTE_MS) usual = FAST_MAX_FIRST_BYTE_MS;
+  if (usual < FAST_MIN_FIRST_BYTE_MS) usual = FAST_MIN_FIRST_BYTE_MS;
+  timeouts.dnsMs = FAST_DNS_TIMEOUT_MS;
+  timeouts.connectMs = FAST_CONNECT_TIMEOUT_MS;
+  timeouts.firstByteMs = usual;
+  return timeouts;
+}
+
+void EndpointSelector::onDns(uint8_t index, uint32_t ms) {
+  _state.stats[index].dnsMs = ms > 0xFFFF ? 0xFFFF : ms;
+}
+
+void EndpointSelector::onAnswer(uint8_t index, uint32_t requestMs, uint8_t attempt) {
+  EndpointStats& stats = _state.stats[index];
+  if (requestMs == 0) requestMs = 1; // 0 means never measured
+  if (requestMs > 0xFFFF) requestMs = 0xFFFF;
+  // quarter weight for the new one, one slow request doesn't reorder anything
+  stats.avgMs = stats.avgMs == 0 ? requestMs : (stats.avgMs * 3 + requestMs) / 4;
+  stats.consecutiveFailures = 0;
+  stats.retryAtSeconds = 0;
+  if (stats.successes < 0xFFFF) stats.successes++;
+  if (attempt > 0 && _state.failovers < 0xFFFF) _state.failovers++;
+}
+
+void EndpointSelector::onFailure(uint8_t index, EndpointPhase phase, uint32_t rawSeconds) {
+  EndpointStats& stats = _state.stats[index];
+  stats.lastFailure = phase;
+  if (stats.failures < 0xFFFF) stats.failures++;
+  if (stats.consecutiveFailures < 255) stats.consecutiveFailures++;
+
+  uint32_t cooldown = COOLDOWN_SECONDS;
+  for (uint8_t i = 1; i < stats.consecutiveFailures && cooldown < MAX_COOLDOWN_SECONDS; i++) cooldown *= 2;
+  if (cooldown > MAX_COOLDOWN_SECONDS) cooldown = MAX_COOLDOWN_SECONDS;
+  stats.retryAtSeconds = rawSeconds + cooldown;
+}
+
+bool EndpointSelector::pendingReport(EndpointReport& report) const {
+  if (_count < 2) return false;
+  report.count = _count;
+  report.failovers = _state.failovers;
+  memcpy(report.stats, _state.stats, sizeof(report.stats));
+  return true;
+}
+
+void EndpointSelector::onReported(const EndpointReport& report) {
+  // whatever happened after the report was built stays for the next one
+  _state.failovers -= report.failovers < _state.failovers ? report.failovers : _state.failovers;
+  for (uint8_t i = 0; i < report.count && i < MAX_ENDPOINTS; i++) {
+    EndpointStats& stats = _state.stats[i];
+    stats.successes -= report.stats[i].successes < stats.successes ? report.stats[i].successes : stats.successes;
+    stats.failures -= report.stats[i].failures < stats.failures ? report.stats[i].failures : stats.failures;
+  }
+}
+
+const char* EndpointSelector::phaseName(uint8_t phase) {
+  switch (phase) {
+    case ENDPOINT_FAIL_DNS:      return "dns";
+    case ENDPOINT_FAIL_CONNECT:  return "connect";
+    case ENDPOINT_FAIL_RESPONSE: return "response";
+    case ENDPOINT_FAIL_SERVER:   return "server";
+    default:                     return "none";
+  }
+}
+
+bool EndpointSelector::hostOf(const char* url, char* host, size_t size) {
+  const char* start = strstr(url, "://");
+  start = start ? start + 3 : url;
+  const char* at = start;
+  // no userinfo in our URLs, but don't take user:pass for the host
+  for (const char* c = start; *c && *c != '/'; c++) {
+    if (*c == '@') at = c + 1;
+  }
+  start = at;
+  size_t length = strcspn(start, ":/?");
+  if (length == 0 || length >= size) return false;
+  memcpy(host, start, length);
+  host[length] = '\0';
+  return true;
+}
+
+bool EndpointSelector::coolingOff(uint8_t index, uint32_t rawSeconds) const {
+  const EndpointStats& stats = _state.stats[index];
+  return stats.consecutiveFailures > 0 && rawSeconds < stats.retryAtSeconds;
+}
+
+// a is configured after b, so b stays ahead on a tie
+bool EndpointSelector::goesBefore(uint8_t a, uint8_t b, uint32_t rawSeconds) const {
+  bool coolingA = coolingOff(a, rawSeconds);
+  bool coolingB = coolingOff(b, rawSeconds);
+  if (coolingA != coolingB) return coolingB;
+  // only a measured endpoint can jump one configured before it, and only by
+  // being clearly faster. One we haven't heard from keeps its place, that
+  // way a primary that was down gets its try once it cooled off.
+  uint16_t avgA = _state.stats[a].avgMs;
+  uint16_t avgB = _state.stats[b].avgMs;
+  return avgA > 0 && avgB > 0 && avgA + PREFER_EARLIER_MS < avgB;
+}
@@ -0,0 +1,106 @@
+#include "NodeAuth.h"
+#include "mbedtls/md.h"
+
+static int hexDigit(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+// the secret is kept as hex in NVS like the other strings
+static bool decodeSecret(const char* hex, uint8_t secret[NodeAuth::SECRET_SIZE]) {
+  if (!hex || strlen(hex) != NodeAuth::SECRET_SIZE * 2) return false;
+  for (size_t i = 0; i < NodeAuth::SECRET_SIZE; i++) {
+    int high = hexDigit(hex[2 * i]);
+    int low = hexDigit(hex[2 * i + 1]);
+    if (high < 0 || low < 0) return false;
+    secret[i] = (high << 4) | low;
+  }
+  return true;
+}
+
+NodeAuth::NodeAuth(ConfigManager& configManager, AuthCounter& counter)
+  : _configManager(configManager), _counter(counter) {
+}
+
+bool NodeAuth::hasSecret() const {
+  uint8_t secret[SECRET_SIZE];
+  return decodeSecret(_configManager.getConfig().authSecret, secret);
+}
+
+bool NodeAuth::setSecret(const char* hex) {
+  uint8_t secret[SECRET_SIZE];
+  if (!decodeSecret(hex, secret)) return false;
+  DeviceConfig& config = _configManager.getMutableConfig();
+  strncpy(config.authSecret, hex, sizeof(config.authSecret) - 1);
+  return true;
+}
+
+void NodeAuth::clearSecret() {
+  DeviceConfig& config = _configManager.getMutableConfig();
+  memset(config.authSecret, 0, sizeof(config.authSecret));
+}
+
+uint32_t NodeAuth::takeCounter() {
+  DeviceConfig& config = _configManager.getMutableConfig();
+  if (_counter.leaseEnd == 0) {
+    // power on: anything below the stored lease end may have gone out already
+    _counter.next = config.authCounterLease;
+    _counter.leaseEnd = config.authCounterLease;
+  }
+  if (_counter.next == 0) _counter.next = 1; // the server takes 0 as "nothing seen yet"
+
+  if (_counter.next >= _counter.leaseEnd) {
+    uint32_t leaseEnd = _counter.next + COUNTER_LEASE;
+    config.authCounterLease = leaseEnd;
+    if (!_configManager.saveConfig()) return 0;
+    _counter.leaseEnd = leaseEnd;
+    Serial.printf("Auth counter lease now ends at %u.\n", leaseEnd);
+  }
+  return _counter.next++;
+}
+
+void NodeAuth::skipPast(uint32_t counter) {
+  // takeCounter() reads NVS after power on, make sure we have state first
+  if (_counter.leaseEnd == 0) {
+    _counter.next = _configManager.getConfig().authCounterLease;
+    _counter.leaseEnd = _counter.next;
+  }
+  if (counter >= _counter.next) _counter.next = counter + 1;
+}
+
+void NodeAuth::onRejected() {
+  if (_counter.rejections < MAX_REJECTIONS) _counter.rejections++;
+}
+
+void NodeAuth::onAccepted() {
+  _counter.rejections = 0;
+}
+
+bool NodeAuth::needsRekey() const {
+  return _counter.rejections >= MAX_REJECTIONS && hasSecret();
+}
+
+bool NodeAuth::sign(const uint8_t* body, size_t length, char tag[TAG_HEX_SIZE]) {
+  uint8_t secret[SECRET_SIZE];
+  if (!decodeSecret(_configManager.getConfig().authSecret, secret)) return false;
+
+  uint8_t mac[32];
+  bool ok = hmacSha256(secret, sizeof(secret), body, length, mac);
+  memset(secret, 0, sizeof(secret));
+  if (!ok) return false;
+
+  static const char HEX_DIGITS[] = "0123456789abcdef";
+  for (size_t i = 0; i < sizeof(mac); i++) {
+    tag[2 * i] = HEX_DIGITS[mac[i] >> 4];
+    tag[2 * i + 1] = HEX_DIGITS[mac[i] & 0x0F];
+  }
+  tag[64] = '\0';
+  return true;
+}
+
+bool NodeAuth::hmacSha256(const uint8_t* key, size_t keyLength, const uint8_t* data, size_t length, uint8_t out[32]) {
+  const mbedtls_md_info_t* info = mbedtls_md_info_from_type(MBEDTLS_MD_SHA256);
+  return info && mbedtls_md_hmac(info, key, keyLength, data, length, out) == 0;
+}
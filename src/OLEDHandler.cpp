@@ -1,4 +1,7 @@
 #include <OLEDHandler.h>
+
+#if HAS_OLED
+
 #include <Wire.h>   
 
 
@@ -98,4 +101,4 @@ void OLEDHandler::clearDisplay() {
     display.display();
 }
 
-
+#endif // HAS_OLED
@@ -0,0 +1,279 @@
+#include "OtaManager.h"
+#include "DeltaPatch.h"
+#include <HTTPClient.h>
+#include <Preferences.h>
+#include <Update.h>
+#include "esp_ota_ops.h"
+#include "esp_partition.h"
+#include "mbedtls/sha256.h"
+#include "rom/miniz.h" // inflate from the ROM, costs no flash
+
+// NVS namespace for the trial state, separate from the device config
+const char* OTA_NAMESPACE = "iot-node-ota";
+
+// failed uploads (WiFi, registration or the send itself) a new image gets
+// before we roll back. Wakes that don't try to upload don't count.
+const uint8_t MAX_TRIAL_FAILURES = 5;
+
+// resets other than deep sleep wakes (crashes, watchdog, power cycles) a new
+// image gets, for one that dies before it ever gets to upload
+const uint8_t MAX_TRIAL_BOOTS = 5;
+
+const size_t DOWNLOAD_CHUNK = 1024;
+const unsigned long DOWNLOAD_TIMEOUT_MS = 10000; // no data for this long = give up
+
+// Arduino marks a freshly booted OTA image as valid by itself unless this
+// says we will do it. We do, in markHealthy().
+extern "C" bool verifyRollbackLater() {
+  return true;
+}
+
+// Feeds DeltaPatcher from the running partition and writes the result
+// through Update, hashing it on the way.
+class PartitionPatchIO : public DeltaPatchIO {
+public:
+  PartitionPatchIO(const esp_partition_t* base) : _base(base) {
+    mbedtls_sha256_init(&_sha);
+    mbedtls_sha256_starts(&_sha, 0);
+  }
+
+  ~PartitionPatchIO() {
+    mbedtls_sha256_free(&_sha);
+  }
+
+  bool checkBase(const uint8_t sha256[32]) override {
+    uint8_t running[32];
+    if (esp_partition_get_sha256(_base, running) != ESP_OK) return false;
+    return memcmp(running, sha256, sizeof(running)) == 0;
+  }
+
+  bool readBase(uint32_t offset, uint8_t* buffer, size_t length) override {
+    return esp_partition_read(_base, offset, buffer, length) == ESP_OK;
+  }
+
+  bool writeOutput(const uint8_t* data, size_t length) override {
+    mbedtls_sha256_update(&_sha, data, length);
+    return Update.write((uint8_t*)data, length) == length;
+  }
+
+  // hex sha256 of everything written
+  String digest() {
+    uint8_t hash[32];
+    mbedtls_sha256_finish(&_sha, hash);
+    char hex[65];
+    for (int i = 0; i < 32; i++) sprintf(&hex[i * 2], "%02x", hash[i]);
+    return String(hex);
+  }
+
+private:
+  const esp_partition_t* _base;
+  mbedtls_sha256_context _sha;
+};
+
+// Inflates the patch as it comes off the network and hands it to the patcher.
+static bool streamPatch(WiFiClient* stream, size_t patchSize, DeltaPatcher& patcher) {
+  // ~11 KB of inflate state plus the 32 KB window, too much for the stack
+  tinfl_decompressor* inflator = (tinfl_decompressor*)malloc(sizeof(tinfl_decompressor));
+  uint8_t* window = (uint8_t*)malloc(TINFL_LZ_DICT_SIZE);
+  uint8_t* input = (uint8_t*)malloc(DOWNLOAD_CHUNK);
+  if (!inflator || !window || !input) {
+    Serial.println("OTA: not enough memory for inflate.");
+    free(inflator);
+    free(window);
+    free(input);
+    return false;
+  }
+  tinfl_init(inflator);
+
+  bool ok = false;
+  size_t received = 0;
+  size_t inputOffset = 0;
+  size_t inputLength = 0;
+  size_t windowOffset = 0;
+  unsigned long lastData = millis();
+
+  while (true) {
+    // refill the input buffer
+    if (inputLength == 0 && received < patchSize) {
+      size_t available = stream->available();
+      if (available == 0) {
+        if (millis() - lastData > DOWNLOAD_TIMEOUT_MS) {
+          Serial.println("OTA: download stalled.");
+          break;
+        }
+        delay(1);
+        continue;
+      }
+      size_t want = min(min(available, DOWNLOAD_CHUNK), patchSize - received);
+      int got = stream->read(input, want);
+      if (got <= 0) continue;
+      inputLength = got;
+      inputOffset = 0;
+      received += inputLength;
+      lastData = millis();
+    }
+
+    size_t inBytes = inputLength;
+    size_t outBytes = TINFL_LZ_DICT_SIZE - windowOffset;
+    int flags = TINFL_FLAG_PARSE_ZLIB_HEADER | (received < patchSize ? TINFL_FLAG_HAS_MORE_INPUT : 0);
+    tinfl_status status = tinfl_decompress(inflator, input + inputOffset, &inBytes,
+                                           window, window + windowOffset, &outBytes, flags);
+    inputOffset += inBytes;
+    inputLength -= inBytes;
+
+    if (outBytes > 0 && patcher.feed(window + windowOffset, outBytes) == DeltaPatcher::PATCH_ERROR) {
+      Serial.printf("OTA: patch failed: %s\n", patcher.error());
+      break;
+    }
+    windowOffset = (windowOffset + outBytes) & (TINFL_LZ_DICT_SIZE - 1);
+
+    if (status == TINFL_STATUS_DONE) {
+      ok = patcher.status() == DeltaPatcher::PATCH_DONE;
+      if (!ok) Serial.println("OTA: patch ended early.");
+      break;
+    }
+    if (status < 0) {
+      Serial.printf("OTA: inflate failed (%d).\n", status);
+      break;
+    }
+    if (status == TINFL_STATUS_NEEDS_MORE_INPUT && received >= patchSize && inputLength == 0) {
+      Serial.println("OTA: patch is truncated.");
+      break;
+    }
+  }
+
+  free(inflator);
+  free(window);
+  free(input);
+  return ok;
+}
+
+OtaManager::OtaManager() : _onTrial(false) {
+}
+
+void OtaManager::begin() {
+  Preferences prefs;
+  prefs.begin(OTA_NAMESPACE, false);
+  _onTrial = prefs.getBool("trial", false);
+  if (!_onTrial) {
+    prefs.end();
+    return;
+  }
+
+  uint8_t failures = prefs.getUChar("trialFails", 0);
+  uint8_t boots = prefs.getUChar("trialBoots", 0);
+  if (esp_reset_reason() != ESP_RST_DEEPSLEEP) {
+    boots++;
+    prefs.putUChar("trialBoots", boots);
+  }
+  Serial.printf("OTA: firmware %s on trial, %d of %d failed uploads, %d of %d boots.\n",
+                FIRMWARE_VERSION, failures, MAX_TRIAL_FAILURES, boots, MAX_TRIAL_BOOTS);
+  if (failures < MAX_TRIAL_FAILURES && boots <= MAX_TRIAL_BOOTS) {
+    prefs.end();
+    return;
+  }
+
+  // never got a telemetry send through, go back to what we had
+  String previous = prefs.getString("previous", "");
+  prefs.putBool("trial", false);
+  prefs.end();
+  _onTrial = false;
+
+  const esp_partition_t* partition = esp_partition_find_first(ESP_PARTITION_TYPE_APP, ESP_PARTITION_SUBTYPE_ANY, previous.c_str());
+  if (partition && esp_ota_set_boot_partition(partition) == ESP_OK) {
+    Serial.printf("OTA: new firmware never sent telemetry, rolling back to %s.\n", previous.c_str());
+    Serial.flush();
+    ESP.restart();
+  }
+  Serial.println("OTA: rollback failed, keeping this firmware.");
+}
+
+void OtaManager::markHealthy() {
+  Preferences prefs;
+  prefs.begin(OTA_NAMESPACE, false);
+  if (prefs.getBool("trial", false)) {
+    prefs.putBool("trial", false);
+    esp_ota_mark_app_valid_cancel_rollback(); // for when the bootloader does rollback too
+    Serial.printf("OTA: firmware %s confirmed.\n", FIRMWARE_VERSION);
+  }
+  prefs.end();
+  _onTrial = false;
+}
+
+void OtaManager::onUploadFailed() {
+  if (!_onTrial) return;
+  Preferences prefs;
+  prefs.begin(OTA_NAMESPACE, false);
+  uint8_t failures = prefs.getUChar("trialFails", 0) + 1;
+  prefs.putUChar("trialFails", failures);
+  prefs.end();
+  // begin() rolls back on the next boot once these are used up
+  Serial.printf("OTA: upload failed on trial firmware, %d of %d.\n", failures, MAX_TRIAL_FAILURES);
+}
+
+bool OtaManager::applyUpdate(const FirmwareUpdate& update, const char* serverUrl) {
+  String url = update.url;
+  if (!url.startsWith("http")) {
+    url = String(serverUrl) + url;
+  }
+  Serial.printf("OTA: updating %s -> %s from %s\n", FIRMWARE_VERSION, update.version, url.c_str());
+  unsigned long startTime = millis();
+
+  HTTPClient http;
+  http.begin(url);
+  int httpCode = http.GET();
+  if (httpCode != HTTP_CODE_OK) {
+    Serial.printf("OTA: download failed, HTTP code: %d\n", httpCode);
+    http.end();
+    return false;
+  }
+  int patchSize = http.getSize();
+  if (patchSize <= 0) {
+    Serial.println("OTA: server has to send a Content-Length for the patch.");
+    http.end();
+    return false;
+  }
+
+  if (!Update.begin(update.size)) {
+    Serial.printf("OTA: can't start update: %s\n", Update.errorString());
+    http.end();
+    return false;
+  }
+
+  const esp_partition_t* running = esp_ota_get_running_partition();
+  PartitionPatchIO io(running);
+  DeltaPatcher patcher(io);
+  bool patched = streamPatch(http.getStreamPtr(), patchSize, patcher);
+  http.end();
+
+  if (!patched || patcher.outputWritten() != update.size) {
+    Update.abort();
+    return false;
+  }
+
+  String digest = io.digest();
+  if (!digest.equalsIgnoreCase(update.sha256)) {
+    Serial.printf("OTA: sha256 mismatch, got %s\n", digest.c_str());
+    Update.abort();
+    return false;
+  }
+
+  // checks the image and sets it as the boot partition
+  if (!Update.end()) {
+    Serial.printf("OTA: image rejected: %s\n", Update.errorString());
+    return false;
+  }
+
+  // the new image is on trial until it sends telemetry, see begin()
+  Preferences prefs;
+  prefs.begin(OTA_NAMESPACE, false);
+  prefs.putBool("trial", true);
+  prefs.putUChar("trialBoots", 0);
+  prefs.putUChar("trialFails", 0);
+  prefs.putString("previous", running->label);
+  prefs.end();
+
+  Serial.printf("OTA: patch %d bytes for a %u byte image (%.1f%%), applied in %lu ms.\n",
+                patchSize, update.size, 100.0 * patchSize / update.size, millis() - startTime);
+  return true;
+}
@@ -1,91 +1,81 @@
+#include "Features.h"
+
+#if HAS_PORTAL
+
 #include "PortalManager.h"
 #include <WiFi.h>
+#include <ArduinoJson.h>
+#include "PortalAssets.h" // generated from web/ by scripts/build_portal_assets.py
+
 
-// config  page
-const char CONFIG_PAGE[] PROGMEM = R"rawliteral(
-<!DOCTYPE html>
-<html>
-<head>
-    <meta name="viewport" content="width=device-width, initial-scale=1">
-    <title>IoT Node Setup</title>
-    <style>
-        body { font-family: -apple-system, BlinkMacSystemFont, "Segoe UI", Roboto, sans-serif; background-color: #f2f2f2; color: #333; margin: 0; padding: 20px; }
-        .container { max-width: 500px; margin: auto; background: white; padding: 20px; border-radius: 8px; box-shadow: 0 2px 4px rgba(0,0,0,0.1); }
-        h1 { color: #007aff; text-align: center; }
-        label { display: block; margin-top: 15px; font-weight: bold; }
-        input[type=text], input[type=password] { width: calc(100% - 22px); padding: 10px; margin-top: 5px; border: 1px solid #ccc; border-radius: 4px; }
-        input[type=submit] { background-color: #007aff; color: white; padding: 12px 20px; border: none; border-radius: 4px; cursor: pointer; width: 100%; font-size: 16px; margin-top: 20px; }
-        input[type=submit]:hover { background-color: #0056b3; }
-        .group { border-top: 1px solid #eee; padding-top: 10px; margin-top: 10px; }
-    </style>
-</head>
-<body>
-    <div class="container">
-        <h1>IoT Node Setup</h1>
-        <form action="/save" method="POST">
-            <div class="group">
-                <label for="ssid">WiFi Network (SSID)</label>
-                <input type="text" id="ssid" name="ssid" required>
-                <label for="pass">WiFi Password</label>
-                <input type="password" id="pass" name="pass">
-            </div>
-            <div class="group">
-                <label for="server">Server URL</label>
-                <input type="text" id="server" name="server" placeholder="http://192.168.1.100:4000/api" required>
-            </div>
-            <div class="group">
-                <label for="name">Device Name</label>
-                <input type="text" id="name" name="name" placeholder="e.g., Living Room Sensor" required>
-                <label for="type">Device Type</label>
-                <select id="type" name="type">
-                    <option value="Temp/Humidity">Temp/Humidity</option>
-                </select>
-                <label for="location">Location Hint</label>
-                <input type="text" id="location" name="location" placeholder="e.g., On the bookshelf">
-            </div>
-            <div class="group">
-                <label for="interval">Sleep Interval (seconds)</label>
-                <input type="text" id="interval" name="interval" value="300" required>
-            </div>
-            <input type="submit" value="Save Configuration">
-        </form>
-    </div>
-</body>
-</html>
-)rawliteral";
-
-//  AP Settings 
+//  AP Settings
 const char* AP_SSID = "IoT-Node-Setup";
 const byte DNS_PORT = 53;
 IPAddress apIP(192, 168, 4, 1);
 
+// pages are gzipped and never change at runtime so phones can cache them
+const char* ASSET_CACHE_CONTROL = "public, max-age=86400";
+
+// URLs phones and laptops fetch right after joining a network to see if there
+// is internet. Anything but the expected answer makes them open the portal,
+// so these get a redirect straight away instead of going through notFound.
+const char* PROBE_PATHS[] = {
+  "/generate_204",              // Android / Chrome
+  "/gen_204",                   // Android
+  "/hotspot-detect.html",       // Apple
+  "/library/test/success.html", // older Apple
+  "/ncsi.txt",                  // Windows
+  "/connecttest.txt",           // Windows 10+
+  "/redirect",                  // Windows 10+
+  "/canonical.html",            // Firefox
+  "/success.txt"                // Firefox
+};
+
 PortalManager::PortalManager(ConfigManager& configManager)
-  : _configManager(configManager), _server(80), _configSaved(false) {
+  : _configManager(configManager), _server(80), _configPending(false), _configSaved(false), _setupResult(SETUP_PENDING), _scanReady(false),
+    _scanChannelCount(0) {
 }
 
 void PortalManager::start() {
   Serial.println("Starting Portal Manager...");
+  // AP+STA so we can scan for networks while the AP is up
+  WiFi.mode(WIFI_AP_STA);
   WiFi.softAP(AP_SSID);
   WiFi.softAPConfig(apIP, apIP, IPAddress(255, 255, 255, 0));
 
+  // kick off the scan now so the list is ready by the time someone opens the page
+  _scanReady = false;
+  WiFi.scanNetworks(true);
+
   _dnsServer.start(DNS_PORT, "*", apIP);
   Serial.println("DNS server started.");
 
-  _server.on("/", HTTP_GET, [this]() { this->handleRoot(); });
-  _server.on("/save", HTTP_POST, [this]() { this->handleSave(); });
-  _server.onNotFound([this]() { this->handleNotFound(); });
+  for (const char* path : PROBE_PATHS) {
+    _server.on(path, HTTP_ANY, [this](AsyncWebServerRequest* request) { this->handleProbe(request); });
+  }
+  _server.on("/favicon.ico", HTTP_GET, [](AsyncWebServerRequest* request) { request->send(404); });
+  _server.on("/scan", HTTP_GET, [this](AsyncWebServerRequest* request) { this->handleScan(request); });
+  _server.on("/status", HTTP_GET, [this](AsyncWebServerRequest* request) { this->handleStatus(request); });
+  _server.on("/save", HTTP_POST, [this](AsyncWebServerRequest* request) { this->handleSave(request); });
+  _server.on("/", HTTP_GET, [this](AsyncWebServerRequest* request) { this->handleRoot(request); });
+  _server.onNotFound([this](AsyncWebServerRequest* request) { this->handleNotFound(request); });
   _server.begin();
   Serial.println("Web server started. AP SSID: " + String(AP_SSID));
 }
 
 void PortalManager::loop() {
+  // web requests are handled by the async server in its own task, we only
+  // need to pump DNS, pick up scan results and apply a submitted form here
   _dnsServer.processNextRequest();
-  _server.handleClient();
+  updateScanResults();
+  if (_configPending) applyPendingConfig();
 }
 
 void PortalManager::stop() {
-  _server.stop();
+  _server.end();
+  _server.reset(); // drop the handlers so start() can add them again
   _dnsServer.stop();
+  WiFi.scanDelete();
   WiFi.softAPdisconnect(true);
   Serial.println("Portal Manager stopped.");
 }
@@ -94,35 +84,217 @@ bool PortalManager::isConfigSaved() {
   return _configSaved;
 }
 
+void PortalManager::clearConfigSaved() {
+  _configSaved = false;
+  // the network may not have been where the last scan saw it
+  _scanReady = false;
+  WiFi.scanNetworks(true);
+}
+
+void PortalManager::setSetupResult(SetupResult result) {
+  _setupResult = result;
+}
+
+int32_t PortalManager::moveToChannelOf(const char* ssid) {
+  int32_t channel = 0;
+  for (int i = 0; i < _scanChannelCount; i++) {
+    if (strcmp(_scanChannels[i].ssid, ssid) == 0) channel = _scanChannels[i].channel;
+  }
+  if (channel == 0) {
+    Serial.printf("Portal: %s wasn't in the scan, the AP moves when the node joins it.\n", ssid);
+    return 0;
+  }
+  if (channel != WiFi.channel()) {
+    Serial.printf("Portal: moving the AP to channel %d for %s.\n", (int)channel, ssid);
+    WiFi.softAP(AP_SSID, nullptr, channel);
+  }
+  return channel;
+}
+
 // handlers
 
-void PortalManager::handleRoot() {
-  _server.send(200, "text/html", CONFIG_PAGE);
+void PortalManager::handleRoot(AsyncWebServerRequest* request) {
+  sendAsset(request, CONFIG_PAGE_GZ, CONFIG_PAGE_GZ_LEN, CONFIG_PAGE_TYPE, CONFIG_PAGE_ETAG);
 }
 
-void PortalManager::handleSave() {
+void PortalManager::handleSave(AsyncWebServerRequest* request) {
+  // this runs in the web server task, so the form only goes into
+  // _pendingConfig here. loop() applies and saves it on the main task.
   Serial.println("Handling save request...");
-  DeviceConfig& config = _configManager.getMutableConfig();
-
-  strncpy(config.wifiSSID, _server.arg("ssid").c_str(), sizeof(config.wifiSSID));
-  strncpy(config.wifiPassword, _server.arg("pass").c_str(), sizeof(config.wifiPassword));
-  strncpy(config.serverUrl, _server.arg("server").c_str(), sizeof(config.serverUrl));
-  strncpy(config.deviceName, _server.arg("name").c_str(), sizeof(config.deviceName));
-  strncpy(config.deviceType, _server.arg("type").c_str(), sizeof(config.deviceType));
-  strncpy(config.locationHint, _server.arg("location").c_str(), sizeof(config.locationHint));
-  config.sleepIntervalSeconds = _server.arg("interval").toInt();
+  if (_configPending || _configSaved) {
+    // the last form is still being applied or tried, the page shows how that went
+    sendAsset(request, SAVED_PAGE_GZ, SAVED_PAGE_GZ_LEN, SAVED_PAGE_TYPE, nullptr);
+    return;
+  }
+
+  DeviceConfig& config = _pendingConfig;
+  memset(&config, 0, sizeof(config));
+  strncpy(config.wifiSSID, request->arg("ssid").c_str(), sizeof(config.wifiSSID) - 1);
+  strncpy(config.wifiPassword, request->arg("pass").c_str(), sizeof(config.wifiPassword) - 1);
+  strncpy(config.serverUrl, request->arg("server").c_str(), sizeof(config.serverUrl) - 1);
+  for (int i = 0; i < FALLBACK_URL_COUNT; i++) {
+    // server2, server3, empty for none
+    strncpy(config.fallbackUrls[i], request->arg("server" + String(i + 2)).c_str(), sizeof(config.fallbackUrls[i]) - 1);
+  }
+  strncpy(config.deviceName, request->arg("name").c_str(), sizeof(config.deviceName) - 1);
+  strncpy(config.deviceType, request->arg("type").c_str(), sizeof(config.deviceType) - 1);
+  strncpy(config.locationHint, request->arg("location").c_str(), sizeof(config.locationHint) - 1);
+  config.sleepIntervalSeconds = request->arg("interval").toInt();
+  config.txPowerMinDbm = request->arg("txmin").toInt(); // empty is 0, no limit
+  config.txPowerMaxDbm = request->arg("txmax").toInt();
+  config.alarmTempHighCenti = ConfigManager::thresholdCenti(request->arg("alarmtemphi").c_str());
+  config.alarmTempLowCenti = ConfigManager::thresholdCenti(request->arg("alarmtemplo").c_str());
+  config.alarmHumidityHighCenti = ConfigManager::thresholdCenti(request->arg("alarmhumhi").c_str());
+  config.alarmHumidityLowCenti = ConfigManager::thresholdCenti(request->arg("alarmhumlo").c_str());
   config.configured = true;
+  _setupResult = SETUP_PENDING;
+  _configPending = true;
 
-  _configManager.saveConfig();
-  
-  String response = "<h1>Configuration Saved!</h1><p>The device will now restart and try to connect to your WiFi.</p>";
-  _server.send(200, "text/html", response);
+  // no ETag here, this is the answer to a POST
+  sendAsset(request, SAVED_PAGE_GZ, SAVED_PAGE_GZ_LEN, SAVED_PAGE_TYPE, nullptr);
+}
+
+// main task: the form handleSave left in _pendingConfig becomes the config
+void PortalManager::applyPendingConfig() {
+  // the form doesn't carry the identity, keep the one we have (replaceConfig
+  // drops it if the server changed)
+  const DeviceConfig& current = _configManager.getConfig();
+  memcpy(_pendingConfig.deviceId, current.deviceId, sizeof(_pendingConfig.deviceId));
+  memcpy(_pendingConfig.authSecret, current.authSecret, sizeof(_pendingConfig.authSecret));
+  _pendingConfig.authCounterLease = current.authCounterLease;
 
+  _configManager.replaceConfig(_pendingConfig);
+  _configManager.saveConfig();
+  _configPending = false;
   _configSaved = true;
   Serial.println("Configuration saved.");
 }
 
-void PortalManager::handleNotFound() {
-  _server.sendHeader("Location", String("http://") + apIP.toString(), true);
-  _server.send(302, "text/plain", "");
+void PortalManager::handleScan(AsyncWebServerRequest* request) {
+  if (!_scanReady) {
+    // page will ask again
+    request->send(202, "application/json", "[]");
+    return;
+  }
+  AsyncWebServerResponse* response = request->beginResponse(200, "application/json", _scanJson);
+  response->addHeader("Cache-Control", "no-store");
+  request->send(response);
 }
+
+void PortalManager::handleStatus(AsyncWebServerRequest* request) {
+  const char* result = "pending";
+  switch (_setupResult) {
+    case SETUP_PENDING:            result = "pending"; break;
+    case SETUP_CONNECTED:          result = "connected"; break;
+    case SETUP_WRONG_PASSWORD:     result = "wrong_password"; break;
+    case SETUP_NO_SSID:            result = "no_ssid"; break;
+    case SETUP_WIFI_FAILED:        result = "wifi_failed"; break;
+    case SETUP_SERVER_UNREACHABLE: result = "server_unreachable"; break;
+  }
+  AsyncWebServerResponse* response = request->beginResponse(200, "application/json", String("{\"result\":\"") + result + "\"}");
+  response->addHeader("Cache-Control", "no-store");
+  request->send(response);
+}
+
+void PortalManager::handleProbe(AsyncWebServerRequest* request) {
+  Serial.println("Portal: connectivity check " + request->url());
+  AsyncWebServerResponse* response = request->beginResponse(302);
+  response->addHeader("Location", String("http://") + apIP.toString() + "/");
+  response->addHeader("Cache-Control", "no-store");
+  request->send(response);
+}
+
+void PortalManager::handleNotFound(AsyncWebServerRequest* request) {
+  request->redirect(String("http://") + apIP.toString());
+}
+
+// sends one of the pre-gzipped pages straight out of flash, or a 304 if the
+// browser already has this version cached
+void PortalManager::sendAsset(AsyncWebServerRequest* request, const uint8_t* data, size_t length, const char* contentType, const char* etag) {
+  unsigned long startMicros = micros();
+
+  if (etag && request->hasHeader("If-None-Match") && request->header("If-None-Match") == etag) {
+    AsyncWebServerResponse* response = request->beginResponse(304);
+    response->addHeader("ETag", etag);
+    response->addHeader("Cache-Control", ASSET_CACHE_CONTROL);
+    request->send(response); // writes the headers to the connection right away
+    Serial.printf("Portal: %s not modified, 0 bytes, headers to TCP after %lu us\n", request->url().c_str(), micros() - startMicros);
+    return;
+  }
+
+  // the async server calls the filler whenever the TCP window has room and
+  // it copies straight from flash, so there is no copy of the page on the
+  // heap. Its first call is when the body starts going out, which is the
+  // time logged. What the phone sees on top of that is the radio, measure it
+  // from a laptop with curl (see README).
+  String url = request->url();
+  AsyncWebServerResponse* response = request->beginResponse(contentType, length,
+    [data, length, startMicros, url](uint8_t* buffer, size_t maxLen, size_t index) -> size_t {
+      if (index == 0) {
+        Serial.printf("Portal: %s, %u bytes gzipped, first byte to TCP after %lu us\n",
+                      url.c_str(), (unsigned)length, micros() - startMicros);
+      }
+      size_t chunk = min(maxLen, length - index);
+      memcpy(buffer, data + index, chunk);
+      return chunk;
+    });
+  response->addHeader("Content-Encoding", "gzip");
+  if (etag) {
+    response->addHeader("ETag", etag);
+    response->addHeader("Cache-Control", ASSET_CACHE_CONTROL);
+  }
+  request->send(response);
+}
+
+// turns finished scan results into the JSON the page asks for
+void PortalManager::updateScanResults() {
+  if (_scanReady) return;
+
+  int count = WiFi.scanComplete();
+  if (count == WIFI_SCAN_RUNNING) return;
+  if (count == WIFI_SCAN_FAILED) {
+    WiFi.scanNetworks(true); // try again
+    return;
+  }
+
+  JsonDocument doc;
+  JsonArray networks = doc.to<JsonArray>();
+  _scanChannelCount = 0;
+  for (int i = 0; i < count && networks.size() < MAX_SCAN_RESULTS; i++) {
+    String ssid = WiFi.SSID(i);
+    if (ssid.length() == 0) continue; // hidden network
+
+    // the same SSID shows up once per AP, keep the strongest one
+    bool duplicate = false;
+    int index = 0;
+    for (JsonObject network : networks) {
+      if (ssid == network["ssid"].as<const char*>()) {
+        if (WiFi.RSSI(i) > network["rssi"].as<int>()) {
+          network["rssi"] = WiFi.RSSI(i);
+          _scanChannels[index].channel = WiFi.channel(i);
+        }
+        duplicate = true;
+        break;
+      }
+      index++;
+    }
+    if (duplicate) continue;
+
+    JsonObject network = networks.add<JsonObject>();
+    network["ssid"] = ssid;
+    network["rssi"] = WiFi.RSSI(i);
+    network["open"] = WiFi.encryptionType(i) == WIFI_AUTH_OPEN;
+    ScanChannel& scanChannel = _scanChannels[_scanChannelCount++];
+    strncpy(scanChannel.ssid, ssid.c_str(), sizeof(scanChannel.ssid) - 1);
+    scanChannel.ssid[sizeof(scanChannel.ssid) - 1] = '\0';
+    scanChannel.channel = WiFi.channel(i);
+  }
+  WiFi.scanDelete();
+
+  _scanJson = "";
+  serializeJson(doc, _scanJson);
+  _scanReady = true;
+  Serial.printf("Portal: WiFi scan found %d networks.\n", networks.size());
+}
+
+#endif // HAS_PORTAL
@@ -1,32 +1,87 @@
 #include "PowerManager.h"
+#include "WakeSlot.h"
 #include "esp_sleep.h"
+#include "soc/gpio_reg.h"
+#include <WiFi.h>
+#if CONNECTED_LIGHT_SLEEP
+#include "esp_pm.h"
+#include "esp_idf_version.h"
+#if ESP_IDF_VERSION_MAJOR < 5
+typedef esp_pm_config_esp32c3_t esp_pm_config_t;
+#endif
+#endif
+
+// how far Retry-After has moved our slot, kept through deep sleep
+RTC_DATA_ATTR uint32_t wakeSlotShiftMs = 0;
+
+// deepSleepFromTimer() sleeps at least this long if the planned wake has passed
+const int64_t MIN_TIMER_SLEEP_US = 1000000;
 
 PowerManager::PowerManager(int buttonPin, int oledPowerPin, int sensorPowerPin) 
-  : _buttonPin(buttonPin), _oledPowerPin(oledPowerPin), _sensorPowerPin(sensorPowerPin) {
-  pinMode(_oledPowerPin, OUTPUT);
+  : _buttonPin(buttonPin), _oledPowerPin(oledPowerPin), _sensorPowerPin(sensorPowerPin),
+    _slotted(false), _slotHash(0), _slotClockMs(0), _retryAfterMs(0), _cpuMhz(0),
+    _plannedWakeUs(0), _plannedShiftMs(0), _awakeTimer(nullptr), _onAwakeTimer(nullptr) {
+  if (_oledPowerPin >= 0) pinMode(_oledPowerPin, OUTPUT);
   pinMode(_sensorPowerPin, OUTPUT);
 }
 
 void PowerManager::peripherals_on() {
   Serial.println("Turning peripherals ON.");
-  digitalWrite(_oledPowerPin, HIGH);
+  if (_oledPowerPin >= 0) digitalWrite(_oledPowerPin, HIGH);
   digitalWrite(_sensorPowerPin, HIGH);
 }
 
 void PowerManager::peripherals_off() {
   Serial.println("Turning peripherals OFF.");
-  digitalWrite(_oledPowerPin, LOW);
+  if (_oledPowerPin >= 0) digitalWrite(_oledPowerPin, LOW);
   digitalWrite(_sensorPowerPin, LOW);
 }
 
+void PowerManager::setWakeSlot(const char* key, uint64_t clockMs) {
+  _slotted = true;
+  _slotHash = wakeSlotHash(key);
+  _slotClockMs = clockMs;
+}
+
+void PowerManager::deferWakeSlot(uint32_t retryAfterSeconds) {
+  _retryAfterMs = retryAfterSeconds * 1000;
+}
+
+// how long enterDeepSleep() sleeps, in our slot if we have one. shiftMs
+// comes in as the slot's shift and goes out as where Retry-After moved it.
+uint64_t PowerManager::deepSleepUs(uint32_t sleepDurationSeconds, uint32_t& shiftMs, bool verbose) const {
+  if (!_slotted) return sleepDurationSeconds * 1000000ULL;
+
+  uint32_t intervalMs = sleepDurationSeconds * 1000;
+  if (_retryAfterMs > 0) {
+    // move the slot to where the server asked us to come back
+    uint32_t wantedPhase = (_slotClockMs + _retryAfterMs) % intervalMs;
+    uint32_t basePhase = wakeSlotPhaseMs(_slotHash, intervalMs, 0);
+    shiftMs = (wantedPhase + intervalMs - basePhase) % intervalMs;
+    if (verbose) Serial.printf("Server asked to retry after %u s, moving wake slot.\n", _retryAfterMs / 1000);
+  }
+
+  uint32_t phaseMs = wakeSlotPhaseMs(_slotHash, intervalMs, shiftMs);
+  uint32_t maxJitterMs = wakeSlotMaxJitterMs(intervalMs);
+  int32_t jitterMs = maxJitterMs ? (int32_t)(esp_random() % (2 * maxJitterMs + 1)) - (int32_t)maxJitterMs : 0;
+  uint32_t minSleepMs = max(intervalMs / 2, _retryAfterMs);
+  uint32_t sleepMs = slottedSleepMs(_slotClockMs, intervalMs, phaseMs, minSleepMs, jitterMs);
+  if (verbose) Serial.printf("Wake slot at %u ms of every %u ms (jitter %d ms).\n", phaseMs, intervalMs, jitterMs);
+  return sleepMs * 1000ULL;
+}
+
 void PowerManager::enterDeepSleep(uint32_t sleepDurationSeconds) {
-  Serial.printf("Enabling timer wakeup for %d seconds.\n", sleepDurationSeconds);
-  esp_sleep_enable_timer_wakeup(sleepDurationSeconds * 1000000ULL);
+  uint64_t sleepDurationUs = deepSleepUs(sleepDurationSeconds, wakeSlotShiftMs, true);
+
+  Serial.printf("Enabling timer wakeup for %llu ms.\n", (unsigned long long)(sleepDurationUs / 1000));
+  esp_sleep_enable_timer_wakeup(sleepDurationUs);
 
-  Serial.printf("Enabling wakeup from button on GPIO %d.\n", _buttonPin);
-  const uint64_t ext_wakeup_pin_mask = 1ULL << _buttonPin;
-  const esp_deepsleep_gpio_wake_up_mode_t ext_wakeup_mode = ESP_GPIO_WAKEUP_GPIO_LOW;
-  esp_deep_sleep_enable_gpio_wakeup(ext_wakeup_pin_mask, ext_wakeup_mode);
+  if (_buttonPin >= 0) {
+    Serial.printf("Enabling wakeup from button on GPIO %d.\n", _buttonPin);
+    const uint64_t ext_wakeup_pin_mask = 1ULL << _buttonPin;
+    const esp_deepsleep_gpio_wake_up_mode_t ext_wakeup_mode = ESP_GPIO_WAKEUP_GPIO_LOW;
+    esp_deep_sleep_enable_gpio_wakeup(ext_wakeup_pin_mask, ext_wakeup_mode);
+  }
 
   Serial.println("Entering deep sleep now.");
   Serial.flush(); 
@@ -34,3 +89,79 @@ void PowerManager::enterDeepSleep(uint32_t sleepDurationSeconds) {
   esp_deep_sleep_start();
 }
 
+
+bool PowerManager::enterConnectedIdle() {
+  // the radio only wakes for the beacons that matter (every DTIM, or every
+  // listen interval with MAX_MODEM), the AP keeps our frames until then
+  WiFi.setSleep(WIFI_PS_MAX_MODEM);
+#if CONNECTED_LIGHT_SLEEP
+  // and the CPU light sleeps between those, down at the crystal clock
+  _cpuMhz = getCpuFrequencyMhz();
+  esp_pm_config_t pm = {};
+  pm.max_freq_mhz = _cpuMhz;
+  pm.min_freq_mhz = getXtalFrequencyMhz();
+  pm.light_sleep_enable = true;
+  esp_err_t err = esp_pm_configure(&pm);
+  if (err == ESP_OK) return true;
+  Serial.printf("No auto light sleep (%s), modem sleep only.\n", esp_err_to_name(err));
+#endif
+  return false;
+}
+
+void PowerManager::leaveConnectedIdle() {
+#if CONNECTED_LIGHT_SLEEP
+  if (_cpuMhz > 0) {
+    esp_pm_config_t pm = {};
+    pm.max_freq_mhz = _cpuMhz;
+    pm.min_freq_mhz = _cpuMhz;
+    pm.light_sleep_enable = false;
+    esp_pm_configure(&pm);
+  }
+#endif
+  WiFi.setSleep(WIFI_PS_MIN_MODEM);
+}
+
+void PowerManager::planDeepSleep(uint32_t sleepDurationSeconds) {
+  _plannedShiftMs = wakeSlotShiftMs;
+  _plannedWakeUs = esp_timer_get_time() + deepSleepUs(sleepDurationSeconds, _plannedShiftMs, false);
+}
+
+void PowerManager::deepSleepFromTimer() {
+  // registers and ROM only, the task we cut short may hold the locks Serial,
+  // WiFi or the heap would need. Deep sleep powers the radio down anyway.
+  uint32_t offMask = BIT(_sensorPowerPin);
+  if (_oledPowerPin >= 0) offMask |= BIT(_oledPowerPin);
+  REG_WRITE(GPIO_OUT_W1TC_REG, offMask);
+
+  wakeSlotShiftMs = _plannedShiftMs;
+  int64_t sleepUs = _plannedWakeUs - esp_timer_get_time();
+  esp_sleep_enable_timer_wakeup(sleepUs > MIN_TIMER_SLEEP_US ? sleepUs : MIN_TIMER_SLEEP_US);
+  if (_buttonPin >= 0) esp_deep_sleep_enable_gpio_wakeup(1ULL << _buttonPin, ESP_GPIO_WAKEUP_GPIO_LOW);
+  esp_deep_sleep_start();
+}
+
+void PowerManager::armAwakeTimer(uint32_t ms, void (*onExpired)()) {
+  if (!_awakeTimer) {
+    esp_timer_create_args_t args = {};
+    args.callback = &PowerManager::awakeTimerFired;
+    args.arg = this;
+    args.name = "awake";
+    if (esp_timer_create(&args, &_awakeTimer) != ESP_OK) {
+      Serial.println("Couldn't create the awake timer, no budget this wake.");
+      _awakeTimer = nullptr;
+      return;
+    }
+  }
+  esp_timer_stop(_awakeTimer); // fails if it isn't running, that's fine
+  _onAwakeTimer = onExpired;
+  esp_timer_start_once(_awakeTimer, ms * 1000ULL);
+}
+
+void PowerManager::disarmAwakeTimer() {
+  if (_awakeTimer) esp_timer_stop(_awakeTimer);
+}
+
+void PowerManager::awakeTimerFired(void* arg) {
+  PowerManager* self = (PowerManager*)arg;
+  if (self->_onAwakeTimer) self->_onAwakeTimer();
+}
@@ -0,0 +1,104 @@
+#include "ProvisionFrame.h"
+#include <string.h>
+
+static const char FRAME_PREFIX[] = "@PROV ";
+static const size_t FRAME_PREFIX_LEN = sizeof(FRAME_PREFIX) - 1;
+static const size_t CRC_HEX_LEN = 8;
+
+ProvisionFrameParser::ProvisionFrameParser() {
+  reset();
+}
+
+void ProvisionFrameParser::reset() {
+  _length = 0;
+  _overflow = false;
+  _payload = nullptr;
+  _payloadLength = 0;
+  _line[0] = '\0';
+}
+
+ProvisionFrameParser::Result ProvisionFrameParser::feed(char c) {
+  if (c == '\r') return FRAME_NONE; // terminals like to send \r\n
+
+  if (c != '\n') {
+    if (_length < MAX_LINE) {
+      _line[_length++] = c;
+    } else {
+      _overflow = true;
+    }
+    return FRAME_NONE;
+  }
+
+  // end of line
+  _line[_length] = '\0';
+  Result result = FRAME_NONE;
+  if (_overflow) {
+    result = FRAME_TOO_LONG;
+  } else if (_length >= FRAME_PREFIX_LEN && memcmp(_line, FRAME_PREFIX, FRAME_PREFIX_LEN) == 0) {
+    result = parseLine();
+  }
+  _length = 0;
+  _overflow = false;
+  return result;
+}
+
+const char* ProvisionFrameParser::payload() const {
+  return _payload;
+}
+
+size_t ProvisionFrameParser::payloadLength() const {
+  return _payloadLength;
+}
+
+// checks "@PROV xxxxxxxx {...}" that is sitting in _line
+ProvisionFrameParser::Result ProvisionFrameParser::parseLine() {
+  const char* p = _line + FRAME_PREFIX_LEN;
+  if (_length < FRAME_PREFIX_LEN + CRC_HEX_LEN + 2 || p[CRC_HEX_LEN] != ' ') {
+    return FRAME_MALFORMED;
+  }
+
+  uint32_t expected = 0;
+  for (size_t i = 0; i < CRC_HEX_LEN; i++) {
+    char h = p[i];
+    uint32_t nibble;
+    if (h >= '0' && h <= '9') nibble = h - '0';
+    else if (h >= 'a' && h <= 'f') nibble = h - 'a' + 10;
+    else if (h >= 'A' && h <= 'F') nibble = h - 'A' + 10;
+    else return FRAME_MALFORMED;
+    expected = (expected << 4) | nibble;
+  }
+
+  const char* json = p + CRC_HEX_LEN + 1;
+  size_t jsonLength = _length - (json - _line);
+  if (provisionCrc32((const uint8_t*)json, jsonLength) != expected) {
+    return FRAME_BAD_CRC;
+  }
+
+  _payload = json;
+  _payloadLength = jsonLength;
+  return FRAME_OK;
+}
+
+uint32_t provisionCrc32(const uint8_t* data, size_t length) {
+  // bitwise version, frames are small and this saves a 1 KB table
+  uint32_t crc = 0xFFFFFFFF;
+  for (size_t i = 0; i < length; i++) {
+    crc ^= data[i];
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+    }
+  }
+  return ~crc;
+}
+
+const char* provisionCheckPayload(JsonDocument& doc, const char* json, size_t length) {
+  if (deserializeJson(doc, json, length) != DeserializationError::Ok) {
+    return "bad_json";
+  }
+  const char* ssid = doc["ssid"];
+  const char* server = doc["server"];
+  if (!ssid || !server || strlen(ssid) == 0 || strlen(server) == 0) {
+    return "missing_fields";
+  }
+  return nullptr;
+}
@@ -0,0 +1,18 @@
+#include "SampleBuffer.h"
+
+void SampleBuffer::clear() {
+  count = 0;
+}
+
+Sample SampleBuffer::makeSample(uint32_t rawSeconds, float temperature, float humidity) {
+  Sample sample;
+  sample.rawSeconds = rawSeconds;
+  // clamp to what fits, a failed read comes back as NaN or something silly
+  if (!(temperature > -327.0f)) temperature = -327.0f;
+  if (temperature > 327.0f) temperature = 327.0f;
+  if (!(humidity > 0.0f)) humidity = 0.0f;
+  if (humidity > 100.0f) humidity = 100.0f;
+  sample.temperatureCenti = (int16_t)(temperature * 100.0f + (temperature < 0 ? -0.5f : 0.5f));
+  sample.humidityCenti = (uint16_t)(humidity * 100.0f + 0.5f);
+  return sample;
+}
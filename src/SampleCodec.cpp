@@ -0,0 +1,183 @@
+#include "SampleCodec.h"
+
+// bits after the 10, 110 and 1110 prefixes, 1111 is followed by the raw value
+static const uint8_t TIME_BUCKET_BITS[3] = { 7, 9, 12 };
+static const uint8_t VALUE_BUCKET_BITS[3] = { 4, 7, 10 };
+
+static const uint8_t FIRST_SAMPLE_BITS = 32 + 16 + 16;
+static const uint8_t MAX_SAMPLE_BITS = (4 + 32) + 2 * (4 + 16);
+
+static uint32_t lowBits(uint64_t value, uint8_t bits) {
+  return (uint32_t)(value & ((1ull << bits) - 1));
+}
+
+// MSB first into a fixed buffer, a byte at a time through a small accumulator
+class BitWriter {
+public:
+  BitWriter(uint8_t* out, size_t capacity) : _out(out), _capacity(capacity), _length(0), _acc(0), _accBits(0), _overflow(false) {}
+
+  void write(uint32_t value, uint8_t bits) {
+    _acc = (_acc << bits) | lowBits(value, bits);
+    _accBits += bits;
+    while (_accBits >= 8) {
+      _accBits -= 8;
+      put((uint8_t)(_acc >> _accBits));
+    }
+  }
+
+  // pads the last byte with 0 bits, returns the length or 0 if it didn't fit
+  size_t finish() {
+    if (_accBits > 0) put((uint8_t)(_acc << (8 - _accBits)));
+    _accBits = 0;
+    return _overflow ? 0 : _length;
+  }
+
+private:
+  uint8_t* _out;
+  size_t _capacity;
+  size_t _length;
+  uint64_t _acc;
+  uint8_t _accBits;
+  bool _overflow;
+
+  void put(uint8_t byte) {
+    if (_length >= _capacity) {
+      _overflow = true;
+      return;
+    }
+    _out[_length++] = byte;
+  }
+};
+
+class BitReader {
+public:
+  BitReader(const uint8_t* data, size_t length) : _data(data), _length(length), _pos(0), _acc(0), _accBits(0) {}
+
+  bool read(uint8_t bits, uint32_t& value) {
+    while (_accBits < bits) {
+      if (_pos >= _length) return false;
+      _acc = (_acc << 8) | _data[_pos++];
+      _accBits += 8;
+    }
+    _accBits -= bits;
+    value = lowBits(_acc >> _accBits, bits);
+    return true;
+  }
+
+  // true if everything was read and the padding is 0 bits
+  bool atCleanEnd() const {
+    return _pos == _length && lowBits(_acc, _accBits) == 0;
+  }
+
+private:
+  const uint8_t* _data;
+  size_t _length;
+  size_t _pos;
+  uint64_t _acc;
+  uint8_t _accBits;
+};
+
+// value in the smallest bucket it fits, otherwise the escape and raw
+static void writeBucketed(BitWriter& writer, int64_t value, const uint8_t widths[3], uint32_t raw, uint8_t rawBits) {
+  if (value == 0) {
+    writer.write(0, 1);
+    return;
+  }
+  for (uint8_t i = 0; i < 3; i++) {
+    int64_t limit = 1ll << (widths[i] - 1);
+    if (value >= -limit && value < limit) {
+      writer.write(((1u << (i + 1)) - 1) << 1, i + 2); // 10, 110, 1110
+      writer.write((uint32_t)value, widths[i]);
+      return;
+    }
+  }
+  writer.write(0xF, 4);
+  writer.write(raw, rawBits);
+}
+
+// the other way round, escaped says value is the raw value and not a change
+static bool readBucketed(BitReader& reader, const uint8_t widths[3], uint8_t rawBits, int64_t& value, bool& escaped) {
+  uint8_t ones = 0;
+  uint32_t bit;
+  while (ones < 4) {
+    if (!reader.read(1, bit)) return false;
+    if (!bit) break;
+    ones++;
+  }
+  escaped = ones == 4;
+  if (ones == 0) {
+    value = 0;
+    return true;
+  }
+
+  uint8_t bits = escaped ? rawBits : widths[ones - 1];
+  uint32_t raw;
+  if (!reader.read(bits, raw)) return false;
+  value = raw;
+  if (!escaped && (raw >> (bits - 1)) & 1) value -= 1ll << bits; // sign extend
+  return true;
+}
+
+size_t sampleBlockMaxSize(size_t count) {
+  if (count == 0) return 1;
+  return 1 + (FIRST_SAMPLE_BITS + (count - 1) * MAX_SAMPLE_BITS + 7) / 8;
+}
+
+size_t encodeSamples(const Sample* samples, size_t count, uint8_t* out, size_t capacity) {
+  if (count > SAMPLE_BLOCK_MAX_SAMPLES) return 0;
+
+  BitWriter writer(out, capacity);
+  writer.write(count, 8);
+  if (count == 0) return writer.finish();
+
+  const Sample& first = samples[0];
+  writer.write(first.rawSeconds, 32);
+  writer.write((uint16_t)first.temperatureCenti, 16);
+  writer.write(first.humidityCenti, 16);
+
+  int64_t previousDelta = 0;
+  for (size_t i = 1; i < count; i++) {
+    const Sample& previous = samples[i - 1];
+    const Sample& sample = samples[i];
+
+    int64_t delta = (int64_t)sample.rawSeconds - previous.rawSeconds;
+    writeBucketed(writer, delta - previousDelta, TIME_BUCKET_BITS, sample.rawSeconds, 32);
+    previousDelta = delta;
+
+    writeBucketed(writer, (int32_t)sample.temperatureCenti - previous.temperatureCenti, VALUE_BUCKET_BITS, (uint16_t)sample.temperatureCenti, 16);
+    writeBucketed(writer, (int32_t)sample.humidityCenti - previous.humidityCenti, VALUE_BUCKET_BITS, sample.humidityCenti, 16);
+  }
+  return writer.finish();
+}
+
+int decodeSamples(const uint8_t* data, size_t length, Sample* samples, size_t capacity) {
+  BitReader reader(data, length);
+  uint32_t count;
+  if (!reader.read(8, count) || count > capacity) return -1;
+  if (count == 0) return reader.atCleanEnd() ? 0 : -1;
+
+  uint32_t rawSeconds, temperature, humidity;
+  if (!reader.read(32, rawSeconds) || !reader.read(16, temperature) || !reader.read(16, humidity)) return -1;
+  samples[0].rawSeconds = rawSeconds;
+  samples[0].temperatureCenti = (int16_t)temperature;
+  samples[0].humidityCenti = (uint16_t)humidity;
+
+  int64_t previousDelta = 0;
+  for (uint32_t i = 1; i < count; i++) {
+    const Sample& previous = samples[i - 1];
+    Sample& sample = samples[i];
+    int64_t value;
+    bool escaped;
+
+    if (!readBucketed(reader, TIME_BUCKET_BITS, 32, value, escaped)) return -1;
+    sample.rawSeconds = escaped ? (uint32_t)value : (uint32_t)(previous.rawSeconds + previousDelta + value);
+    previousDelta = (int64_t)sample.rawSeconds - previous.rawSeconds;
+
+    if (!readBucketed(reader, VALUE_BUCKET_BITS, 16, value, escaped)) return -1;
+    sample.temperatureCenti = (int16_t)(escaped ? value : previous.temperatureCenti + value);
+
+    if (!readBucketed(reader, VALUE_BUCKET_BITS, 16, value, escaped)) return -1;
+    sample.humidityCenti = (uint16_t)(escaped ? value : previous.humidityCenti + value);
+  }
+  return reader.atCleanEnd() ? (int)count : -1;
+}
@@ -0,0 +1,131 @@
+#include "SerialProvisioner.h"
+#include <ArduinoJson.h>
+#include <WiFi.h>
+
+// once a frame has started we give it this long to finish
+const unsigned long FRAME_TIMEOUT_MS = 3000;
+
+SerialProvisioner::SerialProvisioner(ConfigManager& configManager)
+  : _configManager(configManager) {
+}
+
+ProvisionResult SerialProvisioner::listen(unsigned long windowMs) {
+  const DeviceConfig& config = _configManager.getConfig();
+  Serial.printf("@HELLO iot-node %s %s\n", WiFi.macAddress().c_str(),
+                strlen(config.deviceId) > 0 ? config.deviceId : "-");
+
+  _parser.reset();
+  unsigned long startTime = millis();
+  unsigned long deadline = windowMs;
+  bool frameStarted = false;
+
+  while (millis() - startTime < deadline) {
+    if (!Serial.available()) {
+      delay(5);
+      continue;
+    }
+
+    char c = Serial.read();
+    if (!frameStarted && c == '@') {
+      // someone is talking to us, give them time to finish
+      frameStarted = true;
+      deadline = (millis() - startTime) + FRAME_TIMEOUT_MS;
+    }
+
+    switch (_parser.feed(c)) {
+      case ProvisionFrameParser::FRAME_NONE:
+        break;
+      case ProvisionFrameParser::FRAME_OK: {
+        bool wantsRegister = false;
+        if (applyFrame(_parser.payload(), _parser.payloadLength(), wantsRegister)) {
+          return wantsRegister ? PROVISION_SAVED_REGISTER : PROVISION_SAVED;
+        }
+        frameStarted = false; // host may retry within the window
+        break;
+      }
+      case ProvisionFrameParser::FRAME_BAD_CRC:
+        Serial.println("@NAK bad_crc");
+        frameStarted = false;
+        break;
+      case ProvisionFrameParser::FRAME_MALFORMED:
+        Serial.println("@NAK malformed");
+        frameStarted = false;
+        break;
+      case ProvisionFrameParser::FRAME_TOO_LONG:
+        Serial.println("@NAK too_long");
+        frameStarted = false;
+        break;
+    }
+  }
+  return PROVISION_NONE;
+}
+
+void SerialProvisioner::reportRegistration(bool success) {
+  const DeviceConfig& config = _configManager.getConfig();
+  if (success && strlen(config.deviceId) > 0) {
+    Serial.printf("@REG %s\n", config.deviceId);
+  } else {
+    Serial.println("@NAK register_failed");
+  }
+}
+
+// an alarm threshold in C or %RH, missing for none. Goes through the same
+// parsing as the portal's form fields.
+static int alarmCenti(JsonVariantConst value) {
+  char text[32] = "";
+  if (value.is<float>()) serializeJson(value, text, sizeof(text));
+  return ConfigManager::thresholdCenti(text);
+}
+
+bool SerialProvisioner::applyFrame(const char* json, size_t length, bool& wantsRegister) {
+  JsonDocument doc;
+  const char* error = provisionCheckPayload(doc, json, length);
+  if (error) {
+    Serial.printf("@NAK %s\n", error);
+    return false;
+  }
+
+  const char* ssid = doc["ssid"];
+  const char* server = doc["server"];
+
+  // build the whole config first and only then swap it in and save it once
+  DeviceConfig newConfig = _configManager.getConfig();
+  strncpy(newConfig.wifiSSID, ssid, sizeof(newConfig.wifiSSID) - 1);
+  strncpy(newConfig.wifiPassword, doc["pass"] | "", sizeof(newConfig.wifiPassword) - 1);
+  strncpy(newConfig.serverUrl, server, sizeof(newConfig.serverUrl) - 1);
+  JsonArray fallbacks = doc["fallbackServers"];
+  for (int i = 0; i < FALLBACK_URL_COUNT; i++) {
+    memset(newConfig.fallbackUrls[i], 0, sizeof(newConfig.fallbackUrls[i]));
+    strncpy(newConfig.fallbackUrls[i], fallbacks[i] | "", sizeof(newConfig.fallbackUrls[i]) - 1);
+  }
+  strncpy(newConfig.deviceType, doc["type"] | "Temp/Humidity", sizeof(newConfig.deviceType) - 1);
+  strncpy(newConfig.locationHint, doc["location"] | "", sizeof(newConfig.locationHint) - 1);
+  newConfig.sleepIntervalSeconds = doc["interval"] | 300;
+  newConfig.txPowerMinDbm = doc["txPowerMin"] | 0;
+  newConfig.txPowerMaxDbm = doc["txPowerMax"] | 0;
+  JsonObjectConst alarms = doc["alarms"];
+  newConfig.alarmTempHighCenti = alarmCenti(alarms["temperatureHigh"]);
+  newConfig.alarmTempLowCenti = alarmCenti(alarms["temperatureLow"]);
+  newConfig.alarmHumidityHighCenti = alarmCenti(alarms["humidityHigh"]);
+  newConfig.alarmHumidityLowCenti = alarmCenti(alarms["humidityLow"]);
+
+  if (doc["name"].is<const char*>()) {
+    strncpy(newConfig.deviceName, doc["name"], sizeof(newConfig.deviceName) - 1);
+  } else if (strlen(newConfig.deviceName) == 0) {
+    // default to something unique so a whole batch doesn't share one name
+    String mac = WiFi.macAddress();
+    mac.replace(":", "");
+    snprintf(newConfig.deviceName, sizeof(newConfig.deviceName), "node-%s", mac.c_str());
+  }
+  newConfig.configured = true;
+
+  _configManager.replaceConfig(newConfig);
+  if (!_configManager.saveConfig()) {
+    Serial.println("@NAK nvs_write_failed");
+    return false;
+  }
+
+  wantsRegister = doc["register"] | false;
+  Serial.println("@ACK saved");
+  return true;
+}
@@ -0,0 +1,102 @@
+#include "SleepPolicy.h"
+#include <string.h>
+
+static void addSaturated(uint16_t& count, uint16_t n) {
+  count = (uint32_t)count + n > 0xFFFF ? 0xFFFF : count + n;
+}
+
+static void addCycle(SleepModeStats& stats, uint32_t awakeMs, uint32_t radioMs, uint32_t sleepSeconds) {
+  addSaturated(stats.cycles, 1);
+  stats.awakeMs += awakeMs;
+  stats.radioMs += radioMs;
+  stats.sleepS += sleepSeconds;
+}
+
+SleepPolicy::SleepPolicy(SleepPolicyState& state, bool lightSleep) : _state(state), _lightSleep(lightSleep) {
+}
+
+SleepMode SleepPolicy::choose(uint32_t uploadIntervalSeconds) {
+  uint64_t crossover = crossoverSeconds();
+  uint64_t interval = uploadIntervalSeconds;
+  if (crossover == 0) {
+    _state.mode = SLEEP_DEEP;
+  }
+  else if (_state.mode == SLEEP_DEEP && interval * 100 < crossover * (100 - HYSTERESIS_PCT)) {
+    _state.mode = SLEEP_CONNECTED;
+  }
+  else if (_state.mode == SLEEP_CONNECTED && interval * 100 > crossover * (100 + HYSTERESIS_PCT)) {
+    _state.mode = SLEEP_DEEP;
+  }
+  return (SleepMode)_state.mode;
+}
+
+uint32_t SleepPolicy::crossoverSeconds() const {
+  uint32_t extraUa = idleUa() > SLEEP_DEEP_UA ? idleUa() - SLEEP_DEEP_UA : 1;
+  // ms * mA / uA comes out in seconds
+  return (uint64_t)_state.reconnectMs * SLEEP_ACTIVE_MA / extraUa;
+}
+
+void SleepPolicy::onNoLightSleep() {
+  _state.noLightSleep = true;
+}
+
+void SleepPolicy::onReconnect(uint32_t ms) {
+  if (ms == 0) ms = 1; // 0 means not measured
+  if (ms > 0xFFFF) ms = 0xFFFF;
+  // quarter weight, one slow scan doesn't switch modes
+  _state.reconnectMs = _state.reconnectMs == 0 ? ms : (_state.reconnectMs * 3 + ms) / 4;
+}
+
+void SleepPolicy::onReconnectAvoided() {
+  addSaturated(_state.reconnectsAvoided, 1);
+}
+
+void SleepPolicy::onConnectionReused() {
+  addSaturated(_state.connectionsReused, 1);
+}
+
+void SleepPolicy::onDeepSleep(uint32_t awakeMs, uint32_t radioMs, uint32_t sleepSeconds) {
+  addCycle(_state.modes[SLEEP_DEEP], awakeMs, radioMs, sleepSeconds);
+}
+
+void SleepPolicy::onConnectedIdle(uint32_t awakeMs, uint32_t radioMs, uint32_t idleSeconds) {
+  addCycle(_state.modes[SLEEP_CONNECTED], awakeMs, radioMs, idleSeconds);
+}
+
+bool SleepPolicy::pendingReport(SleepReport& report) const {
+  if (_state.modes[SLEEP_DEEP].cycles == 0 && _state.modes[SLEEP_CONNECTED].cycles == 0) return false;
+  report.mode = _state.mode;
+  report.reconnectMs = _state.reconnectMs;
+  report.crossoverS = crossoverSeconds();
+  report.reconnectsAvoided = _state.reconnectsAvoided;
+  report.connectionsReused = _state.connectionsReused;
+  memcpy(report.modes, _state.modes, sizeof(report.modes));
+  // mA * ms / 1000 and uA * s / 1000, both mAs
+  report.chargeMas[SLEEP_DEEP] = ((uint64_t)report.modes[SLEEP_DEEP].awakeMs * SLEEP_ACTIVE_MA +
+                                  (uint64_t)report.modes[SLEEP_DEEP].sleepS * SLEEP_DEEP_UA) / 1000;
+  report.chargeMas[SLEEP_CONNECTED] = ((uint64_t)report.modes[SLEEP_CONNECTED].awakeMs * SLEEP_ACTIVE_MA +
+                                       (uint64_t)report.modes[SLEEP_CONNECTED].sleepS * idleUa()) / 1000;
+  return true;
+}
+
+void SleepPolicy::onReported(const SleepReport& report) {
+  // whatever happened after the report was built stays for the next one
+  _state.reconnectsAvoided -= report.reconnectsAvoided < _state.reconnectsAvoided ? report.reconnectsAvoided : _state.reconnectsAvoided;
+  _state.connectionsReused -= report.connectionsReused < _state.connectionsReused ? report.connectionsReused : _state.connectionsReused;
+  for (uint8_t i = 0; i < SLEEP_MODE_COUNT; i++) {
+    SleepModeStats& stats = _state.modes[i];
+    const SleepModeStats& sent = report.modes[i];
+    stats.cycles -= sent.cycles < stats.cycles ? sent.cycles : stats.cycles;
+    stats.awakeMs -= sent.awakeMs < stats.awakeMs ? sent.awakeMs : stats.awakeMs;
+    stats.radioMs -= sent.radioMs < stats.radioMs ? sent.radioMs : stats.radioMs;
+    stats.sleepS -= sent.sleepS < stats.sleepS ? sent.sleepS : stats.sleepS;
+  }
+}
+
+const char* SleepPolicy::modeName(uint8_t mode) {
+  return mode == SLEEP_CONNECTED ? "connected" : "deep";
+}
+
+uint32_t SleepPolicy::idleUa() const {
+  return _lightSleep && !_state.noLightSleep ? SLEEP_LIGHT_IDLE_UA : SLEEP_MODEM_IDLE_UA;
+}
@@ -0,0 +1,79 @@
+#include "TimeKeeper.h"
+#include <sys/time.h>
+
+// kept in RTC memory so it survives deep sleep, starts over on power loss
+RTC_DATA_ATTR DriftState timeState = { false, 0, 0, 0, 0, 0, 0, 1.0, DriftEstimator::INITIAL_RATIO_UNCERTAINTY, 0 };
+
+TimeKeeper::TimeKeeper()
+  : _estimator(timeState) {
+}
+
+bool TimeKeeper::isSynced() const {
+  return _estimator.isSynced();
+}
+
+int64_t TimeKeeper::nowMs() const {
+  return _estimator.epochMs(rawClockUs());
+}
+
+uint32_t TimeKeeper::uncertaintyMs() const {
+  return _estimator.uncertaintyMs(rawClockUs());
+}
+
+uint64_t TimeKeeper::slotClockMs() const {
+  return isSynced() ? nowMs() : rawClockUs() / 1000;
+}
+
+double TimeKeeper::driftRatio() const {
+  return _estimator.ratio();
+}
+
+bool TimeKeeper::syncFromHttpDate(const String& date, int64_t requestRawUs, int64_t responseRawUs) {
+  int64_t seconds = parseHttpDate(date.c_str());
+  if (seconds < 0) return false;
+
+  // the server's clock was somewhere in [seconds, seconds + 1) when it
+  // answered, and that was somewhere between our send and receive
+  uint32_t halfRoundTripMs = (responseRawUs - requestRawUs) / 2000;
+  _estimator.sync(seconds * 1000 + 500, 500 + halfRoundTripMs, requestRawUs + (responseRawUs - requestRawUs) / 2);
+  return true;
+}
+
+void TimeKeeper::syncFromServerTime(int64_t epochMs, int64_t requestRawUs, int64_t responseRawUs) {
+  uint32_t halfRoundTripMs = (responseRawUs - requestRawUs) / 2000;
+  _estimator.sync(epochMs, halfRoundTripMs + 1, requestRawUs + (responseRawUs - requestRawUs) / 2);
+}
+
+int64_t TimeKeeper::rawClockUs() {
+  // we never set the system time, so this is time since power on, carried
+  // through deep sleep by the RTC slow clock (that's where the drift is)
+  struct timeval tv;
+  gettimeofday(&tv, nullptr);
+  return (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+// days since 1970-01-01 for a date in the proleptic Gregorian calendar
+static int64_t daysFromCivil(int64_t y, unsigned m, unsigned d) {
+  y -= m <= 2;
+  const int64_t era = (y >= 0 ? y : y - 399) / 400;
+  const unsigned yoe = (unsigned)(y - era * 400);
+  const unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+  const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return era * 146097 + (int64_t)doe - 719468;
+}
+
+int64_t TimeKeeper::parseHttpDate(const char* date) {
+  // "Sun, 06 Nov 1994 08:49:37 GMT", the only format servers send today
+  static const char* MONTHS = "JanFebMarAprMayJunJulAugSepOctNovDec";
+  char weekday[4], month[4], zone[4];
+  int day, year, hour, minute, second;
+  if (sscanf(date, "%3s, %d %3s %d %d:%d:%d %3s", weekday, &day, month, &year, &hour, &minute, &second, zone) != 8) {
+    return -1;
+  }
+  const char* found = strstr(MONTHS, month);
+  if (!found || strlen(month) != 3 || (found - MONTHS) % 3 != 0 || strcmp(zone, "GMT") != 0) {
+    return -1;
+  }
+  unsigned monthNumber = (found - MONTHS) / 3 + 1;
+  return daysFromCivil(year, monthNumber, day) * 86400 + hour * 3600 + minute * 60 + second;
+}
@@ -0,0 +1,101 @@
+#include "TxPowerController.h"
+
+// WIFI_POWER_19_5dBm down to WIFI_POWER_2dBm
+const int8_t TxPowerController::LEVELS_QDBM[LEVEL_COUNT] = { 78, 76, 74, 68, 60, 52, 44, 34, 28, 20, 8 };
+
+TxPowerController::TxPowerController(TxPowerState& state) : _state(state) {
+}
+
+void TxPowerController::setBounds(int8_t minDbm, int8_t maxDbm) {
+  _highestLevel = 0;
+  _lowestLevel = LEVEL_COUNT - 1;
+  if (maxDbm > 0) {
+    while (_highestLevel < LEVEL_COUNT - 1 && LEVELS_QDBM[_highestLevel] > maxDbm * 4) _highestLevel++;
+  }
+  if (minDbm > 0) {
+    while (_lowestLevel > 0 && LEVELS_QDBM[_lowestLevel] < minDbm * 4) _lowestLevel--;
+  }
+  // crossed bounds (min above max): the max wins, it's the one that keeps us legal
+  if (_lowestLevel < _highestLevel) _lowestLevel = _highestLevel;
+}
+
+int8_t TxPowerController::powerQdbm() const {
+  return LEVELS_QDBM[level()];
+}
+
+void TxPowerController::onWake(int8_t rssi, bool uploadOk, uint8_t retries) {
+  _state.level = level();
+  record(rssi, (uploadOk ? TX_SAMPLE_UPLOADED : 0) | (retries > 0 ? TX_SAMPLE_RETRIED : 0));
+
+  if (!uploadOk || retries > 0) {
+    stepUp();
+    _state.holdWakes = HOLD_WAKES_AFTER_TROUBLE;
+    return;
+  }
+  if (uplinkGuess(rssi, _state.level) < UPLINK_FLOOR_DBM) {
+    stepUp();
+    return;
+  }
+
+  if (_state.healthyWakes < 255) _state.healthyWakes++;
+  if (_state.holdWakes > 0) {
+    _state.holdWakes--;
+    return;
+  }
+  if (_state.healthyWakes < HEALTHY_WAKES_TO_STEP_DOWN || _state.level >= _lowestLevel) return;
+  if (uplinkGuess(worstRssi(rssi), _state.level + 1) < UPLINK_FLOOR_DBM + STEP_DOWN_MARGIN_DB) return;
+  _state.level++;
+  _state.healthyWakes = 0;
+}
+
+void TxPowerController::onWiFiFailure(uint8_t retries) {
+  _state.level = level();
+  record(0, TX_SAMPLE_FAILED | (retries > 0 ? TX_SAMPLE_RETRIED : 0));
+  stepUp();
+  _state.holdWakes = HOLD_WAKES_AFTER_TROUBLE;
+}
+
+TxPowerReport TxPowerController::report(int8_t rssi, uint8_t retries) const {
+  TxPowerReport report;
+  report.txQdbm = powerQdbm();
+  report.rssi = rssi;
+  report.rssiMin = worstRssi(rssi);
+  report.retries = retries;
+  return report;
+}
+
+// the state's level inside the bounds, which can change between wakes
+uint8_t TxPowerController::level() const {
+  if (_state.level < _highestLevel) return _highestLevel;
+  if (_state.level > _lowestLevel) return _lowestLevel;
+  return _state.level;
+}
+
+void TxPowerController::record(int8_t rssi, uint8_t flags) {
+  TxPowerSample& sample = _state.history[_state.historyNext];
+  sample.rssi = rssi;
+  sample.level = _state.level;
+  sample.flags = flags;
+  _state.historyNext = (_state.historyNext + 1) % TxPowerState::HISTORY;
+  if (_state.historyCount < TxPowerState::HISTORY) _state.historyCount++;
+}
+
+void TxPowerController::stepUp() {
+  if (_state.level > _highestLevel) _state.level--;
+  _state.healthyWakes = 0;
+}
+
+// the weakest the AP has been lately, wakes that never connected don't count
+int8_t TxPowerController::worstRssi(int8_t rssi) const {
+  int8_t worst = rssi;
+  for (uint8_t i = 0; i < _state.historyCount; i++) {
+    int8_t past = _state.history[i].rssi;
+    if (past != 0 && (worst == 0 || past < worst)) worst = past;
+  }
+  return worst;
+}
+
+// how loud the AP hears us at a level, assuming the path loss is the same both ways
+int TxPowerController::uplinkGuess(int8_t rssi, uint8_t level) {
+  return rssi - AP_TX_DBM + LEVELS_QDBM[level] / 4;
+}
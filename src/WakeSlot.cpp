@@ -0,0 +1,34 @@
+#include "WakeSlot.h"
+
+uint32_t wakeSlotHash(const char* key) {
+  uint32_t hash = 2166136261u;
+  for (const char* p = key; *p; p++) {
+    hash ^= (uint8_t)*p;
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+uint32_t wakeSlotPhaseMs(uint32_t hash, uint32_t intervalMs, uint32_t shiftMs) {
+  if (intervalMs == 0) return 0;
+  return (uint32_t)(((uint64_t)hash + shiftMs) % intervalMs);
+}
+
+uint32_t slottedSleepMs(uint64_t clockMs, uint32_t intervalMs, uint32_t phaseMs, uint32_t minSleepMs, int32_t jitterMs) {
+  if (intervalMs == 0) return minSleepMs;
+
+  // first time on or after clockMs + minSleepMs that sits on our phase
+  uint64_t earliest = clockMs + minSleepMs;
+  uint64_t intervalStart = earliest - (earliest % intervalMs);
+  uint64_t target = intervalStart + phaseMs;
+  if (target < earliest) target += intervalMs;
+
+  int64_t sleepMs = (int64_t)(target - clockMs) + jitterMs;
+  if (sleepMs < 1000) sleepMs = 1000; // the timer needs something to do
+  return (uint32_t)sleepMs;
+}
+
+uint32_t wakeSlotMaxJitterMs(uint32_t intervalMs) {
+  uint32_t jitter = intervalMs / 20;
+  return jitter > 2000 ? 2000 : jitter;
+}
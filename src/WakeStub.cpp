@@ -0,0 +1,297 @@
+#include <Arduino.h>
+#include "WakeStub.h"
+#include "AlarmMonitor.h"
+#include "TimeKeeper.h"
+#include "esp_sleep.h"
+
+RTC_DATA_ATTR WakePlan wakePlan = {};
+
+#if WAKE_STUB
+#include "esp_idf_version.h"
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 1, 0)
+#include "esp_wake_stub.h"
+#elif WAKE_STUB_IDF44
+#include "esp32c3/rom/rtc.h"
+#else
+#error "the wake stub on IDF before 5.1 is untested on hardware, build with -DWAKE_STUB_IDF44=1 to use it (see WakeStub.h)"
+#endif
+#include "esp_rom_sys.h"
+#include "soc/rtc.h"
+#include "soc/rtc_cntl_reg.h"
+#include "soc/gpio_reg.h"
+#include "soc/gpio_sig_map.h"
+#include "soc/io_mux_reg.h"
+
+// Everything below up to the firmware side runs before the app is loaded:
+// only RTC memory, registers and ROM functions (esp_rom_*, and libgcc's
+// 64 bit division, which is in the C3's ROM). No Serial, no Wire, no flash.
+
+// same pins as main.cpp
+#define STUB_SDA 8
+#define STUB_SCL 9
+#define STUB_SENSOR_POWER 2
+#define AHT_ADDRESS 0x38
+
+// RTC slow clock, keeps counting through deep sleep
+static inline __attribute__((always_inline)) uint64_t rtcTicks() {
+  SET_PERI_REG_MASK(RTC_CNTL_TIME_UPDATE_REG, RTC_CNTL_TIME_UPDATE);
+  return READ_PERI_REG(RTC_CNTL_TIME_LOW0_REG) | ((uint64_t)READ_PERI_REG(RTC_CNTL_TIME_HIGH0_REG) << 32);
+}
+
+// with the calibration the IDF keeps in an RTC register (us per tick, Q19)
+static inline __attribute__((always_inline)) uint64_t ticksToUs(uint64_t ticks) {
+  return (ticks * READ_PERI_REG(RTC_SLOW_CLK_CAL_REG)) >> RTC_CLK_CAL_FRACT;
+}
+
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 1, 0)
+#define stubWakeupCause esp_wake_stub_get_wakeup_cause
+#define stubSetWakeupTime esp_wake_stub_set_wakeup_time
+#define stubSleep esp_wake_stub_sleep
+#else
+// IDF 4.4 has no esp_wake_stub.h, these do what its functions do in 5.1.
+// Opt in (WAKE_STUB_IDF44), not measured on hardware yet.
+
+static inline __attribute__((always_inline)) uint32_t stubWakeupCause() {
+  return REG_GET_FIELD(RTC_CNTL_SLP_WAKEUP_CAUSE_REG, RTC_CNTL_WAKEUP_CAUSE);
+}
+
+// the sleep timer compares against the RTC slow clock, so us from now in ticks
+static inline __attribute__((always_inline)) void stubSetWakeupTime(uint64_t us) {
+  uint64_t wakeTicks = rtcTicks() + (us << RTC_CLK_CAL_FRACT) / READ_PERI_REG(RTC_SLOW_CLK_CAL_REG);
+  WRITE_PERI_REG(RTC_CNTL_SLP_TIMER0_REG, wakeTicks & UINT32_MAX);
+  WRITE_PERI_REG(RTC_CNTL_SLP_TIMER1_REG, wakeTicks >> 32);
+  SET_PERI_REG_MASK(RTC_CNTL_INT_CLR_REG, RTC_CNTL_MAIN_TIMER_INT_CLR_M);
+  SET_PERI_REG_MASK(RTC_CNTL_SLP_TIMER1_REG, RTC_CNTL_MAIN_TIMER_ALARM_EN_M);
+}
+
+// The ROM jumps to the entry the IDF puts at the start of RTC fast memory
+// (it calls esp_wake_deep_sleep()) if the CRC over the stub's code matches.
+// The IDF sets both up in esp_deep_sleep_start(), the stub sets them again
+// for its own sleep the way esp_wake_stub_sleep() does.
+static RTC_IRAM_ATTR void stubSleep(void (*stub)(void)) {
+  extern char _rtc_text_start[];
+  extern char _rtc_force_fast_end[];
+  (void)stub; // the entry calls esp_wake_deep_sleep() again, the IDF stored that
+  esp_rom_set_rtc_wake_addr((esp_rom_wake_func_t)_rtc_text_start, _rtc_force_fast_end - _rtc_text_start);
+  SET_PERI_REG_MASK(RTC_CNTL_STATE0_REG, RTC_CNTL_SLEEP_EN);
+  while (true) {
+  }
+}
+#endif
+
+// open drain by hand: low is driving 0, high is letting go for the pull-up
+static RTC_IRAM_ATTR void pinLow(uint32_t pin) {
+  REG_WRITE(GPIO_OUT_W1TC_REG, BIT(pin));
+  REG_WRITE(GPIO_ENABLE_W1TS_REG, BIT(pin));
+}
+
+static RTC_IRAM_ATTR void pinRelease(uint32_t pin) {
+  REG_WRITE(GPIO_ENABLE_W1TC_REG, BIT(pin));
+}
+
+static RTC_IRAM_ATTR bool pinRead(uint32_t pin) {
+  return (REG_READ(GPIO_IN_REG) >> pin) & 1;
+}
+
+// ~100 kHz
+static RTC_IRAM_ATTR void i2cDelay() {
+  esp_rom_delay_us(5);
+}
+
+static RTC_IRAM_ATTR void i2cStart() {
+  pinRelease(STUB_SDA);
+  pinRelease(STUB_SCL);
+  i2cDelay();
+  pinLow(STUB_SDA);
+  i2cDelay();
+  pinLow(STUB_SCL);
+}
+
+static RTC_IRAM_ATTR void i2cStop() {
+  pinLow(STUB_SDA);
+  i2cDelay();
+  pinRelease(STUB_SCL);
+  i2cDelay();
+  pinRelease(STUB_SDA);
+  i2cDelay();
+}
+
+// true if the byte was acked
+static RTC_IRAM_ATTR bool i2cWrite(uint8_t byte) {
+  for (int bit = 7; bit >= 0; bit--) {
+    if ((byte >> bit) & 1) pinRelease(STUB_SDA);
+    else pinLow(STUB_SDA);
+    i2cDelay();
+    pinRelease(STUB_SCL);
+    i2cDelay();
+    pinLow(STUB_SCL);
+  }
+  pinRelease(STUB_SDA);
+  i2cDelay();
+  pinRelease(STUB_SCL);
+  i2cDelay();
+  bool acked = !pinRead(STUB_SDA);
+  pinLow(STUB_SCL);
+  return acked;
+}
+
+static RTC_IRAM_ATTR uint8_t i2cRead(bool ack) {
+  uint8_t byte = 0;
+  pinRelease(STUB_SDA);
+  for (int bit = 0; bit < 8; bit++) {
+    i2cDelay();
+    pinRelease(STUB_SCL);
+    i2cDelay();
+    byte = (byte << 1) | pinRead(STUB_SDA);
+    pinLow(STUB_SCL);
+  }
+  if (ack) pinLow(STUB_SDA);
+  i2cDelay();
+  pinRelease(STUB_SCL);
+  i2cDelay();
+  pinLow(STUB_SCL);
+  pinRelease(STUB_SDA);
+  return byte;
+}
+
+// one 3 byte AHT command, false if nobody answered
+static RTC_IRAM_ATTR bool ahtCommand(uint8_t command, uint8_t arg0, uint8_t arg1) {
+  i2cStart();
+  bool acked = i2cWrite(AHT_ADDRESS << 1) && i2cWrite(command) && i2cWrite(arg0) && i2cWrite(arg1);
+  i2cStop();
+  return acked;
+}
+
+static RTC_IRAM_ATTR bool ahtRead(uint8_t* data, int length) {
+  i2cStart();
+  bool acked = i2cWrite((AHT_ADDRESS << 1) | 1);
+  for (int i = 0; acked && i < length; i++) data[i] = i2cRead(i < length - 1);
+  i2cStop();
+  return acked;
+}
+
+// powers the sensor, does one conversion and powers it off again. The same
+// steps Adafruit_AHTX0 takes, minus the soft reset (it just got power).
+static RTC_IRAM_ATTR bool stubReadSensor(Sample& sample) {
+  PIN_FUNC_SELECT(IO_MUX_GPIO2_REG, PIN_FUNC_GPIO);
+  PIN_FUNC_SELECT(IO_MUX_GPIO8_REG, PIN_FUNC_GPIO);
+  PIN_FUNC_SELECT(IO_MUX_GPIO9_REG, PIN_FUNC_GPIO);
+  PIN_INPUT_ENABLE(IO_MUX_GPIO8_REG);
+  PIN_INPUT_ENABLE(IO_MUX_GPIO9_REG);
+  PIN_PULLUP_EN(IO_MUX_GPIO8_REG);
+  PIN_PULLUP_EN(IO_MUX_GPIO9_REG);
+  REG_WRITE(GPIO_FUNC2_OUT_SEL_CFG_REG, SIG_GPIO_OUT_IDX);
+  REG_WRITE(GPIO_FUNC8_OUT_SEL_CFG_REG, SIG_GPIO_OUT_IDX);
+  REG_WRITE(GPIO_FUNC9_OUT_SEL_CFG_REG, SIG_GPIO_OUT_IDX);
+
+  REG_WRITE(GPIO_OUT_W1TS_REG, BIT(STUB_SENSOR_POWER));
+  REG_WRITE(GPIO_ENABLE_W1TS_REG, BIT(STUB_SENSOR_POWER));
+  esp_rom_delay_us(40000); // AHT20 power up time, the AHT10 needs 20
+
+  ahtCommand(0xE1, 0x08, 0x00); // calibrate, AHT20s don't always ack it
+  esp_rom_delay_us(10000);
+
+  uint8_t data[6] = {};
+  bool ok = ahtCommand(0xAC, 0x33, 0x00); // measure
+  if (ok) {
+    esp_rom_delay_us(80000);
+    for (int tries = 0; tries < 10; tries++) {
+      ok = ahtRead(data, sizeof(data)) && !(data[0] & 0x80); // busy bit
+      if (ok) break;
+      esp_rom_delay_us(10000);
+    }
+  }
+
+  REG_WRITE(GPIO_OUT_W1TC_REG, BIT(STUB_SENSOR_POWER));
+  pinRelease(STUB_SDA);
+  pinRelease(STUB_SCL);
+  if (!ok) return false;
+
+  // 20 bit readings, RH = raw / 2^20 * 100, T = raw / 2^20 * 200 - 50
+  uint32_t rawHumidity = ((uint32_t)data[1] << 12) | ((uint32_t)data[2] << 4) | (data[3] >> 4);
+  uint32_t rawTemperature = (((uint32_t)data[3] & 0x0F) << 16) | ((uint32_t)data[4] << 8) | data[5];
+  sample.humidityCenti = (uint16_t)(((uint64_t)rawHumidity * 10000) >> 20);
+  sample.temperatureCenti = (int16_t)((int32_t)(((uint64_t)rawTemperature * 20000) >> 20) - 5000);
+  return true;
+}
+
+// runs on every deep sleep wake, before the bootloader
+void RTC_IRAM_ATTR esp_wake_deep_sleep(void) {
+  uint64_t wakeTicks = rtcTicks();
+  wakePlan.wakeTicks = wakeTicks;
+
+  uint32_t cause = stubWakeupCause();
+  bool timerWake = (cause & RTC_TIMER_TRIG_EN) && !(cause & RTC_GPIO_TRIG_EN);
+  if (decideWake(wakePlan, timerWake, sampleBuffer, alarmState.changed != 0) == WAKE_SAMPLE_ONLY) {
+    Sample sample;
+    if (!stubReadSensor(sample)) {
+      // let the firmware try with the real driver, it samples only if that works
+      wakePlan.stubSensorFailures++;
+    }
+    else {
+      // same clock the firmware stamps its readings with, see TimeKeeper::rawClockUs()
+      sample.rawSeconds = (wakePlan.armRawUs + ticksToUs(rtcTicks() - wakePlan.armTicks)) / 1000000;
+      finishSampleOnlyWake(wakePlan, sampleBuffer, sample);
+
+      // a threshold crossed boots the firmware to send it, the reading is already in the buffer
+      int64_t wakeRawUs = wakePlan.armRawUs + ticksToUs(wakeTicks - wakePlan.armTicks);
+      if (!alarmCheck(alarmState, sample, wakeRawUs)) {
+        uint32_t awakeUs = ticksToUs(rtcTicks() - wakeTicks);
+        wakePlan.stubWakes++;
+        wakePlan.stubAwakeUs += awakeUs;
+        uint64_t intervalUs = wakePlan.intervalMs * 1000ULL;
+        stubSetWakeupTime(intervalUs > awakeUs ? intervalUs - awakeUs : intervalUs);
+        stubSleep(&esp_wake_deep_sleep); // doesn't return
+      }
+    }
+  }
+  esp_default_wake_deep_sleep();
+}
+#endif
+
+// firmware side
+
+void wakePlanArm(WakePlan& plan, uint32_t intervalMs) {
+  plan.bootWakes++;
+  plan.bootAwakeMs += wakePlanAwakeMs(plan);
+  plan.intervalMs = intervalMs;
+#if WAKE_STUB
+  plan.armTicks = rtcTicks();
+#endif
+  plan.armRawUs = TimeKeeper::rawClockUs();
+  plan.armed = true;
+}
+
+void wakePlanUploaded(WakePlan& plan) {
+  plan.wakesUntilUpload = SAMPLES_PER_UPLOAD - 1;
+  plan.stubWakes = 0;
+  plan.stubSensorFailures = 0;
+  plan.stubAwakeUs = 0;
+  plan.bootWakes = 0;
+  plan.bootAwakeMs = 0;
+}
+
+void wakePlanUploadFailed(WakePlan& plan) {
+  plan.wakesUntilUpload = 0;
+}
+
+uint32_t wakePlanAwakeMs(const WakePlan& plan) {
+#if WAKE_STUB
+  // the stub stamped when this wake started, so this includes the bootloader
+  if (esp_sleep_get_wakeup_cause() != ESP_SLEEP_WAKEUP_UNDEFINED) {
+    return ticksToUs(rtcTicks() - plan.wakeTicks) / 1000;
+  }
+#endif
+  // power on or reset: the stub didn't run, this misses the ROM and bootloader
+  return millis();
+}
+
+bool wakePlanReport(const WakePlan& plan, WakeReport& report) {
+  if (plan.stubWakes == 0 && plan.bootWakes == 0) return false;
+  report.stubWakes = plan.stubWakes;
+  report.stubAvgUs = plan.stubWakes ? plan.stubAwakeUs / plan.stubWakes : 0;
+  report.bootWakes = plan.bootWakes;
+  report.bootAvgMs = plan.bootWakes ? plan.bootAwakeMs / plan.bootWakes : 0;
+  report.stubSensorFailures = plan.stubSensorFailures;
+  return true;
+}
@@ -1,12 +1,28 @@
 #include <Arduino.h>
+#include "Features.h"
 #include "ConfigManager.h"
+#if HAS_PORTAL
 #include "PortalManager.h"
+#endif
 #include "ButtonHandler.h"
 #include "OLEDHandler.h"
 #include "ApiHandler.h"
 #include "PowerManager.h"
 #include "SensorHandler.h"
+#include "SerialProvisioner.h"
+#include "OtaManager.h"
+#include "TimeKeeper.h"
+#include "ConnectivityPolicy.h"
+#include "SampleBuffer.h"
+#include "WakeStub.h"
+#include "TxPowerController.h"
+#include "NodeAuth.h"
+#include "EndpointSelector.h"
+#include "SleepPolicy.h"
+#include "AwakeBudget.h"
+#include "AlarmMonitor.h"
 #include "esp_sleep.h"
+#include "esp_rom_sys.h"
 #include <WiFi.h>
 
 //Pins
@@ -16,14 +32,52 @@
 #define OLED_POWER_PIN 3
 #define SENSOR_POWER_PIN 2
 
+// how long a cold boot listens for a provisioning frame on USB serial
+#define PROVISION_WINDOW_MS 2000
+
+// without the portal an unconfigured node listens this long, then sleeps and tries again
+#define HEADLESS_PROVISION_MS 120000
+
+// the saved page gets this long to load before the setup AP may change channel
+#define SAVED_PAGE_GRACE_MS 1500
+
+// how long the AP probe listens on its channel
+#define PROBE_MS_PER_CHANNEL 100
+
+// a connected idle wakes this often to look at the button
+#define CONNECTED_POLL_MS 250
+
 // Global Objects
 ConfigManager configManager;
 ButtonHandler buttonHandler(BUTTON_PIN);
 OLEDHandler oled(I2C_SDA, I2C_SCL);
-ApiHandler apiHandler(configManager);
-PowerManager powerManager(BUTTON_PIN, OLED_POWER_PIN, SENSOR_POWER_PIN);
+TimeKeeper timeKeeper;
+RTC_DATA_ATTR AuthCounter authCounter = {}; // kept through deep sleep, see NodeAuth
+NodeAuth nodeAuth(configManager, authCounter);
+RTC_DATA_ATTR EndpointState endpointState = {}; // how each server URL has been doing
+EndpointSelector endpoints(endpointState);
+ApiHandler apiHandler(configManager, timeKeeper, nodeAuth, endpoints);
+PowerManager powerManager(HAS_BUTTON ? BUTTON_PIN : -1, HAS_OLED ? OLED_POWER_PIN : -1, SENSOR_POWER_PIN);
+#if HAS_PORTAL
 PortalManager portalManager(configManager);
+#endif
 SensorHandler sensorHandler;
+SerialProvisioner serialProvisioner(configManager);
+OtaManager otaManager;
+
+// kept through deep sleep: how the last wakes went, and readings not uploaded yet
+RTC_DATA_ATTR ConnectivityState connectivityState = {};
+RTC_DATA_ATTR SampleBuffer sampleBuffer = {};
+RTC_DATA_ATTR TxPowerState txPowerState = {};
+RTC_DATA_ATTR SleepPolicyState sleepPolicyState = {};
+RTC_DATA_ATTR AwakeBudgetState awakeBudgetState = {};
+RTC_DATA_ATTR AlarmState alarmState = {}; // the wake stub checks its readings against it too
+RTC_DATA_ATTR WakePlan budgetWakePlan = {}; // wakePlan as onAwakeBudgetExpired() leaves it, see planBudgetSleep()
+ConnectivityPolicy connectivity(connectivityState);
+TxPowerController txPower(txPowerState);
+SleepPolicy sleepPolicy(sleepPolicyState, CONNECTED_LIGHT_SLEEP);
+AwakeBudget awakeBudget(awakeBudgetState);
+AlarmMonitor alarmMonitor(alarmState);
 
 //State Machine
 enum DeviceState {
@@ -31,23 +85,71 @@ enum DeviceState {
   STATE_INFO_DISPLAY,
   STATE_SETUP_START,
   STATE_SETUP_RUNNING,
+  STATE_SETUP_VERIFY,
   STATE_SETUP_COMPLETE,
   STATE_CONNECTING_WIFI,
   STATE_TELEMETRY_SEND,
+  STATE_FIRMWARE_UPDATE,
   STATE_TASK_COMPLETE,
-  STATE_DEEP_SLEEP
+  STATE_DEEP_SLEEP,
+  STATE_CONNECTED_SLEEP
 };
 DeviceState currentState = STATE_BOOT;
 unsigned long stateTimer = 0;
 
+#if HAS_PORTAL
+// result of trying the config that was just saved in the portal
+SetupResult setupResult = SETUP_PENDING;
+bool setupWiFiBegun = false;
+#endif
+
+// last reason the station got disconnected, set from the WiFi event task.
+// The count is the driver's retries, setup and the TX power control use it
+volatile uint8_t lastDisconnectReason = 0;
+volatile uint8_t disconnectCount = 0;
+
+// for SleepPolicy: when the radio came on this cycle (0 = it didn't), and
+// once we stayed connected instead of deep sleeping, when this cycle started
+unsigned long wifiStartMs = 0;
+bool connectedThisBoot = false;
+unsigned long cycleStartMs = 0;
+unsigned long connectedIdleMs = 0;
+
 // prototypes
 void checkWakeupReason();
 bool connectToWiFi();
+bool provisionOverSerial(unsigned long windowMs);
+uint32_t rawSeconds();
+bool bufferReading();
+void readSensor(float& temp, float& humidity);
+bool checkAlarms(const Sample& sample);
+int16_t alarmLimit(int configCenti);
+void applyAlarmThresholds();
+int64_t wakeStartRawUs();
+void startAwakeBudget(BudgetWakeReason reason);
+void budgetStep(BudgetStep step);
+void budgetStepDone();
+void onAwakeBudgetExpired();
+void planBudgetSleep();
+void planWakeSlot();
+void sleepUntilNextWake(int sleepInterval);
+int sleepIntervalSeconds();
+uint32_t cycleAwakeMs();
+void powerUpPeripherals();
+void onWiFiDisconnected(WiFiEvent_t event, WiFiEventInfo_t info);
+#if HAS_PORTAL
+SetupResult classifyWiFiFailure(uint8_t reason);
+#endif
 
 //setup
 void setup() {
   Serial.begin(115200);
   delay(100);
+
+  // from here on nothing can keep us awake for good, see AwakeBudget.h
+  esp_sleep_wakeup_cause_t cause = esp_sleep_get_wakeup_cause();
+  startAwakeBudget(cause == ESP_SLEEP_WAKEUP_TIMER ? BUDGET_WAKE_TIMER :
+                   cause == ESP_SLEEP_WAKEUP_GPIO ? BUDGET_WAKE_BUTTON : BUDGET_WAKE_BOOT);
   
   powerManager.peripherals_on();
   delay(100); 
@@ -57,11 +159,19 @@ void setup() {
   oled.initializeOLED();
   oled.displayText("Booting...");
   configManager.begin();
+  otaManager.begin(); // may roll back to the previous firmware and reboot
   buttonHandler.begin();
+  budgetStep(BUDGET_STEP_SENSOR);
   sensorHandler.begin();
+  budgetStepDone();
   configManager.loadConfig();
+  applyAlarmThresholds();
+
+  WiFi.onEvent(onWiFiDisconnected, ARDUINO_EVENT_WIFI_STA_DISCONNECTED);
 
   checkWakeupReason();
+  // for comparing builds (e.g. headless vs not), see README
+  Serial.printf("setup() done after %lu ms, %u bytes heap free\n", millis(), ESP.getFreeHeap());
 }
 
 
@@ -81,8 +191,14 @@ void loop() {
 
   // does differnt things based on what state it is in every loop
   switch (currentState) {
-    case STATE_BOOT: // initial state after power on or reset
+    case STATE_BOOT: { // initial state after power on or reset
       Serial.println("State: BOOT");
+      // short window for bulk provisioning over USB, see tools/provision.py
+      if (provisionOverSerial(PROVISION_WINDOW_MS)) {
+        currentState = STATE_TELEMETRY_SEND; // already online
+        break;
+      }
+
       if (configManager.isConfigured()) {
         currentState = STATE_CONNECTING_WIFI;
       }
@@ -90,13 +206,14 @@ void loop() {
         currentState = STATE_SETUP_START; // start setup if not configured
       }
       break;
+    }
 
     case STATE_INFO_DISPLAY: // shows device info and sensor readings
       if (stateTimer == 0) {
         Serial.println("State: INFO_DISPLAY");
         const DeviceConfig& config = configManager.getConfig();
-        float temp = sensorHandler.readTemperature();
-        float humidity = sensorHandler.readHumidity();
+        float temp, humidity;
+        readSensor(temp, humidity);
         oled.displayInfo(config.deviceName, config.deviceId, config.serverUrl, temp, humidity);
         stateTimer = millis();
       }
@@ -129,9 +246,11 @@ void loop() {
       }
       break;
 
+#if HAS_PORTAL
     case STATE_SETUP_START: // starts the setup portal
       Serial.println("State: SETUP_START");
       oled.displayText("Setup Mode");
+      budgetStep(BUDGET_STEP_PORTAL); // a phone left on the portal doesn't keep us up
       portalManager.start();
       currentState = STATE_SETUP_RUNNING;
       break;
@@ -139,80 +258,305 @@ void loop() {
     case STATE_SETUP_RUNNING: // runs the setup portal and waits for the config to be saved (user input)
       portalManager.loop();
       if (portalManager.isConfigSaved()) {
+        applyAlarmThresholds();
+        stateTimer = 0;
+        currentState = STATE_SETUP_VERIFY;
+      }
+      break;
+
+    case STATE_SETUP_VERIFY: // tries the new config right away, with the portal still up
+      if (stateTimer == 0) {
+        Serial.println("State: SETUP_VERIFY");
+        oled.displayText("Checking WiFi...");
+        setupWiFiBegun = false;
+        stateTimer = millis();
+      }
+      portalManager.loop();
+
+      if (!setupWiFiBegun) {
+        if (millis() - stateTimer < SAVED_PAGE_GRACE_MS) break;
+        const DeviceConfig& config = configManager.getConfig();
+        lastDisconnectReason = 0;
+        disconnectCount = 0;
+        // AP+STA has one radio, so the AP has to be on the network's channel.
+        // It moves there now, while the page is ready for it, and the station
+        // is pinned to it so joining doesn't move the AP again mid-poll.
+        int32_t channel = portalManager.moveToChannelOf(config.wifiSSID);
+        WiFi.begin(config.wifiSSID, config.wifiPassword, channel);
+        setupWiFiBegun = true;
+        stateTimer = millis();
+        break;
+      }
+
+      if (WiFi.status() == WL_CONNECTED) {
+        Serial.println("WiFi Connected! Checking server...");
+        oled.displayText("Checking server...");
+        budgetStep(BUDGET_STEP_REQUEST);
+        setupResult = apiHandler.checkServerReachable() ? SETUP_CONNECTED : SETUP_SERVER_UNREACHABLE;
+        budgetStepDone();
+        stateTimer = 0;
+        currentState = STATE_SETUP_COMPLETE;
+      }
+      // the driver keeps retrying on its own, so the same failure twice is a clear answer
+      else if (disconnectCount >= 2 && classifyWiFiFailure(lastDisconnectReason) != SETUP_WIFI_FAILED) {
+        setupResult = classifyWiFiFailure(lastDisconnectReason);
+        stateTimer = 0;
+        currentState = STATE_SETUP_COMPLETE;
+      }
+      else if (millis() - stateTimer > 15000) {
+        setupResult = classifyWiFiFailure(lastDisconnectReason);
         stateTimer = 0;
         currentState = STATE_SETUP_COMPLETE;
       }
       break;
 
-    case STATE_SETUP_COMPLETE: // finalizes setup and restarts the device
-       if (stateTimer == 0) {
-        Serial.println("State: SETUP_COMPLETE");
-        portalManager.stop();
-        oled.displayText("Restarting...");
+    case STATE_SETUP_COMPLETE: // shows the result on the portal page, then goes online or back to the form
+      if (stateTimer == 0) {
+        Serial.printf("State: SETUP_COMPLETE (result %d)\n", setupResult);
+        portalManager.setSetupResult(setupResult);
+        if (setupResult == SETUP_CONNECTED) oled.displayText("Connected!");
+        else if (setupResult == SETUP_WRONG_PASSWORD) oled.displayText("Wrong Password");
+        else if (setupResult == SETUP_NO_SSID) oled.displayText("WiFi Not Found");
+        else if (setupResult == SETUP_SERVER_UNREACHABLE) oled.displayText("Server Unreachable");
+        else oled.displayText("WiFi Failed");
         stateTimer = millis();
       }
+      portalManager.loop();
+
+      // give the page a few seconds to pick up the result before the AP goes away
       if (millis() - stateTimer > 5000) {
-        ESP.restart();
+        stateTimer = 0;
+        if (setupResult == SETUP_CONNECTED) {
+          // already connected, no need to reboot and connect again
+          portalManager.stop();
+          budgetStepDone();
+          currentState = STATE_TELEMETRY_SEND;
+        }
+        else {
+          // leave the portal up so the user can fix the settings
+          WiFi.disconnect();
+          portalManager.clearConfigSaved();
+          oled.displayText("Setup Mode");
+          currentState = STATE_SETUP_RUNNING;
+        }
+      }
+      break;
+#else
+    case STATE_SETUP_START: // no portal, wait for tools/provision.py on USB serial
+      if (stateTimer == 0) {
+        Serial.println("State: SETUP_START (USB provisioning)");
+        budgetStep(BUDGET_STEP_PORTAL);
+        stateTimer = millis();
+      }
+      if (provisionOverSerial(PROVISION_WINDOW_MS)) {
+        budgetStepDone();
+        stateTimer = 0;
+        currentState = STATE_TELEMETRY_SEND;
+      }
+      else if (configManager.isConfigured()) {
+        budgetStepDone();
+        stateTimer = 0;
+        currentState = STATE_CONNECTING_WIFI;
+      }
+      else if (millis() - stateTimer > HEADLESS_PROVISION_MS) {
+        // nobody came, don't sit here draining the battery
+        Serial.println("Not provisioned, sleeping.");
+        budgetStepDone();
+        stateTimer = 0;
+        currentState = STATE_DEEP_SLEEP;
       }
       break;
 
+    case STATE_SETUP_RUNNING:
+    case STATE_SETUP_VERIFY:
+    case STATE_SETUP_COMPLETE:
+      break; // portal only
+#endif
+
     case STATE_CONNECTING_WIFI: // connects to wifi
       Serial.println("State: CONNECTING_WIFI");
-      if (connectToWiFi()) {
+      if (decideWake(wakePlan, true, sampleBuffer, alarmMonitor.due()) == WAKE_SAMPLE_ONLY) {
+        // not an upload wake. Normally the wake stub does this without booting,
+        // we get here without one or when it couldn't read the sensor.
+        Serial.printf("Sampling only, %d more wakes until the next upload.\n", wakePlan.wakesUntilUpload - 1);
+        float temp, humidity;
+        readSensor(temp, humidity);
+        Sample sample = SampleBuffer::makeSample(rawSeconds(), temp, humidity);
+        finishSampleOnlyWake(wakePlan, sampleBuffer, sample);
+        // an alarm goes out now, decideWake() says so the next time round
+        currentState = checkAlarms(sample) ? STATE_CONNECTING_WIFI : STATE_DEEP_SLEEP;
+      }
+      else if (!alarmMonitor.due() && !connectivity.uploadDue() && !connectivity.shouldProbe()) {
+        // backing off after failures, just keep the reading for later
+        Serial.println("Uploads backed off, sampling only.");
+        if (bufferReading()) break; // unless it set off an alarm, that doesn't wait
+        connectivity.onUploadSkipped();
+        oled.displayText("Saved, offline");
+        stateTimer = millis();
+        currentState = STATE_TASK_COMPLETE;
+      }
+      else if (connectToWiFi()) {
         currentState = STATE_TELEMETRY_SEND;
       }
       else {
+        otaManager.onUploadFailed();
+        bufferReading();
         oled.displayText("WiFi Failed");
         stateTimer = millis();
         currentState = STATE_TASK_COMPLETE;
       }
       break;
 
-    case STATE_TELEMETRY_SEND: // sends telemetry to server
+    case STATE_TELEMETRY_SEND: { // sends telemetry to server
       Serial.println("State: TELEMETRY_SEND");
       oled.displayText("Registering...");
-      if (apiHandler.registerDeviceIfNeeded()) { // tries to register if needed
+      budgetStep(BUDGET_STEP_REQUEST);
+      bool registered = apiHandler.registerDeviceIfNeeded(); // tries to register if needed
+      budgetStepDone();
+      if (registered) {
         oled.displayText("Sending...");
-        float temp = sensorHandler.readTemperature();
-        float humidity = sensorHandler.readHumidity();
+        float temp, humidity;
+        readSensor(temp, humidity);
         Serial.printf("Readings: Temp=%.2f C, Humidity=%.2f %%\n", temp, humidity);
+        checkAlarms(SampleBuffer::makeSample(rawSeconds(), temp, humidity));
 
-        if (apiHandler.sendTelemetry(temp, humidity, 95.0)) { // havent figures out battery reading so this is a placeholder
+        // readings from offline wakes and what went wrong go along
+        TelemetryExtras extras;
+        extras.backlog = &sampleBuffer;
+        ConnectivityReport report;
+        if (connectivity.pendingReport(rawSeconds(), report)) extras.connectivity = &report;
+        WakeReport wakeReport;
+        if (wakePlanReport(wakePlan, wakeReport)) extras.wakes = &wakeReport;
+        int8_t rssi = WiFi.RSSI();
+        TxPowerReport radio = txPower.report(rssi, disconnectCount);
+        extras.radio = &radio;
+        SleepReport sleepReport;
+        if (sleepPolicy.pendingReport(sleepReport)) extras.sleep = &sleepReport;
+        AwakeBudgetReport budgetReport;
+        if (awakeBudget.pendingReport(budgetReport)) extras.budget = &budgetReport;
+        AlarmReport alarmReport;
+        if (alarmMonitor.pendingReport(TimeKeeper::rawClockUs(), alarmReport)) extras.alarm = &alarmReport;
+
+        budgetStep(BUDGET_STEP_REQUEST);
+        bool sent = apiHandler.sendTelemetry(temp, humidity, 95.0, extras); // havent figures out battery reading so this is a placeholder
+        budgetStepDone();
+        if (sent) {
           oled.displayText("Sent!");
+          otaManager.markHealthy();
+          connectivity.onUploadSuccess();
+          txPower.onWake(rssi, true, disconnectCount);
+          sampleBuffer.clear();
+          wakePlanUploaded(wakePlan);
+          if (extras.sleep) sleepPolicy.onReported(sleepReport);
+          if (extras.budget) awakeBudget.onReported(budgetReport);
+          if (extras.alarm) {
+            alarmMonitor.onUploaded(alarmReport, TimeKeeper::rawClockUs());
+            if (alarmReport.changed) Serial.printf("Alarm delivered %lu ms after the wake that saw it.\n", (unsigned long)alarmState.lastLatencyMs);
+          }
+          if (apiHandler.connectionReused()) sleepPolicy.onConnectionReused();
+          if (apiHandler.firmwareUpdateAvailable()) {
+            currentState = STATE_FIRMWARE_UPDATE;
+            break;
+          }
         }
         else {
           oled.displayText("Send Failed");
+          otaManager.onUploadFailed();
+          connectivity.onUploadFailure(rawSeconds());
+          txPower.onWake(rssi, false, disconnectCount);
+          wakePlanUploadFailed(wakePlan);
+          sampleBuffer.push(SampleBuffer::makeSample(rawSeconds(), temp, humidity));
         }
       }
       else {
         oled.displayText("Reg. Failed");
+        otaManager.onUploadFailed();
+        connectivity.onUploadFailure(rawSeconds());
+        txPower.onWake(WiFi.RSSI(), false, disconnectCount);
+        wakePlanUploadFailed(wakePlan);
+        bufferReading();
       }
       stateTimer = millis();
       currentState = STATE_TASK_COMPLETE;
       break;
+    }
 
-    case STATE_TASK_COMPLETE: //goes back to sleep
-      if (millis() - stateTimer > 5000) {
-        stateTimer = 0;
-        currentState = STATE_DEEP_SLEEP;
+    case STATE_FIRMWARE_UPDATE: // server offered new firmware, patch it in and reboot into it
+      Serial.println("State: FIRMWARE_UPDATE");
+      oled.displayText("Updating...");
+      budgetStep(BUDGET_STEP_UPDATE);
+      if (otaManager.applyUpdate(apiHandler.firmwareUpdate(), apiHandler.activeServerUrl())) {
+        oled.displayText("Update OK");
+        powerManager.peripherals_off();
+        delay(100);
+        ESP.restart();
       }
+      budgetStepDone();
+      oled.displayText("Update Failed");
+      stateTimer = millis();
+      currentState = STATE_TASK_COMPLETE;
       break;
 
-    case STATE_DEEP_SLEEP: // puts the device into deep sleep and shuts down peripherals
+    case STATE_TASK_COMPLETE: //goes back to sleep
+#if HAS_OLED
+      // leave the result on the screen for a moment
+      if (millis() - stateTimer <= connectivity.resultDisplayMs()) break;
+#endif
+      stateTimer = 0;
+      currentState = STATE_DEEP_SLEEP;
+      break;
+
+    case STATE_DEEP_SLEEP: { // puts the device into deep sleep and shuts down peripherals
+      int sleepInterval = sleepIntervalSeconds();
+#if HYBRID_SLEEP
+      // for short intervals staying associated can beat waking up again, see SleepPolicy.h
+      if (sleepPolicy.choose(sleepInterval * SAMPLES_PER_UPLOAD) == SLEEP_CONNECTED && WiFi.status() == WL_CONNECTED) {
+        stateTimer = 0;
+        currentState = STATE_CONNECTED_SLEEP;
+        break;
+      }
+#endif
       Serial.println("State: DEEP_SLEEP");
       oled.displayText("Sleeping...");
-      
-      // Turn off peripherals and wait for them to power down
-      powerManager.peripherals_off();
-      delay(100);
-
-      // Use  sleep interval 
-      int sleepInterval = configManager.getConfig().sleepIntervalSeconds;
-      //default
-      if (sleepInterval <= 0) {
-        sleepInterval = 300; 
+      sleepUntilNextWake(sleepInterval);
+      break;
+    }
+
+    case STATE_CONNECTED_SLEEP: // stays associated until the next reading, see SleepPolicy.h
+      if (stateTimer == 0) {
+        // same period as the deep sleep would have had, this cycle's time comes off it.
+        // Retry-After doesn't stretch it while an alarm is on, the readings have to go on.
+        uint32_t retryAfter = alarmMonitor.active() ? 0 : apiHandler.retryAfterSeconds();
+        unsigned long intervalMs = max((uint32_t)sleepIntervalSeconds(), retryAfter) * 1000UL;
+        unsigned long awakeMs = cycleAwakeMs();
+        connectedIdleMs = intervalMs > awakeMs ? intervalMs - awakeMs : 0;
+        Serial.printf("State: CONNECTED_SLEEP (%lu ms)\n", connectedIdleMs);
+        oled.displayText("Sleeping...");
+        powerManager.peripherals_off();
+        sleepPolicy.onConnectedIdle(awakeMs, wifiStartMs ? millis() - wifiStartMs : 0, connectedIdleMs / 1000);
+        powerManager.disarmAwakeTimer(); // nothing runs, the budget is for the cycles
+        apiHandler.keepConnection(true);
+        if (!powerManager.enterConnectedIdle() && CONNECTED_LIGHT_SLEEP) sleepPolicy.onNoLightSleep();
+        connectedThisBoot = true;
+        stateTimer = millis();
+      }
+
+      if (event != EV_NONE || millis() - stateTimer >= connectedIdleMs) {
+        powerManager.leaveConnectedIdle();
+        startAwakeBudget(event != EV_NONE ? BUDGET_WAKE_BUTTON : BUDGET_WAKE_TIMER);
+        stateTimer = 0;
+        cycleStartMs = millis();
+        wifiStartMs = cycleStartMs;
+        powerUpPeripherals();
+        // a click shows the info screen like a button wake would, otherwise
+        // it's the next reading: sample only, or upload over the same association
+        currentState = event != EV_NONE ? STATE_INFO_DISPLAY : STATE_CONNECTING_WIFI;
+        break;
       }
-      powerManager.enterDeepSleep(sleepInterval);
+      // light sleeps in here. Without a button one delay does it, with one we
+      // have to look now and then, so hold it a moment to be noticed.
+      delay(HAS_BUTTON ? min(connectedIdleMs - (millis() - stateTimer), (unsigned long)CONNECTED_POLL_MS)
+                       : connectedIdleMs - (millis() - stateTimer));
       break;
   }
 }
@@ -224,7 +568,8 @@ void checkWakeupReason() {
   switch (wakeup_reason) {
     case ESP_SLEEP_WAKEUP_TIMER:
       Serial.println("Wakeup caused by timer");
-      currentState = STATE_CONNECTING_WIFI;
+      // a node that slept without a config (headless) looks for one again
+      currentState = configManager.isConfigured() ? STATE_CONNECTING_WIFI : STATE_BOOT;
       break;
     case ESP_SLEEP_WAKEUP_GPIO:
       Serial.println("Wakeup caused by GPIO");
@@ -244,17 +589,63 @@ bool connectToWiFi() {
   const DeviceConfig& config = configManager.getConfig();
   if (strlen(config.wifiSSID) == 0) return false;
 
+  // still associated after a connected idle, which is what it was for
+  if (connectedThisBoot && WiFi.status() == WL_CONNECTED) {
+    Serial.println("WiFi still connected.");
+    sleepPolicy.onReconnectAvoided();
+    // no reconnect to set it on, so the TX power loop's last step goes in here
+    WiFi.setTxPower((wifi_power_t)txPower.powerQdbm());
+    return true;
+  }
+
+  budgetStep(BUDGET_STEP_CONNECT);
+  wifiStartMs = millis();
   WiFi.mode(WIFI_STA);
-  WiFi.begin(config.wifiSSID, config.wifiPassword);
+  // has to come after mode(), the driver only takes it once it's started
+  txPower.setBounds(config.txPowerMinDbm, config.txPowerMaxDbm);
+  WiFi.setTxPower((wifi_power_t)txPower.powerQdbm());
+  disconnectCount = 0;
+
+  bool found = false;
+  if (connectivity.shouldProbe()) {
+    // we failed last time, so first look for the AP on its channel (~100 ms)
+    // instead of spending the whole connect timeout on an AP that isn't there
+    const ConnectivityState& known = connectivity.state();
+    Serial.printf("Looking for the AP on channel %d...\n", known.channel);
+    uint8_t bssid[6];
+    found = WiFi.scanNetworks(false, false, false, PROBE_MS_PER_CHANNEL, known.channel, config.wifiSSID) > 0;
+    if (found) memcpy(bssid, WiFi.BSSID(0), sizeof(bssid));
+    WiFi.scanDelete();
+    if (found) {
+      // we know where it is, so the driver can skip its own scan
+      WiFi.begin(config.wifiSSID, config.wifiPassword, known.channel, bssid);
+    }
+    else if (!connectivity.onProbeMiss() && !alarmMonitor.due()) {
+      Serial.println("AP not there, not connecting.");
+      budgetStepDone();
+      return false;
+    }
+    else {
+      Serial.println("AP not there, trying a full connect anyway.");
+    }
+  }
+  if (!found) {
+    WiFi.begin(config.wifiSSID, config.wifiPassword);
+  }
 
   oled.displayText("Connecting...");
   Serial.print("Connecting to WiFi...");
 
+  // shorter after failures, see ConnectivityPolicy. Not for an alarm, that gets every chance.
+  uint32_t timeoutMs = alarmMonitor.due() ? ConnectivityPolicy::CONNECT_TIMEOUT_MS : connectivity.connectTimeoutMs();
   unsigned long startTime = millis();
   while (WiFi.status() != WL_CONNECTED) {
-    if (millis() - startTime > 15000) {
+    if (millis() - startTime > timeoutMs) {
       WiFi.disconnect();
       Serial.println(" failed!");
+      connectivity.onWiFiFailure(rawSeconds());
+      txPower.onWiFiFailure(disconnectCount);
+      budgetStepDone();
       return false;
     }
     buttonHandler.tick();
@@ -263,6 +654,193 @@ bool connectToWiFi() {
     Serial.print(".");
   }
   
-  Serial.println("\nWiFi Connected!");
+  Serial.printf("\nWiFi Connected! RSSI %d dBm at %.2f dBm TX, %d retries\n", WiFi.RSSI(), txPower.powerQdbm() / 4.0, disconnectCount);
+  connectivity.onWiFiConnected(WiFi.BSSID(), WiFi.channel());
+  // what staying connected would have saved, only a timer wake has nothing else in it
+  if (!connectedThisBoot && esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_TIMER) {
+    sleepPolicy.onReconnect(wakePlanAwakeMs(wakePlan));
+  }
+  budgetStepDone();
   return true;
-}
\ No newline at end of file
+}
+
+// raw RTC clock in seconds, what the sample buffer and the policy count in
+uint32_t rawSeconds() {
+  return TimeKeeper::rawClockUs() / 1000000;
+}
+
+// configured sleep interval, 300 s if there is none. While an alarm is on
+// we read more often, see AlarmMonitor.h
+int sleepIntervalSeconds() {
+  int sleepInterval = configManager.getConfig().sleepIntervalSeconds;
+  if (sleepInterval <= 0) sleepInterval = 300;
+  return alarmMonitor.active() ? min(sleepInterval, ALARM_INTERVAL_SECONDS) : sleepInterval;
+}
+
+// this wake, or this cycle if we stayed connected
+uint32_t cycleAwakeMs() {
+  return connectedThisBoot ? millis() - cycleStartMs : wakePlanAwakeMs(wakePlan);
+}
+
+// raw clock when this wake (or cycle) started, what alarm latency counts from
+int64_t wakeStartRawUs() {
+  return TimeKeeper::rawClockUs() - (int64_t)cycleAwakeMs() * 1000;
+}
+
+// after a connected idle, what setup() does for them after a deep sleep wake
+void powerUpPeripherals() {
+  powerManager.peripherals_on();
+  delay(100);
+  oled.initializeOLED();
+  budgetStep(BUDGET_STEP_SENSOR);
+  sensorHandler.begin();
+  budgetStepDone();
+}
+
+// both readings, within the sensor's slice of the awake budget
+void readSensor(float& temp, float& humidity) {
+  budgetStep(BUDGET_STEP_SENSOR);
+  temp = sensorHandler.readTemperature();
+  humidity = sensorHandler.readHumidity();
+  budgetStepDone();
+}
+
+// takes a reading and keeps it for the next upload, true if it set off (or cleared) an alarm
+bool bufferReading() {
+  float temp, humidity;
+  readSensor(temp, humidity);
+  Sample sample = SampleBuffer::makeSample(rawSeconds(), temp, humidity);
+  if (!sampleBuffer.push(sample)) {
+    Serial.println("Sample buffer full, dropped the oldest reading.");
+  }
+  return checkAlarms(sample);
+}
+
+// a threshold from the config as AlarmMonitor takes it
+int16_t alarmLimit(int configCenti) {
+  if (configCenti == CONFIG_NO_THRESHOLD) return ALARM_OFF;
+  return max(-32767, min(configCenti, 32767));
+}
+
+// the thresholds of the config in use, on boot and whenever a new config is applied
+void applyAlarmThresholds() {
+  const DeviceConfig& config = configManager.getConfig();
+  alarmMonitor.setThresholds({alarmLimit(config.alarmTempHighCenti), alarmLimit(config.alarmTempLowCenti),
+                              alarmLimit(config.alarmHumidityHighCenti), alarmLimit(config.alarmHumidityLowCenti)});
+}
+
+// every reading goes through here (or the stub's alarmCheck()), true if an alarm changed
+bool checkAlarms(const Sample& sample) {
+  uint8_t before = alarmMonitor.active();
+  if (!alarmMonitor.check(sample, wakeStartRawUs())) return false;
+  for (uint8_t bit = 1; bit < (1 << ALARM_KIND_COUNT); bit <<= 1) {
+    if ((before ^ alarmMonitor.active()) & bit) {
+      Serial.printf("Alarm %s %s.\n", AlarmMonitor::kindName(bit), alarmMonitor.active() & bit ? "on" : "off");
+    }
+  }
+  return true;
+}
+
+// listens for a config on USB serial. If the host also asked for registration
+// it joins WiFi and registers right away, and returns true if that worked.
+bool provisionOverSerial(unsigned long windowMs) {
+  ProvisionResult result = serialProvisioner.listen(windowMs);
+  if (result == PROVISION_NONE) return false;
+  applyAlarmThresholds();
+  if (result != PROVISION_SAVED_REGISTER) return false;
+  bool registered = false;
+  if (connectToWiFi()) {
+    budgetStep(BUDGET_STEP_REQUEST);
+    registered = apiHandler.registerDeviceIfNeeded();
+    budgetStepDone();
+  }
+  serialProvisioner.reportRegistration(registered);
+  return registered;
+}
+
+// deep sleep until the next reading, turning the peripherals off first
+void sleepUntilNextWake(int sleepInterval) {
+  // Turn off peripherals and wait for them to power down
+  powerManager.peripherals_off();
+  delay(100);
+
+  planWakeSlot();
+  sleepPolicy.onDeepSleep(cycleAwakeMs(), wifiStartMs ? millis() - wifiStartMs : 0, sleepInterval);
+  // the next wakes may not need us, see WakeStub.h
+  wakePlanArm(wakePlan, sleepInterval * 1000);
+  powerManager.enterDeepSleep(sleepInterval);
+}
+
+// wake in our own slot so a fleet powered on together doesn't report in the same second
+void planWakeSlot() {
+#if WAKE_SLOTS
+  const DeviceConfig& sleepConfig = configManager.getConfig();
+  powerManager.setWakeSlot(strlen(sleepConfig.deviceId) > 0 ? sleepConfig.deviceId : WiFi.macAddress().c_str(),
+                           timeKeeper.slotClockMs());
+  powerManager.deferWakeSlot(alarmMonitor.active() ? 0 : apiHandler.retryAfterSeconds());
+#endif
+}
+
+// a wake (or a cycle after a connected idle) starts, the timer goes off at its first limit
+void startAwakeBudget(BudgetWakeReason reason) {
+  awakeBudget.beginWake(reason, millis());
+  planBudgetSleep();
+  powerManager.armAwakeTimer(awakeBudget.msLeft(millis()), onAwakeBudgetExpired);
+}
+
+void budgetStep(BudgetStep step) {
+  awakeBudget.beginStep(step, millis());
+  planBudgetSleep();
+  powerManager.armAwakeTimer(awakeBudget.msLeft(millis()), onAwakeBudgetExpired);
+}
+
+void budgetStepDone() {
+  awakeBudget.endStep(millis());
+  planBudgetSleep();
+  powerManager.armAwakeTimer(awakeBudget.msLeft(millis()), onAwakeBudgetExpired);
+}
+
+// what sleepUntilNextWake() would do, worked out on the main task before the
+// step starts, so the timer's callback only has to copy it in
+void planBudgetSleep() {
+  int sleepInterval = sleepIntervalSeconds();
+  planWakeSlot();
+  budgetWakePlan = wakePlan;
+  wakePlanArm(budgetWakePlan, sleepInterval * 1000);
+  powerManager.planDeepSleep(sleepInterval);
+}
+
+// runs in the esp_timer task while loop() is stuck in whatever ran out of
+// time, maybe holding the Serial, WiFi or heap locks. loop() never gets back,
+// so this only notes the overrun and sleeps as planBudgetSleep() planned.
+// The reading is lost; an upload that didn't happen is still due next wake.
+void onAwakeBudgetExpired() {
+  BudgetStep step = awakeBudget.onOverrun(millis());
+  esp_rom_printf("\nAwake budget: %s ran out after %u ms, going to sleep.\n",
+                 AwakeBudget::stepName(step), (unsigned)awakeBudgetState.lastAwakeMs);
+  wakePlan = budgetWakePlan;
+  powerManager.deepSleepFromTimer();
+}
+
+// remembers why the station lost/failed its connection so setup can tell the user
+void onWiFiDisconnected(WiFiEvent_t event, WiFiEventInfo_t info) {
+  lastDisconnectReason = info.wifi_sta_disconnected.reason;
+  if (disconnectCount < 255) disconnectCount++;
+}
+
+#if HAS_PORTAL
+
+// maps a WiFi disconnect reason to something we can show the user
+SetupResult classifyWiFiFailure(uint8_t reason) {
+  switch (reason) {
+    case WIFI_REASON_AUTH_FAIL:
+    case WIFI_REASON_4WAY_HANDSHAKE_TIMEOUT:
+    case WIFI_REASON_HANDSHAKE_TIMEOUT:
+      return SETUP_WRONG_PASSWORD;
+    case WIFI_REASON_NO_AP_FOUND:
+      return SETUP_NO_SSID;
+    default:
+      return SETUP_WIFI_FAILED;
+  }
+}
+#endif
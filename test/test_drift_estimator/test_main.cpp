@@ -0,0 +1,158 @@
+#include <unity.h>
+#include <math.h>
+#include "DriftEstimator.h"
+
+static DriftState state;
+static DriftEstimator estimator(state);
+
+static const int64_t START_EPOCH_MS = 1700000000000LL;
+static const int64_t HOUR_MS = 3600000LL;
+
+// raw clock that runs ppm fast (negative: slow) and was at 5 s when true time was START_EPOCH_MS
+static int64_t rawUsAt(int64_t epochMs, double ppm) {
+  return 5000000 + (int64_t)llround((epochMs - START_EPOCH_MS) * 1000.0 * (1 + ppm * 1e-6));
+}
+
+// the ratio the estimator should learn for that clock, true elapsed / raw elapsed
+static double trueRatio(double ppm) {
+  return 1 / (1 + ppm * 1e-6);
+}
+
+// an HTTP Date sync the way TimeKeeper feeds it: whole seconds, +-500 ms
+static void syncFromDate(int64_t epochMs, double ppm) {
+  estimator.sync(epochMs / 1000 * 1000 + 500, 500, rawUsAt(epochMs, ppm));
+}
+
+// hourly Date syncs for a day, at a different point of the second each time
+static void syncHourlyForADay(double ppm) {
+  for (int hour = 0; hour <= 24; hour++) {
+    syncFromDate(START_EPOCH_MS + hour * HOUR_MS + (hour * 379) % 1000, ppm);
+  }
+}
+
+void setUp() {
+  estimator.reset();
+}
+
+void tearDown() {
+}
+
+static void checkConvergence(double ppm) {
+  estimator.reset();
+  syncHourlyForADay(ppm);
+  TEST_ASSERT_EQUAL_UINT32(24, state.drifts);
+  // second resolution over an hour can't do better than a few hundred ppm,
+  // but the estimate has to be inside what it claims
+  TEST_ASSERT_LESS_THAN_DOUBLE(0.001, estimator.ratioUncertainty());
+  TEST_ASSERT_DOUBLE_WITHIN(estimator.ratioUncertainty(), trueRatio(ppm), estimator.ratio());
+
+  // and so does the time it predicts 6 h after the last sync
+  int64_t epochMs = START_EPOCH_MS + 30 * HOUR_MS;
+  int64_t rawUs = rawUsAt(epochMs, ppm);
+  TEST_ASSERT_INT64_WITHIN(estimator.uncertaintyMs(rawUs), epochMs, estimator.epochMs(rawUs));
+}
+
+void test_converges_on_a_fast_clock() {
+  checkConvergence(20000);
+}
+
+void test_converges_on_a_slow_clock() {
+  checkConvergence(-30000);
+}
+
+void test_converges_on_a_good_clock() {
+  checkConvergence(200);
+  checkConvergence(-500);
+}
+
+// server time in ms, like syncFromServerTime(), pins it down to the ppm
+static void checkExactSyncs(double ppm) {
+  estimator.reset();
+  for (int hour = 0; hour <= 3; hour++) {
+    int64_t epochMs = START_EPOCH_MS + hour * HOUR_MS;
+    estimator.sync(epochMs, 1, rawUsAt(epochMs, ppm));
+  }
+  TEST_ASSERT_DOUBLE_WITHIN(1e-6, trueRatio(ppm), estimator.ratio());
+}
+
+void test_exact_syncs_converge_to_the_ppm() {
+  checkExactSyncs(15000);
+  checkExactSyncs(-15000);
+}
+
+void test_unsynced_until_first_sync() {
+  TEST_ASSERT_FALSE(estimator.isSynced());
+  syncFromDate(START_EPOCH_MS, 0);
+  TEST_ASSERT_TRUE(estimator.isSynced());
+  TEST_ASSERT_EQUAL_INT64(START_EPOCH_MS + 500, estimator.epochMs(rawUsAt(START_EPOCH_MS, 0)));
+  TEST_ASSERT_EQUAL_UINT32(500, estimator.uncertaintyMs(rawUsAt(START_EPOCH_MS, 0)));
+}
+
+void test_no_drift_learned_before_min_learn() {
+  const double ppm = 20000;
+  syncFromDate(START_EPOCH_MS, ppm);
+  // raw time is what counts, on this clock 9 min true is still under 10 min raw
+  syncFromDate(START_EPOCH_MS + 9 * 60000, ppm);
+  syncFromDate(START_EPOCH_MS + 9 * 60000 + 45000, ppm);
+  TEST_ASSERT_EQUAL_UINT32(0, state.drifts);
+  TEST_ASSERT_EQUAL_DOUBLE(1.0, estimator.ratio());
+  TEST_ASSERT_EQUAL_DOUBLE(DriftEstimator::INITIAL_RATIO_UNCERTAINTY, estimator.ratioUncertainty());
+
+  // measured against the first sync, not the ones that were too close
+  syncFromDate(START_EPOCH_MS + 10 * 60000, ppm);
+  TEST_ASSERT_EQUAL_UINT32(1, state.drifts);
+  TEST_ASSERT_LESS_THAN_DOUBLE(DriftEstimator::INITIAL_RATIO_UNCERTAINTY, estimator.ratioUncertainty());
+  TEST_ASSERT_DOUBLE_WITHIN(0.002, trueRatio(ppm), estimator.ratio());
+}
+
+void test_steps_beyond_max_drift_are_ignored() {
+  syncHourlyForADay(0);
+  double ratio = estimator.ratio();
+  double uncertainty = estimator.ratioUncertainty();
+
+  // the server's clock jumped 15 min in an hour, 25%
+  int64_t rawUs = rawUsAt(START_EPOCH_MS + 25 * HOUR_MS, 0);
+  estimator.sync(START_EPOCH_MS + 25 * HOUR_MS + 15 * 60000, 500, rawUs);
+  TEST_ASSERT_EQUAL_UINT32(24, state.drifts);
+  TEST_ASSERT_EQUAL_DOUBLE(ratio, estimator.ratio());
+  TEST_ASSERT_EQUAL_DOUBLE(uncertainty, estimator.ratioUncertainty());
+
+  // and going back 15 min is no better
+  rawUs = rawUsAt(START_EPOCH_MS + 26 * HOUR_MS, 0);
+  estimator.sync(START_EPOCH_MS + 26 * HOUR_MS - 15 * 60000, 500, rawUs);
+  TEST_ASSERT_EQUAL_UINT32(24, state.drifts);
+  TEST_ASSERT_EQUAL_DOUBLE(ratio, estimator.ratio());
+}
+
+void test_steps_within_max_drift_are_learned() {
+  syncHourlyForADay(0);
+  // 5 min in an hour is 8%, an awful clock but a possible one
+  int64_t rawUs = rawUsAt(START_EPOCH_MS + 25 * HOUR_MS, 0);
+  estimator.sync(START_EPOCH_MS + 25 * HOUR_MS + 5 * 60000, 500, rawUs);
+  TEST_ASSERT_EQUAL_UINT32(25, state.drifts);
+  TEST_ASSERT_GREATER_THAN_DOUBLE(1.0, estimator.ratio());
+}
+
+void test_raw_clock_going_back_starts_over() {
+  syncHourlyForADay(20000);
+  // power loss: the raw clock starts from 0 again
+  estimator.sync(START_EPOCH_MS + 25 * HOUR_MS, 500, 1000000);
+  TEST_ASSERT_TRUE(estimator.isSynced());
+  TEST_ASSERT_EQUAL_UINT32(0, state.drifts);
+  TEST_ASSERT_EQUAL_DOUBLE(1.0, estimator.ratio());
+  TEST_ASSERT_EQUAL_INT64(START_EPOCH_MS + 25 * HOUR_MS, estimator.epochMs(1000000));
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_converges_on_a_fast_clock);
+  RUN_TEST(test_converges_on_a_slow_clock);
+  RUN_TEST(test_converges_on_a_good_clock);
+  RUN_TEST(test_exact_syncs_converge_to_the_ppm);
+  RUN_TEST(test_unsynced_until_first_sync);
+  RUN_TEST(test_no_drift_learned_before_min_learn);
+  RUN_TEST(test_steps_beyond_max_drift_are_ignored);
+  RUN_TEST(test_steps_within_max_drift_are_learned);
+  RUN_TEST(test_raw_clock_going_back_starts_over);
+  return UNITY_END();
+}
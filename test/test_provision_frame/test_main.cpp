@@ -0,0 +1,144 @@
+#include <unity.h>
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include "ProvisionFrame.h"
+
+static ProvisionFrameParser parser;
+
+// feeds a whole line, the result of its last byte
+static ProvisionFrameParser::Result feedLine(const std::string& line) {
+  ProvisionFrameParser::Result result = ProvisionFrameParser::FRAME_NONE;
+  for (char c : line) result = parser.feed(c);
+  return result;
+}
+
+// "@PROV <crc> <json>\n" with the right CRC, like tools/provision.py sends it
+static std::string frame(const std::string& json) {
+  char crc[9];
+  snprintf(crc, sizeof(crc), "%08x", (unsigned)provisionCrc32((const uint8_t*)json.data(), json.size()));
+  return "@PROV " + std::string(crc) + " " + json + "\n";
+}
+
+static const char* check(const std::string& json) {
+  JsonDocument doc;
+  return provisionCheckPayload(doc, json.data(), json.size());
+}
+
+void setUp() {
+  parser.reset();
+}
+
+void tearDown() {
+}
+
+void test_crc_matches_zlib() {
+  // zlib.crc32(b"123456789")
+  TEST_ASSERT_EQUAL_HEX32(0xCBF43926, provisionCrc32((const uint8_t*)"123456789", 9));
+}
+
+void test_good_frame() {
+  std::string json = "{\"ssid\":\"lab\",\"server\":\"http://10.0.0.2/api\"}";
+  TEST_ASSERT_EQUAL(ProvisionFrameParser::FRAME_OK, feedLine(frame(json)));
+  TEST_ASSERT_EQUAL(json.size(), parser.payloadLength());
+  TEST_ASSERT_EQUAL_STRING(json.c_str(), parser.payload());
+}
+
+void test_crlf_and_uppercase_crc() {
+  std::string line = frame("{\"ssid\":\"a\",\"server\":\"b\"}");
+  for (size_t i = 6; i < 14; i++) line[i] = toupper(line[i]);
+  line.insert(line.size() - 1, "\r");
+  TEST_ASSERT_EQUAL(ProvisionFrameParser::FRAME_OK, feedLine(line));
+}
+
+void test_crc_mismatch() {
+  std::string line = frame("{\"ssid\":\"lab\",\"server\":\"x\"}");
+  line[line.size() - 4] = 'y'; // payload changed after the CRC was taken
+  TEST_ASSERT_EQUAL(ProvisionFrameParser::FRAME_BAD_CRC, feedLine(line));
+  TEST_ASSERT_NULL(parser.payload());
+}
+
+void test_bad_hex_is_malformed() {
+  TEST_ASSERT_EQUAL(ProvisionFrameParser::FRAME_MALFORMED, feedLine("@PROV 1234567g {}\n"));
+}
+
+void test_short_frames_are_malformed() {
+  TEST_ASSERT_EQUAL(ProvisionFrameParser::FRAME_MALFORMED, feedLine("@PROV \n"));
+  TEST_ASSERT_EQUAL(ProvisionFrameParser::FRAME_MALFORMED, feedLine("@PROV 1234\n"));
+  TEST_ASSERT_EQUAL(ProvisionFrameParser::FRAME_MALFORMED, feedLine("@PROV 12345678\n"));
+  TEST_ASSERT_EQUAL(ProvisionFrameParser::FRAME_MALFORMED, feedLine("@PROV 12345678{}\n"));
+}
+
+void test_truncated_frame_waits_for_newline() {
+  std::string line = frame("{\"ssid\":\"lab\",\"server\":\"x\"}");
+  line.pop_back();
+  TEST_ASSERT_EQUAL(ProvisionFrameParser::FRAME_NONE, feedLine(line));
+  TEST_ASSERT_EQUAL(ProvisionFrameParser::FRAME_OK, parser.feed('\n'));
+}
+
+void test_truncated_payload_fails_crc() {
+  // the line ended early, the CRC is for the whole JSON
+  std::string line = frame("{\"ssid\":\"lab\",\"server\":\"x\"}");
+  line.erase(line.size() - 6, 5);
+  TEST_ASSERT_EQUAL(ProvisionFrameParser::FRAME_BAD_CRC, feedLine(line));
+}
+
+void test_oversized_frame() {
+  std::string json = "{\"ssid\":\"" + std::string(ProvisionFrameParser::MAX_LINE, 'a') + "\",\"server\":\"x\"}";
+  TEST_ASSERT_EQUAL(ProvisionFrameParser::FRAME_TOO_LONG, feedLine(frame(json)));
+  // and the next line is parsed from scratch
+  TEST_ASSERT_EQUAL(ProvisionFrameParser::FRAME_OK, feedLine(frame("{\"ssid\":\"a\",\"server\":\"b\"}")));
+}
+
+void test_longest_frame_fits() {
+  std::string head = frame("");
+  std::string json(ProvisionFrameParser::MAX_LINE - (head.size() - 1), 'a');
+  TEST_ASSERT_EQUAL(ProvisionFrameParser::FRAME_OK, feedLine(frame(json)));
+  TEST_ASSERT_EQUAL(ProvisionFrameParser::FRAME_TOO_LONG, feedLine(frame(json + "a")));
+}
+
+void test_other_lines_are_ignored() {
+  TEST_ASSERT_EQUAL(ProvisionFrameParser::FRAME_NONE, feedLine("ESP-ROM:esp32c3-api1-20210207\n"));
+  TEST_ASSERT_EQUAL(ProvisionFrameParser::FRAME_NONE, feedLine("@PROVX 00000000 {}\n"));
+  TEST_ASSERT_EQUAL(ProvisionFrameParser::FRAME_NONE, feedLine("\n"));
+  TEST_ASSERT_EQUAL(ProvisionFrameParser::FRAME_OK, feedLine(frame("{\"ssid\":\"a\",\"server\":\"b\"}")));
+}
+
+void test_payload_ok() {
+  TEST_ASSERT_NULL(check("{\"ssid\":\"lab\",\"pass\":\"\",\"server\":\"http://10.0.0.2/api\",\"interval\":60}"));
+}
+
+void test_bad_json() {
+  TEST_ASSERT_EQUAL_STRING("bad_json", check("{\"ssid\":\"lab\",\"server\":"));
+  TEST_ASSERT_EQUAL_STRING("bad_json", check("not json"));
+  TEST_ASSERT_EQUAL_STRING("bad_json", check(""));
+}
+
+void test_missing_fields() {
+  TEST_ASSERT_EQUAL_STRING("missing_fields", check("{}"));
+  TEST_ASSERT_EQUAL_STRING("missing_fields", check("{\"ssid\":\"lab\"}"));
+  TEST_ASSERT_EQUAL_STRING("missing_fields", check("{\"server\":\"x\"}"));
+  TEST_ASSERT_EQUAL_STRING("missing_fields", check("{\"ssid\":\"\",\"server\":\"x\"}"));
+  TEST_ASSERT_EQUAL_STRING("missing_fields", check("{\"ssid\":\"lab\",\"server\":\"\"}"));
+  TEST_ASSERT_EQUAL_STRING("missing_fields", check("{\"ssid\":1,\"server\":\"x\"}"));
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_crc_matches_zlib);
+  RUN_TEST(test_good_frame);
+  RUN_TEST(test_crlf_and_uppercase_crc);
+  RUN_TEST(test_crc_mismatch);
+  RUN_TEST(test_bad_hex_is_malformed);
+  RUN_TEST(test_short_frames_are_malformed);
+  RUN_TEST(test_truncated_frame_waits_for_newline);
+  RUN_TEST(test_truncated_payload_fails_crc);
+  RUN_TEST(test_oversized_frame);
+  RUN_TEST(test_longest_frame_fits);
+  RUN_TEST(test_other_lines_are_ignored);
+  RUN_TEST(test_payload_ok);
+  RUN_TEST(test_bad_json);
+  RUN_TEST(test_missing_fields);
+  return UNITY_END();
+}
@@ -0,0 +1,92 @@
+#include <unity.h>
+#include "TimeKeeper.h"
+
+// not in native_test's build_src_filter, the other suites don't have the
+// raw clock below. Brings timeState (RTC memory) with it.
+#include "../../src/TimeKeeper.cpp"
+
+// the raw clock TimeKeeper reads, see sim/hal/sys/time.h
+static int64_t rawUs;
+
+int simGettimeofday(struct timeval* tv, void* tz) {
+  tv->tv_sec = rawUs / 1000000;
+  tv->tv_usec = rawUs % 1000000;
+  return 0;
+}
+
+void setUp() {
+  DriftEstimator(timeState).reset();
+  rawUs = 0;
+}
+
+void tearDown() {
+}
+
+void test_parses_imf_fixdate() {
+  TEST_ASSERT_EQUAL_INT64(784111777, TimeKeeper::parseHttpDate("Sun, 06 Nov 1994 08:49:37 GMT"));
+  TEST_ASSERT_EQUAL_INT64(0, TimeKeeper::parseHttpDate("Thu, 01 Jan 1970 00:00:00 GMT"));
+  TEST_ASSERT_EQUAL_INT64(1767225599, TimeKeeper::parseHttpDate("Wed, 31 Dec 2025 23:59:59 GMT"));
+}
+
+void test_leap_years() {
+  TEST_ASSERT_EQUAL_INT64(1709208000, TimeKeeper::parseHttpDate("Thu, 29 Feb 2024 12:00:00 GMT"));
+  // 2000 is a leap year, the day after 29 Feb
+  TEST_ASSERT_EQUAL_INT64(951868800, TimeKeeper::parseHttpDate("Wed, 01 Mar 2000 00:00:00 GMT"));
+}
+
+void test_past_2038() {
+  TEST_ASSERT_EQUAL_INT64(2147483648LL, TimeKeeper::parseHttpDate("Tue, 19 Jan 2038 03:14:08 GMT"));
+}
+
+void test_rejects_obsolete_formats() {
+  // RFC 850 and asctime, which RFC 7231 still lets clients accept
+  TEST_ASSERT_EQUAL_INT64(-1, TimeKeeper::parseHttpDate("Sunday, 06-Nov-94 08:49:37 GMT"));
+  TEST_ASSERT_EQUAL_INT64(-1, TimeKeeper::parseHttpDate("Sun Nov  6 08:49:37 1994"));
+}
+
+void test_rejects_garbage() {
+  TEST_ASSERT_EQUAL_INT64(-1, TimeKeeper::parseHttpDate(""));
+  TEST_ASSERT_EQUAL_INT64(-1, TimeKeeper::parseHttpDate("yesterday"));
+  TEST_ASSERT_EQUAL_INT64(-1, TimeKeeper::parseHttpDate("Sun, 06 Nov 1994 08:49"));
+  TEST_ASSERT_EQUAL_INT64(-1, TimeKeeper::parseHttpDate("Sun, 06 Nov 1994 08:49:37 UTC"));
+  TEST_ASSERT_EQUAL_INT64(-1, TimeKeeper::parseHttpDate("Sun, 06 Foo 1994 08:49:37 GMT"));
+  TEST_ASSERT_EQUAL_INT64(-1, TimeKeeper::parseHttpDate("Sun, 06 nov 1994 08:49:37 GMT"));
+  // in MONTHS, but across two of them
+  TEST_ASSERT_EQUAL_INT64(-1, TimeKeeper::parseHttpDate("Sun, 06 ovD 1994 08:49:37 GMT"));
+  TEST_ASSERT_EQUAL_INT64(-1, TimeKeeper::parseHttpDate("Sun, 06 No 1994 08:49:37 GMT"));
+}
+
+void test_sync_from_date_header() {
+  TimeKeeper timeKeeper;
+  // sent at 1 s, answered at 1.2 s raw
+  TEST_ASSERT_TRUE(timeKeeper.syncFromHttpDate("Sun, 06 Nov 1994 08:49:37 GMT", 1000000, 1200000));
+  TEST_ASSERT_TRUE(timeKeeper.isSynced());
+
+  // the middle of that second, at the middle of the round trip
+  rawUs = 1100000;
+  TEST_ASSERT_EQUAL_INT64(784111777500LL, timeKeeper.nowMs());
+  TEST_ASSERT_EQUAL_UINT32(600, timeKeeper.uncertaintyMs());
+
+  // no drift learned yet, a minute later it could be 2% of it further off
+  rawUs += 60000000;
+  TEST_ASSERT_EQUAL_INT64(784111837500LL, timeKeeper.nowMs());
+  TEST_ASSERT_EQUAL_UINT32(600 + 1200, timeKeeper.uncertaintyMs());
+}
+
+void test_bad_date_header_is_not_a_sync() {
+  TimeKeeper timeKeeper;
+  TEST_ASSERT_FALSE(timeKeeper.syncFromHttpDate("", 1000000, 1200000));
+  TEST_ASSERT_FALSE(timeKeeper.isSynced());
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_parses_imf_fixdate);
+  RUN_TEST(test_leap_years);
+  RUN_TEST(test_past_2038);
+  RUN_TEST(test_rejects_obsolete_formats);
+  RUN_TEST(test_rejects_garbage);
+  RUN_TEST(test_sync_from_date_header);
+  RUN_TEST(test_bad_date_header_is_not_a_sync);
+  return UNITY_END();
+}
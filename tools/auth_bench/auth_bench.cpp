@@ -0,0 +1,128 @@
+// Signing vs TLS on the node itself: how long NodeAuth takes to sign ingest
+// bodies of typical sizes (same code as SIGNED_INGEST, on the SHA
+// accelerator), against a plain TCP connect and a TLS handshake with the
+// server. Flash it instead of the firmware:
+//
+//    pio run -e auth_bench -t upload && pio device monitor
+//
+// It uses the WiFi and server URL already in NVS, so set the node up with
+// the normal firmware first. The handshake goes to the same host on
+// AUTH_BENCH_TLS_PORT, e.g. tools/standin_server.py --tls-port 4443 with a
+// P-256 certificate (see its docstring). The certificate isn't checked
+// (setInsecure()), checking a real chain only adds to the TLS side.
+// Flash the firmware again afterwards.
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <WiFiClientSecure.h>
+#include "esp_random.h"
+#include "ConfigManager.h"
+#include "NodeAuth.h"
+
+#ifndef AUTH_BENCH_TLS_PORT
+#define AUTH_BENCH_TLS_PORT 4443
+#endif
+
+// a bare ingest, a normal one, 4 h offline as a sample block, 4 h offline as JSON
+static const size_t BODY_SIZES[] = { 64, 340, 1400, 4300 };
+static const int SIGN_ROUNDS = 200;
+static const int CONNECT_ROUNDS = 5;
+
+ConfigManager configManager;
+
+// "http://host:port/api" -> host, port
+static bool parseServer(const char* url, String& host, uint16_t& port) {
+  String text(url);
+  int start = text.indexOf("://");
+  if (start < 0) return false;
+  start += 3;
+  int end = text.indexOf('/', start);
+  String hostPort = text.substring(start, end < 0 ? text.length() : end);
+  int colon = hostPort.indexOf(':');
+  host = colon < 0 ? hostPort : hostPort.substring(0, colon);
+  port = colon < 0 ? 80 : hostPort.substring(colon + 1).toInt();
+  return host.length() > 0;
+}
+
+static void benchSigning() {
+  uint8_t key[NodeAuth::SECRET_SIZE];
+  esp_fill_random(key, sizeof(key));
+  size_t largest = BODY_SIZES[sizeof(BODY_SIZES) / sizeof(BODY_SIZES[0]) - 1];
+  uint8_t* body = (uint8_t*)malloc(largest);
+  if (!body) return;
+  esp_fill_random(body, largest);
+
+  Serial.printf("HMAC-SHA256 at %u MHz, %d rounds each\n", getCpuFrequencyMhz(), SIGN_ROUNDS);
+  for (size_t size : BODY_SIZES) {
+    uint8_t mac[32];
+    unsigned long start = micros();
+    for (int i = 0; i < SIGN_ROUNDS; i++) NodeAuth::hmacSha256(key, sizeof(key), body, size, mac);
+    Serial.printf("  %5u bytes  %7.1f us\n", (unsigned)size, (micros() - start) / (float)SIGN_ROUNDS);
+  }
+  free(body);
+}
+
+static void benchConnects(const String& host, uint16_t port) {
+  unsigned long tcpTotal = 0, tlsTotal = 0;
+  int tcpCount = 0, tlsCount = 0;
+  uint32_t tlsHeap = 0;
+
+  for (int i = 0; i < CONNECT_ROUNDS; i++) {
+    WiFiClient client;
+    unsigned long start = millis();
+    if (client.connect(host.c_str(), port)) {
+      tcpTotal += millis() - start;
+      tcpCount++;
+    }
+    client.stop();
+
+    WiFiClientSecure tls;
+    tls.setInsecure();
+    uint32_t heapBefore = ESP.getFreeHeap();
+    start = millis();
+    if (tls.connect(host.c_str(), AUTH_BENCH_TLS_PORT)) {
+      tlsTotal += millis() - start;
+      tlsCount++;
+      tlsHeap = max(tlsHeap, heapBefore - ESP.getFreeHeap());
+    }
+    tls.stop();
+    delay(200);
+  }
+
+  Serial.printf("connects to %s, %d rounds\n", host.c_str(), CONNECT_ROUNDS);
+  if (tcpCount) Serial.printf("  TCP :%u        %6lu ms\n", port, tcpTotal / tcpCount);
+  else Serial.printf("  TCP :%u        failed\n", port);
+  if (tlsCount) Serial.printf("  TLS :%u        %6lu ms (TCP included), %u bytes heap while connected\n", AUTH_BENCH_TLS_PORT, tlsTotal / tlsCount, tlsHeap);
+  else Serial.printf("  TLS :%u        failed, is something listening with TLS there?\n", AUTH_BENCH_TLS_PORT);
+}
+
+void setup() {
+  Serial.begin(115200);
+  delay(2000); // time to open the monitor
+  configManager.begin();
+  configManager.loadConfig();
+  const DeviceConfig& config = configManager.getConfig();
+
+  benchSigning();
+
+  String host;
+  uint16_t port;
+  if (!config.configured || !parseServer(config.serverUrl, host, port)) {
+    Serial.println("No config in NVS, set the node up with the firmware first.");
+    return;
+  }
+  WiFi.mode(WIFI_STA);
+  WiFi.begin(config.wifiSSID, config.wifiPassword);
+  unsigned long start = millis();
+  while (WiFi.status() != WL_CONNECTED && millis() - start < 15000) delay(100);
+  if (WiFi.status() != WL_CONNECTED) {
+    Serial.println("WiFi didn't come up.");
+    return;
+  }
+  benchConnects(host, port);
+  WiFi.disconnect(true);
+}
+
+void loop() {
+  delay(1000);
+}
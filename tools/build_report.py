@@ -0,0 +1,95 @@
+#!/usr/bin/env python3
+"""
+Compares firmware builds: image size, static RAM and, with a node plugged
+in, how long it takes to get to loop() and how much heap is left then.
+
+    python tools/build_report.py                        # the normal and the headless env
+    python tools/build_report.py --port /dev/ttyACM0    # also flash each one and boot it
+    python tools/build_report.py -e seeed_xiao_esp32c3 -e my_other_env
+
+Sizes come from PlatformIO's own "RAM:" / "Flash:" summary (static RAM is
+.data + .bss, flash is the whole image) and the size of firmware.bin. The
+boot numbers are what the firmware prints at the end of setup(): millis()
+since the app started, so without the ROM and bootloader, and the free heap.
+The node is reset through the USB port and booted 3 times.
+
+Needs pio on the PATH, and pyserial for --port.
+"""
+import argparse
+import os
+import re
+import subprocess
+import sys
+import time
+
+DEFAULT_ENVS = ["seeed_xiao_esp32c3", "seeed_xiao_esp32c3_headless"]
+SUMMARY = re.compile(r"^(RAM|Flash):.*\(used (\d+) bytes from (\d+) bytes\)", re.M)
+BOOT_LINE = re.compile(r"setup\(\) done after (\d+) ms, (\d+) bytes heap free")
+BOOTS = 3
+
+
+def build(env, upload_port=None):
+    """Returns {"RAM": used, "Flash": used, "bin": bytes}."""
+    command = ["pio", "run", "-e", env]
+    if upload_port:
+        command += ["-t", "upload", "--upload-port", upload_port]
+    result = subprocess.run(command, capture_output=True, text=True)
+    if result.returncode != 0:
+        sys.stdout.write(result.stdout[-3000:] + result.stderr[-3000:])
+        sys.exit("build of %s failed" % env)
+    sizes = {name: int(used) for name, used, _ in SUMMARY.findall(result.stdout)}
+    binary = os.path.join(".pio", "build", env, "firmware.bin")
+    sizes["bin"] = os.path.getsize(binary) if os.path.exists(binary) else None
+    return sizes
+
+
+def time_boots(port_name):
+    """Resets the node BOOTS times, returns [(ms to loop(), free heap)]."""
+    import serial
+
+    boots = []
+    with serial.Serial(port_name, 115200, timeout=0.2) as port:
+        for _ in range(BOOTS):
+            # same reset as tools/provision.py
+            port.dtr = False
+            port.rts = True
+            time.sleep(0.1)
+            port.rts = False
+            deadline = time.monotonic() + 15
+            while time.monotonic() < deadline:
+                match = BOOT_LINE.search(port.readline().decode("utf-8", "replace"))
+                if match:
+                    boots.append((int(match.group(1)), int(match.group(2))))
+                    break
+            else:
+                print("  no boot line from %s" % port_name)
+    return boots
+
+
+def kib(value):
+    return "-" if value is None else "%.1f KiB" % (value / 1024.0)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Compare image size, RAM and boot time of firmware builds.")
+    parser.add_argument("-e", "--env", action="append", help="PlatformIO env, can be repeated (default: %s)" % ", ".join(DEFAULT_ENVS))
+    parser.add_argument("--port", help="flash and boot each build on the node at this port")
+    args = parser.parse_args()
+
+    rows = []
+    for env in args.env or DEFAULT_ENVS:
+        print("building %s..." % env)
+        sizes = build(env, args.port)
+        boots = time_boots(args.port) if args.port else []
+        rows.append((env, sizes, boots))
+
+    print()
+    print("%-30s %12s %12s %12s %14s %14s" % ("env", "firmware.bin", "flash used", "static RAM", "boot to loop", "heap free"))
+    for env, sizes, boots in rows:
+        boot = "%d ms" % min(b[0] for b in boots) if boots else "-"
+        heap = kib(boots[-1][1]) if boots else "-"
+        print("%-30s %12s %12s %12s %14s %14s" % (env, kib(sizes.get("bin")), kib(sizes.get("Flash")), kib(sizes.get("RAM")), boot, heap))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,128 @@
+#!/usr/bin/env python3
+"""
+Reference verifier for signed ingest (nodes built with SIGNED_INGEST=1, see
+include/NodeAuth.h). tools/standin_server.py uses it; a real backend has to
+do the same checks in the same order.
+
+Registration with "auth": "HMAC-SHA256" in the body gets the node a secret:
+
+    {"id": "...", "secret": "<64 hex digits>"}
+
+Every /ingest then has
+
+    Authorization: HMAC-SHA256 <deviceId>:<HMAC-SHA256 of the body, hex>
+
+and a "counter" in the body (in the JSON header for binary ingest) that has
+to be bigger than the last one accepted from that device. The signature
+covers the exact body bytes, so it doesn't matter how they got here.
+
+    1. look up the secret by the deviceId in the header   -> 401 if unknown
+    2. compare the HMAC, in constant time                  -> 401 if wrong
+    3. only now parse the body, and check the counter     -> 409 if not bigger
+
+A 409 carries "lastCounter" so a node whose counter went back (NVS restored
+from an old image) can skip past it. After a few 401s in a row the node
+re-keys: it registers again with its "deviceId" and a "counter" in the body,
+signed with the old secret like an ingest. Check it the same way (steps 1 to
+3, with a 401 if the signature isn't from that deviceId) and answer with the
+same id and a new secret. A node whose re-key gets a 401 registers as a new
+device.
+Keep the last counters somewhere that survives a restart, or an old body
+can be replayed once after every restart. This one only keeps them in memory
+(and so do the secrets, nodes re-register after a restart).
+
+It also works as a command line check of a captured body:
+
+    python tools/ingest_auth.py sign <secret> body.bin
+    python tools/ingest_auth.py verify <secret> body.bin <tag>
+"""
+import hashlib
+import hmac
+import secrets
+import sys
+import threading
+
+SCHEME = "HMAC-SHA256"
+SECRET_SIZE = 32
+
+
+class AuthError(Exception):
+    def __init__(self, code, message, **extra):
+        super().__init__(message)
+        self.code = code
+        self.body = dict(extra, error=message)
+
+
+def sign(secret, body):
+    return hmac.new(secret, body, hashlib.sha256).hexdigest()
+
+
+def parse_authorization(value):
+    """Returns (device_id, tag), or raises AuthError."""
+    scheme, _, credentials = (value or "").partition(" ")
+    device_id, _, tag = credentials.partition(":")
+    if scheme != SCHEME or not device_id or len(tag) != 64:
+        raise AuthError(401, "missing or malformed signature")
+    return device_id, tag.lower()
+
+
+class Verifier:
+    def __init__(self):
+        self.lock = threading.Lock()
+        self.secrets = {}       # deviceId -> bytes
+        self.last_counter = {}  # deviceId -> int
+
+    def provision(self, device_id):
+        """New secret for a device that just registered, as hex for the response."""
+        secret = secrets.token_bytes(SECRET_SIZE)
+        with self.lock:
+            self.secrets[device_id] = secret
+            self.last_counter[device_id] = 0
+        return secret.hex()
+
+    def is_signed(self, device_id):
+        with self.lock:
+            return device_id in self.secrets
+
+    def check_signature(self, authorization, body):
+        """Steps 1 and 2, before the body is parsed. Returns the deviceId."""
+        device_id, tag = parse_authorization(authorization)
+        with self.lock:
+            secret = self.secrets.get(device_id)
+        if secret is None:
+            raise AuthError(401, "unknown device")
+        if not hmac.compare_digest(sign(secret, body), tag):
+            raise AuthError(401, "bad signature")
+        return device_id
+
+    def accept_counter(self, device_id, doc):
+        """Step 3, on the parsed (and now trusted) body."""
+        counter = doc.get("counter")
+        if doc.get("deviceId") != device_id:
+            raise AuthError(401, "deviceId doesn't match the signature")
+        if not isinstance(counter, int) or counter <= 0:
+            raise AuthError(400, "missing counter")
+        with self.lock:
+            last = self.last_counter.get(device_id, 0)
+            if counter <= last:
+                raise AuthError(409, "replayed counter", lastCounter=last)
+            self.last_counter[device_id] = counter
+
+
+def main():
+    if len(sys.argv) < 4 or sys.argv[1] not in ("sign", "verify"):
+        sys.exit(__doc__)
+    secret = bytes.fromhex(sys.argv[2])
+    with open(sys.argv[3], "rb") as f:
+        body = f.read()
+    tag = sign(secret, body)
+    if sys.argv[1] == "sign":
+        print(tag)
+    elif len(sys.argv) > 4 and hmac.compare_digest(tag, sys.argv[4].lower()):
+        print("ok")
+    else:
+        sys.exit("bad signature")
+
+
+if __name__ == "__main__":
+    main()
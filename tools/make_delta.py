@@ -0,0 +1,179 @@
+#!/usr/bin/env python3
+"""
+Builds a compressed delta patch between two firmware images for OTA.
+
+    python tools/make_delta.py old.bin new.bin out.ndp
+
+old.bin must be exactly the image running on the nodes (keep the
+.pio/build/<env>/firmware.bin of every release). The output is the patch
+format described in include/DeltaPatch.h, zlib compressed, which is what
+OtaManager downloads and applies. The sizes and the sha256 the server has to
+advertise are printed at the end.
+"""
+import argparse
+import hashlib
+import struct
+import sys
+import time
+import zlib
+
+OP_END, OP_COPY, OP_DATA, OP_ADD = 0, 1, 2, 3
+
+BLOCK = 16        # bytes hashed per index entry
+INDEX_STEP = 2    # RISC-V code is 2 byte aligned
+MIN_MATCH = 24    # shorter matches aren't worth an op
+MISMATCH_WINDOW = 16
+MAX_MISMATCHES = 8
+
+
+def image_sha256(image):
+    """What esp_partition_get_sha256() reports for an app image.
+
+    If the image has its sha256 appended (byte 23 of the header) the
+    bootloader just returns that, otherwise it hashes the whole image.
+    """
+    if len(image) > 56 and image[0] == 0xE9 and image[23] == 1:
+        return image[-32:]
+    return hashlib.sha256(image).digest()
+
+
+def build_index(old):
+    index = {}
+    for i in range(0, len(old) - BLOCK + 1, INDEX_STEP):
+        index.setdefault(old[i:i + BLOCK], i)
+    return index
+
+
+def extend_match(old, new, o, n):
+    """Extends a seed match forward, allowing scattered mismatches (for ADD).
+
+    Returns (length, exact) where exact means no byte differed.
+    """
+    length = 0
+    last_good = 0
+    recent = []
+    while o + length < len(old) and n + length < len(new):
+        same = old[o + length] == new[n + length]
+        recent.append(same)
+        if len(recent) > MISMATCH_WINDOW:
+            recent.pop(0)
+        if recent.count(False) > MAX_MISMATCHES:
+            break
+        length += 1
+        if same:
+            last_good = length
+    length = last_good
+    exact = old[o:o + length] == new[n:n + length]
+    return length, exact
+
+
+def diff(old, new):
+    index = build_index(old)
+    ops = []
+    literal_start = 0
+    i = 0
+    while i <= len(new) - BLOCK:
+        o = index.get(new[i:i + BLOCK])
+        if o is None:
+            i += 1
+            continue
+        length, exact = extend_match(old, new, o, i)
+        if length < MIN_MATCH:
+            i += 1
+            continue
+        if literal_start < i:
+            ops.append((OP_DATA, new[literal_start:i]))
+        if exact:
+            ops.append((OP_COPY, o, length))
+        else:
+            delta = bytes((new[i + k] - old[o + k]) & 0xFF for k in range(length))
+            ops.append((OP_ADD, o, delta))
+        i += length
+        literal_start = i
+    if literal_start < len(new):
+        ops.append((OP_DATA, new[literal_start:]))
+    return ops
+
+
+def encode(ops, new_size, base_sha):
+    out = bytearray(b"NDP1")
+    out += struct.pack("<I", new_size)
+    out += base_sha
+    for op in ops:
+        if op[0] == OP_COPY:
+            out += struct.pack("<BII", OP_COPY, op[1], op[2])
+        elif op[0] == OP_DATA:
+            out += struct.pack("<BI", OP_DATA, len(op[1])) + op[1]
+        else:
+            out += struct.pack("<BII", OP_ADD, op[1], len(op[2])) + op[2]
+    out.append(OP_END)
+    return bytes(out)
+
+
+def apply(old, raw_patch):
+    """Reference implementation of DeltaPatcher, used to check our own output."""
+    assert raw_patch[:4] == b"NDP1"
+    size = struct.unpack_from("<I", raw_patch, 4)[0]
+    pos = 40
+    out = bytearray()
+    while True:
+        op = raw_patch[pos]
+        pos += 1
+        if op == OP_END:
+            break
+        if op == OP_COPY:
+            o, n = struct.unpack_from("<II", raw_patch, pos)
+            pos += 8
+            out += old[o:o + n]
+        elif op == OP_DATA:
+            n = struct.unpack_from("<I", raw_patch, pos)[0]
+            pos += 4
+            out += raw_patch[pos:pos + n]
+            pos += n
+        elif op == OP_ADD:
+            o, n = struct.unpack_from("<II", raw_patch, pos)
+            pos += 8
+            out += bytes((old[o + k] + raw_patch[pos + k]) & 0xFF for k in range(n))
+            pos += n
+        else:
+            raise ValueError("bad opcode %d" % op)
+    assert len(out) == size
+    return bytes(out)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Make a delta OTA patch.")
+    parser.add_argument("old")
+    parser.add_argument("new")
+    parser.add_argument("out")
+    args = parser.parse_args()
+
+    with open(args.old, "rb") as f:
+        old = f.read()
+    with open(args.new, "rb") as f:
+        new = f.read()
+
+    started = time.monotonic()
+    ops = diff(old, new)
+    raw = encode(ops, len(new), image_sha256(old))
+    patch = zlib.compress(raw, 9)
+
+    if apply(old, zlib.decompress(patch)) != new:
+        sys.exit("internal error: patch does not reproduce the new image")
+
+    with open(args.out, "wb") as f:
+        f.write(patch)
+
+    copies = sum(1 for op in ops if op[0] == OP_COPY)
+    adds = sum(1 for op in ops if op[0] == OP_ADD)
+    literals = sum(len(op[1]) for op in ops if op[0] == OP_DATA)
+    print("new image:       %8d bytes" % len(new))
+    print("full image gz:   %8d bytes" % len(zlib.compress(new, 9)))
+    print("patch:           %8d bytes (%.1f%% of the image)" % (len(patch), 100.0 * len(patch) / len(new)))
+    print("ops:             %d copy, %d add, %d literal bytes" % (copies, adds, literals))
+    print("diff time:       %.1f s" % (time.monotonic() - started))
+    print("advertise:       size=%d sha256=%s" % (len(new), hashlib.sha256(new).hexdigest()))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,172 @@
+#!/usr/bin/env python3
+"""
+Bulk provisioning for IoT nodes over USB serial.
+
+Sends one config to every node plugged into this machine, all ports at the
+same time, and prints a CSV line per node (port, mac, result, deviceId).
+The protocol is described in include/SerialProvisioner.h.
+
+    pip install pyserial
+    python tools/provision.py --config site.json --register /dev/ttyACM*
+
+site.json holds the same fields as the portal form:
+
+    {"ssid": "warehouse", "pass": "secret", "server": "http://10.0.0.5:4000/api",
+     "type": "Temp/Humidity", "location": "Bay 4", "interval": 300}
+
+Optional: "txPowerMin" / "txPowerMax" bound the WiFi TX power in whole dBm,
+and "fallbackServers" lists up to two more URLs of the same backend, tried
+when "server" doesn't answer. "alarms" sets thresholds that upload right
+away when crossed, any of
+{"temperatureHigh": 30, "temperatureLow": 5, "humidityHigh": 80, "humidityLow": 20}
+in C and %RH.
+
+Leave "name" out and every node names itself node-<mac>. A CSV with
+mac,name,location columns (--names) gives each node its own name instead.
+
+The node only listens right after a cold boot, so either plug them in after
+starting the tool or pass --reset to reboot them through the USB port.
+"""
+import argparse
+import concurrent.futures
+import csv
+import glob
+import json
+import sys
+import time
+import zlib
+
+try:
+    import serial
+except ImportError:
+    sys.exit("pyserial is required: pip install pyserial")
+
+
+def build_frame(config):
+    payload = json.dumps(config, separators=(",", ":")).encode("utf-8")
+    return b"@PROV %08x " % zlib.crc32(payload) + payload + b"\n"
+
+
+def reset_node(port):
+    # same sequence esptool uses for a plain reset on the C3's USB-JTAG-serial
+    port.dtr = False
+    port.rts = True
+    time.sleep(0.1)
+    port.rts = False
+
+
+def read_line(port, deadline):
+    while time.monotonic() < deadline:
+        line = port.readline()
+        if line:
+            return line.decode("utf-8", "replace").strip()
+    return None
+
+
+def provision(port_name, config, names, do_reset, timeout):
+    """Returns (port, mac, result, deviceId)."""
+    mac = "-"
+    try:
+        with serial.Serial(port_name, 115200, timeout=0.2, dsrdtr=False, rtscts=False) as port:
+            if do_reset:
+                reset_node(port)
+
+            # wait for the node to open its window
+            deadline = time.monotonic() + timeout
+            while True:
+                line = read_line(port, deadline)
+                if line is None:
+                    return port_name, mac, "no_hello", ""
+                if line.startswith("@HELLO "):
+                    parts = line.split()
+                    mac = parts[2] if len(parts) > 2 else "-"
+                    break
+
+            node_config = dict(config)
+            node_config.update(names.get(mac.upper(), {}))
+            frame = build_frame(node_config)
+
+            # one retry if the frame got mangled on the way
+            for _ in range(2):
+                port.write(frame)
+                port.flush()
+                reply = None
+                while True:
+                    line = read_line(port, time.monotonic() + 5)
+                    if line is None or line.startswith("@ACK") or line.startswith("@NAK"):
+                        reply = line
+                        break
+                if reply != "@NAK bad_crc":
+                    break
+
+            if reply is None:
+                return port_name, mac, "no_reply", ""
+            if reply.startswith("@NAK"):
+                return port_name, mac, reply[5:], ""
+            if not node_config.get("register"):
+                return port_name, mac, "saved", ""
+
+            # registration needs WiFi + a round trip to the server
+            deadline = time.monotonic() + 30
+            while True:
+                line = read_line(port, deadline)
+                if line is None:
+                    return port_name, mac, "saved_no_register_reply", ""
+                if line.startswith("@REG "):
+                    return port_name, mac, "registered", line[5:]
+                if line.startswith("@NAK"):
+                    return port_name, mac, "saved_" + line[5:], ""
+    except serial.SerialException as e:
+        return port_name, mac, "serial_error: %s" % e, ""
+
+
+def load_names(path):
+    names = {}
+    if not path:
+        return names
+    with open(path, newline="") as f:
+        for row in csv.DictReader(f):
+            entry = {k: v for k, v in row.items() if k != "mac" and v}
+            names[row["mac"].upper()] = entry
+    return names
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Provision IoT nodes over USB serial.")
+    parser.add_argument("ports", nargs="*", help="serial ports (default: every /dev/ttyACM*)")
+    parser.add_argument("--config", required=True, help="JSON file with the shared config")
+    parser.add_argument("--names", help="CSV with mac,name[,location] per node")
+    parser.add_argument("--register", action="store_true", help="register each node and report its deviceId")
+    parser.add_argument("--reset", action="store_true", help="reboot each node through the USB port first")
+    parser.add_argument("--timeout", type=float, default=30, help="seconds to wait for a node to boot")
+    args = parser.parse_args()
+
+    with open(args.config) as f:
+        config = json.load(f)
+    if args.register:
+        config["register"] = True
+    names = load_names(args.names)
+
+    ports = args.ports or sorted(glob.glob("/dev/ttyACM*"))
+    if not ports:
+        sys.exit("no serial ports found")
+
+    writer = csv.writer(sys.stdout)
+    writer.writerow(["port", "mac", "result", "deviceId"])
+    started = time.monotonic()
+    ok = 0
+    with concurrent.futures.ThreadPoolExecutor(max_workers=len(ports)) as pool:
+        jobs = [pool.submit(provision, p, config, names, args.reset, args.timeout) for p in ports]
+        for job in concurrent.futures.as_completed(jobs):
+            row = job.result()
+            writer.writerow(row)
+            sys.stdout.flush()
+            if row[2] in ("saved", "registered"):
+                ok += 1
+
+    print("%d/%d nodes provisioned in %.1f s" % (ok, len(ports), time.monotonic() - started), file=sys.stderr)
+    sys.exit(0 if ok == len(ports) else 1)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,183 @@
+#!/usr/bin/env python3
+"""
+Decoder for the packed sample blocks the nodes send to /ingest when they are
+built with BINARY_INGEST=1. The block format is described in
+include/SampleCodec.h, this is the same decoder as src/SampleCodec.cpp.
+
+As a library, for the server:
+
+    from sample_codec import CONTENT_TYPE, decode_ingest
+    if request.content_type == CONTENT_TYPE:
+        doc = decode_ingest(body)   # same shape as the JSON ingest
+
+decode_ingest() turns the binary body into the document a JSON node would
+have sent: the newest reading becomes "metrics", the others "backlog".
+
+On the command line it checks blocks made by tools/sample_codec_fuzz.cpp,
+one "<hex block> <json list of [rawSeconds, temperatureCenti, humidityCenti]>"
+per line:
+
+    ./sample_codec_fuzz --dump 1000 > blocks.txt
+    python tools/sample_codec.py --check blocks.txt
+"""
+import argparse
+import json
+import struct
+import sys
+
+CONTENT_TYPE = "application/x-iot-samples"
+
+# bits after the 10, 110 and 1110 prefixes, 1111 is followed by the raw value
+TIME_BUCKET_BITS = (7, 9, 12)
+VALUE_BUCKET_BITS = (4, 7, 10)
+
+
+class DecodeError(ValueError):
+    pass
+
+
+class BitReader:
+    def __init__(self, data):
+        self.data = data
+        self.pos = 0  # in bits
+
+    def read(self, bits):
+        end = self.pos + bits
+        if end > len(self.data) * 8:
+            raise DecodeError("block is truncated")
+        value = 0
+        while self.pos < end:
+            byte = self.data[self.pos // 8]
+            value = (value << 1) | ((byte >> (7 - self.pos % 8)) & 1)
+            self.pos += 1
+        return value
+
+    def at_clean_end(self):
+        # only 0 bits of padding left
+        rest = len(self.data) * 8 - self.pos
+        return rest < 8 and (rest == 0 or self.read(rest) == 0)
+
+
+def read_bucketed(reader, widths, raw_bits):
+    """Returns (value, escaped). escaped means value is the raw value."""
+    ones = 0
+    while ones < 4 and reader.read(1):
+        ones += 1
+    if ones == 0:
+        return 0, False
+    if ones == 4:
+        return reader.read(raw_bits), True
+    bits = widths[ones - 1]
+    value = reader.read(bits)
+    if value >> (bits - 1):
+        value -= 1 << bits
+    return value, False
+
+
+def int16(value):
+    value &= 0xFFFF
+    return value - 0x10000 if value & 0x8000 else value
+
+
+def decode_samples(block):
+    """Decodes a sample block into a list of (rawSeconds, temperatureCenti, humidityCenti)."""
+    reader = BitReader(block)
+    count = reader.read(8)
+    samples = []
+    if count > 0:
+        samples.append((reader.read(32), int16(reader.read(16)), reader.read(16)))
+    previous_delta = 0
+    for _ in range(1, count):
+        raw_seconds, temperature, humidity = samples[-1]
+
+        value, escaped = read_bucketed(reader, TIME_BUCKET_BITS, 32)
+        t = value if escaped else (raw_seconds + previous_delta + value) & 0xFFFFFFFF
+        previous_delta = t - raw_seconds
+
+        value, escaped = read_bucketed(reader, VALUE_BUCKET_BITS, 16)
+        temperature = int16(value if escaped else temperature + value)
+
+        value, escaped = read_bucketed(reader, VALUE_BUCKET_BITS, 16)
+        humidity = (value if escaped else humidity + value) & 0xFFFF
+
+        samples.append((t, temperature, humidity))
+    if not reader.at_clean_end():
+        raise DecodeError("junk after the last sample")
+    return samples
+
+
+def decode_ingest(body):
+    """Turns a binary ingest body into the JSON ingest document.
+
+    The body is a u16 little endian header length, the JSON header (deviceId,
+    fwVersion, metrics.battery_pct, timestampMs, connectivity, rawNowS) and
+    a sample block with the current reading last.
+    """
+    if len(body) < 2:
+        raise DecodeError("body too short")
+    header_length = struct.unpack_from("<H", body)[0]
+    if 2 + header_length > len(body):
+        raise DecodeError("header is truncated")
+    try:
+        doc = json.loads(body[2:2 + header_length])
+    except ValueError:
+        raise DecodeError("header is not JSON")
+    samples = decode_samples(body[2 + header_length:])
+    if not samples:
+        raise DecodeError("no readings")
+
+    raw_now = doc.pop("rawNowS", 0)
+    timestamp_ms = doc.get("timestampMs")
+
+    def reading(sample):
+        return {"temperature_c": sample[1] / 100.0, "humidity_pct": sample[2] / 100.0}
+
+    doc.setdefault("metrics", {}).update(reading(samples[-1]))
+    backlog = []
+    for sample in samples[:-1]:
+        entry = {"ageS": max(0, raw_now - sample[0])}
+        if timestamp_ms is not None:
+            entry["timestampMs"] = timestamp_ms - entry["ageS"] * 1000
+        entry.update(reading(sample))
+        backlog.append(entry)
+    if backlog:
+        doc["backlog"] = backlog
+    return doc
+
+
+def check(path):
+    """Decodes every block in a --dump file from sample_codec_fuzz and compares."""
+    good = bad = 0
+    with open(path) as f:
+        for number, line in enumerate(f, 1):
+            block_hex, expected = line.split(" ", 1)
+            expected = [tuple(s) for s in json.loads(expected)]
+            try:
+                decoded = decode_samples(bytes.fromhex(block_hex))
+            except DecodeError as e:
+                decoded = "error: %s" % e
+            if decoded == expected:
+                good += 1
+            else:
+                bad += 1
+                print("line %d: expected %s, got %s" % (number, expected, decoded))
+    print("%d blocks decoded, %d mismatches" % (good + bad, bad))
+    return bad == 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Decode packed sample blocks.")
+    parser.add_argument("--check", metavar="FILE", help="compare against a sample_codec_fuzz --dump file")
+    parser.add_argument("body", nargs="?", help="a binary ingest body to print as JSON")
+    args = parser.parse_args()
+
+    if args.check:
+        sys.exit(0 if check(args.check) else 1)
+    if not args.body:
+        parser.error("give a body file or --check")
+    with open(args.body, "rb") as f:
+        print(json.dumps(decode_ingest(f.read()), indent=2))
+
+
+if __name__ == "__main__":
+    main()
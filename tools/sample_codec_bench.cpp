@@ -0,0 +1,115 @@
+// Compares the packed sample blocks (src/SampleCodec.cpp, the same code the
+// firmware runs) with the JSON the node sends otherwise: bytes per reading
+// and time to encode, for uploads with 1 to 49 readings of a synthetic but
+// realistic indoor series (5 minute interval with wake slot jitter, a daily
+// temperature swing plus sensor noise).
+//
+//    g++ -O2 -Iinclude tools/sample_codec_bench.cpp src/SampleCodec.cpp src/SampleBuffer.cpp -o sample_codec_bench
+//    ./sample_codec_bench [interval s]
+//
+// Times are for this PC. On the node, ApiHandler prints how long the block
+// took ("Packed N readings into B bytes in T us").
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <string>
+#include <chrono>
+#include <random>
+#include <vector>
+#include "SampleCodec.h"
+
+// what ApiHandler puts in the request besides the readings
+static const char* JSON_HEAD = "{\"deviceId\":\"clxja8xkq000008l5g1j2h3k4\",\"metrics\":{\"temperature_c\":%.2f,\"humidity_pct\":%.2f,\"battery_pct\":95},"
+                               "\"fwVersion\":\"1.0.0\",\"timestampMs\":1763497800123,\"timestampUncertaintyMs\":850";
+static const char* BINARY_HEADER = "{\"deviceId\":\"clxja8xkq000008l5g1j2h3k4\",\"metrics\":{\"battery_pct\":95},"
+                                   "\"fwVersion\":\"1.0.0\",\"timestampMs\":1763497800123,\"timestampUncertaintyMs\":850,\"rawNowS\":%u}";
+
+static std::vector<Sample> makeSeries(size_t count, uint32_t interval, std::mt19937& rng) {
+  std::normal_distribution<double> noise(0, 0.03);
+  std::uniform_int_distribution<int> jitter(-2, 2);
+  std::vector<Sample> samples;
+  uint32_t t = 86400 + rng() % 86400;
+  double humidityDrift = 0;
+  for (size_t i = 0; i < count; i++) {
+    double hour = fmod(t / 3600.0, 24);
+    double temperature = 21.5 + 1.8 * sin((hour - 9) / 24 * 2 * M_PI) + noise(rng);
+    humidityDrift += noise(rng) * 2;
+    double humidity = 48 - 4 * sin((hour - 9) / 24 * 2 * M_PI) + humidityDrift;
+    samples.push_back(SampleBuffer::makeSample(t, (float)temperature, (float)humidity));
+    t += interval + jitter(rng);
+  }
+  return samples;
+}
+
+// the JSON path: current reading in metrics, the rest as backlog entries
+static std::string jsonBody(const std::vector<Sample>& samples) {
+  char buffer[256];
+  const Sample& current = samples.back();
+  snprintf(buffer, sizeof(buffer), JSON_HEAD, SampleBuffer::temperature(current), SampleBuffer::humidity(current));
+  std::string body = buffer;
+  if (samples.size() > 1) {
+    body += ",\"backlog\":[";
+    for (size_t i = 0; i + 1 < samples.size(); i++) {
+      uint32_t age = current.rawSeconds - samples[i].rawSeconds;
+      snprintf(buffer, sizeof(buffer), "%s{\"ageS\":%u,\"timestampMs\":%llu,\"temperature_c\":%.2f,\"humidity_pct\":%.2f}",
+               i ? "," : "", age, 1763497800123ull - age * 1000ull, SampleBuffer::temperature(samples[i]), SampleBuffer::humidity(samples[i]));
+      body += buffer;
+    }
+    body += "]";
+  }
+  return body + "}";
+}
+
+template <typename F>
+static double nanosecondsPerCall(F f) {
+  const int rounds = 20000;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < rounds; i++) f();
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(end - start).count() / rounds;
+}
+
+int main(int argc, char** argv) {
+  uint32_t interval = argc > 1 ? atoi(argv[1]) : 300;
+  std::mt19937 rng(1);
+
+  printf("%u s interval, %zu byte samples in RTC memory\n\n", interval, sizeof(Sample));
+  printf("%-9s %-23s %-23s %-19s %s\n", "readings", "sample block", "whole request", "encode (this PC)", "decode");
+  printf("%-9s %7s %15s %7s %7s %7s %9s %9s %9s\n", "", "bytes", "B/reading", "JSON", "binary", "ratio", "block ns", "JSON ns", "block ns");
+
+  const size_t counts[] = { 1, 2, 4, 12, 24, 49 };
+  std::vector<uint8_t> block(sampleBlockMaxSize(SAMPLE_BLOCK_MAX_SAMPLES));
+  std::vector<Sample> decoded(SAMPLE_BLOCK_MAX_SAMPLES);
+  for (size_t count : counts) {
+    // average over a few series, the bit count depends on the data
+    const int series = 50;
+    double blockBytes = 0, jsonBytes = 0, binaryBytes = 0, encodeNs = 0, jsonNs = 0, decodeNs = 0;
+    for (int s = 0; s < series; s++) {
+      std::vector<Sample> samples = makeSeries(count, interval, rng);
+      size_t length = encodeSamples(samples.data(), count, block.data(), block.size());
+      if (decodeSamples(block.data(), length, decoded.data(), decoded.size()) != (int)count) {
+        printf("round trip failed, run sample_codec_fuzz\n");
+        return 1;
+      }
+      char header[256];
+      size_t headerLength = snprintf(header, sizeof(header), BINARY_HEADER, samples.back().rawSeconds);
+
+      blockBytes += length;
+      jsonBytes += jsonBody(samples).size();
+      binaryBytes += 2 + headerLength + length;
+      if (s < 5) {
+        encodeNs += nanosecondsPerCall([&] { encodeSamples(samples.data(), count, block.data(), block.size()); }) / 5;
+        jsonNs += nanosecondsPerCall([&] { volatile size_t n = jsonBody(samples).size(); (void)n; }) / 5;
+        decodeNs += nanosecondsPerCall([&] { decodeSamples(block.data(), length, decoded.data(), decoded.size()); }) / 5;
+      }
+    }
+    blockBytes /= series;
+    jsonBytes /= series;
+    binaryBytes /= series;
+    printf("%-9zu %7.1f %15.2f %7.0f %7.0f %6.1fx %9.0f %9.0f %9.0f\n", count, blockBytes, blockBytes / count,
+           jsonBytes, binaryBytes, jsonBytes / binaryBytes, encodeNs, jsonNs, decodeNs);
+  }
+  printf("\nJSON ns is snprintf building the same text, not ArduinoJson.\n");
+  return 0;
+}
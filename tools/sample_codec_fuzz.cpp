@@ -0,0 +1,158 @@
+// Round-trip fuzzing for src/SampleCodec.cpp: random series, including the
+// nasty ones (clock jumps, wrap around, full range values), must decode to
+// exactly what went in, truncated blocks must be rejected, and random bytes
+// must never crash the decoder or make it write past its buffer.
+//
+//    g++ -O1 -g -fsanitize=address,undefined -Iinclude tools/sample_codec_fuzz.cpp src/SampleCodec.cpp src/SampleBuffer.cpp -o sample_codec_fuzz
+//    ./sample_codec_fuzz [iterations] [seed]
+//
+// --dump N prints N blocks with their samples instead, for checking the
+// server's decoder: ./sample_codec_fuzz --dump 1000 > blocks.txt && python tools/sample_codec.py --check blocks.txt
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <random>
+#include <vector>
+#include "SampleCodec.h"
+
+static std::mt19937 rng;
+
+static uint32_t randomBetween(uint32_t low, uint32_t high) {
+  return std::uniform_int_distribution<uint32_t>(low, high)(rng);
+}
+
+// a series of one of several shapes, some friendly and some not
+static std::vector<Sample> randomSeries() {
+  size_t count = randomBetween(0, 8) == 0 ? randomBetween(0, 2) : randomBetween(1, SAMPLE_BLOCK_MAX_SAMPLES);
+  uint32_t shape = randomBetween(0, 4);
+  std::vector<Sample> samples(count);
+
+  uint32_t t = randomBetween(0, 1) ? randomBetween(0, 100000) : UINT32_MAX - randomBetween(0, 100000);
+  uint32_t interval = randomBetween(1, 4000);
+  int32_t temperature = (int32_t)randomBetween(0, 65535) - 32768;
+  int32_t humidity = randomBetween(0, 65535);
+
+  for (Sample& sample : samples) {
+    switch (shape) {
+      case 0: // like a real node: regular-ish interval, values drifting slowly
+        t += interval + randomBetween(0, 4) - 2;
+        temperature += (int32_t)randomBetween(0, 20) - 10;
+        humidity += (int32_t)randomBetween(0, 40) - 20;
+        break;
+      case 1: // bigger steps, hits every bucket
+        t += randomBetween(0, 1) ? interval : randomBetween(0, 5000);
+        temperature += (int32_t)randomBetween(0, 2000) - 1000;
+        humidity += (int32_t)randomBetween(0, 2000) - 1000;
+        break;
+      case 2: // anything at all
+        t = rng();
+        temperature = (int32_t)randomBetween(0, 65535) - 32768;
+        humidity = randomBetween(0, 65535);
+        break;
+      case 3: // extremes, alternating
+        t = randomBetween(0, 1) ? 0 : UINT32_MAX;
+        temperature = randomBetween(0, 1) ? INT16_MIN : INT16_MAX;
+        humidity = randomBetween(0, 1) ? 0 : UINT16_MAX;
+        break;
+      default: // nothing changes
+        break;
+    }
+    sample.rawSeconds = t;
+    sample.temperatureCenti = (int16_t)temperature;
+    sample.humidityCenti = (uint16_t)humidity;
+  }
+  return samples;
+}
+
+static bool sameSamples(const Sample* a, const Sample* b, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    if (a[i].rawSeconds != b[i].rawSeconds || a[i].temperatureCenti != b[i].temperatureCenti || a[i].humidityCenti != b[i].humidityCenti) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static void dump(int blocks) {
+  std::vector<uint8_t> block(sampleBlockMaxSize(SAMPLE_BLOCK_MAX_SAMPLES));
+  for (int i = 0; i < blocks; i++) {
+    std::vector<Sample> samples = randomSeries();
+    size_t length = encodeSamples(samples.data(), samples.size(), block.data(), block.size());
+    for (size_t j = 0; j < length; j++) printf("%02x", block[j]);
+    printf(" [");
+    for (size_t j = 0; j < samples.size(); j++) {
+      printf("%s[%u, %d, %u]", j ? ", " : "", samples[j].rawSeconds, samples[j].temperatureCenti, samples[j].humidityCenti);
+    }
+    printf("]\n");
+  }
+}
+
+int main(int argc, char** argv) {
+  if (argc >= 3 && strcmp(argv[1], "--dump") == 0) {
+    rng.seed(1);
+    dump(atoi(argv[2]));
+    return 0;
+  }
+  long iterations = argc > 1 ? atol(argv[1]) : 100000;
+  rng.seed(argc > 2 ? atoi(argv[2]) : 1);
+
+  const size_t maxBlock = sampleBlockMaxSize(SAMPLE_BLOCK_MAX_SAMPLES);
+  std::vector<uint8_t> block(maxBlock);
+  std::vector<Sample> decoded(SAMPLE_BLOCK_MAX_SAMPLES);
+  long failures = 0;
+  long garbageAccepted = 0;
+
+  for (long i = 0; i < iterations && failures < 10; i++) {
+    std::vector<Sample> samples = randomSeries();
+    size_t count = samples.size();
+
+    size_t length = encodeSamples(samples.data(), count, block.data(), block.size());
+    if (length == 0 || length > sampleBlockMaxSize(count)) {
+      printf("iteration %ld: encode of %zu samples gave %zu bytes\n", i, count, length);
+      failures++;
+      continue;
+    }
+
+    int got = decodeSamples(block.data(), length, decoded.data(), decoded.size());
+    if (got != (int)count || !sameSamples(samples.data(), decoded.data(), count)) {
+      printf("iteration %ld: %zu samples did not survive the round trip (decoded %d)\n", i, count, got);
+      failures++;
+      continue;
+    }
+
+    // one byte short of what it needs has to fail cleanly on both sides
+    if (encodeSamples(samples.data(), count, block.data(), length - 1) != 0) {
+      printf("iteration %ld: encode into a too small buffer did not fail\n", i);
+      failures++;
+    }
+    // (that overwrote the block, make it again)
+    encodeSamples(samples.data(), count, block.data(), block.size());
+    if (decodeSamples(block.data(), length - 1, decoded.data(), decoded.size()) != -1) {
+      printf("iteration %ld: truncated block was accepted\n", i);
+      failures++;
+    }
+    if (count > 0 && decodeSamples(block.data(), length, decoded.data(), count - 1) != -1) {
+      printf("iteration %ld: block bigger than the buffer was accepted\n", i);
+      failures++;
+    }
+
+    // flipped bits and plain noise: anything but a crash or overrun is fine
+    std::vector<uint8_t> mangled(block.begin(), block.begin() + length);
+    mangled[randomBetween(0, length - 1)] ^= 1 << randomBetween(0, 7);
+    decodeSamples(mangled.data(), mangled.size(), decoded.data(), decoded.size());
+
+    std::vector<uint8_t> noise(randomBetween(0, maxBlock));
+    for (uint8_t& byte : noise) byte = rng();
+    std::vector<Sample> small(randomBetween(0, 4));
+    int accepted = decodeSamples(noise.data(), noise.size(), small.data(), small.size());
+    if (accepted > (int)small.size()) {
+      printf("iteration %ld: decoder returned %d samples for a buffer of %zu\n", i, accepted, small.size());
+      failures++;
+    }
+    if (accepted >= 0) garbageAccepted++;
+  }
+
+  printf("%ld iterations, %ld failures (%ld random blocks happened to be valid)\n", iterations, failures, garbageAccepted);
+  return failures == 0 ? 0 : 1;
+}
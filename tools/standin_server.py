@@ -0,0 +1,287 @@
+#!/usr/bin/env python3
+"""
+Local stand-in for the telemetry backend, for testing nodes without the real
+server. Point a node's Server URL at http://<this machine>:4000/api.
+
+    python tools/standin_server.py
+
+It implements the two endpoints the firmware uses, /api/devices and
+/api/ingest, and prints every request.
+
+To test a delta OTA update, give it the new release and a patch made with
+tools/make_delta.py. Every node that reports a different fwVersion is then
+offered the patch:
+
+    python tools/make_delta.py v1.0.0.bin v1.1.0.bin v1.1.0.ndp
+    python tools/standin_server.py --release v1.1.0.bin --patch v1.1.0.ndp --version 1.1.0
+
+For load tests with the fleet simulator (sim/README.md) use --quiet, which
+prints a requests per second line every few seconds instead of every request.
+
+Nodes built with BINARY_INGEST=1 send packed sample blocks instead of JSON,
+they are decoded with tools/sample_codec.py and printed as JSON.
+
+Nodes built with SIGNED_INGEST=1 get a secret at registration and sign every
+ingest, which is checked with tools/ingest_auth.py. To compare that with TLS
+(the auth_bench env) it can also listen for HTTPS with a certificate of yours:
+
+    openssl req -x509 -newkey ec -pkeyopt ec_paramgen_curve:P-256 -nodes -days 365 -subj /CN=standin -keyout key.pem -out cert.pem
+    python tools/standin_server.py --tls-port 4443 --cert cert.pem --key key.pem
+
+To test fallback server URLs, run a few of them on different ports and make
+some of them slow or flaky. --delay holds every POST before answering (a
+fixed time, or a range), --fail-rate answers that share of them with a 503:
+
+    python tools/standin_server.py --port 4000 --delay 800:3000
+    python tools/standin_server.py --port 4001 --fail-rate 0.2
+
+They don't share registrations, which only matters for signed nodes (after
+a few 401s in a row those re-key, and on a server that doesn't know them at
+all that fails and they register as a new device).
+"""
+import argparse
+import hashlib
+import json
+import os
+import random
+import ssl
+import threading
+import time
+import uuid
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+import ingest_auth
+import sample_codec
+
+PREFIX = "/api"
+STATS_INTERVAL = 5  # seconds between --quiet summary lines
+
+
+class Release:
+    def __init__(self, version, image_path, patch_path):
+        with open(image_path, "rb") as f:
+            image = f.read()
+        with open(patch_path, "rb") as f:
+            self.patch = f.read()
+        self.version = version
+        self.size = len(image)
+        self.sha256 = hashlib.sha256(image).hexdigest()
+        self.name = os.path.basename(patch_path)
+
+    def advert(self):
+        return {
+            "version": self.version,
+            "url": "/firmware/" + self.name,
+            "sha256": self.sha256,
+            "size": self.size,
+        }
+
+
+class Stats:
+    """Request counts for --quiet mode."""
+
+    def __init__(self):
+        self.lock = threading.Lock()
+        self.counts = {}
+        self.handler_ms = []
+
+    def add(self, path, handler_ms):
+        with self.lock:
+            self.counts[path] = self.counts.get(path, 0) + 1
+            self.handler_ms.append(handler_ms)
+
+    def take(self):
+        with self.lock:
+            counts, handler_ms = self.counts, self.handler_ms
+            self.counts, self.handler_ms = {}, []
+        return counts, handler_ms
+
+
+def print_stats(stats):
+    while True:
+        time.sleep(STATS_INTERVAL)
+        counts, handler_ms = stats.take()
+        if not counts:
+            continue
+        handler_ms.sort()
+        total = sum(counts.values())
+        print("%.0f req/s (%s), handler p50 %.2f ms, max %.2f ms" % (
+            total / STATS_INTERVAL,
+            ", ".join("%s %d" % (path, n) for path, n in sorted(counts.items())),
+            handler_ms[len(handler_ms) // 2], handler_ms[-1]), flush=True)
+
+
+class Handler(BaseHTTPRequestHandler):
+    release = None
+    stats = None
+    delay_ms = (0, 0)  # --delay, min and max
+    fail_rate = 0.0
+    verifier = ingest_auth.Verifier()
+    protocol_version = "HTTP/1.1"
+    # headers and body go out in separate writes, without this a kept
+    # connection waits out the client's delayed ACK (~40 ms) on every answer
+    disable_nagle_algorithm = True
+
+    def log_message(self, fmt, *args):
+        pass  # we print our own, shorter lines
+
+    def log(self, text):
+        if not self.stats:
+            print("%s  %s" % (self.client_address[0], text))
+
+    def send_json(self, code, body):
+        data = json.dumps(body).encode("utf-8")
+        self.send_response(code)
+        self.send_header("Content-Type", "application/json")
+        self.send_header("Content-Length", str(len(data)))
+        self.end_headers()
+        self.wfile.write(data)
+
+    def read_body(self):
+        length = int(self.headers.get("Content-Length", 0))
+        return self.rfile.read(length) if length else b""
+
+    def do_GET(self):
+        path = self.path[len(PREFIX):] if self.path.startswith(PREFIX) else self.path
+        if self.release and path == "/firmware/" + self.release.name:
+            started = time.monotonic()
+            self.send_response(200)
+            self.send_header("Content-Type", "application/octet-stream")
+            self.send_header("Content-Length", str(len(self.release.patch)))
+            self.end_headers()
+            self.wfile.write(self.release.patch)
+            print("%s  patch %s: %d bytes in %.0f ms" % (
+                self.client_address[0], self.release.name, len(self.release.patch),
+                (time.monotonic() - started) * 1000))
+            return
+        # anything else counts as a reachability check
+        self.send_json(200, {"ok": True})
+
+    def do_POST(self):
+        started = time.monotonic()
+        body = self.read_body()
+        if self.delay_ms[1] > 0:
+            time.sleep(random.uniform(*self.delay_ms) / 1000.0)
+        if self.fail_rate and random.random() < self.fail_rate:
+            self.log("%s: injected 503" % self.path)
+            self.send_json(503, {"error": "injected failure"})
+            return
+        ingest = self.path == PREFIX + "/ingest"
+        registering = self.path == PREFIX + "/devices"
+        signed_by = None
+        try:
+            # before anything looks inside the body
+            if (ingest or registering) and self.headers.get("Authorization"):
+                signed_by = self.verifier.check_signature(self.headers.get("Authorization"), body)
+        except ingest_auth.AuthError as e:
+            self.log("ingest turned down: %s" % e)
+            self.send_json(e.code, e.body)
+            return
+        try:
+            if self.headers.get("Content-Type") == sample_codec.CONTENT_TYPE:
+                doc = sample_codec.decode_ingest(body)
+            else:
+                doc = json.loads(body or b"{}")
+        except sample_codec.DecodeError as e:
+            self.send_json(400, {"error": "bad sample block: %s" % e})
+            return
+        except ValueError:
+            self.send_json(400, {"error": "bad json"})
+            return
+
+        if registering:
+            device_id = doc.get("deviceId")
+            if device_id:
+                # re-key: a new secret for an id, only for whoever holds the old one
+                try:
+                    if signed_by != device_id:
+                        raise ingest_auth.AuthError(401, "re-key not signed by the device")
+                    self.verifier.accept_counter(signed_by, doc)
+                except ingest_auth.AuthError as e:
+                    self.log("re-key turned down: %s" % e)
+                    self.send_json(e.code, e.body)
+                    return
+                self.log("re-key %s" % device_id)
+            else:
+                device_id = uuid.uuid4().hex[:25]
+                self.log("register %r -> %s" % (doc.get("name"), device_id))
+            response = dict(doc, id=device_id)
+            response.pop("counter", None)
+            if doc.get("auth") == ingest_auth.SCHEME:
+                response["secret"] = self.verifier.provision(device_id)
+            self.send_json(201, response)
+        elif ingest:
+            try:
+                if signed_by:
+                    self.verifier.accept_counter(signed_by, doc)
+                elif self.verifier.is_signed(doc.get("deviceId")):
+                    raise ingest_auth.AuthError(401, "unsigned ingest from a signed device")
+            except ingest_auth.AuthError as e:
+                self.log("ingest turned down: %s" % e)
+                self.send_json(e.code, e.body)
+                return
+            self.log("ingest %s%s" % ("(signed) " if signed_by else "", json.dumps(doc)))
+            response = {}
+            if self.release and doc.get("fwVersion") != self.release.version:
+                response["firmware"] = self.release.advert()
+                self.log("offering firmware %s" % self.release.version)
+            self.send_json(200, response)
+        else:
+            self.send_json(404, {"error": "not found"})
+
+        if self.stats:
+            self.stats.add(self.path[len(PREFIX):], (time.monotonic() - started) * 1000)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Stand-in telemetry server.")
+    parser.add_argument("--port", type=int, default=4000)
+    parser.add_argument("--version", help="firmware version to offer")
+    parser.add_argument("--release", help="the complete new firmware .bin")
+    parser.add_argument("--patch", help="delta patch from tools/make_delta.py")
+    parser.add_argument("--quiet", action="store_true", help="print request rates instead of every request")
+    parser.add_argument("--tls-port", type=int, help="also serve HTTPS on this port")
+    parser.add_argument("--cert", help="certificate (PEM) for --tls-port")
+    parser.add_argument("--key", help="its private key (PEM)")
+    parser.add_argument("--delay", metavar="MS[:MAX]", help="hold every POST this long (or between MS and MAX) before answering")
+    parser.add_argument("--fail-rate", type=float, default=0.0, help="answer this share of POSTs with a 503")
+    args = parser.parse_args()
+    if args.tls_port and not (args.cert and args.key):
+        parser.error("--tls-port needs --cert and --key")
+
+    if args.version or args.release or args.patch:
+        if not (args.version and args.release and args.patch):
+            parser.error("--version, --release and --patch go together")
+        Handler.release = Release(args.version, args.release, args.patch)
+        print("offering %s: image %d bytes, patch %d bytes (%.1f%%)" % (
+            args.version, Handler.release.size, len(Handler.release.patch),
+            100.0 * len(Handler.release.patch) / Handler.release.size))
+
+    if args.delay:
+        low, _, high = args.delay.partition(":")
+        Handler.delay_ms = (float(low), float(high or low))
+    Handler.fail_rate = args.fail_rate
+
+    if args.quiet:
+        Handler.stats = Stats()
+        threading.Thread(target=print_stats, args=(Handler.stats,), daemon=True).start()
+
+    ThreadingHTTPServer.request_queue_size = 128  # a fleet connects all at once
+    server = ThreadingHTTPServer(("", args.port), Handler)
+    print("listening on http://0.0.0.0:%d%s" % (args.port, PREFIX))
+    if args.tls_port:
+        context = ssl.SSLContext(ssl.PROTOCOL_TLS_SERVER)
+        context.load_cert_chain(args.cert, args.key)
+        tls_server = ThreadingHTTPServer(("", args.tls_port), Handler)
+        # the handshake happens in the request's thread, not in accept()
+        tls_server.socket = context.wrap_socket(tls_server.socket, server_side=True, do_handshake_on_connect=False)
+        threading.Thread(target=tls_server.serve_forever, daemon=True).start()
+        print("listening on https://0.0.0.0:%d%s" % (args.tls_port, PREFIX))
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == "__main__":
+    main()
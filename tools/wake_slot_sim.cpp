@@ -0,0 +1,92 @@
+// Simulates a fleet of nodes that were all powered on together (e.g. after a
+// power cut) and prints how many /ingest requests arrive per second, with
+// plain interval sleep and with wake slots (src/WakeSlot.cpp, the same code
+// the firmware runs).
+//
+//    g++ -O2 -Iinclude tools/wake_slot_sim.cpp src/WakeSlot.cpp -o wake_slot_sim
+//    ./wake_slot_sim [nodes] [interval s] [hours]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <random>
+#include <vector>
+#include <algorithm>
+#include "WakeSlot.h"
+
+struct Node {
+  char deviceId[33];
+  double clockRate;   // node seconds per real second, the RTC is off by a few %
+  double bootDelay;   // power on to first upload
+  double awakeTime;   // wake to upload
+};
+
+struct Stats {
+  int maxPerSecond;
+  double p99PerSecond;
+  int busySeconds; // seconds with more than 1% of the fleet arriving
+};
+
+static Stats simulate(const std::vector<Node>& nodes, uint32_t intervalMs, double hours, bool slotted, std::mt19937& rng) {
+  const int seconds = (int)(hours * 3600);
+  std::vector<int> arrivals(seconds + 1, 0);
+
+  for (const Node& node : nodes) {
+    uint32_t hash = wakeSlotHash(node.deviceId);
+    uint32_t maxJitter = wakeSlotMaxJitterMs(intervalMs);
+    std::uniform_int_distribution<int32_t> jitter(-(int32_t)maxJitter, (int32_t)maxJitter);
+
+    double now = node.bootDelay; // real seconds, this is when the upload lands
+    while (now < seconds) {
+      arrivals[(int)now]++;
+
+      // node's own clock since power on (no time sync yet, the worst case)
+      uint64_t clockMs = (uint64_t)(now * node.clockRate * 1000);
+      uint32_t sleepMs = intervalMs;
+      if (slotted) {
+        uint32_t phase = wakeSlotPhaseMs(hash, intervalMs, 0);
+        sleepMs = slottedSleepMs(clockMs, intervalMs, phase, intervalMs / 2, jitter(rng));
+      }
+      // sleep is measured on the node's clock, then it boots and sends again
+      now += sleepMs / 1000.0 / node.clockRate + node.awakeTime;
+    }
+  }
+
+  Stats stats = { 0, 0, 0 };
+  std::vector<int> sorted(arrivals.begin(), arrivals.end());
+  std::sort(sorted.begin(), sorted.end());
+  stats.maxPerSecond = sorted.back();
+  stats.p99PerSecond = sorted[(size_t)(sorted.size() * 0.99)];
+  for (int count : arrivals) {
+    if (count > (int)nodes.size() / 100) stats.busySeconds++;
+  }
+  return stats;
+}
+
+int main(int argc, char** argv) {
+  int count = argc > 1 ? atoi(argv[1]) : 1000;
+  uint32_t intervalMs = (argc > 2 ? atoi(argv[2]) : 300) * 1000;
+  double hours = argc > 3 ? atof(argv[3]) : 24;
+
+  std::mt19937 rng(42);
+  std::uniform_real_distribution<double> rate(0.98, 1.02);
+  std::uniform_real_distribution<double> boot(1.0, 3.0);
+  std::uniform_real_distribution<double> awake(2.0, 4.0);
+
+  std::vector<Node> nodes(count);
+  for (int i = 0; i < count; i++) {
+    snprintf(nodes[i].deviceId, sizeof(nodes[i].deviceId), "%08x%08x", (unsigned)rng(), (unsigned)rng());
+    nodes[i].clockRate = rate(rng);
+    nodes[i].bootDelay = boot(rng);
+    nodes[i].awakeTime = awake(rng);
+  }
+
+  printf("%d nodes, %u s interval, %.0f h, all powered on at t=0\n", count, intervalMs / 1000, hours);
+  printf("ideal spread: %.1f requests/s\n\n", count * 1000.0 / intervalMs);
+  printf("%-10s %12s %12s %14s\n", "", "max req/s", "p99 req/s", "busy seconds");
+  Stats before = simulate(nodes, intervalMs, hours, false, rng);
+  printf("%-10s %12d %12.0f %14d\n", "interval", before.maxPerSecond, before.p99PerSecond, before.busySeconds);
+  Stats after = simulate(nodes, intervalMs, hours, true, rng);
+  printf("%-10s %12d %12.0f %14d\n", "slotted", after.maxPerSecond, after.p99PerSecond, after.busySeconds);
+  return 0;
+}